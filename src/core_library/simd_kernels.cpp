@@ -0,0 +1,126 @@
+#include <core_library/simd_kernels.hpp>
+
+namespace simd {
+
+namespace scalar {
+extern const kernels_t kernels;
+}
+
+#ifdef CORE_LIBRARY_SIMD_X86
+namespace sse4 {
+extern const kernels_t kernels;
+}
+namespace avx2 {
+extern const kernels_t kernels;
+}
+namespace avx512 {
+extern const kernels_t kernels;
+}
+#endif
+
+namespace {
+
+instruction_set_t detect_instruction_set() {
+#ifdef CORE_LIBRARY_SIMD_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512vl"))
+    return instruction_set_t::AVX512;
+  if (__builtin_cpu_supports("avx2")) return instruction_set_t::AVX2;
+  if (__builtin_cpu_supports("sse4.1")) return instruction_set_t::SSE4;
+#endif
+
+  return instruction_set_t::SCALAR;
+}
+
+}  // namespace
+
+const kernels_t& kernels_for(instruction_set_t instruction_set) {
+  switch (instruction_set) {
+#ifdef CORE_LIBRARY_SIMD_X86
+    case instruction_set_t::AVX512:
+      return avx512::kernels;
+    case instruction_set_t::AVX2:
+      return avx2::kernels;
+    case instruction_set_t::SSE4:
+      return sse4::kernels;
+#endif
+    default:
+      return scalar::kernels;
+  }
+}
+
+namespace {
+
+const kernels_t& kernels() {
+  static const kernels_t& kernels = kernels_for(instruction_set());
+  return kernels;
+}
+
+}  // namespace
+
+instruction_set_t instruction_set() {
+  static const instruction_set_t instruction_set = detect_instruction_set();
+  return instruction_set;
+}
+
+// Every instruction set includes the ones before it
+bool is_supported(instruction_set_t instruction_set) {
+  return instruction_set <= simd::instruction_set();
+}
+
+const char* instruction_set_name(instruction_set_t instruction_set) {
+  switch (instruction_set) {
+    case instruction_set_t::SCALAR:
+      return "scalar";
+    case instruction_set_t::SSE4:
+      return "SSE4.1";
+    case instruction_set_t::AVX2:
+      return "AVX2";
+    case instruction_set_t::AVX512:
+      return "AVX-512";
+  }
+  return "";
+}
+
+void extend_bounds(const uint8_t* data, size_t stride, size_t count,
+                   glm::vec3* min_point, glm::vec3* max_point) {
+  float min_values[3] = {min_point->x, min_point->y, min_point->z};
+  float max_values[3] = {max_point->x, max_point->y, max_point->z};
+
+  kernels().extend_bounds(data, stride, count, min_values, max_values);
+
+  *min_point = glm::vec3(min_values[0], min_values[1], min_values[2]);
+  *max_point = glm::vec3(max_values[0], max_values[1], max_values[2]);
+}
+
+void convert(value_type_t source_type, const uint8_t* source,
+             size_t source_stride, value_type_t target_type, uint8_t* target,
+             size_t target_stride, size_t count, bool normalized) {
+  kernels().convert(source_type, source, source_stride, target_type, target,
+                    target_stride, count, normalized);
+}
+
+void transform(const glm::mat4& transformation, const uint8_t* source,
+               size_t source_stride, uint8_t* target, size_t target_stride,
+               size_t count) {
+  float matrix[12];
+  for (int column = 0; column < 4; ++column)
+    for (int row = 0; row < 3; ++row)
+      matrix[column * 3 + row] = transformation[column][row];
+
+  kernels().transform(matrix, source, source_stride, target, target_stride,
+                      count);
+}
+
+void masked_fill(uint8_t* target, size_t stride, size_t count,
+                 const uint8_t* value, const uint8_t* mask, size_t size) {
+  kernels().masked_fill(target, stride, count, value, mask, size);
+}
+
+void flip_rows(uint8_t* data, size_t bytes_per_row, size_t num_rows) {
+  kernels().flip_rows(data, bytes_per_row, num_rows);
+}
+
+}  // namespace simd
@@ -0,0 +1,99 @@
+#ifndef CORELIBRARY_SIMD_KERNELS_HPP_
+#define CORELIBRARY_SIMD_KERNELS_HPP_
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+Kernels for bulk operations on point buffers.
+
+Every kernel is compiled once per instruction set (scalar, SSE4, AVX2 and
+AVX-512 on x86) and the best one supported by the cpu is chosen at runtime.
+The values are accessed with a stride in bytes, so the kernels work directly
+on the interleaved vertex and user data buffers.
+*/
+
+namespace simd {
+
+enum class instruction_set_t {
+  SCALAR,
+  SSE4,
+  AVX2,
+  AVX512,
+};
+
+// The instruction set used by the kernels
+instruction_set_t instruction_set();
+const char* instruction_set_name(instruction_set_t instruction_set);
+
+// Same values as data_type::base_type_t
+enum class value_type_t : uint8_t {
+  INT8 = 0,
+  INT16 = 1,
+  INT32 = 2,
+  UINT8 = 4,
+  UINT16 = 5,
+  UINT32 = 6,
+  FLOAT32 = 8,
+  FLOAT64 = 9,
+};
+
+// Extends the bounds by the vec3 of floats at data + i * stride. Nan
+// coordinates are ignored.
+void extend_bounds(const uint8_t* data, size_t stride, size_t count,
+                   glm::vec3* min_point, glm::vec3* max_point);
+
+// Converts the values at source + i * source_stride to target + i *
+// target_stride. Normalized conversions map the integers to [0, 1] (or
+// [-1, 1] if signed) like convert_component::convert_normalized, absolute
+// conversions round and clamp the values to the target type.
+void convert(value_type_t source_type, const uint8_t* source,
+             size_t source_stride, value_type_t target_type, uint8_t* target,
+             size_t target_stride, size_t count, bool normalized);
+
+// Writes transformation * vec4(source, 1) for the vec3 of floats at source +
+// i * source_stride to target + i * target_stride. Source and target may be
+// the same.
+void transform(const glm::mat4& transformation, const uint8_t* source,
+               size_t source_stride, uint8_t* target, size_t target_stride,
+               size_t count);
+
+// Overwrites the first size bytes at target + i * stride with value, but
+// only the bytes where mask is not zero
+void masked_fill(uint8_t* target, size_t stride, size_t count,
+                 const uint8_t* value, const uint8_t* mask, size_t size);
+
+// Reverses the order of the rows of bytes_per_row bytes
+void flip_rows(uint8_t* data, size_t bytes_per_row, size_t num_rows);
+
+/*
+The kernels of one instruction set. glm types are passed as plain floats, as
+the kernels can't share any inline functions with the code compiled for the
+baseline instruction set.
+*/
+struct kernels_t {
+  void (*extend_bounds)(const uint8_t* data, size_t stride, size_t count,
+                        float* min_point, float* max_point);
+  void (*convert)(value_type_t source_type, const uint8_t* source,
+                  size_t source_stride, value_type_t target_type,
+                  uint8_t* target, size_t target_stride, size_t count,
+                  bool normalized);
+  // matrix is a column major 4x3 matrix
+  void (*transform)(const float* matrix, const uint8_t* source,
+                    size_t source_stride, uint8_t* target,
+                    size_t target_stride, size_t count);
+  void (*masked_fill)(uint8_t* target, size_t stride, size_t count,
+                      const uint8_t* value, const uint8_t* mask, size_t size);
+  void (*flip_rows)(uint8_t* data, size_t bytes_per_row, size_t num_rows);
+};
+
+// Whether the kernels of the instruction set can run on this cpu
+bool is_supported(instruction_set_t instruction_set);
+// The kernels of a supported instruction set, e.g. for comparing them
+const kernels_t& kernels_for(instruction_set_t instruction_set);
+
+}  // namespace simd
+
+#endif  // CORELIBRARY_SIMD_KERNELS_HPP_
@@ -0,0 +1,6 @@
+// Compiled with the flags for AVX2 (see CMakeLists.txt)
+#ifdef CORE_LIBRARY_SIMD_X86
+#define SIMD_KERNELS_NAMESPACE avx2
+#define SIMD_KERNELS_VECTOR_SIZE 32
+#include <core_library/simd_kernels_impl.inl>
+#endif
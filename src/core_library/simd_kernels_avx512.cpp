@@ -0,0 +1,6 @@
+// Compiled with the flags for AVX-512 (see CMakeLists.txt)
+#ifdef CORE_LIBRARY_SIMD_X86
+#define SIMD_KERNELS_NAMESPACE avx512
+#define SIMD_KERNELS_VECTOR_SIZE 64
+#include <core_library/simd_kernels_impl.inl>
+#endif
@@ -0,0 +1,439 @@
+#include <core_library/simd_kernels.hpp>
+
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+/*
+The kernel bodies, included by the simd_kernels_*.cpp files with
+SIMD_KERNELS_NAMESPACE and SIMD_KERNELS_VECTOR_SIZE (in bytes) defined. The
+reductions and byte operations on vertices use intrinsics of the instruction
+set the file is compiled for. The other kernels copy chunks of strided
+values into arrays, whose loops the compiler vectorizes.
+
+Everything here has internal linkage. An inline function of another header
+could be emitted by several of the files and the linker might keep the copy
+using the most advanced instruction set. So only builtins like memcpy and
+constant expressions of the standard library are used.
+*/
+
+namespace simd {
+namespace SIMD_KERNELS_NAMESPACE {
+
+extern const kernels_t kernels;
+
+namespace {
+
+// Number of floats processed at once
+const size_t vector_floats = SIMD_KERNELS_VECTOR_SIZE / sizeof(float);
+
+template <typename T>
+T load(const uint8_t* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+template <typename T>
+void store(uint8_t* data, T value) {
+  std::memcpy(data, &value, sizeof(T));
+}
+
+// ==== extend_bounds ====
+
+// Vertices of 16 bytes: four floats at once, the fourth one isn't a
+// coordinate and its bounds are dropped
+void extend_bounds_of_vertices(const uint8_t* data, size_t count,
+                               float* min_point, float* max_point) {
+  const size_t lanes = vector_floats < 4 ? 4 : vector_floats;
+  const size_t points_per_step = lanes / 4;
+
+  float min_values[lanes];
+  float max_values[lanes];
+  for (size_t j = 0; j < lanes; ++j) {
+    min_values[j] = j % 4 < 3 ? min_point[j % 4] : 0.f;
+    max_values[j] = j % 4 < 3 ? max_point[j % 4] : 0.f;
+  }
+
+  size_t i = 0;
+#if defined(__AVX512F__)
+  __m512 min_vector = _mm512_loadu_ps(min_values);
+  __m512 max_vector = _mm512_loadu_ps(max_values);
+  for (; i + points_per_step <= count; i += points_per_step) {
+    // a nan value keeps the previous bound
+    const __m512 value =
+        _mm512_loadu_ps(reinterpret_cast<const float*>(data + i * 16));
+    min_vector = _mm512_min_ps(value, min_vector);
+    max_vector = _mm512_max_ps(value, max_vector);
+  }
+  _mm512_storeu_ps(min_values, min_vector);
+  _mm512_storeu_ps(max_values, max_vector);
+#elif defined(__AVX__)
+  __m256 min_vector = _mm256_loadu_ps(min_values);
+  __m256 max_vector = _mm256_loadu_ps(max_values);
+  for (; i + points_per_step <= count; i += points_per_step) {
+    const __m256 value =
+        _mm256_loadu_ps(reinterpret_cast<const float*>(data + i * 16));
+    min_vector = _mm256_min_ps(value, min_vector);
+    max_vector = _mm256_max_ps(value, max_vector);
+  }
+  _mm256_storeu_ps(min_values, min_vector);
+  _mm256_storeu_ps(max_values, max_vector);
+#elif defined(__SSE4_1__)
+  __m128 min_vector = _mm_loadu_ps(min_values);
+  __m128 max_vector = _mm_loadu_ps(max_values);
+  for (; i + points_per_step <= count; i += points_per_step) {
+    const __m128 value =
+        _mm_loadu_ps(reinterpret_cast<const float*>(data + i * 16));
+    min_vector = _mm_min_ps(value, min_vector);
+    max_vector = _mm_max_ps(value, max_vector);
+  }
+  _mm_storeu_ps(min_values, min_vector);
+  _mm_storeu_ps(max_values, max_vector);
+#else
+  for (; i + points_per_step <= count; i += points_per_step) {
+    const uint8_t* step = data + i * 16;
+    for (size_t j = 0; j < lanes; ++j) {
+      const float value = load<float>(step + j * sizeof(float));
+      min_values[j] = value < min_values[j] ? value : min_values[j];
+      max_values[j] = value > max_values[j] ? value : max_values[j];
+    }
+  }
+#endif
+
+  for (; i < count; ++i)
+    for (size_t j = 0; j < 3; ++j) {
+      const float value = load<float>(data + i * 16 + j * sizeof(float));
+      min_values[j] = value < min_values[j] ? value : min_values[j];
+      max_values[j] = value > max_values[j] ? value : max_values[j];
+    }
+
+  for (size_t j = 0; j < lanes; ++j) {
+    if (j % 4 == 3) continue;
+    const float min_value = min_values[j];
+    const float max_value = max_values[j];
+    min_point[j % 4] =
+        min_value < min_point[j % 4] ? min_value : min_point[j % 4];
+    max_point[j % 4] =
+        max_value > max_point[j % 4] ? max_value : max_point[j % 4];
+  }
+}
+
+void extend_bounds(const uint8_t* data, size_t stride, size_t count,
+                   float* min_point, float* max_point) {
+  if (stride == 16) {
+    extend_bounds_of_vertices(data, count, min_point, max_point);
+    return;
+  }
+
+  for (size_t j = 0; j < 3; ++j) {
+    float min_value = min_point[j];
+    float max_value = max_point[j];
+
+    for (size_t i = 0; i < count; ++i) {
+      const float value = load<float>(data + i * stride + j * sizeof(float));
+      min_value = value < min_value ? value : min_value;
+      max_value = value > max_value ? value : max_value;
+    }
+
+    min_point[j] = min_value;
+    max_point[j] = max_value;
+  }
+}
+
+// ==== convert ====
+
+template <typename function_t>
+void visit_value_type(value_type_t type, const function_t& function) {
+  switch (type) {
+    case value_type_t::INT8:
+      function(int8_t());
+      return;
+    case value_type_t::INT16:
+      function(int16_t());
+      return;
+    case value_type_t::INT32:
+      function(int32_t());
+      return;
+    case value_type_t::UINT8:
+      function(uint8_t());
+      return;
+    case value_type_t::UINT16:
+      function(uint16_t());
+      return;
+    case value_type_t::UINT32:
+      function(uint32_t());
+      return;
+    case value_type_t::FLOAT32:
+      function(float());
+      return;
+    case value_type_t::FLOAT64:
+      function(double());
+      return;
+  }
+}
+
+// The float type used for normalizing, like float_type in convert_values.hpp
+template <typename T>
+using float_for_t =
+    typename std::conditional<sizeof(T) == 8, double, float>::type;
+
+// Rounds half away from zero (like glm::round) and clamps to the range of T.
+// Nan becomes zero.
+template <typename T, typename float_t>
+T round_to(float_t value) {
+  value = value == value ? value : float_t(0);
+
+  // The bounds of small types are exact floats, so they are clamped before
+  // rounding, which keeps the integers (and vectors) 32 bit
+  if constexpr (sizeof(T) <= 2) {
+    constexpr float_t min = float_t(std::numeric_limits<T>::min());
+    constexpr float_t max = float_t(std::numeric_limits<T>::max());
+
+    value = value < min ? min : value > max ? max : value;
+
+    const int32_t integer = int32_t(value);
+    const float_t rest = value - float_t(integer);
+    return T(integer +
+             (rest >= float_t(0.5) ? 1 : rest <= float_t(-0.5) ? -1 : 0));
+  } else {
+    constexpr float_t limit = float_t(int64_t(1) << 62);
+    constexpr int64_t min = int64_t(std::numeric_limits<T>::min());
+    constexpr int64_t max = int64_t(std::numeric_limits<T>::max());
+
+    value = value < -limit ? -limit : value > limit ? limit : value;
+
+    int64_t integer = int64_t(value);
+    const float_t rest = value - float_t(integer);
+    integer += rest >= float_t(0.5) ? 1 : rest <= float_t(-0.5) ? -1 : 0;
+
+    return T(integer < min ? min : integer > max ? max : integer);
+  }
+}
+
+template <typename T>
+float_for_t<T> to_normalized(T value) {
+  typedef float_for_t<T> float_t;
+  constexpr float_t min = float_t(std::numeric_limits<T>::min());
+  constexpr float_t max = float_t(std::numeric_limits<T>::max());
+
+  if constexpr (std::is_floating_point<T>::value)
+    return value;
+  else if constexpr (std::is_signed<T>::value)
+    return value >= 0 ? float_t(value) / max : -float_t(value) / min;
+  else
+    return float_t(value) / max;
+}
+
+template <typename T>
+T from_normalized(float_for_t<T> value) {
+  typedef float_for_t<T> float_t;
+  constexpr float_t min = float_t(std::numeric_limits<T>::min());
+  constexpr float_t max = float_t(std::numeric_limits<T>::max());
+
+  if constexpr (std::is_floating_point<T>::value)
+    return value;
+  else if constexpr (std::is_signed<T>::value)
+    return round_to<T>(value >= 0 ? value * max : -value * min);
+  else
+    return round_to<T>(value * max);
+}
+
+template <typename t_in, typename t_out>
+t_out convert_absolute(t_in value) {
+  if constexpr (!std::is_floating_point<t_out>::value) {
+    if constexpr (std::is_floating_point<t_in>::value) {
+      return round_to<t_out>(value);
+    } else {
+      constexpr int64_t min = int64_t(std::numeric_limits<t_out>::min());
+      constexpr int64_t max = int64_t(std::numeric_limits<t_out>::max());
+      const int64_t integer = int64_t(value);
+      return t_out(integer < min ? min : integer > max ? max : integer);
+    }
+  } else if constexpr (sizeof(t_out) < sizeof(t_in)) {
+    constexpr t_in max = t_in(std::numeric_limits<t_out>::max());
+    return t_out(value < -max ? -max : value > max ? max : value);
+  } else {
+    return t_out(value);
+  }
+}
+
+// Number of values converted at once in arrays on the stack
+const size_t chunk_size = 256;
+
+// The strided values are gathered into an array, converted in a vectorized
+// loop and scattered to the target
+template <typename t_in, typename t_out, bool normalized>
+void convert_values(const uint8_t* source, size_t source_stride,
+                    uint8_t* target, size_t target_stride, size_t count) {
+  t_in in_values[chunk_size];
+  t_out out_values[chunk_size];
+
+  for (size_t first = 0; first < count; first += chunk_size) {
+    const size_t n = count - first < chunk_size ? count - first : chunk_size;
+
+    for (size_t i = 0; i < n; ++i)
+      in_values[i] = load<t_in>(source + (first + i) * source_stride);
+
+    for (size_t i = 0; i < n; ++i)
+      if constexpr (normalized)
+        out_values[i] = from_normalized<t_out>(
+            float_for_t<t_out>(to_normalized(in_values[i])));
+      else
+        out_values[i] = convert_absolute<t_in, t_out>(in_values[i]);
+
+    for (size_t i = 0; i < n; ++i)
+      store(target + (first + i) * target_stride, out_values[i]);
+  }
+}
+
+template <typename T>
+void copy_values(const uint8_t* source, size_t source_stride, uint8_t* target,
+                 size_t target_stride, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    store(target + i * target_stride, load<T>(source + i * source_stride));
+}
+
+void convert(value_type_t source_type, const uint8_t* source,
+             size_t source_stride, value_type_t target_type, uint8_t* target,
+             size_t target_stride, size_t count, bool normalized) {
+  visit_value_type(source_type, [&](auto source_value) {
+    visit_value_type(target_type, [&](auto target_value) {
+      typedef decltype(source_value) t_in;
+      typedef decltype(target_value) t_out;
+
+      if constexpr (std::is_same<t_in, t_out>::value)
+        copy_values<t_in>(source, source_stride, target, target_stride,
+                          count);
+      else if (normalized)
+        convert_values<t_in, t_out, true>(source, source_stride, target,
+                                          target_stride, count);
+      else
+        convert_values<t_in, t_out, false>(source, source_stride, target,
+                                           target_stride, count);
+    });
+  });
+}
+
+// ==== transform ====
+
+void transform(const float* matrix, const uint8_t* source,
+               size_t source_stride, uint8_t* target, size_t target_stride,
+               size_t count) {
+  float coordinates[3][chunk_size];
+
+  for (size_t first = 0; first < count; first += chunk_size) {
+    const size_t n = count - first < chunk_size ? count - first : chunk_size;
+
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; j < 3; ++j)
+        coordinates[j][i] = load<float>(source + (first + i) * source_stride +
+                                        j * sizeof(float));
+
+    for (size_t i = 0; i < n; ++i) {
+      const float x = coordinates[0][i];
+      const float y = coordinates[1][i];
+      const float z = coordinates[2][i];
+      for (size_t j = 0; j < 3; ++j)
+        coordinates[j][i] = matrix[j] * x + matrix[3 + j] * y +
+                            matrix[6 + j] * z + matrix[9 + j];
+    }
+
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; j < 3; ++j)
+        store(target + (first + i) * target_stride + j * sizeof(float),
+              coordinates[j][i]);
+  }
+}
+
+// ==== masked_fill ====
+
+// Values of 16 bytes next to each other, e.g. vertices
+void masked_fill_vertices(uint8_t* target, size_t count,
+                          const uint8_t* value, const uint8_t* mask) {
+  uint8_t bits[16];
+  uint8_t keep[16];
+  for (size_t j = 0; j < 16; ++j) {
+    keep[j] = mask[j] != 0 ? 0x00 : 0xff;
+    bits[j] = value[j] & uint8_t(~keep[j]);
+  }
+
+  size_t i = 0;
+#if defined(__AVX512F__)
+  const __m512i keep_vector = _mm512_broadcast_i32x4(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(keep)));
+  const __m512i bits_vector = _mm512_broadcast_i32x4(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(bits)));
+  for (; i + 4 <= count; i += 4) {
+    void* vertices = target + i * 16;
+    const __m512i kept =
+        _mm512_and_si512(_mm512_loadu_si512(vertices), keep_vector);
+    _mm512_storeu_si512(vertices, _mm512_or_si512(kept, bits_vector));
+  }
+#elif defined(__AVX2__)
+  const __m256i keep_vector = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(keep)));
+  const __m256i bits_vector = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(bits)));
+  for (; i + 2 <= count; i += 2) {
+    __m256i* vertices = reinterpret_cast<__m256i*>(target + i * 16);
+    const __m256i kept =
+        _mm256_and_si256(_mm256_loadu_si256(vertices), keep_vector);
+    _mm256_storeu_si256(vertices, _mm256_or_si256(kept, bits_vector));
+  }
+#elif defined(__SSE4_1__)
+  const __m128i keep_vector =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(keep));
+  const __m128i bits_vector =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(bits));
+  for (; i < count; ++i) {
+    __m128i* vertex = reinterpret_cast<__m128i*>(target + i * 16);
+    const __m128i kept = _mm_and_si128(_mm_loadu_si128(vertex), keep_vector);
+    _mm_storeu_si128(vertex, _mm_or_si128(kept, bits_vector));
+  }
+#endif
+
+  for (; i < count; ++i)
+    for (size_t j = 0; j < 16; ++j)
+      target[i * 16 + j] = uint8_t((target[i * 16 + j] & keep[j]) | bits[j]);
+}
+
+void masked_fill(uint8_t* target, size_t stride, size_t count,
+                 const uint8_t* value, const uint8_t* mask, size_t size) {
+  if (size == 16 && stride == 16) {
+    masked_fill_vertices(target, count, value, mask);
+    return;
+  }
+
+  for (size_t j = 0; j < size; ++j) {
+    if (mask[j] == 0) continue;
+    const uint8_t byte = value[j];
+    for (size_t i = 0; i < count; ++i) target[i * stride + j] = byte;
+  }
+}
+
+// ==== flip_rows ====
+
+void flip_rows(uint8_t* data, size_t bytes_per_row, size_t num_rows) {
+  for (size_t y = 0; y < num_rows / 2; ++y) {
+    uint8_t* __restrict a = data + y * bytes_per_row;
+    uint8_t* __restrict b = data + (num_rows - 1 - y) * bytes_per_row;
+    for (size_t x = 0; x < bytes_per_row; ++x) {
+      const uint8_t byte = a[x];
+      a[x] = b[x];
+      b[x] = byte;
+    }
+  }
+}
+
+}  // namespace
+
+const kernels_t kernels = {extend_bounds, convert, transform, masked_fill,
+                           flip_rows};
+
+}  // namespace SIMD_KERNELS_NAMESPACE
+}  // namespace simd
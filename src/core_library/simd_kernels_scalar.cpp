@@ -0,0 +1,4 @@
+// The kernels for the baseline instruction set of the build
+#define SIMD_KERNELS_NAMESPACE scalar
+#define SIMD_KERNELS_VECTOR_SIZE 16
+#include <core_library/simd_kernels_impl.inl>
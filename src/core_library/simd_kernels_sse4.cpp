@@ -0,0 +1,6 @@
+// Compiled with the flags for SSE4.1 (see CMakeLists.txt)
+#ifdef CORE_LIBRARY_SIMD_X86
+#define SIMD_KERNELS_NAMESPACE sse4
+#define SIMD_KERNELS_VECTOR_SIZE 16
+#include <core_library/simd_kernels_impl.inl>
+#endif
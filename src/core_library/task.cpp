@@ -0,0 +1,24 @@
+#include <core_library/task.hpp>
+
+#include <glm/glm.hpp>
+
+cancellation_token_t::cancellation_token_t()
+    : canceled(std::make_shared<std::atomic<bool>>(false)) {}
+
+void cancellation_token_t::cancel() const { *canceled = true; }
+
+bool cancellation_token_t::is_canceled() const { return *canceled; }
+
+progress_counter_t::progress_counter_t()
+    : _value(std::make_shared<std::atomic<int>>(0)) {}
+
+void progress_counter_t::set(int64_t current, int64_t total) const {
+  const double progress = double(current) / double(glm::max<int64_t>(1, total));
+  *_value = glm::clamp(int(progress * max() + 0.5), 0, max());
+}
+
+int progress_counter_t::value() const { return *_value; }
+
+task_handle_t::~task_handle_t() {}
+
+void task_handle_t::cancel() const { cancellation_token.cancel(); }
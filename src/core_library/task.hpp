@@ -0,0 +1,84 @@
+#ifndef CORELIBRARY_TASK_HPP_
+#define CORELIBRARY_TASK_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+
+/*
+A task runs a function in its own thread and returns the result through a
+future.
+
+The function reports its progress to an atomic counter, which the owner polls
+(e.g. on a timer of the gui), and regularly checks its cancellation token. So
+neither side needs an event loop and any number of tasks can run at once.
+
+    task_t<size_t> task = run_task([](progress_counter_t progress,
+                                      cancellation_token_t canceled) {
+      ...
+      return num_points;
+    });
+*/
+
+// Shared by a task and its owner. Canceling is a request, the task decides
+// when to stop.
+class cancellation_token_t {
+ public:
+  cancellation_token_t();
+
+  void cancel() const;
+  bool is_canceled() const;
+
+ private:
+  std::shared_ptr<std::atomic<bool>> canceled;
+};
+
+// The progress of a task in [0, max()], which can be set from any thread
+class progress_counter_t {
+ public:
+  constexpr static int max() { return 65536; }
+
+  progress_counter_t();
+
+  void set(int64_t current, int64_t total) const;
+  int value() const;
+
+ private:
+  std::shared_ptr<std::atomic<int>> _value;
+};
+
+// The part of a task not depending on its result
+class task_handle_t {
+ public:
+  progress_counter_t progress;
+  cancellation_token_t cancellation_token;
+
+  virtual ~task_handle_t();
+
+  void cancel() const;
+
+  // Whether the result can be taken without blocking
+  virtual bool is_finished() const = 0;
+};
+
+template <typename result_t>
+class task_t final : public task_handle_t {
+ public:
+  // Destroying the future waits for the task
+  std::future<result_t> future;
+
+  bool is_finished() const override;
+
+  // Waits for the result (rethrows the exception thrown by the task)
+  result_t get();
+};
+
+// Calls function(progress, cancellation_token) in a new thread
+template <typename function_t>
+auto run_task(function_t function)
+    -> task_t<decltype(function(progress_counter_t(), cancellation_token_t()))>;
+
+#include <core_library/task.inl>
+
+#endif  // CORELIBRARY_TASK_HPP_
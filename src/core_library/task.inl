@@ -0,0 +1,27 @@
+#include <core_library/task.hpp>
+
+#include <chrono>
+
+template <typename result_t>
+bool task_t<result_t>::is_finished() const {
+  return future.valid() && future.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready;
+}
+
+template <typename result_t>
+result_t task_t<result_t>::get() {
+  return future.get();
+}
+
+template <typename function_t>
+auto run_task(function_t function)
+    -> task_t<decltype(function(progress_counter_t(),
+                                cancellation_token_t()))> {
+  task_t<decltype(function(progress_counter_t(), cancellation_token_t()))>
+      task;
+
+  task.future = std::async(std::launch::async, std::move(function),
+                           task.progress, task.cancellation_token);
+
+  return task;
+}
@@ -0,0 +1,315 @@
+#include <core_library/print.hpp>
+#include <core_library/thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::function<void()> job_t;
+
+const size_t num_priorities = 2;
+
+struct queue_t {
+  std::mutex mutex;
+  std::deque<job_t> jobs;
+
+  void push(job_t job);
+  bool pop_back(job_t* job);
+  bool pop_front(job_t* job);
+};
+
+class pool_t {
+ public:
+  explicit pool_t(size_t num_threads);
+  ~pool_t();
+
+  size_t num_threads() const { return threads.size(); }
+
+  void push(job_t job, priority_t priority);
+
+  // Runs one pending job in the calling thread, if there is one
+  bool run_pending_job();
+
+ private:
+  struct worker_queues_t {
+    queue_t queues[num_priorities];
+  };
+
+  std::vector<std::unique_ptr<worker_queues_t>> worker_queues;
+  queue_t shared_queues[num_priorities];
+  std::vector<std::thread> threads;
+
+  std::atomic<size_t> num_pending_jobs;
+  std::mutex sleep_mutex;
+  std::condition_variable wake_up;
+  bool stopping = false;
+
+  bool pop_job(job_t* job);
+  void work(size_t worker);
+};
+
+std::atomic<size_t> configured_num_threads(0);
+std::atomic<bool> is_pool_started(false);
+
+// The worker running the calling thread, if any
+thread_local pool_t* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+pool_t& pool() {
+  static pool_t pool(configured_num_threads);
+  return pool;
+}
+
+}  // namespace
+
+namespace thread_pool {
+
+void set_num_threads(size_t num_threads) {
+  if (is_pool_started) {
+    println_error("The thread pool already runs ", pool().num_threads(),
+                  " threads, ignoring the new number of threads ",
+                  num_threads);
+    return;
+  }
+
+  configured_num_threads = num_threads;
+}
+
+size_t num_threads() { return pool().num_threads(); }
+
+}  // namespace thread_pool
+
+struct task_group_t::state_t {
+  struct job_t {
+    std::function<void()> function;
+    std::atomic<bool> is_claimed;
+
+    explicit job_t(std::function<void()> function)
+        : function(std::move(function)), is_claimed(false) {}
+  };
+
+  std::atomic<size_t> num_unfinished_jobs;
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::exception_ptr exception;
+
+  // Jobs, which may not have been started by the pool yet. A waiting thread
+  // outside of the pool takes them from here, so it never runs jobs of other
+  // groups.
+  std::deque<std::shared_ptr<job_t>> unstarted_jobs;
+
+  state_t() : num_unfinished_jobs(0) {}
+
+  // Runs the job, unless it has been run by another thread already
+  void run(job_t* job);
+  bool run_unstarted_job();
+};
+
+void task_group_t::state_t::run(job_t* job) {
+  if (job->is_claimed.exchange(true)) return;
+
+  try {
+    job->function();
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!exception) exception = std::current_exception();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (--num_unfinished_jobs == 0) finished.notify_all();
+}
+
+bool task_group_t::state_t::run_unstarted_job() {
+  std::shared_ptr<job_t> job;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (unstarted_jobs.empty()) return false;
+    job = std::move(unstarted_jobs.front());
+    unstarted_jobs.pop_front();
+  }
+
+  run(job.get());
+  return true;
+}
+
+task_group_t::task_group_t(priority_t priority)
+    : priority(priority), state(std::make_shared<state_t>()) {}
+
+task_group_t::~task_group_t() {
+  try {
+    wait();
+  } catch (...) {
+  }
+}
+
+void task_group_t::run(std::function<void()> job) {
+  state->num_unfinished_jobs++;
+
+  std::shared_ptr<state_t::job_t> group_job =
+      std::make_shared<state_t::job_t>(std::move(job));
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    // the jobs already run by the pool are dropped
+    while (!state->unstarted_jobs.empty() &&
+           state->unstarted_jobs.front()->is_claimed)
+      state->unstarted_jobs.pop_front();
+    state->unstarted_jobs.push_back(group_job);
+  }
+
+  std::shared_ptr<state_t> state = this->state;
+  pool().push([state, group_job]() { state->run(group_job.get()); },
+              priority);
+}
+
+// Workers help with any job, so nested groups make progress. Other threads
+// (e.g. the gui thread) only run the jobs of this group, as jobs of other
+// groups may take long, and block once all of them are started.
+void task_group_t::wait() {
+  const bool is_worker = current_pool == &pool();
+
+  while (state->num_unfinished_jobs > 0) {
+    if (is_worker ? pool().run_pending_job() : state->run_unstarted_job())
+      continue;
+
+    // the remaining jobs are running
+    std::unique_lock<std::mutex> lock(state->mutex);
+    if (is_worker)
+      state->finished.wait_for(lock, std::chrono::milliseconds(1), [this]() {
+        return state->num_unfinished_jobs == 0;
+      });
+    else
+      state->finished.wait(
+          lock, [this]() { return state->num_unfinished_jobs == 0; });
+  }
+
+  std::exception_ptr exception;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    std::swap(exception, state->exception);
+  }
+  if (exception) std::rethrow_exception(exception);
+}
+
+bool task_group_t::wait_for(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(state->mutex);
+  return state->finished.wait_for(lock, timeout, [this]() {
+    return state->num_unfinished_jobs == 0;
+  });
+}
+
+namespace {
+
+void queue_t::push(job_t job) {
+  std::lock_guard<std::mutex> lock(mutex);
+  jobs.push_back(std::move(job));
+}
+
+bool queue_t::pop_back(job_t* job) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (jobs.empty()) return false;
+  *job = std::move(jobs.back());
+  jobs.pop_back();
+  return true;
+}
+
+bool queue_t::pop_front(job_t* job) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (jobs.empty()) return false;
+  *job = std::move(jobs.front());
+  jobs.pop_front();
+  return true;
+}
+
+pool_t::pool_t(size_t num_threads) : num_pending_jobs(0) {
+  is_pool_started = true;
+
+  if (num_threads == 0)
+    num_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+  for (size_t i = 0; i < num_threads; ++i)
+    worker_queues.emplace_back(new worker_queues_t);
+  for (size_t i = 0; i < num_threads; ++i)
+    threads.emplace_back([this, i]() { work(i); });
+}
+
+pool_t::~pool_t() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stopping = true;
+  }
+  wake_up.notify_all();
+
+  for (std::thread& thread : threads) thread.join();
+}
+
+void pool_t::push(job_t job, priority_t priority) {
+  const size_t lane = size_t(priority);
+
+  if (current_pool == this)
+    worker_queues[current_worker]->queues[lane].push(std::move(job));
+  else
+    shared_queues[lane].push(std::move(job));
+
+  num_pending_jobs++;
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+  }
+  wake_up.notify_one();
+}
+
+bool pool_t::run_pending_job() {
+  job_t job;
+  if (!pop_job(&job)) return false;
+
+  job();
+  return true;
+}
+
+// All interactive jobs come first. Within a priority, a worker prefers its
+// own jobs, then the shared ones, then the ones of the other workers.
+bool pool_t::pop_job(job_t* job) {
+  const bool is_worker = current_pool == this;
+  const size_t num_workers = worker_queues.size();
+
+  for (size_t lane = 0; lane < num_priorities; ++lane) {
+    if ((is_worker &&
+         worker_queues[current_worker]->queues[lane].pop_back(job)) ||
+        shared_queues[lane].pop_front(job)) {
+      num_pending_jobs--;
+      return true;
+    }
+
+    for (size_t i = 1; i <= num_workers; ++i) {
+      const size_t victim = (current_worker + i) % num_workers;
+      if (worker_queues[victim]->queues[lane].pop_front(job)) {
+        num_pending_jobs--;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+void pool_t::work(size_t worker) {
+  current_pool = this;
+  current_worker = worker;
+
+  while (true) {
+    if (run_pending_job()) continue;
+
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    wake_up.wait(lock,
+                 [this]() { return stopping || num_pending_jobs > 0; });
+    if (stopping && num_pending_jobs == 0) return;
+  }
+}
+
+}  // namespace
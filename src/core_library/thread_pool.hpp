@@ -0,0 +1,87 @@
+#ifndef CORELIBRARY_THREAD_POOL_HPP_
+#define CORELIBRARY_THREAD_POOL_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+/*
+The process wide pool of worker threads for all cpu heavy work.
+
+Every worker has its own queues, which it runs from the back (the most recent
+job first), while idle workers steal from their front. Jobs started outside
+of the pool go into shared queues. Interactive jobs (picking, previews) are
+always taken before background jobs (index builds, exports), so they don't
+wait behind background work queued earlier. Running jobs are never
+interrupted, so the jobs should be small, e.g. blocks of points.
+*/
+
+enum class priority_t {
+  INTERACTIVE,
+  BACKGROUND,
+};
+
+namespace thread_pool {
+
+// Only has an effect before the pool is used for the first time (prints a
+// warning otherwise). 0 starts one thread per core.
+void set_num_threads(size_t num_threads);
+size_t num_threads();
+
+}  // namespace thread_pool
+
+/*
+Jobs run by the pool, which can be waited for together. Exceptions thrown by
+the jobs are rethrown by wait(). The destructor waits for the jobs, as they
+usually refer to variables of the caller.
+*/
+class task_group_t {
+ public:
+  explicit task_group_t(priority_t priority = priority_t::BACKGROUND);
+  ~task_group_t();
+
+  task_group_t(const task_group_t&) = delete;
+  task_group_t& operator=(const task_group_t&) = delete;
+
+  void run(std::function<void()> job);
+
+  // Runs jobs itself, until all jobs of the group are done: workers of the
+  // pool run any pending jobs, other threads only the jobs of this group.
+  // Rethrows the first exception thrown by the jobs.
+  void wait();
+
+  // Blocks until all jobs are done or the timeout has passed, without running
+  // jobs itself. Returns whether all jobs are done.
+  bool wait_for(std::chrono::milliseconds timeout);
+
+ private:
+  struct state_t;
+
+  const priority_t priority;
+  std::shared_ptr<state_t> state;
+};
+
+// Calls function(range_begin, range_end) for the ranges of grain_size
+// indices of [begin, end) in parallel
+template <typename function_t>
+void parallel_for(size_t begin, size_t end, size_t grain_size,
+                  const function_t& function,
+                  priority_t priority = priority_t::BACKGROUND);
+
+// Combines map(range_begin, range_end) of the ranges of parallel_for with
+// reduce in the order of the ranges, starting with identity
+template <typename value_t, typename map_t, typename reduce_t>
+value_t parallel_reduce(size_t begin, size_t end, size_t grain_size,
+                        value_t identity, const map_t& map,
+                        const reduce_t& reduce,
+                        priority_t priority = priority_t::BACKGROUND);
+
+// Sorts the parts for each thread in parallel and merges them pairwise
+template <typename iterator_t, typename less_t>
+void parallel_sort(iterator_t begin, iterator_t end, const less_t& less,
+                   priority_t priority = priority_t::BACKGROUND);
+
+#include <core_library/thread_pool.inl>
+
+#endif  // CORELIBRARY_THREAD_POOL_HPP_
@@ -0,0 +1,76 @@
+#include <core_library/thread_pool.hpp>
+
+#include <algorithm>
+#include <vector>
+
+template <typename function_t>
+void parallel_for(size_t begin, size_t end, size_t grain_size,
+                  const function_t& function, priority_t priority) {
+  if (end <= begin) return;
+
+  grain_size = std::max<size_t>(1, grain_size);
+  if (end - begin <= grain_size) {
+    function(begin, end);
+    return;
+  }
+
+  task_group_t group(priority);
+  for (size_t range_begin = begin; range_begin < end;
+       range_begin += std::min(grain_size, end - range_begin)) {
+    const size_t range_end =
+        range_begin + std::min(grain_size, end - range_begin);
+    group.run([&function, range_begin, range_end]() {
+      function(range_begin, range_end);
+    });
+  }
+  group.wait();
+}
+
+template <typename value_t, typename map_t, typename reduce_t>
+value_t parallel_reduce(size_t begin, size_t end, size_t grain_size,
+                        value_t identity, const map_t& map,
+                        const reduce_t& reduce, priority_t priority) {
+  if (end <= begin) return identity;
+
+  grain_size = std::max<size_t>(1, grain_size);
+  const size_t num_ranges = (end - begin + grain_size - 1) / grain_size;
+
+  std::vector<value_t> values(num_ranges, identity);
+  parallel_for(0, num_ranges, 1,
+               [&](size_t range, size_t) {
+                 const size_t range_begin = begin + range * grain_size;
+                 values[range] = map(
+                     range_begin, std::min(range_begin + grain_size, end));
+               },
+               priority);
+
+  value_t value = identity;
+  for (const value_t& range_value : values) value = reduce(value, range_value);
+  return value;
+}
+
+template <typename iterator_t, typename less_t>
+void parallel_sort(iterator_t begin, iterator_t end, const less_t& less,
+                   priority_t priority) {
+  const size_t min_part_size = 65536;
+  const size_t size = size_t(end - begin);
+  const size_t part_size = std::max(
+      min_part_size,
+      (size + thread_pool::num_threads() - 1) / thread_pool::num_threads());
+
+  parallel_for(0, size, part_size,
+               [begin, &less](size_t first, size_t last) {
+                 std::sort(begin + first, begin + last, less);
+               },
+               priority);
+
+  for (size_t sorted_size = part_size; sorted_size < size; sorted_size *= 2)
+    parallel_for(0, size, 2 * sorted_size,
+                 [begin, &less, sorted_size](size_t first, size_t last) {
+                   if (first + sorted_size < last)
+                     std::inplace_merge(begin + first,
+                                        begin + first + sorted_size,
+                                        begin + last, less);
+                 },
+                 priority);
+}
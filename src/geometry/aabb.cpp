@@ -2,7 +2,7 @@
 #include <geometry/aabb.hpp>
 #include <glm/gtx/io.hpp>
 
-aabb_t aabb_t::fromVertices(const glm::vec3* vertices, int numVertices) {
+aabb_t aabb_t::fromVertices(const glm::vec3* vertices, size_t numVertices) {
   return fromVertices(vertices, numVertices, sizeof(glm::vec3));
 }
 
@@ -55,12 +55,12 @@ void aabb_t::operator|=(const glm::vec3& other) {
   this->max_point = glm::max(other, this->max_point);
 }
 
-aabb_t aabb_t::fromVertices(const glm::vec3* vertices, int num_vertices,
+aabb_t aabb_t::fromVertices(const glm::vec3* vertices, size_t num_vertices,
                             size_t stride) {
   aabb_t aabb = aabb_t::invalid();
   size_t address = size_t(vertices);
 
-  for (int i = 0; i < num_vertices; ++i) {
+  for (size_t i = 0; i < num_vertices; ++i) {
     const glm::vec3& v = *reinterpret_cast<const glm::vec3*>(address);
 
     aabb |= v;
@@ -41,8 +41,8 @@ struct aabb_t {
 
   static aabb_t invalid();
 
-  static aabb_t fromVertices(const glm::vec3* vertices, int num_vertices);
-  static aabb_t fromVertices(const glm::vec3* vertices, int num_vertices,
+  static aabb_t fromVertices(const glm::vec3* vertices, size_t num_vertices);
+  static aabb_t fromVertices(const glm::vec3* vertices, size_t num_vertices,
                              size_t stride);
   aabb_t aabbOfTransformedBoundingBox(const frame_t& coordFrame) const;
 
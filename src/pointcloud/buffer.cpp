@@ -1,28 +1,306 @@
 #include <core_library/print.hpp>
+#include <core_library/thread_pool.hpp>
 #include <pointcloud/buffer.hpp>
 #include <pointcloud/convert_values.hpp>
+#include <pointcloud/parallel_blocks.hpp>
 
+#include <QFile>
 #include <QString>
 #include <glm/glm.hpp>
 
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <string>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+buffer_allocation_t& current_allocation() {
+  static buffer_allocation_t allocation;
+  return allocation;
+}
+
+// Touching every 4096th byte reaches every page
+const size_t page_size = 4096;
+
+// Calls process(begin, end) for parts of [0, size) in parallel. Small sizes
+// are processed by the calling thread.
+void for_parts_in_parallel(size_t size,
+                           const std::function<void(size_t, size_t)>& process);
+
+uint8_t* map_memory(size_t* size, buffer_allocation_t::huge_pages_t huge_pages);
+void unmap_memory(uint8_t* data, size_t size);
+
+}  // namespace
+
+struct Buffer::mapping_t {
+  QSharedPointer<QFile> file;
+  uint8_t* data;
+  size_t size;
+
+  ~mapping_t() { file->unmap(data); }
+};
+
+bool buffer_allocation_t::parse_huge_pages(QString text,
+                                           huge_pages_t* huge_pages) {
+  text = text.trimmed();
+
+  if (text == "none")
+    *huge_pages = huge_pages_t::NONE;
+  else if (text == "transparent")
+    *huge_pages = huge_pages_t::TRANSPARENT;
+  else if (text == "explicit")
+    *huge_pages = huge_pages_t::EXPLICIT;
+  else
+    return false;
+
+  return true;
+}
+
+void Buffer::set_allocation(const buffer_allocation_t& allocation) {
+  current_allocation() = allocation;
+}
+
+buffer_allocation_t Buffer::allocation() { return current_allocation(); }
+
+size_t Buffer::available_memory() {
+#ifdef Q_OS_WIN
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof(status);
+  if (!GlobalMemoryStatusEx(&status)) return 0;
+  return size_t(status.ullAvailPhys);
+#else
+  // The page cache can be reclaimed, so MemAvailable is preferred over the
+  // free pages
+  std::ifstream meminfo("/proc/meminfo");
+  std::string key;
+  size_t kilobytes;
+  while (meminfo >> key >> kilobytes) {
+    if (key == "MemAvailable:") return kilobytes * 1024;
+    meminfo.ignore(256, '\n');
+  }
+
+#ifdef _SC_AVPHYS_PAGES
+  const long pages = ::sysconf(_SC_AVPHYS_PAGES);
+  const long page_bytes = ::sysconf(_SC_PAGESIZE);
+  if (pages > 0 && page_bytes > 0) return size_t(pages) * size_t(page_bytes);
+#endif
+  return 0;
+#endif
+}
+
 Buffer::Buffer() {}
 
-Buffer::Buffer(Buffer&& other) = default;
+Buffer::Buffer(Buffer&& other)
+    : bytes(other.bytes), mapping(std::move(other.mapping)) {
+  other.bytes = bytes_t();
+}
+
+Buffer& Buffer::operator=(Buffer&& other) {
+  if (this == &other) return *this;
+
+  release(&bytes);
+  bytes = other.bytes;
+  mapping = std::move(other.mapping);
+  other.bytes = bytes_t();
+
+  return *this;
+}
+
+Buffer::~Buffer() { release(&bytes); }
+
+uint8_t* Buffer::data() { return mapping ? mapping->data : bytes.data; }
+
+const uint8_t* Buffer::data() const {
+  return mapping ? mapping->data : bytes.data;
+}
+
+size_t Buffer::size() const { return mapping ? mapping->size : bytes.size; }
+
+void Buffer::clear() {
+  mapping.reset();
+  release(&bytes);
+}
+
+void Buffer::resize(size_t size) {
+  resize(size, current_allocation().parallel_first_touch);
+}
 
-Buffer& Buffer::operator=(Buffer&& other) = default;
+void Buffer::resize_without_first_touch(size_t size) { resize(size, false); }
 
-uint8_t* Buffer::data() { return bytes.data(); }
+void Buffer::resize(size_t size, bool first_touch) {
+  if (mapping) {
+    if (size == mapping->size) return;
+    copy_mapped_bytes(size);
+    return;
+  }
 
-const uint8_t* Buffer::data() const { return bytes.data(); }
+  if (size > bytes.capacity) {
+    bytes_t new_bytes = allocate(size, first_touch);
 
-void Buffer::clear() { bytes.clear(); }
+    for_parts_in_parallel(bytes.size, [&](size_t begin, size_t end) {
+      std::memcpy(new_bytes.data + begin, bytes.data + begin, end - begin);
+    });
 
-void Buffer::resize(size_t size) { bytes.resize(size); }
+    release(&bytes);
+    bytes = new_bytes;
+  }
+
+  bytes.size = size;
+}
 
 void Buffer::memset(uint32_t value) {
-  std::memset(bytes.data(), int(value), bytes.size());
+  // no need to copy the mapped bytes, which will be overwritten anyway
+  if (mapping) {
+    const size_t size = mapping->size;
+    mapping.reset();
+    bytes = allocate(size);
+    bytes.size = size;
+  }
+
+  for_parts_in_parallel(bytes.size, [this, value](size_t begin, size_t end) {
+    std::memset(bytes.data + begin, int(value), end - begin);
+  });
+}
+
+bool Buffer::map_file_section(const QSharedPointer<QFile>& file,
+                              qint64 offset, size_t size) {
+  if (size == 0) return false;
+
+  uchar* data = file->map(offset, qint64(size), QFileDevice::MapPrivateOption);
+  if (data == nullptr) return false;
+
+  release(&bytes);
+  mapping.reset(new mapping_t{file, data, size});
+
+  return true;
+}
+
+bool Buffer::is_mapped() const { return bool(mapping); }
+
+Buffer::bytes_t Buffer::allocate(size_t capacity, bool first_touch) {
+  bytes_t bytes;
+  if (capacity == 0) return bytes;
+
+  const buffer_allocation_t& allocation = current_allocation();
+
+  if (capacity >= allocation.mapping_threshold) {
+    size_t mapped_size = capacity;
+    uint8_t* data = map_memory(&mapped_size, allocation.huge_pages);
+
+    if (data != nullptr) {
+      bytes.data = data;
+      bytes.capacity = mapped_size;
+      bytes.is_system_mapping = true;
+
+      if (allocation.parallel_first_touch && first_touch)
+        for_parts_in_parallel(mapped_size, [data](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i += page_size) data[i] = 0;
+        });
+      return bytes;
+    }
+  }
+
+  bytes.data = static_cast<uint8_t*>(std::malloc(capacity));
+  if (bytes.data == nullptr) throw std::bad_alloc();
+  bytes.capacity = capacity;
+  return bytes;
 }
 
+void Buffer::release(bytes_t* bytes) {
+  if (bytes->is_system_mapping)
+    unmap_memory(bytes->data, bytes->capacity);
+  else
+    std::free(bytes->data);
+
+  *bytes = bytes_t();
+}
+
+void Buffer::copy_mapped_bytes(size_t size) {
+  std::unique_ptr<mapping_t> mapping = std::move(this->mapping);
+
+  bytes = allocate(size);
+  bytes.size = size;
+  std::memcpy(bytes.data, mapping->data, glm::min(size, mapping->size));
+}
+
+namespace {
+
+void for_parts_in_parallel(size_t size,
+                           const std::function<void(size_t, size_t)>& process) {
+  const size_t min_part_size = size_t(16) << 20;
+  const size_t num_threads = num_threads_for_blocks(size / min_part_size);
+
+  if (num_threads <= 1) {
+    if (size > 0) process(0, size);
+    return;
+  }
+
+  // the parts start at page boundaries
+  const size_t part_size =
+      (size / num_threads + page_size - 1) / page_size * page_size;
+
+  parallel_for(0, size, part_size, process);
+}
+
+// Rounds up the size to the pages of the mapping. Returns null on failure.
+uint8_t* map_memory(size_t* size,
+                    buffer_allocation_t::huge_pages_t huge_pages) {
+#ifdef Q_OS_WIN
+  Q_UNUSED(huge_pages);
+
+  *size = (*size + page_size - 1) / page_size * page_size;
+  return static_cast<uint8_t*>(
+      VirtualAlloc(nullptr, *size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+#else
+#ifdef MAP_HUGETLB
+  if (huge_pages == buffer_allocation_t::huge_pages_t::EXPLICIT) {
+    const size_t huge_page_size = size_t(2) << 20;
+    const size_t huge_size =
+        (*size + huge_page_size - 1) / huge_page_size * huge_page_size;
+    void* data = ::mmap(nullptr, huge_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      *size = huge_size;
+      return static_cast<uint8_t*>(data);
+    }
+  }
+#endif
+
+  *size = (*size + page_size - 1) / page_size * page_size;
+  void* data = ::mmap(nullptr, *size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED) return nullptr;
+
+#ifdef MADV_HUGEPAGE
+  if (huge_pages != buffer_allocation_t::huge_pages_t::NONE)
+    ::madvise(data, *size, MADV_HUGEPAGE);
+#endif
+
+  return static_cast<uint8_t*>(data);
+#endif
+}
+
+void unmap_memory(uint8_t* data, size_t size) {
+#ifdef Q_OS_WIN
+  Q_UNUSED(size);
+  VirtualFree(data, 0, MEM_RELEASE);
+#else
+  ::munmap(data, size);
+#endif
+}
+
+}  // namespace
+
 namespace data_type {
 
 QString toString(data_type::base_type_t base_type) {
@@ -1,10 +1,15 @@
 #ifndef POINTCLOUDVIEWER_BUFFER_HPP_
 #define POINTCLOUDVIEWER_BUFFER_HPP_
 
+#include <QSharedPointer>
+#include <QString>
 #include <QtGlobal>
 #include <core_library/types.hpp>
+#include <memory>
 #include <vector>
 
+class QFile;
+
 namespace data_type {
 
 // The values are directly stored into binary files, so make sure not to change
@@ -62,28 +67,94 @@ BASE_TYPE(float64_t, FLOAT64)
 
 }  // namespace data_type
 
+/*
+How the memory of buffers is allocated.
+
+Buffers of at least mapping_threshold bytes are mapped directly from the
+system, smaller ones come from the heap. Mapped buffers can be backed by huge
+pages: TRANSPARENT asks the kernel to use huge pages where possible, EXPLICIT
+takes them from the reserved huge pages (falling back to TRANSPARENT). With
+parallel_first_touch, the pages of a new mapping are touched by all threads,
+so they're cleared in parallel and spread over the numa nodes of the threads.
+*/
+struct buffer_allocation_t {
+  enum class huge_pages_t {
+    NONE,
+    TRANSPARENT,
+    EXPLICIT,
+  };
+
+  huge_pages_t huge_pages = huge_pages_t::TRANSPARENT;
+  bool parallel_first_touch = true;
+  size_t mapping_threshold = size_t(32) << 20;
+
+  // Parses "none", "transparent" or "explicit"
+  static bool parse_huge_pages(QString text, huge_pages_t* huge_pages);
+};
+
 /**
 Buffer for storing the point cloud.
+
+The buffer can be backed by a private memory mapping of a file section. Its
+pages are only read, when accessed, and copied, when written to.
+
+Allocated bytes aren't initialized, so the importers write every byte only
+once. Formats needing a fill value call memset.
 */
 class Buffer final {
  public:
+  // The strategy of all following allocations (set it before loading points)
+  static void set_allocation(const buffer_allocation_t& allocation);
+  static buffer_allocation_t allocation();
+  // The physical memory available for new buffers in bytes (0 if unknown)
+  static size_t available_memory();
+
   Buffer();
   Buffer(Buffer&& other);
   Buffer& operator=(Buffer&& other);
+  ~Buffer();
 
   Buffer(const Buffer& buffer) = delete;
   Buffer& operator=(const Buffer& buffer) = delete;
 
   uint8_t* data();
   const uint8_t* data() const;
+  size_t size() const;
 
   void clear();
 
+  // Keeps the first bytes, the added bytes are uninitialized
   void resize(size_t size);
+  // Like resize, but the pages of a new mapping aren't touched up front, so
+  // they only take physical memory once they're written (for buffers filled
+  // piece by piece while other buffers are released)
+  void resize_without_first_touch(size_t size);
+  // Sets all bytes to the lowest byte of value (in parallel)
   void memset(uint32_t value);
 
+  // Returns false, if the section couldn't be mapped. The file must be open.
+  bool map_file_section(const QSharedPointer<QFile>& file, qint64 offset,
+                        size_t size);
+  bool is_mapped() const;
+
  private:
-  std::vector<uint8_t> bytes;
+  struct mapping_t;
+
+  struct bytes_t {
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;
+    bool is_system_mapping = false;  // instead of heap memory
+  };
+
+  bytes_t bytes;
+  std::unique_ptr<mapping_t> mapping;
+
+  static bytes_t allocate(size_t capacity,
+                          bool first_touch = true);  // uninitialized
+  static void release(bytes_t* bytes);
+  void copy_mapped_bytes(size_t size);
+  void resize(size_t size, bool first_touch);
 };
 
 #include <pointcloud/buffer.inl>
@@ -3,17 +3,20 @@
 #include <pointcloud/exporter/abstract_exporter.hpp>
 #include <pointcloud/exporter/pcvd_exporter.hpp>
 #include <pointcloud/exporter/ply_exporter.hpp>
+#include <pointcloud/exporter/text_exporter.hpp>
+#include <pointcloud/parallel_blocks.hpp>
 
-#include <QAbstractEventDispatcher>
 #include <QFileInfo>
 #include <QSettings>
 #include <QSharedPointer>
-#include <QThread>
 
 #include <iostream>
 
-#define PLY_FILTER "PLY (*.ply)"
+#define PLY_FILTER "ASCII PLY (*.ply)"
+#define BINARY_PLY_FILTER "Binary PLY (*.ply)"
+#define XYZ_FILTER "XYZ (*.xyz)"
 #define PCVD_FILTER "Pointcoud Viewer Dump (*.pcvd)"
+#define COMPRESSED_PCVD_FILTER "Compressed Pointcoud Viewer Dump (*.pcvd)"
 
 AbstractPointCloudExporter::~AbstractPointCloudExporter() {}
 
@@ -21,10 +24,14 @@ QString AbstractPointCloudExporter::addMissingSuffix(QString filepath,
                                                      QString selectedFilter) {
   const QString suffix = QFileInfo(filepath).suffix().toLower();
 
-  if (selectedFilter == PLY_FILTER) {
+  if (selectedFilter == PLY_FILTER || selectedFilter == BINARY_PLY_FILTER) {
     if (suffix == "ply") return filepath;
     return filepath + ".ply";
-  } else if (selectedFilter == PCVD_FILTER) {
+  } else if (selectedFilter == XYZ_FILTER) {
+    if (suffix == "xyz") return filepath;
+    return filepath + ".xyz";
+  } else if (selectedFilter == PCVD_FILTER ||
+             selectedFilter == COMPRESSED_PCVD_FILTER) {
     if (suffix == "pcvd") return filepath;
     return filepath + ".pcvd";
   }
@@ -37,24 +44,44 @@ AbstractPointCloudExporter::exporterForSuffix(QString selectedFilter,
                                               std::string filepath,
                                               const PointCloud& pointcloud) {
   if (selectedFilter == PLY_FILTER)
+    return QSharedPointer<AbstractPointCloudExporter>(new TextExporter(
+        filepath, pointcloud, TextExporter::format_t::PLY));
+  else if (selectedFilter == BINARY_PLY_FILTER)
     return QSharedPointer<AbstractPointCloudExporter>(
         new PlyExporter(filepath, pointcloud));
+  else if (selectedFilter == XYZ_FILTER)
+    return QSharedPointer<AbstractPointCloudExporter>(new TextExporter(
+        filepath, pointcloud, TextExporter::format_t::XYZ));
   else if (selectedFilter == PCVD_FILTER)
     return QSharedPointer<AbstractPointCloudExporter>(
         new PcvdExporter(filepath, pointcloud));
+  else if (selectedFilter == COMPRESSED_PCVD_FILTER) {
+    PcvdExporter* exporter = new PcvdExporter(filepath, pointcloud);
+    exporter->compress = true;
+    return QSharedPointer<AbstractPointCloudExporter>(exporter);
+  }
 
   Q_UNREACHABLE();
   return exporterForSuffix(PCVD_FILTER, filepath, pointcloud);
 }
 
 QString AbstractPointCloudExporter::allSupportedFiletypes() {
-  return PCVD_FILTER ";;" PLY_FILTER;
+  return PCVD_FILTER ";;" COMPRESSED_PCVD_FILTER ";;" BINARY_PLY_FILTER
+                     ";;" PLY_FILTER ";;" XYZ_FILTER;
 }
 
 void AbstractPointCloudExporter::export_now() {
   this->state = RUNNING;
 
   try {
+    select_exported_points();
+
+    // The file formats need at least one point
+    if (num_exported_points == 0) {
+      this->state = NO_POINTS;
+      return;
+    }
+
     if (export_implementation())
       this->state = SUCCEEDED;
     else if (this->state == RUNNING)
@@ -67,8 +94,6 @@ void AbstractPointCloudExporter::export_now() {
   } catch (...) {
     this->state = RUNTIME_ERROR;
   }
-
-  finished();
 }
 
 AbstractPointCloudExporter::AbstractPointCloudExporter(
@@ -77,31 +102,58 @@ AbstractPointCloudExporter::AbstractPointCloudExporter(
       pointcloud(pointcloud),
       total_progress(progress_max()) {}
 
-void AbstractPointCloudExporter::cancel() { this->state = CANCELED; }
+void AbstractPointCloudExporter::select_exported_points() {
+  exported_ranges.clear();
+
+  if (filter.is_enabled()) {
+    // the progress of testing the points
+    total_progress = glm::max<int64_t>(1, int64_t(pointcloud.num_points));
+    exported_ranges = filtered_point_ranges(
+        pointcloud, filter,
+        [this](int64_t progress) { handle_written_chunk(progress); });
+    total_progress = progress_max();
+  } else if (pointcloud.num_points > 0) {
+    exported_ranges.push_back(
+        PointCloud::point_range_t{0, pointcloud.num_points});
+  }
+
+  first_exported_points.clear();
+  num_exported_points = 0;
+  for (const PointCloud::point_range_t& range : exported_ranges) {
+    first_exported_points.push_back(num_exported_points);
+    num_exported_points += range.end - range.begin;
+  }
+}
 
 void AbstractPointCloudExporter::handle_written_chunk(
     int64_t current_progress) {
   Q_ASSERT(current_progress <= total_progress);
 
-  auto process_events = []() {
-    QThread* thread = QThread::currentThread();
-    if (thread != nullptr && thread->eventDispatcher() != nullptr)
-      thread->eventDispatcher()->processEvents(
-          QEventLoop::EventLoopExec | QEventLoop::ExcludeUserInputEvents |
-          QEventLoop::ExcludeSocketNotifiers);
-  };
-
-  process_events();
-
-  if (Q_UNLIKELY(this->state == CANCELED)) throw canceled_t();
+  if (Q_UNLIKELY(cancellation_token.is_canceled())) throw canceled_t();
 
-  float86_t progress = float86_t(current_progress) / float86_t(total_progress);
-  int discrete_progress_value = int(progress * 65536 + float86_t(0.5));
-  discrete_progress_value = glm::clamp(0, 65536, discrete_progress_value);
+  progress.set(current_progress, total_progress);
+}
 
-  update_progress(discrete_progress_value);
+size_t AbstractPointCloudExporter::num_threads_for_blocks(size_t num_blocks) {
+  return ::num_threads_for_blocks(num_blocks);
+}
 
-  process_events();
+void AbstractPointCloudExporter::process_blocks_in_parallel(
+    size_t num_blocks,
+    const std::function<int64_t(size_t, size_t)>& process_block,
+    int64_t first_progress) {
+  ::process_blocks_in_parallel(
+      num_blocks, process_block,
+      [this](int64_t progress) { handle_written_chunk(progress); },
+      first_progress);
+}
 
-  Q_ASSERT(this->state == RUNNING);
+task_t<void> start_export(
+    QSharedPointer<AbstractPointCloudExporter> exporter) {
+  return run_task([exporter](progress_counter_t progress,
+                             cancellation_token_t cancellation_token) {
+    exporter->progress = progress;
+    exporter->cancellation_token = cancellation_token;
+    exporter->export_now();
+  });
 }
@@ -1,15 +1,24 @@
 #ifndef POINTCLOUD_IMPORTER_ABSTRACTEXPORTER_HPP_
 #define POINTCLOUD_IMPORTER_ABSTRACTEXPORTER_HPP_
 
-#include <QObject>
+#include <core_library/task.hpp>
+#include <pointcloud/exporter/export_filter.hpp>
 #include <pointcloud/pointcloud.hpp>
 
+#include <QSharedPointer>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
 /**
 Parent class for different kinds of PointCloud formats to import.
-*/
-class AbstractPointCloudExporter : public QObject {
-  Q_OBJECT
 
+Like AbstractPointCloudImporter, export_now() runs in the calling thread (see
+start_export), reports its progress to the progress counter and stops, once
+the cancellation token is canceled.
+*/
+class AbstractPointCloudExporter {
  public:
   enum state_t {
     IDLE,
@@ -17,6 +26,7 @@ class AbstractPointCloudExporter : public QObject {
     SUCCEEDED,
     RUNTIME_ERROR,
     CANCELED,
+    NO_POINTS,  // no point passes the filter, so no file is written
   };
 
   enum class canceled_t {};
@@ -26,31 +36,79 @@ class AbstractPointCloudExporter : public QObject {
 
   const PointCloud& pointcloud;
 
+  // Only the points passing the filter are exported
+  export_filter_t filter;
+
+  progress_counter_t progress;
+  cancellation_token_t cancellation_token;
+
   AbstractPointCloudExporter(const std::string& output_file,
                              const PointCloud& pointcloud);
-  ~AbstractPointCloudExporter();
+  virtual ~AbstractPointCloudExporter();
 
-  constexpr static int progress_max() { return 65536; }
+  constexpr static int progress_max() { return progress_counter_t::max(); }
 
   static QSharedPointer<AbstractPointCloudExporter> exporterForSuffix(
       QString suffix, std::string filepath, const PointCloud& pointcloud);
   static QString addMissingSuffix(QString filepath, QString selectedFilter);
   static QString allSupportedFiletypes();
 
- public slots:
   void export_now();
-  void cancel();
-
- signals:
-  void update_progress(int progress);
-  void finished();
 
  protected:
   int64_t total_progress = 0;
+  // Like AbstractPointCloudImporter::handle_loaded_chunk
   void handle_written_chunk(int64_t progress);
 
- protected slots:
+  // The exported points in ascending order (set before export_implementation
+  // is called), so the exporters stream the points straight from the point
+  // cloud without copying them
+  std::vector<PointCloud::point_range_t> exported_ranges;
+  size_t num_exported_points = 0;
+
+  // Calls visit(point) for the exported points [first, first+n) in order
+  template <typename visitor_t>
+  void for_each_exported_point(size_t first, size_t n,
+                               const visitor_t& visit) const;
+
+  // Like AbstractPointCloudImporter::process_blocks_in_parallel
+  static size_t num_threads_for_blocks(size_t num_blocks);
+  void process_blocks_in_parallel(
+      size_t num_blocks,
+      const std::function<int64_t(size_t block, size_t thread)>& process_block,
+      int64_t first_progress = 0);
+
   virtual bool export_implementation() = 0;
+
+ private:
+  // first_exported_points[i] is the number of exported points before
+  // exported_ranges[i]
+  std::vector<size_t> first_exported_points;
+
+  void select_exported_points();
 };
 
+template <typename visitor_t>
+void AbstractPointCloudExporter::for_each_exported_point(
+    size_t first, size_t n, const visitor_t& visit) const {
+  if (n == 0) return;
+
+  size_t range = size_t(std::upper_bound(first_exported_points.begin(),
+                                         first_exported_points.end(),
+                                         first) -
+                        first_exported_points.begin()) -
+                 1;
+  size_t point =
+      exported_ranges[range].begin + (first - first_exported_points[range]);
+
+  for (; n > 0; --n) {
+    if (point == exported_ranges[range].end)
+      point = exported_ranges[++range].begin;
+    visit(point++);
+  }
+}
+
+// Like start_import
+task_t<void> start_export(QSharedPointer<AbstractPointCloudExporter> exporter);
+
 #endif  // POINTCLOUD_IMPORTER_ABSTRACTEXPORTER_HPP_
@@ -0,0 +1,311 @@
+#include <core_library/types.hpp>
+#include <core_library/thread_pool.hpp>
+#include <pointcloud/exporter/export_filter.hpp>
+#include <pointcloud/parallel_blocks.hpp>
+#include <pointcloud/property_view.hpp>
+
+#include <QRegularExpression>
+#include <QStringList>
+
+#include <cmath>
+#include <functional>
+
+namespace {
+
+typedef PointCloud::point_range_t point_range_t;
+typedef export_filter_t::comparison_t comparison_t;
+
+const size_t points_per_block = 65536;
+
+// A condition bound to the values of its property
+struct bound_condition_t {
+  const uint8_t* values;
+  size_t stride;
+  size_t num_points;
+  data_type::base_type_t type;
+  comparison_t comparison;
+  double value;
+
+  // Clears passes[i] of the points, which don't satisfy the condition. The
+  // points are points[i], or first_point + i without points.
+  void apply(const size_t* points, size_t first_point, size_t count,
+             uint8_t* passes) const;
+};
+
+std::vector<bound_condition_t> bind_conditions(const PointCloud& pointcloud,
+                                               const export_filter_t& filter);
+
+aabb_t region_bounds(const export_filter_t& filter);
+
+bool parse_floats(QString text, float* values, int num_values);
+
+}  // namespace
+
+bool export_filter_t::parse(QString text, export_filter_t* filter) {
+  *filter = export_filter_t();
+
+  const QRegularExpression condition_expression(
+      "^(.+?)\\s*(==|!=|<=|>=|<|>)\\s*(\\S+)$");
+
+  for (QString part : text.split(';')) {
+    part = part.trimmed();
+    if (part.isEmpty()) continue;
+
+    if (part.startsWith("box:") || part.startsWith("obox:")) {
+      if (filter->region != region_t::NONE) return false;
+
+      const QString parameters = part.mid(part.indexOf(':') + 1);
+      float values[10];
+
+      if (part.startsWith("box:")) {
+        if (!parse_floats(parameters, values, 6)) return false;
+
+        filter->region = region_t::BOX;
+        filter->box = aabb_t::invalid();
+        filter->box.min_point = glm::vec3(values[0], values[1], values[2]);
+        filter->box.max_point = glm::vec3(values[3], values[4], values[5]);
+        if (!glm::all(glm::lessThanEqual(filter->box.min_point,
+                                         filter->box.max_point)))
+          return false;
+      } else {
+        if (!parse_floats(parameters, values, 10)) return false;
+
+        const glm::quat orientation(values[3], values[4], values[5],
+                                    values[6]);
+        if (!(glm::length(orientation) > 0.f)) return false;
+
+        filter->region = region_t::ORIENTED_BOX;
+        filter->frame =
+            frame_t(glm::vec3(values[0], values[1], values[2]),
+                    glm::normalize(orientation));
+        filter->extent = glm::vec3(values[7], values[8], values[9]);
+        if (!glm::all(glm::greaterThanEqual(filter->extent, glm::vec3(0))))
+          return false;
+      }
+    } else {
+      const QRegularExpressionMatch match = condition_expression.match(part);
+      if (!match.hasMatch()) return false;
+
+      const QString comparison = match.captured(2);
+      condition_t condition;
+      condition.property = match.captured(1).trimmed();
+
+      if (comparison == "==")
+        condition.comparison = comparison_t::EQUAL;
+      else if (comparison == "!=")
+        condition.comparison = comparison_t::NOT_EQUAL;
+      else if (comparison == "<")
+        condition.comparison = comparison_t::LESS;
+      else if (comparison == "<=")
+        condition.comparison = comparison_t::LESS_EQUAL;
+      else if (comparison == ">")
+        condition.comparison = comparison_t::GREATER;
+      else
+        condition.comparison = comparison_t::GREATER_EQUAL;
+
+      bool ok;
+      condition.value = match.captured(3).toDouble(&ok);
+      if (!ok || std::isnan(condition.value)) return false;
+
+      filter->conditions << condition;
+    }
+  }
+
+  return true;
+}
+
+/*
+Without a region or kd tree, all points are tested. Otherwise the candidates
+are the points of the kd tree near the region, which are sorted again, so the
+points keep their order. The candidates are tested in parallel blocks.
+*/
+std::vector<point_range_t> filtered_point_ranges(
+    const PointCloud& pointcloud, const export_filter_t& filter,
+    const std::function<void(int64_t)>& wait) {
+  typedef export_filter_t::region_t region_t;
+
+  const std::vector<bound_condition_t> conditions =
+      bind_conditions(pointcloud, filter);
+  const frame_t inverse_frame = filter.frame.inverse();
+
+  auto inside_region = [&](size_t point) -> bool {
+    const glm::vec3 coordinate = pointcloud.vertex(point).coordinate;
+
+    switch (filter.region) {
+      case region_t::NONE:
+        return true;
+      case region_t::BOX:
+        return filter.box.contains(coordinate, 0.f);
+      case region_t::ORIENTED_BOX:
+        return glm::all(glm::lessThanEqual(
+            glm::abs(inverse_frame.transform_point(coordinate)),
+            filter.extent));
+    }
+
+    Q_UNREACHABLE();
+    return false;
+  };
+
+  const bool use_kd_tree =
+      filter.region != region_t::NONE && pointcloud.has_build_kdtree();
+
+  std::vector<size_t> candidates;
+  if (use_kd_tree) {
+    pointcloud.kdtree_index.visit_points_in_region(
+        region_bounds(filter), pointcloud.coordinate_color.data(),
+        PointCloud::stride,
+        [&candidates](const KDTreeIndex::point_index_t* begin,
+                      const KDTreeIndex::point_index_t* end) {
+          for (; begin != end; ++begin) candidates.push_back(size_t(*begin));
+        });
+    parallel_sort(candidates.begin(), candidates.end(), std::less<size_t>());
+  }
+
+  const size_t num_candidates =
+      use_kd_tree ? candidates.size() : pointcloud.num_points;
+  const size_t num_blocks =
+      (num_candidates + points_per_block - 1) / points_per_block;
+
+  std::vector<std::vector<point_range_t>> ranges_of_block(num_blocks);
+  process_blocks_in_parallel(
+      num_blocks,
+      [&](size_t block, size_t) -> int64_t {
+        const size_t begin = block * points_per_block;
+        const size_t end = glm::min(begin + points_per_block, num_candidates);
+        std::vector<point_range_t>& ranges = ranges_of_block[block];
+        const size_t* points = use_kd_tree ? candidates.data() + begin
+                                           : nullptr;
+
+        // The conditions are tested column by column for the whole block
+        std::vector<uint8_t> passes(end - begin);
+        for (size_t i = begin; i < end; ++i)
+          passes[i - begin] = inside_region(use_kd_tree ? candidates[i] : i);
+        for (const bound_condition_t& condition : conditions)
+          condition.apply(points, begin, end - begin, passes.data());
+
+        for (size_t i = begin; i < end; ++i) {
+          const size_t point = use_kd_tree ? candidates[i] : i;
+          if (!passes[i - begin]) continue;
+
+          if (!ranges.empty() && ranges.back().end == point)
+            ranges.back().end = point + 1;
+          else
+            ranges.push_back(point_range_t{point, point + 1});
+        }
+
+        return int64_t(end - begin);
+      },
+      wait);
+
+  // Joins the ranges continued in the next block
+  std::vector<point_range_t> ranges;
+  for (const std::vector<point_range_t>& block_ranges : ranges_of_block) {
+    for (const point_range_t& range : block_ranges) {
+      if (!ranges.empty() && ranges.back().end == range.begin)
+        ranges.back().end = range.end;
+      else
+        ranges.push_back(range);
+    }
+  }
+
+  return ranges;
+}
+
+namespace {
+
+void bound_condition_t::apply(const size_t* points, size_t first_point,
+                              size_t count, uint8_t* passes) const {
+  const double value = this->value;
+
+  visit_property_type(type, [&](auto type_value) {
+    const PropertyView<decltype(type_value)> view(values, stride, num_points);
+
+    auto test = [&](auto holds) {
+      if (points) {
+        for (size_t i = 0; i < count; ++i)
+          passes[i] &= uint8_t(holds(double(view[points[i]])));
+      } else {
+        const auto block = view.block(first_point, count);
+        for (size_t i = 0; i < count; ++i)
+          passes[i] &= uint8_t(holds(double(block[i])));
+      }
+    };
+
+    switch (comparison) {
+      case comparison_t::EQUAL:
+        test([value](double x) { return x == value; });
+        break;
+      case comparison_t::NOT_EQUAL:
+        test([value](double x) { return x != value; });
+        break;
+      case comparison_t::LESS:
+        test([value](double x) { return x < value; });
+        break;
+      case comparison_t::LESS_EQUAL:
+        test([value](double x) { return x <= value; });
+        break;
+      case comparison_t::GREATER:
+        test([value](double x) { return x > value; });
+        break;
+      case comparison_t::GREATER_EQUAL:
+        test([value](double x) { return x >= value; });
+        break;
+    }
+  });
+}
+
+std::vector<bound_condition_t> bind_conditions(const PointCloud& pointcloud,
+                                               const export_filter_t& filter) {
+  std::vector<bound_condition_t> conditions;
+
+  for (const export_filter_t::condition_t& condition : filter.conditions) {
+    const int column = pointcloud.user_data_names.indexOf(condition.property);
+    if (column < 0)
+      throw QString("Unknown property %0").arg(condition.property);
+
+    bound_condition_t bound_condition;
+    bound_condition.type = pointcloud.user_data_types[column];
+    bound_condition.num_points = pointcloud.num_points;
+    bound_condition.comparison = condition.comparison;
+    bound_condition.value = condition.value;
+
+    // Pending columns are read from where they are mapped
+    if (pointcloud.is_user_data_column_pending(column)) {
+      bound_condition.values =
+          pointcloud.pending_user_data_columns[size_t(column)].data();
+      bound_condition.stride = data_type::size_of_type(bound_condition.type);
+    } else {
+      bound_condition.values =
+          pointcloud.user_data.data() + pointcloud.user_data_offset[column];
+      bound_condition.stride = pointcloud.user_data_stride;
+    }
+
+    conditions.push_back(bound_condition);
+  }
+
+  return conditions;
+}
+
+aabb_t region_bounds(const export_filter_t& filter) {
+  if (filter.region == export_filter_t::region_t::BOX) return filter.box;
+
+  aabb_t box = aabb_t::invalid();
+  box.min_point = -filter.extent;
+  box.max_point = filter.extent;
+  return box.aabbOfTransformedBoundingBox(filter.frame);
+}
+
+bool parse_floats(QString text, float* values, int num_values) {
+  const QStringList components = text.split(',');
+  if (components.length() != num_values) return false;
+
+  for (int i = 0; i < num_values; ++i) {
+    bool ok;
+    values[i] = components[i].trimmed().toFloat(&ok);
+    if (!ok || !std::isfinite(values[i])) return false;
+  }
+
+  return true;
+}
+
+}  // namespace
@@ -0,0 +1,68 @@
+#ifndef POINTCLOUD_EXPORTER_EXPORT_FILTER_HPP_
+#define POINTCLOUD_EXPORTER_EXPORT_FILTER_HPP_
+
+#include <geometry/frame.hpp>
+#include <pointcloud/pointcloud.hpp>
+
+#include <QString>
+#include <QVector>
+
+#include <functional>
+#include <vector>
+
+/*
+Which points are exported.
+
+BOX keeps the points inside the axis aligned box, ORIENTED_BOX the points p
+with |frame.inverse() * p| <= extent, so extent is half the size of the box
+along the axes of the frame. Both include the boundary. Additionally, all
+conditions on the properties have to hold.
+*/
+struct export_filter_t {
+  enum class region_t {
+    NONE,
+    BOX,
+    ORIENTED_BOX,
+  };
+
+  enum class comparison_t {
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+  };
+
+  struct condition_t {
+    QString property;
+    comparison_t comparison;
+    double value;
+  };
+
+  region_t region = region_t::NONE;
+  aabb_t box;
+  frame_t frame;
+  glm::vec3 extent;
+  QVector<condition_t> conditions;
+
+  bool is_enabled() const {
+    return region != region_t::NONE || !conditions.isEmpty();
+  }
+
+  // Parses ';' separated parts: "box:<minx,miny,minz,maxx,maxy,maxz>",
+  // "obox:<x,y,z,qw,qx,qy,qz,extentx,extenty,extentz>" (the position and
+  // orientation of the frame) and conditions like "classification == 2"
+  // (==, !=, <, <=, > or >=)
+  static bool parse(QString text, export_filter_t* filter);
+};
+
+// The ranges of the points passing the filter in ascending order. Uses the
+// kd tree, if built, to test only the points near the region. wait is called
+// like by process_blocks_in_parallel with the number of tested points.
+// Throws a QString if a condition refers to an unknown property.
+std::vector<PointCloud::point_range_t> filtered_point_ranges(
+    const PointCloud& pointcloud, const export_filter_t& filter,
+    const std::function<void(int64_t progress)>& wait);
+
+#endif  // POINTCLOUD_EXPORTER_EXPORT_FILTER_HPP_
@@ -0,0 +1,149 @@
+#include <pointcloud/exporter/file_writer.hpp>
+
+#include <QFileInfo>
+#include <QString>
+
+#include <algorithm>
+#include <cstdio>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t buffer_size = size_t(16) << 20;
+
+bool sync_to_disk(int file_descriptor) {
+#ifdef Q_OS_WIN
+  return _commit(file_descriptor) == 0;
+#else
+  return ::fsync(file_descriptor) == 0;
+#endif
+}
+
+// Atomically, so the target file is either the old or the new one
+bool replace_file(const QString& source, const std::string& target) {
+#ifdef Q_OS_WIN
+  // rename fails, if the target exists
+  const std::wstring source_path = source.toStdWString();
+  const std::wstring target_path =
+      QString::fromStdString(target).toStdWString();
+  return MoveFileExW(source_path.c_str(), target_path.c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+  return std::rename(source.toStdString().c_str(), target.c_str()) == 0;
+#endif
+}
+
+// Makes the renaming durable
+void sync_directory(const std::string& filename) {
+#ifdef Q_OS_WIN
+  Q_UNUSED(filename);
+#else
+  const std::string directory = QFileInfo(QString::fromStdString(filename))
+                                    .absolutePath()
+                                    .toStdString();
+  const int file_descriptor = ::open(directory.c_str(), O_RDONLY);
+  if (file_descriptor < 0) return;
+  ::fsync(file_descriptor);
+  ::close(file_descriptor);
+#endif
+}
+
+}  // namespace
+
+file_writer_t::file_writer_t(const std::string& filename)
+    : filename(filename), file(QString::fromStdString(filename + ".part")) {
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate |
+                 QIODevice::Unbuffered))
+    throw QString("Could not open %0 for writing").arg(file.fileName());
+
+  buffer.reserve(buffer_size);
+}
+
+file_writer_t::~file_writer_t() {
+  if (writer.joinable()) writer.join();
+
+  if (!committed) file.remove();
+}
+
+void file_writer_t::write(const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  _position += size;
+
+  while (size > 0) {
+    const size_t n = std::min(size, buffer_size - buffer.size());
+    buffer.insert(buffer.end(), bytes, bytes + n);
+    bytes += n;
+    size -= n;
+
+    if (buffer.size() == buffer_size) flush_buffer();
+  }
+}
+
+void file_writer_t::write_zeros(size_t size) {
+  const uint8_t zeros[4096] = {};
+
+  while (size > 0) {
+    const size_t n = std::min(size, sizeof(zeros));
+    write(zeros, n);
+    size -= n;
+  }
+}
+
+void file_writer_t::write_at(uint64_t offset, const void* data, size_t size) {
+  Q_ASSERT(offset + size <= _position);
+
+  flush_buffer();
+  wait_for_writer();
+
+  if (!file.seek(qint64(offset)) ||
+      file.write(static_cast<const char*>(data), qint64(size)) !=
+          qint64(size) ||
+      !file.seek(qint64(_position)))
+    throw QString("Could not write %0").arg(file.fileName());
+}
+
+void file_writer_t::commit() {
+  flush_buffer();
+  wait_for_writer();
+
+  if (!file.flush() || !sync_to_disk(file.handle()))
+    throw QString("Could not write %0").arg(file.fileName());
+  file.close();
+
+  if (!replace_file(file.fileName(), filename))
+    throw QString("Could not replace %0").arg(QString::fromStdString(filename));
+  committed = true;
+
+  sync_directory(filename);
+}
+
+// Hands the buffer to the writer thread, once the previous one is written
+void file_writer_t::flush_buffer() {
+  wait_for_writer();
+
+  std::swap(buffer, written_buffer);
+  buffer.clear();
+  buffer.reserve(buffer_size);
+
+  if (written_buffer.empty()) return;
+
+  writer = std::thread([this]() {
+    const qint64 size = qint64(written_buffer.size());
+    if (file.write(reinterpret_cast<const char*>(written_buffer.data()),
+                   size) != size)
+      write_failed = true;
+  });
+}
+
+void file_writer_t::wait_for_writer() {
+  if (writer.joinable()) writer.join();
+
+  if (write_failed) throw QString("Could not write %0").arg(file.fileName());
+}
@@ -0,0 +1,54 @@
+#ifndef POINTCLOUD_WORKERS_EXPORTER_FILE_WRITER_HPP_
+#define POINTCLOUD_WORKERS_EXPORTER_FILE_WRITER_HPP_
+
+#include <QFile>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Writes a file crash safe and asynchronously.
+
+The data goes into a temporary file next to the target file. The writes are
+collected in a buffer, which is handed to a writer thread once it's full,
+while the next buffer is filled. commit() writes the rest, flushes the file to
+the disk and atomically replaces the target file by the temporary file. If
+commit isn't reached, the destructor removes the temporary file, so the target
+file is either the old or the complete new file, even if the process dies.
+
+Errors are thrown as QString.
+*/
+class file_writer_t {
+ public:
+  explicit file_writer_t(const std::string& filename);
+  ~file_writer_t();
+
+  // Number of bytes written so far
+  uint64_t position() const { return _position; }
+
+  void write(const void* data, size_t size);
+  void write_zeros(size_t size);
+
+  // Overwrites bytes written before (waits for all pending writes)
+  void write_at(uint64_t offset, const void* data, size_t size);
+
+  void commit();
+
+ private:
+  const std::string filename;
+  QFile file;
+  bool committed = false;
+
+  uint64_t _position = 0;
+  std::vector<uint8_t> buffer;
+  std::vector<uint8_t> written_buffer;
+  std::thread writer;
+  bool write_failed = false;
+
+  void flush_buffer();
+  void wait_for_writer();
+};
+
+#endif  // POINTCLOUD_WORKERS_EXPORTER_FILE_WRITER_HPP_
@@ -1,23 +1,121 @@
-#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <pointcloud/exporter/file_writer.hpp>
 #include <pointcloud/exporter/pcvd_exporter.hpp>
+#include <pointcloud/pcvd_checksum.hpp>
+#include <pointcloud/pcvd_codec.hpp>
 #include <pointcloud/pcvd_file_format.hpp>
 
+namespace {
+
+// Sorts the written points into the cells of a regular grid over the aabb.
+// Each non empty cell becomes a chunk of roughly points_per_chunk points. If
+// order isn't empty, it contains the num_points written points, otherwise all
+// points are written.
+void sort_into_spatial_chunks(
+    const PointCloud& pointcloud, const aabb_t& aabb, size_t num_points,
+    std::vector<size_t>* order,
+    std::vector<pcvd_format::spatial_chunk_t>* chunks) {
+  const size_t points_per_chunk = 65536;
+  const std::vector<size_t> points = std::move(*order);
+  auto point_at = [&points](size_t i) {
+    return points.empty() ? i : points[i];
+  };
+
+  const size_t resolution = glm::clamp<size_t>(
+      size_t(std::ceil(std::cbrt(double(num_points) / points_per_chunk))), 1,
+      128);
+  const size_t num_cells = resolution * resolution * resolution;
+  const glm::vec3 cell_size =
+      glm::max(aabb.size() / float(resolution), glm::vec3(1.e-20f));
+
+  std::vector<uint32_t> cell_of_point(num_points);
+  std::vector<size_t> first_point_of_cell(num_cells + 1, 0);
+
+  for (size_t i = 0; i < num_points; ++i) {
+    const glm::vec3 coordinate = pointcloud.vertex(point_at(i)).coordinate;
+    uint32_t cell_index = 0;
+
+    if (!glm::any(glm::isnan(coordinate))) {
+      const glm::vec3 relative_coordinate =
+          glm::max((coordinate - aabb.min_point) / cell_size, glm::vec3(0));
+      const glm::uvec3 cell = glm::min(glm::uvec3(relative_coordinate),
+                                       glm::uvec3(resolution - 1));
+      cell_index = uint32_t((cell.z * resolution + cell.y) * resolution +
+                            cell.x);
+    }
+
+    cell_of_point[i] = cell_index;
+    first_point_of_cell[cell_index + 1]++;
+  }
+
+  for (size_t cell = 0; cell < num_cells; ++cell)
+    first_point_of_cell[cell + 1] += first_point_of_cell[cell];
+
+  std::vector<size_t> next_point_of_cell(first_point_of_cell.begin(),
+                                         first_point_of_cell.end() - 1);
+  order->resize(num_points);
+  for (size_t i = 0; i < num_points; ++i)
+    (*order)[next_point_of_cell[cell_of_point[i]]++] = point_at(i);
+
+  chunks->clear();
+  for (size_t cell = 0; cell < num_cells; ++cell) {
+    const size_t begin = first_point_of_cell[cell];
+    const size_t end = first_point_of_cell[cell + 1];
+    if (begin == end) continue;
+
+    pcvd_format::spatial_chunk_t chunk;
+    chunk.aabb = aabb_t::invalid();
+    chunk.first_point = begin;
+    chunk.num_points = end - begin;
+
+    for (size_t i = begin; i < end; ++i) {
+      const glm::vec3 coordinate = pointcloud.vertex((*order)[i]).coordinate;
+      if (!glm::any(glm::isnan(coordinate))) chunk.aabb |= coordinate;
+    }
+
+    chunks->push_back(chunk);
+  }
+}
+
+}  // namespace
+
 PcvdExporter::PcvdExporter(const std::string& output_file,
                            const PointCloud& pointcloud)
     : AbstractPointCloudExporter(output_file, pointcloud) {}
 
 bool PcvdExporter::export_implementation() {
-  std::ofstream stream(
-      output_file,
-      std::ios_base::out | std::ios_base::binary);  // a binary stream
+  // The point cloud might be backed by a memory mapping of the output file, so
+  // the file is only replaced after all data has been written.
+  file_writer_t writer(output_file);
+
+  // The checksum of the section being written
+  pcvd_checksum::accumulator_t checksum;
+  auto write = [&writer, &checksum](const void* data, size_t size) {
+    writer.write(data, size);
+    checksum.append(data, size);
+  };
 
   pcvd_format::header_t header;
 
   header.magic_number = pcvd_format::header_t::expected_macic_number();
-  header.file_version_number = 1;
-  header.downwards_compatibility_version_number = 0;
 
-  header.number_points = pointcloud.num_points;
+  // Only files with a table of contents can store the origin
+  const bool save_origin = pointcloud.origin != glm::dvec3(0);
+  column_sections = column_sections || compress || save_origin;
+
+  header.file_version_number =
+      column_sections ? 7 : align_sections ? 3 : 2;
+  header.downwards_compatibility_version_number =
+      save_origin ? 7
+                  : compress ? 5 : column_sections ? 4 : align_sections ? 3 : 0;
+
+  // Only the exported points are written
+  const size_t num_points = num_exported_points;
+  const bool filtered = filter.is_enabled();
+
+  header.number_points = num_points;
 
   header.point_data_stride =
       decltype(header.point_data_stride)(pointcloud.user_data_stride);
@@ -56,12 +154,23 @@ bool PcvdExporter::export_implementation() {
         "More properties than supported by the file format (property names too "
         "long)");
 
-  save_kd_tree = save_kd_tree && pointcloud.has_build_kdtree();
+  // The kd tree of the points doesn't fit a subset of them
+  save_kd_tree = save_kd_tree && pointcloud.has_build_kdtree() && !filtered;
+  save_remap_cache = save_remap_cache && !pointcloud.remap_cache.is_empty();
 
   header.flags = (save_kd_tree ? 0b1 : 0) | (save_vertex_data ? 0b10 : 0) |
-                 (save_shader ? 0b100 : 0);
+                 (save_shader ? 0b100 : 0) | (save_remap_cache ? 0b1000 : 0) |
+                 (column_sections ? 0b100000 : align_sections ? 0b10000 : 0) |
+                 (compress ? 0b1000000 : 0);
 
   header.aabb = pointcloud.aabb;
+  if (filtered && num_points > 0) {
+    header.aabb = aabb_t::invalid();
+    for_each_exported_point(0, num_points, [&header, this](size_t point) {
+      const glm::vec3 coordinate = pointcloud.vertex(point).coordinate;
+      if (!glm::any(glm::isnan(coordinate))) header.aabb |= coordinate;
+    });
+  }
 
   header.reserved = 0;
 
@@ -119,56 +228,470 @@ bool PcvdExporter::export_implementation() {
       sizeof(pcvd_format::field_description_t) * header.number_fields;
   std::streamsize field_names_size = header.field_names_total_size;
   std::streamsize vertex_data_size =
-      save_vertex_data ? std::streamsize(pointcloud.num_points *
+      save_vertex_data ? std::streamsize(num_points *
                                          sizeof(PointCloud::vertex_t))
                        : 0;
   std::streamsize point_data_size =
-      std::streamsize(pointcloud.num_points * header.point_data_stride);
+      std::streamsize(num_points * header.point_data_stride);
   std::streamsize kd_tree_size =
-      save_kd_tree ? std::streamsize(pointcloud.num_points * sizeof(size_t))
+      save_kd_tree ? std::streamsize(num_points * sizeof(size_t))
                    : 0;
   std::streamsize shader_data_size =
       save_shader ? std::streamsize(sizeof(pcvd_format::shader_description_t) +
                                     header.shader_data_size)
                   : 0;
+
+  pcvd_format::remap_cache_description_t remap_cache_description;
+  remap_cache_description.number_entries =
+      save_remap_cache ? uint32_t(pointcloud.remap_cache.entries().size()) : 0;
+  remap_cache_description.reserved = 0;
+  const std::streamsize remap_cache_entry_size = std::streamsize(
+      sizeof(RemapCache::key_t) +
+      num_points * sizeof(PointCloud::vertex_t));
+  std::streamsize remap_cache_size =
+      save_remap_cache
+          ? std::streamsize(sizeof(pcvd_format::remap_cache_description_t)) +
+                remap_cache_description.number_entries * remap_cache_entry_size
+          : 0;
+
   total_progress = header_size + field_headers_size + field_names_size +
                    vertex_data_size + point_data_size + kd_tree_size +
-                   shader_data_size;
+                   shader_data_size + remap_cache_size;
   int64_t current_progress = 0;
 
-  stream.write(reinterpret_cast<const char*>(&header), header_size);
+  auto write_padding = [&]() {
+    if (!align_sections && !column_sections) return;
+    writer.write_zeros(size_t(
+        pcvd_format::padding_for_section_alignment(writer.position())));
+  };
+
+  auto write_shader = [&]() {
+    write(&shader_description, sizeof(shader_description));
+    write(shader_used_properies_bytes.data(),
+          size_t(shader_used_properies_bytes.length()));
+    write(shader_coordinate_bytes.data(),
+          size_t(shader_coordinate_bytes.length()));
+    write(shader_color_bytes.data(), size_t(shader_color_bytes.length()));
+    write(shader_node_bytes.data(), size_t(shader_node_bytes.length()));
+  };
+
+  if (column_sections) {
+    // order[i] is the index of the i-th written point
+    std::vector<size_t> order;
+    std::vector<pcvd_format::spatial_chunk_t> chunks;
+    if (filtered) {
+      order.reserve(num_points);
+      for_each_exported_point(
+          0, num_points, [&order](size_t point) { order.push_back(point); });
+    }
+    if (spatial_chunks && save_vertex_data && num_points > 0 &&
+        header.aabb.is_valid())
+      sort_into_spatial_chunks(pointcloud, header.aabb, num_points, &order,
+                               &chunks);
+
+    // Within the compressed blocks, the points are sorted along the Morton
+    // order, without moving them into other chunks
+    if (compress && save_vertex_data) {
+      if (order.empty()) {
+        order.resize(num_points);
+        for (size_t i = 0; i < num_points; ++i) order[i] = i;
+      }
+
+      std::vector<size_t> segment_begins;
+      for (const pcvd_format::spatial_chunk_t& chunk : chunks)
+        segment_begins.push_back(chunk.first_point);
+      for (size_t i = 0; i < num_points;
+           i += pcvd_codec::points_per_block())
+        segment_begins.push_back(i);
+      segment_begins.push_back(num_points);
+      std::sort(segment_begins.begin(), segment_begins.end());
+      segment_begins.erase(
+          std::unique(segment_begins.begin(), segment_begins.end()),
+          segment_begins.end());
+
+      process_blocks_in_parallel(
+          segment_begins.size() - 1, [&](size_t segment, size_t) -> int64_t {
+            pcvd_codec::sort_by_morton_code(
+                pointcloud, order.data() + segment_begins[segment],
+                order.data() + segment_begins[segment + 1]);
+            return 0;
+          });
+    }
+
+    std::vector<pcvd_format::section_t> sections;
+    auto add_section = [&sections](pcvd_format::section_type_t type,
+                                   uint32_t index, uint64_t key,
+                                   uint64_t size) {
+      sections.push_back(pcvd_format::section_t{type, index, key, 0, size});
+    };
+
+    // The shader comes first, so readers know the needed columns early
+    if (save_shader)
+      add_section(pcvd_format::section_type_t::SHADER, 0, 0,
+                  uint64_t(shader_data_size));
+    if (save_origin)
+      add_section(pcvd_format::section_type_t::ORIGIN, 0, 0,
+                  3 * sizeof(float64_t));
+    if (!chunks.empty())
+      add_section(pcvd_format::section_type_t::SPATIAL_CHUNKS, 0, 0,
+                  chunks.size() * sizeof(pcvd_format::spatial_chunk_t));
+    if (save_vertex_data)
+      add_section(pcvd_format::section_type_t::VERTEX_DATA, 0, 0,
+                  uint64_t(vertex_data_size));
+    for (int i = 0; i < header.number_fields; ++i)
+      add_section(pcvd_format::section_type_t::PROPERTY_COLUMN, uint32_t(i), 0,
+                  num_points *
+                      data_type::size_of_type(pointcloud.user_data_types[i]));
+    if (save_kd_tree)
+      add_section(pcvd_format::section_type_t::KD_TREE, 0, 0,
+                  uint64_t(kd_tree_size));
+    if (save_remap_cache) {
+      uint32_t index = 0;
+      for (const RemapCache::entry_t& entry : pointcloud.remap_cache.entries())
+        add_section(pcvd_format::section_type_t::REMAP_CACHE_ENTRY, index++,
+                    entry.key,
+                    num_points * sizeof(PointCloud::vertex_t));
+    }
+    // The checksums come last, when the checksums of the others are known
+    add_section(pcvd_format::section_type_t::CHECKSUMS, 0, 0,
+                (sections.size() + 1) * sizeof(uint64_t));
+    std::vector<uint64_t> checksums(sections.size(), 0);
+
+    pcvd_format::table_of_contents_t table_of_contents;
+    table_of_contents.number_sections = uint32_t(sections.size());
+    table_of_contents.reserved = 0;
+
+    // The progress is measured in uncompressed bytes
+    total_progress = header_size + field_headers_size + field_names_size;
+    for (const pcvd_format::section_t& section : sections)
+      total_progress += int64_t(section.size);
+
+    write(&header, size_t(header_size));
+    write(field_descriptions.data(), size_t(field_headers_size));
+    write(joined_field_names.c_str(), size_t(field_names_size));
+    write(&table_of_contents, sizeof(pcvd_format::table_of_contents_t));
+
+    // The section offsets and sizes are written after the sections
+    const uint64_t sections_position = writer.position();
+    const size_t sections_size =
+        sections.size() * sizeof(pcvd_format::section_t);
+    write(sections.data(), sections_size);
+    handle_written_chunk(current_progress += header_size + field_headers_size +
+                                             field_names_size);
+
+    // Copies the elements of the written points [first, first+n) to target
+    typedef std::function<void(size_t first, size_t n, uint8_t* target)>
+        gather_t;
+    // Encodes the gathered elements of the written points [first, first+n)
+    typedef std::function<void(size_t first, const uint8_t* elements, size_t n,
+                               std::vector<uint8_t>* block)>
+        encode_t;
+
+    auto gather_points = [&order](const uint8_t* source, size_t element_size,
+                                  size_t source_stride) -> gather_t {
+      return [&order, source, element_size, source_stride](
+                 size_t first, size_t n, uint8_t* target) {
+        for (size_t i = first; i < first + n; ++i) {
+          const size_t point = order.empty() ? i : order[i];
+          std::memcpy(target, source + point * source_stride, element_size);
+          target += element_size;
+        }
+      };
+    };
+
+    // Quantizing the coordinates moves points across the splitting planes of
+    // the kd tree, so it's built again on the decoded coordinates of the
+    // written points
+    const bool rebuild_kd_tree = save_kd_tree && compress && save_vertex_data;
+    Buffer quantized_vertices;
+    KDTreeIndex quantized_kd_tree;
+    if (rebuild_kd_tree)
+      quantized_vertices.resize(num_points * PointCloud::stride);
+
+    // Otherwise, the kd tree keeps its structure, but refers to the new point
+    // indices
+    std::vector<size_t> new_index_of_point;
+    if (save_kd_tree && !rebuild_kd_tree && !order.empty()) {
+      new_index_of_point.resize(num_points);
+      for (size_t i = 0; i < num_points; ++i)
+        new_index_of_point[order[i]] = i;
+    }
+    const gather_t gather_kd_tree = [&](size_t first, size_t n,
+                                        uint8_t* target) {
+      const KDTreeIndex::point_index_t* tree =
+          rebuild_kd_tree ? quantized_kd_tree.data()
+                          : pointcloud.kdtree_index.data();
+      for (size_t i = first; i < first + n; ++i) {
+        const uint64_t index = new_index_of_point.empty()
+                                   ? uint64_t(tree[i])
+                                   : new_index_of_point[size_t(tree[i])];
+        std::memcpy(target, &index, sizeof(uint64_t));
+        target += sizeof(uint64_t);
+      }
+    };
+
+    // Writes the elements of all points. Compressed sections are encoded in
+    // batches of blocks in parallel.
+    std::vector<uint8_t> write_buffer;
+    uint64_t section_position = 0;
+    auto write_points = [&](size_t element_size, const gather_t& gather,
+                            const encode_t& encode) {
+      const size_t points_per_block = pcvd_codec::points_per_block();
+      const size_t num_blocks =
+          (num_points + points_per_block - 1) / points_per_block;
+
+      if (!compress) {
+        write_buffer.resize(points_per_block * element_size);
+        for (size_t first = 0; first < num_points; first += points_per_block) {
+          const size_t n = std::min(points_per_block, num_points - first);
+          gather(first, n, write_buffer.data());
+          write(write_buffer.data(), n * element_size);
+          handle_written_chunk(current_progress +=
+                               int64_t(n * element_size));
+        }
+        return;
+      }
+
+      pcvd_codec::section_header_t section_header;
+      section_header.number_blocks = uint32_t(num_blocks);
+      section_header.points_per_block = uint32_t(points_per_block);
+      std::vector<uint64_t> block_sizes(num_blocks, 0);
+
+      const uint64_t block_sizes_position =
+          writer.position() + sizeof(pcvd_codec::section_header_t);
+      write(&section_header, sizeof(pcvd_codec::section_header_t));
+      write(block_sizes.data(), num_blocks * sizeof(uint64_t));
+
+      const size_t num_threads = num_threads_for_blocks(num_blocks);
+      const size_t blocks_per_batch = num_threads * 4;
+      std::vector<std::vector<uint8_t>> elements(num_threads);
+      std::vector<std::vector<uint8_t>> blocks(blocks_per_batch);
+
+      for (size_t batch = 0; batch < num_blocks; batch += blocks_per_batch) {
+        const size_t batch_size =
+            std::min(blocks_per_batch, num_blocks - batch);
+        process_blocks_in_parallel(
+            batch_size,
+            [&](size_t i, size_t thread) -> int64_t {
+              const size_t first = (batch + i) * points_per_block;
+              const size_t n = std::min(points_per_block, num_points - first);
+              elements[thread].resize(n * element_size);
+              gather(first, n, elements[thread].data());
+              encode(first, elements[thread].data(), n, &blocks[i]);
+              return int64_t(n * element_size);
+            },
+            current_progress);
+
+        for (size_t i = 0; i < batch_size; ++i) {
+          write(blocks[i].data(), blocks[i].size());
+          block_sizes[batch + i] = blocks[i].size();
+        }
+        const size_t batch_points =
+            std::min(num_points, (batch + batch_size) * points_per_block) -
+            batch * points_per_block;
+        handle_written_chunk(current_progress +=
+                             int64_t(batch_points * element_size));
+      }
+
+      writer.write_at(block_sizes_position, block_sizes.data(),
+                      num_blocks * sizeof(uint64_t));
+      for (size_t i = 0; i < num_blocks; ++i)
+        checksum.replace_word(
+            block_sizes_position - section_position + i * sizeof(uint64_t), 0,
+            block_sizes[i]);
+    };
+
+    const glm::vec3 extent = header.aabb.size();
+    float step = coordinate_step;
+    if (!(step > 0.f))
+      step = glm::max(extent.x, glm::max(extent.y, extent.z)) / float(1 << 20);
+    if (!std::isfinite(step)) step = 0.f;
+    const encode_t encode_vertices = [step](size_t, const uint8_t* elements,
+                                            size_t n,
+                                            std::vector<uint8_t>* block) {
+      pcvd_codec::encode_vertices(
+          reinterpret_cast<const PointCloud::vertex_t*>(elements), n, step,
+          block);
+    };
+    // Keeps the decoded vertices for rebuilding the kd tree
+    const encode_t encode_written_vertices =
+        [&](size_t first, const uint8_t* elements, size_t n,
+            std::vector<uint8_t>* block) {
+          encode_vertices(first, elements, n, block);
+          if (rebuild_kd_tree)
+            pcvd_codec::decode_vertices(
+                block->data(), block->size(),
+                reinterpret_cast<PointCloud::vertex_t*>(
+                    quantized_vertices.data() + first * PointCloud::stride),
+                n);
+        };
+    const encode_t encode_indices = [](size_t, const uint8_t* elements,
+                                       size_t n, std::vector<uint8_t>* block) {
+      pcvd_codec::encode_indices(reinterpret_cast<const uint64_t*>(elements),
+                                 n, block);
+    };
+
+    auto remap_cache_entry = pointcloud.remap_cache.entries().begin();
+    for (size_t section_index = 0; section_index < sections.size();
+         ++section_index) {
+      pcvd_format::section_t& section = sections[section_index];
+      write_padding();
+      section.offset = section_position = writer.position();
+      checksum = pcvd_checksum::accumulator_t();
+
+      switch (section.type) {
+        case pcvd_format::section_type_t::SHADER:
+          write_shader();
+          handle_written_chunk(current_progress += int64_t(section.size));
+          break;
+        case pcvd_format::section_type_t::ORIGIN: {
+          const float64_t origin[3] = {pointcloud.origin.x,
+                                       pointcloud.origin.y,
+                                       pointcloud.origin.z};
+          write(origin, sizeof(origin));
+          handle_written_chunk(current_progress += int64_t(section.size));
+          break;
+        }
+        case pcvd_format::section_type_t::SPATIAL_CHUNKS:
+          write(chunks.data(), size_t(section.size));
+          handle_written_chunk(current_progress += int64_t(section.size));
+          break;
+        case pcvd_format::section_type_t::VERTEX_DATA:
+          write_points(PointCloud::stride,
+                       gather_points(pointcloud.coordinate_color.data(),
+                                     PointCloud::stride, PointCloud::stride),
+                       encode_written_vertices);
+          if (rebuild_kd_tree) {
+            // the decoded coordinates might exceed the aabb by half a step
+            const aabb_t quantized_aabb = aabb_t::fromVertices(
+                reinterpret_cast<const glm::vec3*>(quantized_vertices.data()),
+                num_points, PointCloud::stride);
+            if (quantized_aabb.is_valid()) {
+              header.aabb |= quantized_aabb;
+              writer.write_at(0, &header, size_t(header_size));
+            }
+          }
+          break;
+        case pcvd_format::section_type_t::PROPERTY_COLUMN: {
+          const int field = int(section.index);
+          const data_type::base_type_t type = pointcloud.user_data_types[field];
+          const size_t value_size = data_type::size_of_type(type);
+          const gather_t gather_column =
+              pointcloud.is_user_data_column_pending(field)
+                  ? gather_points(
+                        pointcloud.pending_user_data_columns[size_t(field)]
+                            .data(),
+                        value_size, value_size)
+                  : gather_points(pointcloud.user_data.data() +
+                                      pointcloud.user_data_offset[field],
+                                  value_size, pointcloud.user_data_stride);
+          write_points(value_size, gather_column,
+                       [type](size_t, const uint8_t* elements, size_t n,
+                              std::vector<uint8_t>* block) {
+                         pcvd_codec::encode_values(type, elements, n, block);
+                       });
+          break;
+        }
+        case pcvd_format::section_type_t::KD_TREE:
+          if (rebuild_kd_tree) {
+            quantized_kd_tree.build(
+                header.aabb, quantized_vertices.data(), num_points,
+                PointCloud::stride, [this](size_t, size_t) {
+                  return !cancellation_token.is_canceled();
+                });
+            if (!quantized_kd_tree.is_initialized()) throw canceled_t();
+          }
+          write_points(sizeof(uint64_t), gather_kd_tree, encode_indices);
+          break;
+        case pcvd_format::section_type_t::REMAP_CACHE_ENTRY:
+          write_points(
+              PointCloud::stride,
+              gather_points((remap_cache_entry++)->coordinate_color.data(),
+                            PointCloud::stride, PointCloud::stride),
+              encode_vertices);
+          break;
+        case pcvd_format::section_type_t::CHECKSUMS: {
+          // The own entry is the checksum of the file up to the end of the
+          // table of contents
+          pcvd_checksum::accumulator_t header_checksum;
+          header_checksum.append(&header, size_t(header_size));
+          header_checksum.append(field_descriptions.data(),
+                                 size_t(field_headers_size));
+          header_checksum.append(joined_field_names.c_str(),
+                                 size_t(field_names_size));
+          header_checksum.append(&table_of_contents,
+                                 sizeof(pcvd_format::table_of_contents_t));
+          header_checksum.append(sections.data(), sections_size);
+          checksums[section_index] = header_checksum.checksum();
+
+          write(checksums.data(), size_t(section.size));
+          handle_written_chunk(current_progress += int64_t(section.size));
+          break;
+        }
+      }
+
+      section.size = writer.position() - section.offset;
+      if (section.type != pcvd_format::section_type_t::CHECKSUMS)
+        checksums[section_index] = checksum.checksum();
+    }
+
+    writer.write_at(sections_position, sections.data(), sections_size);
+
+    writer.commit();
+    return true;
+  }
+
+  write(&header, size_t(header_size));
   handle_written_chunk(current_progress += header_size);
 
-  stream.write(reinterpret_cast<const char*>(field_descriptions.data()),
-               field_headers_size);
+  write(field_descriptions.data(), size_t(field_headers_size));
   handle_written_chunk(current_progress += field_headers_size);
 
-  stream.write(joined_field_names.c_str(), field_names_size);
+  write(joined_field_names.c_str(), size_t(field_names_size));
   handle_written_chunk(current_progress += field_names_size);
 
+  // Writes the elements of the exported points from a tightly packed array
+  auto write_exported_points = [&](const uint8_t* elements,
+                                   size_t element_size) {
+    for (const PointCloud::point_range_t& range : exported_ranges)
+      write(elements + range.begin * element_size,
+            (range.end - range.begin) * element_size);
+  };
+
   if (save_vertex_data) {
-    stream.write(
-        reinterpret_cast<const char*>(pointcloud.coordinate_color.data()),
-        vertex_data_size);
+    write_padding();
+    write_exported_points(pointcloud.coordinate_color.data(),
+                          PointCloud::stride);
     handle_written_chunk(current_progress += vertex_data_size);
   }
-  stream.write(reinterpret_cast<const char*>(pointcloud.user_data.data()),
-               point_data_size);
+  write_padding();
+  write_exported_points(pointcloud.user_data.data(),
+                        pointcloud.user_data_stride);
   handle_written_chunk(current_progress += point_data_size);
   if (save_kd_tree) {
-    stream.write(reinterpret_cast<const char*>(pointcloud.kdtree_index.data()),
-                 kd_tree_size);
+    write_padding();
+    write(pointcloud.kdtree_index.data(), size_t(kd_tree_size));
     handle_written_chunk(current_progress += kd_tree_size);
   }
 
-  stream.write(reinterpret_cast<const char*>(&shader_description),
-               sizeof(shader_description));
-  stream.write(shader_used_properies_bytes.data(),
-               shader_used_properies_bytes.length());
-  stream.write(shader_coordinate_bytes.data(),
-               shader_coordinate_bytes.length());
-  stream.write(shader_color_bytes.data(), shader_color_bytes.length());
-  stream.write(shader_node_bytes.data(), shader_node_bytes.length());
+  if (save_shader) {
+    write_shader();
+    handle_written_chunk(current_progress += shader_data_size);
+  }
+
+  if (save_remap_cache) {
+    write(&remap_cache_description, sizeof(remap_cache_description));
+    handle_written_chunk(current_progress +=
+                         sizeof(pcvd_format::remap_cache_description_t));
+
+    for (const RemapCache::entry_t& entry : pointcloud.remap_cache.entries()) {
+      write(&entry.key, sizeof(RemapCache::key_t));
+      write_padding();
+      write_exported_points(entry.coordinate_color.data(), PointCloud::stride);
+      handle_written_chunk(current_progress += remap_cache_entry_size);
+    }
+  }
 
+  writer.commit();
   return true;
 }
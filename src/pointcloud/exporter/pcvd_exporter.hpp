@@ -10,6 +10,14 @@ class PcvdExporter final : public AbstractPointCloudExporter {
   bool save_kd_tree = true;
   bool save_vertex_data = true;
   bool save_shader = true;
+  bool save_remap_cache = true;
+  bool align_sections = true;
+  bool column_sections = true;  // implies aligned sections
+  bool spatial_chunks = true;   // needs column sections and vertex data
+  bool compress = false;         // implies column sections
+
+  // Quantization step of compressed coordinates (0: 2^-20 of the extent)
+  float coordinate_step = 0.f;
 
  protected:
   bool export_implementation() override;
@@ -1,5 +1,7 @@
+#include <cstring>
 #include <fstream>
 #include <pointcloud/exporter/ply_exporter.hpp>
+#include <pointcloud/property_view.hpp>
 
 typedef data_type::BASE_TYPE BASE_TYPE;
 
@@ -10,45 +12,126 @@ PlyExporter::PlyExporter(const std::string& output_file,
     : AbstractPointCloudExporter(output_file, pointcloud) {}
 
 bool PlyExporter::export_implementation() {
-  std::ofstream stream(output_file, std::ios_base::out);  // not a binary stream
-  stream << std::fixed;
-
-  if (pointcloud.num_points > std::numeric_limits<int64_t>::max()) {
-    std::cerr
-        << "Internal error: too large pointcloud too be written into a file"
-        << std::endl;
-    return false;
-  }
+  std::ofstream stream(output_file,
+                       std::ios_base::out | std::ios_base::binary);
+  if (!stream)
+    throw QString("Could not open %0 for writing")
+        .arg(QString::fromStdString(output_file));
+
+  // binary_little_endian on the supported platforms
+  write_ply_header(stream, pointcloud, num_exported_points,
+                   Q_BYTE_ORDER == Q_BIG_ENDIAN ? "binary_big_endian"
+                                                : "binary_little_endian");
+
+  write_binary_vertices(stream);
 
-  total_progress = int64_t(pointcloud.num_points);
+  stream.close();
+  if (stream.fail())
+    throw QString("Could not write %0")
+        .arg(QString::fromStdString(output_file));
 
-  if (!stream.is_open()) return false;
+  return true;
+}
 
+void write_ply_header(std::ostream& stream, const PointCloud& pointcloud,
+                      size_t num_points, const char* format) {
   const int num_properties = pointcloud.user_data_types.length();
 
   stream << "ply\n";
-  stream << "format ascii 1.0\n";
-  stream << "element vertex " << pointcloud.num_points << "\n";
+  stream << "format " << format << " 1.0\n";
+  stream << "element vertex " << num_points << "\n";
   for (int i = 0; i < num_properties; ++i)
     stream << "property " << format_data_type(pointcloud.user_data_types[i])
            << " " << pointcloud.user_data_names[i].toStdString() << "\n";
   stream << "end_header\n";
+}
 
-  const uint8_t* data = pointcloud.user_data.data();
-  const data_type::base_type_t* data_types = pointcloud.user_data_types.data();
-  for (size_t point_index = 0; point_index < pointcloud.num_points;
-       ++point_index) {
-    for (int i = 0; i < num_properties; ++i) {
-      if (i != 0) stream << ' ';
+void PlyExporter::write_binary_vertices(std::ostream& stream) {
+  const int num_properties = pointcloud.user_data_types.length();
 
-      data += read_value_from_buffer_to_stream(stream, data_types[i], data);
-    }
-    handle_written_chunk(int64_t(point_index));
+  // The records of a binary ply file are the properties packed in the order
+  // of the header. If the user data has the same layout and no coordinates
+  // are moved back by the origin, it's written as it is, otherwise the
+  // records are packed into a buffer first.
+  QVector<size_t> record_offsets;
+  QVector<double> offsets;
+  size_t record_size = 0;
+  bool has_offsets = false;
+  for (int i = 0; i < num_properties; ++i) {
+    record_offsets << record_size;
+    record_size += data_type::size_of_type(pointcloud.user_data_types[i]);
+    offsets << pointcloud.offset_of_property(i);
+    has_offsets = has_offsets || offsets.last() != 0.;
+  }
+  const bool packed = record_size == pointcloud.user_data_stride &&
+                      record_offsets == pointcloud.user_data_offset &&
+                      !has_offsets;
+
+  if (record_size == 0) return;
 
-    stream << "\n";
+  // at most one megabyte per write and one progress update per megabyte
+  const size_t points_per_chunk =
+      glm::max<size_t>(1, (size_t(1) << 20) / record_size);
+
+  total_progress = int64_t(num_exported_points * record_size);
+  int64_t current_progress = 0;
+
+  std::vector<uint8_t> buffer(packed ? 0 : points_per_chunk * record_size);
+
+  // The exported points are written range by range
+  const size_t stride = pointcloud.user_data_stride;
+  for (const PointCloud::point_range_t& range : exported_ranges) {
+    for (size_t first_point = range.begin; first_point < range.end;
+         first_point += points_per_chunk) {
+      const size_t num_points =
+          glm::min(points_per_chunk, range.end - first_point);
+      const uint8_t* records =
+          pointcloud.user_data.data() + first_point * stride;
+
+      if (!packed) {
+        for (int i = 0; i < num_properties; ++i) {
+          const size_t size =
+              data_type::size_of_type(pointcloud.user_data_types[i]);
+          const uint8_t* source = records + pointcloud.user_data_offset[i];
+          uint8_t* target = buffer.data() + record_offsets[i];
+          if (offsets[i] == 0.) {
+            for (size_t p = 0; p < num_points; ++p)
+              std::memcpy(target + p * record_size, source + p * stride,
+                          size);
+            continue;
+          }
+
+          // only floating point properties have an offset
+          visit_property_type(
+              pointcloud.user_data_types[i], [&](auto type_value) {
+                typedef decltype(type_value) value_t;
+                const PropertyView<value_t> values(source, stride,
+                                                   num_points);
+                for (size_t p = 0; p < num_points; ++p)
+                  write_value_to_buffer(
+                      target + p * record_size,
+                      value_t(float64_t(values[p]) + offsets[i]));
+              });
+        }
+        records = buffer.data();
+      }
+
+      stream.write(reinterpret_cast<const char*>(records),
+                   std::streamsize(num_points * record_size));
+      if (!stream)
+        throw QString("Could not write %0")
+            .arg(QString::fromStdString(output_file));
+
+      // short ranges are reported together
+      const int64_t previous_progress = current_progress;
+      current_progress += int64_t(num_points * record_size);
+      if (previous_progress / (int64_t(1) << 20) !=
+          current_progress / (int64_t(1) << 20))
+        handle_written_chunk(current_progress);
+    }
   }
 
-  return true;
+  handle_written_chunk(current_progress);
 }
 
 const char* format_data_type(data_type::base_type_t type) {
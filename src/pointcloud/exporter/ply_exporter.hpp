@@ -3,12 +3,26 @@
 
 #include <pointcloud/exporter/abstract_exporter.hpp>
 
+#include <ostream>
+
+/**
+Implementation for saving binary ply files. Ascii ply files are saved by the
+TextExporter.
+*/
 class PlyExporter final : public AbstractPointCloudExporter {
  public:
   PlyExporter(const std::string& output_file, const PointCloud& pointcloud);
 
  protected:
   bool export_implementation() override;
+
+ private:
+  void write_binary_vertices(std::ostream& stream);
 };
 
+// Writes the ply header of num_points vertices with all properties of the
+// pointcloud
+void write_ply_header(std::ostream& stream, const PointCloud& pointcloud,
+                      size_t num_points, const char* format);
+
 #endif  // POINTCLOUD_WORKERS_EXPORTER_PLY_HPP_
@@ -0,0 +1,237 @@
+#include <core_library/types.hpp>
+#include <pointcloud/exporter/ply_exporter.hpp>
+#include <pointcloud/exporter/text_exporter.hpp>
+#include <pointcloud/property_view.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t points_per_block = 16384;
+
+// Longest formatted value including the separator (a float64 with 17 digits,
+// sign, decimal point and exponent)
+const size_t max_value_length = 25;
+
+// A column of the exported lines
+struct column_t {
+  const uint8_t* first_value;
+  size_t stride;
+  data_type::base_type_t type;
+  double offset;  // added to the values, unless 0
+};
+
+// The formatted values of a column, each in a slot of max_value_length
+// characters
+struct formatted_column_t {
+  std::vector<char> text;
+  std::vector<uint8_t> lengths;
+};
+
+void format_column(const column_t& column, const std::vector<size_t>& points,
+                   formatted_column_t* formatted);
+
+template <typename value_type>
+char* format_value(char* begin, char* end, value_type value);
+
+}  // namespace
+
+TextExporter::TextExporter(const std::string& output_file,
+                           const PointCloud& pointcloud, format_t format)
+    : AbstractPointCloudExporter(output_file, pointcloud), format(format) {}
+
+/*
+The blocks are formatted in windows of two blocks per thread. While a window is
+formatted in parallel, the writer thread writes the previous window in order.
+*/
+bool TextExporter::export_implementation() {
+  // a binary stream, so the lines end with "\n" on all platforms
+  std::ofstream stream(output_file,
+                       std::ios_base::out | std::ios_base::binary);
+  if (!stream)
+    throw QString("Could not open %0 for writing")
+        .arg(QString::fromStdString(output_file));
+
+  const size_t num_points = num_exported_points;
+
+  if (format == format_t::PLY)
+    write_ply_header(stream, pointcloud, num_points, "ascii");
+
+  // The columns of the lines
+  std::vector<column_t> columns;
+  if (format == format_t::PLY) {
+    for (int i = 0; i < pointcloud.user_data_types.length(); ++i)
+      columns.push_back(
+          column_t{pointcloud.user_data.data() + pointcloud.user_data_offset[i],
+                   pointcloud.user_data_stride, pointcloud.user_data_types[i],
+                   pointcloud.offset_of_property(i)});
+  } else {
+    const uint8_t* vertices = pointcloud.coordinate_color.data();
+    for (int i = 0; i < 3; ++i)
+      columns.push_back(column_t{
+          vertices + offsetof(PointCloud::vertex_t, coordinate) +
+              size_t(i) * sizeof(float32_t),
+          PointCloud::stride, data_type::base_type_t::FLOAT32,
+          pointcloud.origin[i]});
+    for (int i = 0; i < 3; ++i)
+      columns.push_back(column_t{
+          vertices + offsetof(PointCloud::vertex_t, color) + size_t(i),
+          PointCloud::stride, data_type::base_type_t::UINT8, 0.});
+  }
+  const size_t max_line_length = columns.size() * max_value_length + 1;
+
+  // The buffers of every thread
+  struct block_buffers_t {
+    std::vector<size_t> points;
+    std::vector<formatted_column_t> columns;
+  };
+  std::vector<block_buffers_t> buffers(num_threads_for_blocks(
+      (num_points + points_per_block - 1) / points_per_block));
+
+  // Formats the points of the block column by column and assembles the lines
+  // into text, returns the number of points
+  auto format_block = [&](size_t block, size_t thread, std::string* text) {
+    const size_t first_point = block * points_per_block;
+    const size_t n = glm::min(first_point + points_per_block, num_points) -
+                     first_point;
+    block_buffers_t& buffer = buffers[thread];
+
+    buffer.points.clear();
+    for_each_exported_point(
+        first_point, n, [&](size_t point) { buffer.points.push_back(point); });
+
+    buffer.columns.resize(columns.size());
+    for (size_t j = 0; j < columns.size(); ++j)
+      format_column(columns[j], buffer.points, &buffer.columns[j]);
+
+    text->resize(n * max_line_length);
+    char* const begin = &(*text)[0];
+    char* c = begin;
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < columns.size(); ++j) {
+        if (j != 0) *c++ = ' ';
+        const formatted_column_t& column = buffer.columns[j];
+        const size_t length = column.lengths[i];
+        std::memcpy(c, column.text.data() + i * max_value_length, length);
+        c += length;
+      }
+      *c++ = '\n';
+    }
+
+    text->resize(size_t(c - begin));
+    return int64_t(n);
+  };
+
+  const size_t num_blocks =
+      (num_points + points_per_block - 1) / points_per_block;
+  const size_t blocks_per_window = 2 * num_threads_for_blocks(num_blocks);
+
+  total_progress = glm::max<int64_t>(1, int64_t(num_points));
+
+  std::vector<std::string> windows[2] = {
+      std::vector<std::string>(blocks_per_window),
+      std::vector<std::string>(blocks_per_window)};
+  std::thread writer;
+  bool write_failed = false;
+
+  try {
+    for (size_t first_block = 0, window = 0; first_block < num_blocks;
+         first_block += blocks_per_window, window = 1 - window) {
+      std::vector<std::string>& texts = windows[window];
+      const size_t num_window_blocks =
+          glm::min(blocks_per_window, num_blocks - first_block);
+
+      process_blocks_in_parallel(
+          num_window_blocks,
+          [&](size_t block, size_t thread) {
+            return format_block(first_block + block, thread, &texts[block]);
+          },
+          int64_t(first_block * points_per_block));
+
+      if (writer.joinable()) writer.join();
+      if (write_failed) break;
+
+      writer = std::thread([&stream, &texts, num_window_blocks,
+                            &write_failed]() {
+        for (size_t i = 0; i < num_window_blocks; ++i)
+          stream.write(texts[i].data(), std::streamsize(texts[i].size()));
+        write_failed = !stream;
+      });
+    }
+  } catch (...) {
+    if (writer.joinable()) writer.join();
+    throw;
+  }
+  if (writer.joinable()) writer.join();
+
+  stream.close();
+  if (write_failed || stream.fail())
+    throw QString("Could not write %0")
+        .arg(QString::fromStdString(output_file));
+
+  return true;
+}
+
+namespace {
+
+// The type of the column is resolved once, so the loop over the points is
+// compiled for it
+void format_column(const column_t& column, const std::vector<size_t>& points,
+                   formatted_column_t* formatted) {
+  const size_t n = points.size();
+  formatted->text.resize(n * max_value_length);
+  formatted->lengths.resize(n);
+
+  visit_property_type(column.type, [&](auto type_value) {
+    typedef decltype(type_value) value_t;
+
+    auto format_values = [&](const auto& transform) {
+      char* slot = formatted->text.data();
+      for (size_t i = 0; i < n; ++i, slot += max_value_length) {
+        const value_t value = read_value_from_buffer<value_t>(
+            column.first_value + points[i] * column.stride);
+        char* const end =
+            format_value(slot, slot + max_value_length, transform(value));
+        formatted->lengths[i] = uint8_t(end - slot);
+      }
+    };
+
+    if (column.offset == 0.)
+      format_values([](value_t value) { return value; });
+    else
+      format_values([offset = column.offset](value_t value) {
+        return float64_t(value) + offset;
+      });
+  });
+}
+
+// The shortest text, which is parsed back to the same value
+template <typename value_type>
+char* format_value(char* begin, char* end, value_type value) {
+#if !defined(__cpp_lib_to_chars)
+  // Standard libraries without to_chars for floating point values
+  if constexpr (std::is_floating_point<value_type>::value) {
+    std::ostringstream stream;
+    stream.imbue(std::locale::classic());
+    stream << std::setprecision(std::numeric_limits<value_type>::max_digits10)
+           << value;
+    const std::string text = stream.str();
+    return std::copy(text.begin(), text.end(), begin);
+  } else
+#endif
+  {
+    return std::to_chars(begin, end, value).ptr;
+  }
+}
+
+}  // namespace
@@ -0,0 +1,30 @@
+#ifndef POINTCLOUD_WORKERS_EXPORTER_TEXT_HPP_
+#define POINTCLOUD_WORKERS_EXPORTER_TEXT_HPP_
+
+#include <pointcloud/exporter/abstract_exporter.hpp>
+
+/**
+Implementation for saving text files with one point per line (ascii ply and
+xyz files). Blocks of points are formatted in parallel and written in order
+by a writer thread, so the output doesn't depend on the number of threads.
+
+Ascii ply files contain all properties, xyz files the coordinates and colors
+of the vertices ("x y z red green blue").
+*/
+class TextExporter final : public AbstractPointCloudExporter {
+ public:
+  enum class format_t {
+    PLY,
+    XYZ,
+  };
+
+  const format_t format;
+
+  TextExporter(const std::string& output_file, const PointCloud& pointcloud,
+               format_t format);
+
+ protected:
+  bool export_implementation() override;
+};
+
+#endif  // POINTCLOUD_WORKERS_EXPORTER_TEXT_HPP_
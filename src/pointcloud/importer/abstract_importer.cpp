@@ -1,15 +1,18 @@
 #include <core_library/print.hpp>
 #include <core_library/types.hpp>
 #include <pointcloud/importer/abstract_importer.hpp>
+#include <pointcloud/importer/las_importer.hpp>
 #include <pointcloud/importer/pcvd_importer.hpp>
 #include <pointcloud/importer/ply_importer.hpp>
+#include <pointcloud/importer/text_importer.hpp>
+#include <pointcloud/parallel_blocks.hpp>
 
-#include <QAbstractEventDispatcher>
 #include <QSettings>
 #include <QSharedPointer>
-#include <QThread>
 
+#include <algorithm>
 #include <iostream>
+#include <unordered_map>
 
 AbstractPointCloudImporter::~AbstractPointCloudImporter() {}
 
@@ -20,22 +23,80 @@ AbstractPointCloudImporter::importerForSuffix(QString suffix,
     return QSharedPointer<AbstractPointCloudImporter>(
         new PcvdImporter(filepath));
   } else if (suffix == "ply") {
+    if (TextImporter::is_supported_ascii_ply(filepath))
+      return QSharedPointer<AbstractPointCloudImporter>(
+          new TextImporter(filepath, TextImporter::format_t::PLY));
     return QSharedPointer<AbstractPointCloudImporter>(
         new PlyImporter(filepath));
+  } else if (suffix == "las") {
+    return QSharedPointer<AbstractPointCloudImporter>(
+        new LasImporter(filepath));
+  } else if (suffix == "xyz") {
+    return QSharedPointer<AbstractPointCloudImporter>(
+        new TextImporter(filepath, TextImporter::format_t::XYZ));
+  } else if (suffix == "pts") {
+    return QSharedPointer<AbstractPointCloudImporter>(
+        new TextImporter(filepath, TextImporter::format_t::PTS));
   } else
     return QSharedPointer<AbstractPointCloudImporter>();
 }
 
+QStringList AbstractPointCloudImporter::supportedSuffixes() {
+  return QStringList({"pcvd", "ply", "las", "xyz", "pts"});
+}
+
 QString AbstractPointCloudImporter::allSupportedFiletypes() {
-  return "All Supported (*.pcvd *.ply);;PCVD (*.pcvd);;PLY (*.ply)";
+  return "All Supported (*.pcvd *.ply *.las *.xyz *.pts);;PCVD (*.pcvd);;"
+         "PLY (*.ply);;LAS (*.las);;XYZ (*.xyz);;PTS (*.pts)";
 }
 
 void AbstractPointCloudImporter::import() {
   this->state = RUNNING;
 
+  {
+    std::lock_guard<std::mutex> lock(loaded_points_mutex);
+    loaded_points_readable = true;
+    loaded_points.clear();
+    num_read_loaded_points = 0;
+  }
+
+  region_of_interest_applied = false;
+  decimation_applied = false;
+  keeps_loaded_points = false;
+
   try {
-    if (import_implementation())
+    const bool imported = import_implementation();
+    keeps_loaded_points =
+        imported && (!use_region_of_interest || region_of_interest_applied) &&
+        (!decimation.is_enabled() || decimation_applied);
+    // otherwise, the pointcloud is modified from here on
+    if (!keeps_loaded_points) stop_publishing_loaded_points();
+
+    if (imported) {
+      if (use_region_of_interest && !region_of_interest_applied)
+        pointcloud = pointcloud.subset(pointcloud.point_ranges_in_region(
+            region_of_interest,
+            PointCloud::point_range_t{0, pointcloud.num_points}));
+      if (use_region_of_interest && pointcloud.num_points == 0)
+        throw QString("No points inside the region of interest");
+      if (decimation.is_enabled() && !decimation_applied &&
+          pointcloud.num_points > 0) {
+        const PointCloud::vertex_t* vertices = pointcloud.begin();
+        total_progress = int64_t(pointcloud.num_points);
+        point_selection_t selection;
+        if (select_points(
+                pointcloud.num_points,
+                PointCloud::stride + pointcloud.user_data_stride,
+                [vertices](size_t first_point, size_t num_points,
+                           glm::vec3* coordinates) {
+                  for (size_t i = 0; i < num_points; ++i)
+                    coordinates[i] = vertices[first_point + i].coordinate;
+                },
+                &selection))
+          pointcloud = pointcloud.subset(selection.selected_ranges());
+      }
       this->state = SUCCEEDED;
+    }
     else if (this->state == RUNNING)
       this->state = RUNTIME_ERROR;
   } catch (QString message) {
@@ -43,41 +104,189 @@ void AbstractPointCloudImporter::import() {
     this->state = INVALID_FILE;
   } catch (canceled_t) {
     this->state = CANCELED;
+    keep_only_loaded_points();
   } catch (...) {
     this->state = RUNTIME_ERROR;
   }
 
-  finished();
+  // The loaded points of a successful import stay readable, so the points
+  // published last can still be read
+  if (this->state != SUCCEEDED) keeps_loaded_points = false;
+  if (!keeps_loaded_points) stop_publishing_loaded_points();
+}
+
+void AbstractPointCloudImporter::read_new_loaded_points(
+    const std::function<void(const PointCloud::vertex_t*, size_t, size_t,
+                             size_t)>& read) {
+  std::lock_guard<std::mutex> lock(loaded_points_mutex);
+  if (!loaded_points_readable) return;
+
+  const PointCloud::vertex_t* vertices =
+      reinterpret_cast<const PointCloud::vertex_t*>(
+          pointcloud.coordinate_color.data());
+
+  for (; num_read_loaded_points < loaded_points.size();
+       ++num_read_loaded_points) {
+    const PointCloud::point_range_t& range =
+        loaded_points[num_read_loaded_points];
+    read(vertices, range.begin, range.end - range.begin,
+         pointcloud.num_points);
+  }
+}
+
+bool AbstractPointCloudImporter::published_all_points() {
+  std::lock_guard<std::mutex> lock(loaded_points_mutex);
+  if (!loaded_points_readable) return false;
+
+  // the published ranges don't overlap
+  size_t num_published_points = 0;
+  for (const PointCloud::point_range_t& range : loaded_points)
+    num_published_points += range.end - range.begin;
+  return num_published_points == pointcloud.num_points;
 }
 
 AbstractPointCloudImporter::AbstractPointCloudImporter(
     const std::string& input_file)
     : input_file(input_file), total_progress(progress_max()) {}
 
-void AbstractPointCloudImporter::cancel() { this->state = CANCELED; }
-
 void AbstractPointCloudImporter::handle_loaded_chunk(int64_t current_progress) {
   Q_ASSERT(current_progress <= total_progress);
 
-  auto process_events = []() {
-    QThread* thread = QThread::currentThread();
-    if (thread != nullptr && thread->eventDispatcher() != nullptr)
-      thread->eventDispatcher()->processEvents(
-          QEventLoop::EventLoopExec | QEventLoop::ExcludeUserInputEvents |
-          QEventLoop::ExcludeSocketNotifiers);
-  };
+  if (Q_UNLIKELY(cancellation_token.is_canceled())) throw canceled_t();
+
+  progress.set(current_progress, total_progress);
+}
+
+bool AbstractPointCloudImporter::select_points(
+    size_t num_points, size_t bytes_per_point,
+    const std::function<void(size_t, size_t, glm::vec3*)>& decode_coordinates,
+    point_selection_t* selection) {
+  decimation_applied = true;
+
+  const double ratio = decimation.ratio_for(num_points, bytes_per_point);
+  if (!decimation.is_enabled() ||
+      (decimation.mode != decimation_t::mode_t::VOXEL_GRID && ratio >= 1.))
+    return false;
 
-  process_events();
+  *selection = point_selection_t(num_points);
+  const size_t block_size = point_selection_t::points_per_block();
+  const size_t num_blocks = selection->num_blocks();
 
-  if (Q_UNLIKELY(this->state == CANCELED)) throw canceled_t();
+  if (decimation.mode == decimation_t::mode_t::VOXEL_GRID) {
+    // The first point of each cell represents the cell
+    typedef std::unordered_map<voxel_cell_t, size_t, voxel_cell_t::hash_t>
+        representatives_t;
+    std::vector<representatives_t> thread_representatives(
+        num_threads_for_blocks(num_blocks));
+    std::vector<std::vector<glm::vec3>> thread_coordinates(
+        thread_representatives.size());
 
-  float86_t progress = float86_t(current_progress) / float86_t(total_progress);
-  int discrete_progress_value = int(progress * 65536 + float86_t(0.5));
-  discrete_progress_value = glm::clamp(0, 65536, discrete_progress_value);
+    process_blocks_in_parallel(num_blocks, [&](size_t block, size_t thread) {
+      const size_t first_point = block * block_size;
+      const size_t block_num_points =
+          glm::min(block_size, num_points - first_point);
 
-  update_progress(discrete_progress_value);
+      std::vector<glm::vec3>& coordinates = thread_coordinates[thread];
+      representatives_t& representatives = thread_representatives[thread];
+      coordinates.resize(block_num_points);
+      decode_coordinates(first_point, block_num_points, coordinates.data());
 
-  process_events();
+      for (size_t i = 0; i < block_num_points; ++i) {
+        // points without valid coordinates are kept
+        if (glm::any(glm::isnan(coordinates[i])) ||
+            glm::any(glm::isinf(coordinates[i]))) {
+          selection->select(first_point + i);
+          continue;
+        }
+
+        auto inserted = representatives.emplace(
+            voxel_grid_cell(coordinates[i], decimation.voxel_size),
+            first_point + i);
+        if (!inserted.second)
+          inserted.first->second =
+              glm::min(inserted.first->second, first_point + i);
+      }
+
+      return int64_t(block_num_points);
+    });
+
+    representatives_t& representatives = thread_representatives.front();
+    for (size_t thread = 1; thread < thread_representatives.size(); ++thread) {
+      for (const auto& cell : thread_representatives[thread]) {
+        auto inserted = representatives.insert(cell);
+        if (!inserted.second)
+          inserted.first->second =
+              glm::min(inserted.first->second, cell.second);
+      }
+      thread_representatives[thread].clear();
+    }
+
+    for (const auto& cell : representatives) selection->select(cell.second);
+  } else {
+    process_blocks_in_parallel(num_blocks, [&](size_t block, size_t) {
+      selection->select_block(block, decimation.mode, ratio, decimation.seed);
+      return int64_t(glm::min(block_size, num_points - block * block_size));
+    });
+  }
+
+  selection->count_selected_points();
+  return true;
+}
+
+void AbstractPointCloudImporter::publish_loaded_points(size_t first_point,
+                                                       size_t num_points) {
+  if (num_points == 0) return;
+
+  std::lock_guard<std::mutex> lock(loaded_points_mutex);
+  if (!loaded_points_readable) return;
+
+  loaded_points.push_back(
+      PointCloud::point_range_t{first_point, first_point + num_points});
+}
+
+void AbstractPointCloudImporter::stop_publishing_loaded_points() {
+  std::lock_guard<std::mutex> lock(loaded_points_mutex);
+  loaded_points_readable = false;
+}
+
+// Called after canceling, once all threads writing the pointcloud are done
+void AbstractPointCloudImporter::keep_only_loaded_points() {
+  stop_publishing_loaded_points();
+
+  if (loaded_points.empty()) {
+    pointcloud = PointCloud();
+    return;
+  }
+
+  std::sort(loaded_points.begin(), loaded_points.end(),
+            [](const PointCloud::point_range_t& a,
+               const PointCloud::point_range_t& b) {
+              return a.begin < b.begin;
+            });
+  pointcloud = pointcloud.subset(loaded_points);
+  loaded_points.clear();
+}
+
+size_t AbstractPointCloudImporter::num_threads_for_blocks(size_t num_blocks) {
+  return ::num_threads_for_blocks(num_blocks);
+}
+
+void AbstractPointCloudImporter::process_blocks_in_parallel(
+    size_t num_blocks,
+    const std::function<int64_t(size_t, size_t)>& process_block,
+    int64_t first_progress) {
+  ::process_blocks_in_parallel(
+      num_blocks, process_block,
+      [this](int64_t progress) { handle_loaded_chunk(progress); },
+      first_progress);
+}
 
-  Q_ASSERT(this->state == RUNNING);
+task_t<void> start_import(
+    QSharedPointer<AbstractPointCloudImporter> importer) {
+  return run_task([importer](progress_counter_t progress,
+                             cancellation_token_t cancellation_token) {
+    importer->progress = progress;
+    importer->cancellation_token = cancellation_token;
+    importer->import();
+  });
 }
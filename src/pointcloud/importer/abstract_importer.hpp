@@ -1,15 +1,25 @@
 #ifndef POINTCLOUD_IMPORTER_ABSTRACTIMPORTER_HPP_
 #define POINTCLOUD_IMPORTER_ABSTRACTIMPORTER_HPP_
 
-#include <QObject>
+#include <core_library/task.hpp>
+#include <pointcloud/importer/point_selection.hpp>
 #include <pointcloud/pointcloud.hpp>
 
+#include <QSharedPointer>
+#include <QStringList>
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
 /**
 Parent class for different kinds of PointCloud formats to import.
-*/
-class AbstractPointCloudImporter : public QObject {
-  Q_OBJECT
 
+import() runs in the calling thread, usually the thread of a task (see
+start_import). The importer reports its progress to the progress counter and
+stops, once the cancellation token is canceled.
+*/
+class AbstractPointCloudImporter {
  public:
   enum state_t {
     IDLE,
@@ -27,29 +37,99 @@ class AbstractPointCloudImporter : public QObject {
 
   PointCloud pointcloud;
 
+  // Only the points inside the region (including its boundary) are imported
+  bool use_region_of_interest = false;
+  aabb_t region_of_interest;
+
+  // Subsamples the points (after applying the region of interest)
+  decimation_t decimation;
+
+  progress_counter_t progress;
+  cancellation_token_t cancellation_token;
+
   AbstractPointCloudImporter(const std::string& input_file);
-  ~AbstractPointCloudImporter();
+  virtual ~AbstractPointCloudImporter();
 
-  constexpr static int progress_max() { return 65536; }
+  constexpr static int progress_max() { return progress_counter_t::max(); }
 
   static QSharedPointer<AbstractPointCloudImporter> importerForSuffix(
       QString suffix, std::string filepath);
+  static QStringList supportedSuffixes();
   static QString allSupportedFiletypes();
 
- public slots:
-  void import();
-  void cancel();
+  // Calls read for the blocks of points loaded since the last call, while
+  // the import is still running. vertices are all vertices of the pointcloud
+  // being imported, of which [first_point, first_point+num_points) were
+  // loaded. Can be called from any thread, e.g. polled by the gui.
+  void read_new_loaded_points(
+      const std::function<void(const PointCloud::vertex_t* vertices,
+                               size_t first_point, size_t num_points,
+                               size_t total_num_points)>& read);
 
- signals:
-  void update_progress(int progress);
-  void finished();
+  // Whether the points published while importing are all points of the
+  // imported pointcloud, at their final position (until the pointcloud is
+  // moved out of the importer). A viewer, which read all of them after the
+  // import, already shows the whole pointcloud.
+  bool published_all_points();
+
+  void import();
 
  protected:
   int64_t total_progress = 0;
+  // Set by importers reading only the region of interest. Otherwise, the
+  // points outside are removed after importing all of them.
+  bool region_of_interest_applied = false;
+  // Set by select_points. Otherwise, the points are decimated after
+  // importing all of them.
+  bool decimation_applied = false;
+  // Sets the progress (of total_progress) and throws canceled_t, once the
+  // import is canceled
   void handle_loaded_chunk(int64_t progress);
 
- protected slots:
+  // Called by importers decoding the points directly into the allocated
+  // pointcloud, as soon as a block of points is completely loaded (from any
+  // thread). These points can be shown while the import is running and are
+  // kept, if the import is canceled.
+  void publish_loaded_points(size_t first_point, size_t num_points);
+
+  // Number of threads used by process_blocks_in_parallel
+  static size_t num_threads_for_blocks(size_t num_blocks);
+
+  // Calls process_block(block, thread) for all blocks using
+  // num_threads_for_blocks threads, while keeping the progress bar alive. The
+  // returned values are summed up to the progress (starting at
+  // first_progress).
+  void process_blocks_in_parallel(
+      size_t num_blocks,
+      const std::function<int64_t(size_t block, size_t thread)>& process_block,
+      int64_t first_progress = 0);
+
+  // Selects the points to import according to the decimation, before the
+  // pointcloud is allocated. Returns false, if all points are imported.
+  // decode_coordinates writes the coordinates of the given points and is
+  // only called for the voxel grid (which needs its own pass over the data).
+  bool select_points(
+      size_t num_points, size_t bytes_per_point,
+      const std::function<void(size_t first_point, size_t num_points,
+                               glm::vec3* coordinates)>& decode_coordinates,
+      point_selection_t* selection);
+
   virtual bool import_implementation() = 0;
+
+ private:
+  std::mutex loaded_points_mutex;
+  bool loaded_points_readable = false;
+  std::vector<PointCloud::point_range_t> loaded_points;
+  size_t num_read_loaded_points = 0;
+  // neither a subset nor a decimation is applied after importing
+  bool keeps_loaded_points = false;
+
+  void stop_publishing_loaded_points();
+  void keep_only_loaded_points();
 };
 
+// Imports in a new task, sharing its progress counter and cancellation token
+// with the importer. The state of the importer tells the result.
+task_t<void> start_import(QSharedPointer<AbstractPointCloudImporter> importer);
+
 #endif  // POINTCLOUD_IMPORTER_ABSTRACTIMPORTER_HPP_
@@ -0,0 +1,341 @@
+#include <core_library/types.hpp>
+#include <pointcloud/importer/las_importer.hpp>
+#include <pointcloud/importer/vertex_decoder.hpp>
+
+#include <QFile>
+#include <QFileInfo>
+
+#include <cstring>
+
+namespace {
+
+// Fields of the public header block needed for reading the point records
+struct las_header_t {
+  int version_major = 0;
+  int version_minor = 0;
+  size_t offset_to_point_data = 0;
+  int point_format = 0;
+  size_t record_length = 0;
+  size_t num_points = 0;
+  glm::dvec3 scale;
+  glm::dvec3 offset;
+  glm::dvec3 min_point;
+  glm::dvec3 max_point;
+};
+
+// Byte offsets of the fields within a point record. Negative offsets mark
+// fields missing in the point data record format.
+struct las_record_layout_t {
+  size_t min_record_length;
+  int return_number_bits;
+  int classification;
+  uint8_t classification_mask;
+  int gps_time;
+  int rgb;
+};
+
+las_header_t parse_las_header(const uint8_t* data, size_t size);
+las_record_layout_t las_record_layout(int point_format);
+
+template <typename value_type>
+value_type read_value(const uint8_t* data);
+
+}  // namespace
+
+LasImporter::LasImporter(const std::string& input_file)
+    : AbstractPointCloudImporter(input_file) {}
+
+bool LasImporter::import_implementation() {
+  QFile file(QString::fromStdString(input_file));
+  if (!file.open(QIODevice::ReadOnly))
+    throw QString("Could not open the file %0").arg(file.fileName());
+
+  const size_t file_size = size_t(file.size());
+  const uchar* file_data = file.map(0, file.size());
+  if (file_data == nullptr)
+    throw QString("Could not map the file %0 into memory")
+        .arg(QFileInfo(file).fileName());
+
+  const las_header_t header = parse_las_header(file_data, file_size);
+  const las_record_layout_t layout = las_record_layout(header.point_format);
+
+  if (Q_UNLIKELY(header.record_length < layout.min_record_length))
+    throw QString("Point records of format %0 need at least %1 bytes")
+        .arg(header.point_format)
+        .arg(layout.min_record_length);
+  if (Q_UNLIKELY(header.offset_to_point_data > file_size ||
+                 (file_size - header.offset_to_point_data) /
+                         header.record_length <
+                     header.num_points))
+    throw QString("Unexpected end of the point records in %0")
+        .arg(QFileInfo(file).fileName());
+
+  // Shifting the coordinates keeps the precision of the floats
+  glm::dvec3 origin = glm::round((header.min_point + header.max_point) * 0.5);
+  if (!glm::all(glm::lessThanEqual(header.min_point, header.max_point)) ||
+      glm::any(glm::isinf(origin)) || glm::any(glm::isnan(origin)))
+    origin = header.offset;
+
+  // The record fields are stored as typed user data
+  QVector<QString> property_names;
+  QVector<size_t> property_offsets;
+  QVector<data_type::base_type_t> property_types;
+  size_t stride = 0;
+  auto add_property = [&](QString name, data_type::base_type_t type,
+                          size_t size) {
+    property_names << name;
+    property_offsets << stride;
+    property_types << type;
+    stride += size;
+    return property_offsets.last();
+  };
+
+  const size_t x_property =
+      add_property("x", data_type::base_type_t::FLOAT64, 8);
+  add_property("y", data_type::base_type_t::FLOAT64, 8);
+  add_property("z", data_type::base_type_t::FLOAT64, 8);
+  const size_t gps_time_property =
+      layout.gps_time >= 0
+          ? add_property("gps_time", data_type::base_type_t::FLOAT64, 8)
+          : 0;
+  const size_t intensity_property =
+      add_property("intensity", data_type::base_type_t::UINT16, 2);
+  const size_t return_number_property =
+      add_property("return_number", data_type::base_type_t::UINT8, 1);
+  add_property("number_of_returns", data_type::base_type_t::UINT8, 1);
+  const size_t classification_property =
+      add_property("classification", data_type::base_type_t::UINT8, 1);
+  const size_t rgb_property =
+      layout.rgb >= 0 ? add_property("red", data_type::base_type_t::UINT8, 1)
+                      : 0;
+  if (layout.rgb >= 0) {
+    add_property("green", data_type::base_type_t::UINT8, 1);
+    add_property("blue", data_type::base_type_t::UINT8, 1);
+  }
+  // The records are padded, so the float64 values stay aligned. The padding
+  // is zeroed, as it's exported like the values.
+  const size_t values_size = stride;
+  stride = (stride + 7) / 8 * 8;
+
+  const size_t num_records = header.num_points;
+  const uint8_t* records = file_data + header.offset_to_point_data;
+
+  const size_t block_size = point_selection_t::points_per_block();
+  const size_t num_blocks = (num_records + block_size - 1) / block_size;
+
+  Q_ASSERT(num_records < size_t(std::numeric_limits<int64_t>::max() / 2));
+  total_progress = int64_t(layout.rgb >= 0 ? num_records * 2 : num_records);
+
+  auto coordinate_of_record = [&](const uint8_t* record, int dimension) {
+    return read_value<int32_t>(record + dimension * 4) *
+               header.scale[dimension] +
+           header.offset[dimension] - origin[dimension];
+  };
+
+  point_selection_t selection;
+  const bool decimate = select_points(
+      num_records, stride + PointCloud::stride,
+      [&](size_t first_point, size_t num_points, glm::vec3* coordinates) {
+        for (size_t i = 0; i < num_points; ++i)
+          for (int dimension = 0; dimension < 3; ++dimension)
+            coordinates[i][dimension] = float32_t(coordinate_of_record(
+                records + (first_point + i) * header.record_length,
+                dimension));
+      },
+      &selection);
+  const size_t num_points =
+      decimate ? selection.num_selected_points() : num_records;
+
+  pointcloud.aabb = aabb_t::invalid();
+  pointcloud.origin = origin;
+  pointcloud.set_user_data_format(stride, property_names, property_offsets,
+                                  property_types);
+  pointcloud.resize(num_points);
+
+  // The colors are 16 bit according to the specification, but some writers
+  // store 8 bit colors
+  int color_shift = 0;
+  if (layout.rgb >= 0) {
+    std::vector<uint16_t> thread_colors(num_threads_for_blocks(num_blocks), 0);
+    process_blocks_in_parallel(num_blocks, [&](size_t block, size_t thread) {
+      const size_t first_record = block * block_size;
+      const size_t end_record =
+          glm::min(first_record + block_size, num_records);
+
+      uint16_t colors = thread_colors[thread];
+      for (size_t i = first_record; i < end_record; ++i) {
+        const uint8_t* rgb = records + i * header.record_length + layout.rgb;
+        for (int channel = 0; channel < 3; ++channel)
+          colors |= read_value<uint16_t>(rgb + channel * 2);
+      }
+      thread_colors[thread] = colors;
+
+      return int64_t(end_record - first_record);
+    });
+
+    uint16_t colors = 0;
+    for (uint16_t c : thread_colors) colors |= c;
+    color_shift = colors > 0xff ? 8 : 0;
+  }
+
+  const int return_number_mask = (1 << layout.return_number_bits) - 1;
+  uint8_t* user_data = pointcloud.user_data.data();
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(
+      pointcloud.coordinate_color.data());
+
+  std::vector<aabb_t> thread_aabbs(num_threads_for_blocks(num_blocks),
+                                   aabb_t::invalid());
+
+  const int64_t first_progress = layout.rgb >= 0 ? int64_t(num_records) : 0;
+  process_blocks_in_parallel(
+      num_blocks,
+      [&](size_t block, size_t thread) {
+        const size_t first_record = block * block_size;
+        const size_t end_record =
+            glm::min(first_record + block_size, num_records);
+        const size_t first_point =
+            decimate ? selection.first_selected_point(block) : first_record;
+
+        aabb_t aabb = thread_aabbs[thread];
+        size_t point = first_point;
+        for (size_t i = first_record; i < end_record; ++i) {
+          if (decimate && !selection.is_selected(i)) continue;
+
+          const uint8_t* record = records + i * header.record_length;
+          uint8_t* values = user_data + point * stride;
+          PointCloud::vertex_t& vertex = vertices[point];
+          vertex._padding = padding<uint8_t>();
+          ++point;
+
+          std::memset(values + values_size, 0, stride - values_size);
+
+          for (int dimension = 0; dimension < 3; ++dimension) {
+            const float64_t value = coordinate_of_record(record, dimension);
+            std::memcpy(values + x_property + dimension * 8, &value, 8);
+            vertex.coordinate[dimension] = float32_t(value);
+          }
+          aabb |= vertex.coordinate;
+
+          std::memcpy(values + intensity_property, record + 12, 2);
+          const uint8_t returns = record[14];
+          values[return_number_property] = returns & return_number_mask;
+          values[return_number_property + 1] =
+              (returns >> layout.return_number_bits) & return_number_mask;
+          values[classification_property] =
+              record[layout.classification] & layout.classification_mask;
+          if (layout.gps_time >= 0)
+            std::memcpy(values + gps_time_property, record + layout.gps_time,
+                        8);
+
+          if (layout.rgb >= 0) {
+            for (int channel = 0; channel < 3; ++channel) {
+              const uint8_t color = uint8_t(
+                  read_value<uint16_t>(record + layout.rgb + channel * 2) >>
+                  color_shift);
+              values[rgb_property + channel] = color;
+              vertex.color[channel] = color;
+            }
+          } else {
+            vertex.color = glm::u8vec3(255);
+          }
+        }
+        thread_aabbs[thread] = aabb;
+        publish_loaded_points(first_point, point - first_point);
+
+        return int64_t(end_record - first_record);
+      },
+      first_progress);
+
+  for (const aabb_t& aabb : thread_aabbs)
+    vertex_decoder_t::merge_aabb(&pointcloud.aabb, aabb);
+
+  return true;
+}
+
+namespace {
+
+las_header_t parse_las_header(const uint8_t* data, size_t size) {
+  // The offsets of the fields are given by the specification
+  if (size < 227 || std::memcmp(data, "LASF", 4) != 0)
+    throw QString("Not a las file");
+
+  las_header_t header;
+  header.version_major = data[24];
+  header.version_minor = data[25];
+  if (header.version_major != 1 || header.version_minor < 2 ||
+      header.version_minor > 4)
+    throw QString("Unsupported las version %0.%1")
+        .arg(header.version_major)
+        .arg(header.version_minor);
+
+  const size_t header_size = read_value<uint16_t>(data + 94);
+  header.offset_to_point_data = read_value<uint32_t>(data + 96);
+  if (header_size > size || header.offset_to_point_data < header_size)
+    throw QString("Invalid las header");
+
+  // The upper two bits mark compressed point records
+  const uint8_t point_format = data[104];
+  if (point_format & 0xc0)
+    throw QString("Compressed las files (laz) are not supported");
+  header.point_format = point_format;
+  header.record_length = read_value<uint16_t>(data + 105);
+  header.num_points = read_value<uint32_t>(data + 107);
+
+  // Version 1.4 added a 64 bit point count. The legacy count is zero for
+  // files with more points or point formats above 5.
+  if (header.version_minor >= 4 && header_size >= 255)
+    header.num_points = size_t(read_value<uint64_t>(data + 247));
+
+  for (int dimension = 0; dimension < 3; ++dimension) {
+    header.scale[dimension] = read_value<float64_t>(data + 131 + dimension * 8);
+    header.offset[dimension] =
+        read_value<float64_t>(data + 155 + dimension * 8);
+    header.max_point[dimension] =
+        read_value<float64_t>(data + 179 + dimension * 16);
+    header.min_point[dimension] =
+        read_value<float64_t>(data + 187 + dimension * 16);
+  }
+
+  return header;
+}
+
+las_record_layout_t las_record_layout(int point_format) {
+  // Formats 0 to 5 share the legacy layout, formats 6 to 10 the extended one
+  switch (point_format) {
+    case 0:
+      return las_record_layout_t{20, 3, 15, 0x1f, -1, -1};
+    case 1:
+      return las_record_layout_t{28, 3, 15, 0x1f, 20, -1};
+    case 2:
+      return las_record_layout_t{26, 3, 15, 0x1f, -1, 20};
+    case 3:
+      return las_record_layout_t{34, 3, 15, 0x1f, 20, 28};
+    case 4:
+      return las_record_layout_t{57, 3, 15, 0x1f, 20, -1};
+    case 5:
+      return las_record_layout_t{63, 3, 15, 0x1f, 20, 28};
+    case 6:
+      return las_record_layout_t{30, 4, 16, 0xff, 22, -1};
+    case 7:
+      return las_record_layout_t{36, 4, 16, 0xff, 22, 30};
+    case 8:
+      return las_record_layout_t{38, 4, 16, 0xff, 22, 30};
+    case 9:
+      return las_record_layout_t{59, 4, 16, 0xff, 22, -1};
+    case 10:
+      return las_record_layout_t{67, 4, 16, 0xff, 22, 30};
+    default:
+      throw QString("Unsupported las point data record format %0")
+          .arg(point_format);
+  }
+}
+
+// las files are little endian, like the supported platforms
+template <typename value_type>
+value_type read_value(const uint8_t* data) {
+  value_type value;
+  std::memcpy(&value, data, sizeof(value_type));
+  return value;
+}
+
+}  // namespace
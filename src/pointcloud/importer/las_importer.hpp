@@ -0,0 +1,24 @@
+#ifndef POINTCLOUD_WORKERS_IMPORTER_LAS_HPP_
+#define POINTCLOUD_WORKERS_IMPORTER_LAS_HPP_
+
+#include <pointcloud/importer/abstract_importer.hpp>
+
+/**
+Implementation for loading las files (version 1.2 to 1.4, point data record
+formats 0 to 10). The file is mapped into memory and the point records are
+decoded in parallel blocks.
+
+The scaled integer coordinates are stored relative to the center of the file's
+bounding box (PointCloud::origin), so the precision of the coordinates doesn't
+depend on how far the points are away from the origin of their coordinate
+system. Compressed (laz) files are not supported.
+*/
+class LasImporter final : public AbstractPointCloudImporter {
+ public:
+  LasImporter(const std::string& input_file);
+
+ protected:
+  bool import_implementation() override;
+};
+
+#endif  // POINTCLOUD_WORKERS_IMPORTER_LAS_HPP_
@@ -0,0 +1,159 @@
+#include <pointcloud/importer/merge_pointclouds.hpp>
+#include <pointcloud/parallel_blocks.hpp>
+#include <pointcloud/property_view.hpp>
+
+#include <cstring>
+
+PointCloud merge_pointclouds(std::vector<PointCloud>* pointclouds,
+                             const QString& tile_id_property) {
+  PointCloud merged;
+
+  // The union of the properties
+  QVector<QString> names;
+  QVector<data_type::base_type_t> types;
+  size_t num_points = 0;
+  bool has_first_pointcloud = false;
+  glm::dvec3 origin(0);
+  for (PointCloud& pointcloud : *pointclouds) {
+    if (pointcloud.num_points == 0) continue;
+    num_points += pointcloud.num_points;
+    if (pointcloud.coordinates_need_remapping)
+      merged.coordinates_need_remapping = true;
+
+    if (!has_first_pointcloud) {
+      merged.shader = pointcloud.shader;
+      origin = pointcloud.origin;
+      has_first_pointcloud = true;
+    }
+
+    for (int i = 0; i < pointcloud.user_data_names.length(); ++i) {
+      const int property = names.indexOf(pointcloud.user_data_names[i]);
+      if (property < 0) {
+        names << pointcloud.user_data_names[i];
+        types << pointcloud.user_data_types[i];
+      } else if (types[property] != pointcloud.user_data_types[i]) {
+        types[property] = data_type::base_type_t::FLOAT64;
+      }
+    }
+  }
+
+  if (!names.contains(tile_id_property)) {
+    names << tile_id_property;
+    types << data_type::base_type_t::UINT32;
+  }
+  const int tile_id_column = names.indexOf(tile_id_property);
+
+  QVector<size_t> offsets;
+  size_t stride = 0;
+  for (data_type::base_type_t type : types) {
+    offsets << stride;
+    stride += data_type::size_of_type(type);
+  }
+
+  merged.set_user_data_format(stride, names, offsets, types);
+  merged.origin = origin;
+
+  // The pages of the merged buffers are only taken, when they're written,
+  // while the pointclouds are released one after the other. So the merge
+  // needs about as much memory as the pointclouds themselves.
+  merged.coordinate_color.resize_without_first_touch(num_points *
+                                                     PointCloud::stride);
+  merged.user_data.resize_without_first_touch(num_points * stride);
+  merged.resize(num_points);
+  merged.aabb = aabb_t::invalid();
+
+  const size_t block_size = 65536;
+  size_t target_point = 0;
+  for (size_t tile = 0; tile < pointclouds->size(); ++tile) {
+    PointCloud& pointcloud = (*pointclouds)[tile];
+    if (pointcloud.num_points == 0) continue;
+    pointcloud.load_all_user_data_columns();
+
+    // Moves the coordinates from the origin of the pointcloud to the common
+    // origin (added in double precision before they're rounded to floats)
+    const glm::dvec3 shift = pointcloud.origin - origin;
+    const bool is_shifted = shift != glm::dvec3(0);
+
+    // The values of a column are moved by the offset of the source property
+    // minus the one of the merged property
+    QVector<int> columns;
+    QVector<double> column_shifts;
+    for (int i = 0; i < pointcloud.user_data_names.length(); ++i) {
+      columns << names.indexOf(pointcloud.user_data_names[i]);
+      column_shifts << pointcloud.offset_of_property(i) -
+                           merged.offset_of_property(columns.last());
+    }
+
+    if (pointcloud.aabb.is_valid()) {
+      merged.aabb |= glm::vec3(glm::dvec3(pointcloud.aabb.min_point) + shift);
+      merged.aabb |= glm::vec3(glm::dvec3(pointcloud.aabb.max_point) + shift);
+    }
+
+    const size_t num_blocks =
+        (pointcloud.num_points + block_size - 1) / block_size;
+    process_blocks_in_parallel(
+        num_blocks,
+        [&](size_t block, size_t) {
+          const size_t first_point = block * block_size;
+          const size_t n =
+              glm::min(block_size, pointcloud.num_points - first_point);
+          const size_t first_target = target_point + first_point;
+
+          PointCloud::vertex_t* target_vertices =
+              reinterpret_cast<PointCloud::vertex_t*>(
+                  merged.coordinate_color.data()) +
+              first_target;
+          std::memcpy(target_vertices, pointcloud.begin() + first_point,
+                      n * PointCloud::stride);
+          if (is_shifted)
+            for (size_t p = 0; p < n; ++p)
+              target_vertices[p].coordinate = glm::vec3(
+                  glm::dvec3(target_vertices[p].coordinate) + shift);
+
+          uint8_t* target = merged.user_data.data() + first_target * stride;
+          std::memset(target, 0, n * stride);
+
+          for (int i = 0; i < columns.length(); ++i) {
+            const int column = columns[i];
+            if (column == tile_id_column) continue;
+
+            uint8_t* column_target = target + offsets[column];
+            const double column_shift = column_shifts[i];
+
+            // Both types are resolved once per column, not for every value
+            visit_property(pointcloud, i, [&](auto source_view) {
+              const auto source = source_view.block(first_point, n);
+              visit_property_type(types[column], [&](auto target_value) {
+                typedef decltype(target_value) target_t;
+                if (column_shift == 0.)
+                  for (size_t p = 0; p < n; ++p)
+                    write_value_to_buffer(column_target + p * stride,
+                                          target_t(float64_t(source[p])));
+                else
+                  for (size_t p = 0; p < n; ++p)
+                    write_value_to_buffer(
+                        column_target + p * stride,
+                        target_t(float64_t(source[p]) + column_shift));
+              });
+            });
+          }
+
+          const uint32_t tile_id = uint32_t(tile);
+          visit_property_type(types[tile_id_column], [&](auto target_value) {
+            typedef decltype(target_value) target_t;
+            uint8_t* column_target = target + offsets[tile_id_column];
+            for (size_t p = 0; p < n; ++p)
+              write_value_to_buffer(column_target + p * stride,
+                                    target_t(tile_id));
+          });
+
+          return int64_t(n);
+        },
+        [](int64_t) {});
+
+    target_point += pointcloud.num_points;
+    pointcloud.clear();
+  }
+
+  return merged;
+}
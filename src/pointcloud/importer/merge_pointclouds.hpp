@@ -0,0 +1,26 @@
+#ifndef POINTCLOUD_IMPORTER_MERGE_POINTCLOUDS_HPP_
+#define POINTCLOUD_IMPORTER_MERGE_POINTCLOUDS_HPP_
+
+#include <pointcloud/pointcloud.hpp>
+
+#include <vector>
+
+/*
+Merges pointclouds (e.g. the tiles of a dataset) into one pointcloud.
+
+The result has the properties of all pointclouds. Properties missing in a
+pointcloud are zero for its points, properties having different types in
+different pointclouds are stored as float64. The index of the pointcloud
+each point comes from is stored as the additional uint32 property
+tile_id_property. The shader and the origin of the first non empty
+pointcloud are used, the coordinates of the other pointclouds (and their
+coordinate properties x, y and z) are moved to this origin.
+
+The pointclouds are copied one after the other, each in parallel, and each
+is cleared right after it's copied. Throws a QString, if a pending
+property column of a pointcloud is corrupt.
+*/
+PointCloud merge_pointclouds(std::vector<PointCloud>* pointclouds,
+                             const QString& tile_id_property = "tile_id");
+
+#endif  // POINTCLOUD_IMPORTER_MERGE_POINTCLOUDS_HPP_
@@ -1,7 +1,14 @@
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <core_library/simd_kernels.hpp>
 #include <pointcloud/importer/pcvd_importer.hpp>
+#include <pointcloud/pcvd_checksum.hpp>
+#include <pointcloud/pcvd_codec.hpp>
 #include <pointcloud/pcvd_file_format.hpp>
 
+#include <QFile>
+
 PcvdImporter::PcvdImporter(const std::string& input_file)
     : AbstractPointCloudImporter(input_file) {}
 
@@ -32,7 +39,7 @@ bool PcvdImporter::import_implementation() {
   if (read_bytes != sizeof(pcvd_format::header_t))
     throw QString("Can't load corrupt file");
 
-  if (header.downwards_compatibility_version_number > 1)
+  if (header.downwards_compatibility_version_number > 7)
     throw QString("Incompatible file format version");
 
   if (header.number_points == 0) throw QString("Need at least one point");
@@ -46,6 +53,14 @@ bool PcvdImporter::import_implementation() {
     throw QString("corrupt header (invalid flags)");
   if (header.file_version_number == 1 && (header.flags & 0xfff8) != 0)
     throw QString("corrupt header (invalid flags)");
+  if (header.file_version_number == 2 && (header.flags & 0xfff0) != 0)
+    throw QString("corrupt header (invalid flags)");
+  if (header.file_version_number == 3 && (header.flags & 0xffe0) != 0)
+    throw QString("corrupt header (invalid flags)");
+  if (header.file_version_number == 4 && (header.flags & 0xffd0) != 0)
+    throw QString("corrupt header (invalid flags)");
+  if (header.file_version_number >= 5 && (header.flags & 0xff90) != 0)
+    throw QString("corrupt header (invalid flags)");
   if (header.file_version_number < 1 && header.shader_data_size != 0)
     throw QString("corrupt header (invalid padding)");
   if (header.reserved != 0) throw QString("corrupt header (invalid padding)");
@@ -61,6 +76,42 @@ bool PcvdImporter::import_implementation() {
   const bool load_kd_tree = header.flags & 0b1;
   const bool load_vertex = header.flags & 0b10;
   const bool load_shader = header.flags & 0b100;
+  const bool load_remap_cache = header.flags & 0b1000;
+  const bool aligned_sections = header.flags & 0b10000;
+  const bool has_table_of_contents = header.flags & 0b100000;
+  const bool compressed_sections = header.flags & 0b1000000;
+
+  if (compressed_sections && !has_table_of_contents)
+    throw QString("corrupt header (invalid flags)");
+
+  // The large sections are mapped into memory instead of being read
+  QSharedPointer<QFile> file(new QFile(QString::fromStdString(input_file)));
+  if (!file->open(QIODevice::ReadOnly))
+    throw QString("Could not open the file for mapping");
+
+  auto skip_padding = [&]() {
+    if (aligned_sections)
+      stream.seekg(std::streamoff(pcvd_format::padding_for_section_alignment(
+                       uint64_t(stream.tellg()))),
+                   std::ios_base::cur);
+  };
+
+  // Sections at unaligned offsets are read, as their elements could not be
+  // accessed in place.
+  auto load_section = [&](Buffer* buffer, std::streamsize size) {
+    skip_padding();
+    const std::streamsize offset = stream.tellg();
+    if (offset < 0 || offset + size > file->size())
+      throw QString("Incomplete file!");
+
+    if (offset % std::streamsize(sizeof(uint64_t)) == 0 &&
+        buffer->map_file_section(file, offset, size_t(size))) {
+      stream.seekg(size, std::ios_base::cur);
+    } else {
+      buffer->resize(size_t(size));
+      if (read(buffer->data(), size) != size) throw QString("Incomplete file!");
+    }
+  };
 
   std::streamsize header_size = sizeof(pcvd_format::header_t);
   std::streamsize field_headers_size =
@@ -133,59 +184,19 @@ bool PcvdImporter::import_implementation() {
   pointcloud.user_data_names = field_names;
   pointcloud.user_data_offset = field_data_offset;
   pointcloud.user_data_types = field_types;
-  pointcloud.resize(header.number_points);
+  pointcloud.num_points = header.number_points;
+  pointcloud.is_valid = true;
 
   handle_loaded_chunk(current_progress +=
                       field_headers_size + field_names_size);
 
-  if (load_vertex) {
-    read_bytes = read(pointcloud.coordinate_color.data(), vertex_data_size);
-    if (read_bytes != vertex_data_size) throw QString("Incomplete file!");
-    handle_loaded_chunk(current_progress += vertex_data_size);
-  }
-
-  read_bytes = read(pointcloud.user_data.data(), point_data_size);
-  if (read_bytes != point_data_size) throw QString("Incomplete file!");
-  handle_loaded_chunk(current_progress += point_data_size);
-
-  if (!load_vertex) {
-    uint8_t* coordinates = pointcloud.coordinate_color.data();
-
-    size_t ui_update = 0;
-    for (size_t i = 0; i < header.number_points; ++i) {
-      PointCloud::vertex_t vertex;
-
-      vertex.coordinate.x = std::numeric_limits<float>::quiet_NaN();
-      vertex.coordinate.y = std::numeric_limits<float>::quiet_NaN();
-      vertex.coordinate.z = std::numeric_limits<float>::quiet_NaN();
-      vertex.color.r = 255;
-      vertex.color.g = 0;
-      vertex.color.b = 255;
-
-      write_value_to_buffer<PointCloud::vertex_t>(coordinates, vertex);
-
-      coordinates += PointCloud::stride;
-    }
-    handle_loaded_chunk(current_progress += ui_update * PointCloud::stride);
-  }
-
-  if (load_kd_tree) {
-    read_bytes = read(pointcloud.kdtree_index.alloc_for_loading(
-                          header.number_points, header.aabb),
-                      kd_tree_size);
-    if (read_bytes != kd_tree_size) throw QString("Incomplete file!");
-    handle_loaded_chunk(current_progress += kd_tree_size);
-  }
-
-  if (load_shader) {
+  auto read_shader = [&]() {
     QByteArray text_data;
     pcvd_format::shader_description_t shader_description;
 
     read_bytes = read(&shader_description, sizeof(shader_description));
     if (read_bytes != sizeof(pcvd_format::shader_description_t))
       throw QString("Incomplete file!");
-    handle_loaded_chunk(current_progress +=
-                        sizeof(pcvd_format::shader_description_t));
 
     text_data.resize(shader_description.used_properties_length);
     read(text_data.data(), shader_description.used_properties_length);
@@ -203,6 +214,518 @@ bool PcvdImporter::import_implementation() {
     text_data.resize(shader_description.node_data_length);
     read(text_data.data(), shader_description.node_data_length);
     pointcloud.shader.node_data = QString::fromUtf8(text_data);
+  };
+
+  // Points without vertex data are shown after applying a shader
+  auto fill_vertices_without_coordinates = [&]() {
+    pointcloud.coordinate_color.resize(size_t(vertex_data_size));
+    pointcloud.coordinates_need_remapping = true;
+
+    PointCloud::vertex_t vertex;
+    vertex.coordinate = glm::vec3(std::numeric_limits<float>::quiet_NaN());
+    vertex.color = glm::u8vec3(255, 0, 255);
+
+    uint8_t value[PointCloud::stride];
+    uint8_t mask[PointCloud::stride];
+    write_value_to_buffer<PointCloud::vertex_t>(value, vertex);
+    std::memset(mask, 0xff, sizeof(mask));
+
+    simd::masked_fill(pointcloud.coordinate_color.data(), PointCloud::stride,
+                      header.number_points, value, mask, PointCloud::stride);
+  };
+
+  if (has_table_of_contents) {
+    pcvd_format::table_of_contents_t table_of_contents;
+    read_bytes = read(&table_of_contents, sizeof(table_of_contents));
+    if (read_bytes != sizeof(pcvd_format::table_of_contents_t))
+      throw QString("Incomplete file!");
+    if (table_of_contents.reserved != 0)
+      throw QString("corrupt table of contents (invalid padding)");
+
+    std::vector<pcvd_format::section_t> sections(
+        table_of_contents.number_sections);
+    const std::streamsize sections_size =
+        std::streamsize(sections.size() * sizeof(pcvd_format::section_t));
+    if (read(sections.data(), sections_size) != sections_size)
+      throw QString("Incomplete file!");
+
+    const pcvd_format::section_t* vertex_section = nullptr;
+    const pcvd_format::section_t* kd_tree_section = nullptr;
+    const pcvd_format::section_t* shader_section = nullptr;
+    const pcvd_format::section_t* spatial_chunks_section = nullptr;
+    const pcvd_format::section_t* checksums_section = nullptr;
+    const pcvd_format::section_t* origin_section = nullptr;
+    std::vector<const pcvd_format::section_t*> column_sections(
+        size_t(header.number_fields), nullptr);
+    std::vector<const pcvd_format::section_t*> remap_cache_sections;
+
+    total_progress = header_size + field_headers_size + field_names_size +
+                     std::streamsize(sizeof(table_of_contents)) +
+                     sections_size;
+    current_progress = total_progress;
+
+    for (const pcvd_format::section_t& section : sections) {
+      // Written without the sum, which might overflow
+      const uint64_t file_size = uint64_t(file->size());
+      if (section.offset > file_size ||
+          section.size > file_size - section.offset)
+        throw QString("Incomplete file!");
+
+      uint64_t expected_size = section.size;
+      switch (section.type) {
+        case pcvd_format::section_type_t::VERTEX_DATA:
+          vertex_section = &section;
+          expected_size = uint64_t(vertex_data_size);
+          break;
+        case pcvd_format::section_type_t::PROPERTY_COLUMN:
+          if (section.index >= header.number_fields)
+            throw QString("corrupt table of contents (invalid field index)");
+          column_sections[section.index] = &section;
+          expected_size = header.number_points *
+                          data_type::size_of_type(field_types[section.index]);
+          break;
+        case pcvd_format::section_type_t::KD_TREE:
+          kd_tree_section = &section;
+          expected_size = header.number_points * sizeof(size_t);
+          break;
+        case pcvd_format::section_type_t::SHADER:
+          shader_section = &section;
+          expected_size = sizeof(pcvd_format::shader_description_t) +
+                          header.shader_data_size;
+          break;
+        case pcvd_format::section_type_t::REMAP_CACHE_ENTRY:
+          remap_cache_sections.push_back(&section);
+          expected_size = uint64_t(vertex_data_size);
+          break;
+        case pcvd_format::section_type_t::SPATIAL_CHUNKS:
+          spatial_chunks_section = &section;
+          if (section.size % sizeof(pcvd_format::spatial_chunk_t) != 0)
+            throw QString("corrupt table of contents (invalid section size)");
+          break;
+        case pcvd_format::section_type_t::CHECKSUMS:
+          checksums_section = &section;
+          expected_size = sections.size() * sizeof(uint64_t);
+          break;
+        case pcvd_format::section_type_t::ORIGIN:
+          origin_section = &section;
+          expected_size = 3 * sizeof(float64_t);
+          break;
+        default:
+          continue;  // unknown sections are ignored
+      }
+
+      // The size of compressed sections is checked while decoding them
+      const bool is_compressed =
+          compressed_sections &&
+          section.type != pcvd_format::section_type_t::SHADER &&
+          section.type != pcvd_format::section_type_t::SPATIAL_CHUNKS &&
+          section.type != pcvd_format::section_type_t::CHECKSUMS &&
+          section.type != pcvd_format::section_type_t::ORIGIN;
+      if (section.size != expected_size && !is_compressed)
+        throw QString("corrupt table of contents (invalid section size)");
+      total_progress += std::streamsize(section.size);
+    }
+
+    for (const pcvd_format::section_t* section : column_sections)
+      if (section == nullptr) throw QString("Missing property column!");
+
+    std::sort(remap_cache_sections.begin(), remap_cache_sections.end(),
+              [](const pcvd_format::section_t* a,
+                 const pcvd_format::section_t* b) {
+                return a->index < b->index;
+              });
+
+    // Every section is verified while it's loaded, so the sections, which
+    // are only mapped, are still read lazily: the pending property columns
+    // are verified, once they're loaded into the user data. Loading only a
+    // region of interest skips the verification, as it would read the whole
+    // sections.
+    std::vector<uint64_t> checksums;
+    if (checksums_section != nullptr && verify_checksums &&
+        !use_region_of_interest) {
+      checksums.resize(sections.size());
+      stream.seekg(std::streamoff(checksums_section->offset));
+      if (read(checksums.data(), std::streamsize(checksums_section->size)) !=
+          std::streamsize(checksums_section->size))
+        throw QString("Incomplete file!");
+    }
+
+    auto checksum_of_section = [&](const pcvd_format::section_t& section) {
+      return checksums[size_t(&section - sections.data())];
+    };
+
+    // Verifies a small section (or the beginning of the file) by reading it
+    auto verify_read_bytes = [&](uint64_t offset, uint64_t size,
+                                 uint64_t checksum) {
+      if (checksums.empty()) return;
+      std::vector<uint8_t> bytes(size_t(size));
+      stream.seekg(std::streamoff(offset));
+      if (read(bytes.data(), std::streamsize(size)) != std::streamsize(size))
+        throw QString("Incomplete file!");
+      if (pcvd_checksum::checksum_of_words(bytes.data(), bytes.size(), 0) !=
+          checksum)
+        throw QString("Corrupt file! (checksum mismatch)");
+    };
+    auto verify_read_section = [&](const pcvd_format::section_t& section) {
+      if (!checksums.empty())
+        verify_read_bytes(section.offset, section.size,
+                          checksum_of_section(section));
+    };
+
+    // The own entry of the checksums section covers the file up to the end
+    // of the table of contents
+    if (!checksums.empty())
+      verify_read_bytes(
+          0,
+          uint64_t(header_size + field_headers_size + field_names_size +
+                   std::streamsize(sizeof(table_of_contents)) +
+                   sections_size),
+          checksum_of_section(*checksums_section));
+
+    // Verifies a loaded section in pieces in parallel
+    auto verify_loaded_section = [&](const pcvd_format::section_t& section,
+                                     const uint8_t* data) {
+      if (checksums.empty()) return;
+
+      const size_t piece_size = size_t(16) << 20;
+      const size_t size = size_t(section.size);
+      std::vector<uint64_t> piece_checksums((size + piece_size - 1) /
+                                            piece_size);
+      process_blocks_in_parallel(
+          piece_checksums.size(),
+          [&](size_t piece, size_t) -> int64_t {
+            const size_t first = piece * piece_size;
+            const size_t n = std::min(piece_size, size - first);
+            piece_checksums[piece] = pcvd_checksum::checksum_of_words(
+                data + first, n, first / sizeof(uint64_t));
+            return int64_t(n);
+          },
+          current_progress);
+
+      uint64_t checksum = 0;
+      for (uint64_t piece_checksum : piece_checksums)
+        checksum += piece_checksum;
+      if (checksum != checksum_of_section(section))
+        throw QString("Corrupt file! (checksum mismatch)");
+    };
+
+    // Pending columns are verified, when they're loaded
+    auto load_toc_section = [&](Buffer* buffer,
+                                const pcvd_format::section_t& section,
+                                bool is_pending = false) {
+      stream.seekg(std::streamoff(section.offset));
+      load_section(buffer, std::streamsize(section.size));
+      if (!is_pending) verify_loaded_section(section, buffer->data());
+      handle_loaded_chunk(current_progress += std::streamsize(section.size));
+    };
+
+    // Decodes the blocks of a compressed section in parallel
+    typedef std::function<void(const uint8_t* block, size_t block_size,
+                               uint8_t* elements, size_t n)>
+        decode_t;
+    auto decode_toc_section = [&](Buffer* buffer,
+                                  const pcvd_format::section_t& section,
+                                  size_t element_size, const decode_t& decode) {
+      Buffer encoded;
+      stream.seekg(std::streamoff(section.offset));
+      load_section(&encoded, std::streamsize(section.size));
+
+      pcvd_codec::section_header_t section_header;
+      if (encoded.size() < sizeof(pcvd_codec::section_header_t))
+        throw QString("Incomplete compressed section!");
+      std::memcpy(&section_header, encoded.data(),
+                  sizeof(pcvd_codec::section_header_t));
+
+      const size_t points_per_block = section_header.points_per_block;
+      const size_t num_blocks = section_header.number_blocks;
+      if (points_per_block == 0 ||
+          num_blocks != (header.number_points + points_per_block - 1) /
+                            points_per_block)
+        throw QString("Corrupt compressed section! (invalid blocks)");
+
+      const size_t block_sizes_size = num_blocks * sizeof(uint64_t);
+      if (encoded.size() <
+          sizeof(pcvd_codec::section_header_t) + block_sizes_size)
+        throw QString("Incomplete compressed section!");
+
+      std::vector<uint64_t> block_offsets(num_blocks + 1);
+      block_offsets[0] = sizeof(pcvd_codec::section_header_t) +
+                         block_sizes_size;
+      for (size_t i = 0; i < num_blocks; ++i) {
+        uint64_t block_size;
+        std::memcpy(&block_size,
+                    encoded.data() + sizeof(pcvd_codec::section_header_t) +
+                        i * sizeof(uint64_t),
+                    sizeof(uint64_t));
+        if (block_size > encoded.size() - block_offsets[i])
+          throw QString("Incomplete compressed section!");
+        block_offsets[i + 1] = block_offsets[i] + block_size;
+      }
+
+      buffer->resize(header.number_points * element_size);
+      const uint8_t* encoded_data = encoded.data();
+      uint8_t* elements = buffer->data();
+
+      // Every block job also checks the words starting within its block (the
+      // first one the section header and the block sizes too)
+      std::vector<uint64_t> block_checksums(checksums.empty() ? 0
+                                                              : num_blocks);
+      auto first_word_of_block = [&](size_t block) -> uint64_t {
+        if (block == 0) return 0;
+        if (block == num_blocks) return (encoded.size() + 7) / 8;
+        return block_offsets[block] / sizeof(uint64_t);
+      };
+
+      process_blocks_in_parallel(
+          num_blocks,
+          [&](size_t block, size_t) -> int64_t {
+            const size_t first = block * points_per_block;
+            const size_t n = std::min(points_per_block,
+                                      size_t(header.number_points) - first);
+            decode(encoded_data + block_offsets[block],
+                   block_offsets[block + 1] - block_offsets[block],
+                   elements + first * element_size, n);
+
+            if (!block_checksums.empty()) {
+              const uint64_t first_word = first_word_of_block(block);
+              const size_t begin = size_t(first_word * sizeof(uint64_t));
+              const size_t end =
+                  std::min(size_t(first_word_of_block(block + 1) *
+                                  sizeof(uint64_t)),
+                           encoded.size());
+              block_checksums[block] = pcvd_checksum::checksum_of_words(
+                  encoded_data + begin, end - begin, first_word);
+            }
+
+            return int64_t(block_offsets[block + 1] - block_offsets[block]);
+          },
+          current_progress);
+
+      if (!block_checksums.empty()) {
+        uint64_t checksum = 0;
+        for (uint64_t block_checksum : block_checksums)
+          checksum += block_checksum;
+        if (checksum != checksum_of_section(section))
+          throw QString("Corrupt file! (checksum mismatch)");
+      }
+      handle_loaded_chunk(current_progress += std::streamsize(section.size));
+    };
+
+    // Per-point sections are either mapped or decoded
+    auto load_points_section = [&](Buffer* buffer,
+                                   const pcvd_format::section_t& section,
+                                   bool is_pending = false) {
+      if (!compressed_sections)
+        return load_toc_section(buffer, section, is_pending);
+
+      switch (section.type) {
+        case pcvd_format::section_type_t::PROPERTY_COLUMN: {
+          const data_type::base_type_t type = field_types[int(section.index)];
+          return decode_toc_section(
+              buffer, section, data_type::size_of_type(type),
+              [type](const uint8_t* block, size_t block_size,
+                     uint8_t* elements, size_t n) {
+                pcvd_codec::decode_values(type, block, block_size, elements,
+                                          n);
+              });
+        }
+        case pcvd_format::section_type_t::KD_TREE:
+          return decode_toc_section(
+              buffer, section, sizeof(uint64_t),
+              [](const uint8_t* block, size_t block_size, uint8_t* elements,
+                 size_t n) {
+                pcvd_codec::decode_indices(
+                    block, block_size, reinterpret_cast<uint64_t*>(elements),
+                    n);
+              });
+        default:
+          return decode_toc_section(
+              buffer, section, PointCloud::stride,
+              [](const uint8_t* block, size_t block_size, uint8_t* elements,
+                 size_t n) {
+                pcvd_codec::decode_vertices(
+                    block, block_size,
+                    reinterpret_cast<PointCloud::vertex_t*>(elements), n);
+              });
+      }
+    };
+
+    // The shader tells, which columns are needed right away
+    if (shader_section != nullptr) {
+      verify_read_section(*shader_section);
+      stream.seekg(std::streamoff(shader_section->offset));
+      read_shader();
+      handle_loaded_chunk(current_progress +=
+                          std::streamsize(shader_section->size));
+    }
+
+    if (origin_section != nullptr) {
+      verify_read_section(*origin_section);
+      float64_t origin[3];
+      stream.seekg(std::streamoff(origin_section->offset));
+      if (read(origin, sizeof(origin)) != std::streamsize(sizeof(origin)))
+        throw QString("Incomplete file!");
+      pointcloud.origin = glm::dvec3(origin[0], origin[1], origin[2]);
+      if (glm::any(glm::isnan(pointcloud.origin)) ||
+          glm::any(glm::isinf(pointcloud.origin)))
+        throw QString("corrupt origin (not finite)");
+      handle_loaded_chunk(current_progress +=
+                          std::streamsize(origin_section->size));
+    }
+
+    // Only the chunks intersecting the region of interest are read. The
+    // sections stay mapped, so the other chunks are never touched.
+    if (use_region_of_interest && spatial_chunks_section != nullptr &&
+        vertex_section != nullptr && !compressed_sections) {
+      std::vector<pcvd_format::spatial_chunk_t> chunks(
+          spatial_chunks_section->size / sizeof(pcvd_format::spatial_chunk_t));
+      stream.seekg(std::streamoff(spatial_chunks_section->offset));
+      if (read(chunks.data(), std::streamsize(spatial_chunks_section->size)) !=
+          std::streamsize(spatial_chunks_section->size))
+        throw QString("Incomplete file!");
+      handle_loaded_chunk(current_progress += std::streamsize(
+                              spatial_chunks_section->size));
+
+      load_toc_section(&pointcloud.coordinate_color, *vertex_section);
+      pointcloud.pending_user_data_columns.resize(
+          size_t(header.number_fields));
+      for (int i = 0; i < header.number_fields; ++i)
+        load_toc_section(&pointcloud.pending_user_data_columns[size_t(i)],
+                         *column_sections[size_t(i)]);
+      for (const pcvd_format::section_t* section : remap_cache_sections) {
+        Buffer coordinate_color;
+        load_toc_section(&coordinate_color, *section);
+        pointcloud.remap_cache.append(section->key,
+                                      std::move(coordinate_color));
+      }
+
+      const aabb_t& region = region_of_interest;
+      std::vector<PointCloud::point_range_t> ranges;
+      auto add_range = [&ranges](PointCloud::point_range_t range) {
+        if (!ranges.empty() && ranges.back().end == range.begin)
+          ranges.back().end = range.end;
+        else
+          ranges.push_back(range);
+      };
+
+      for (const pcvd_format::spatial_chunk_t& chunk : chunks) {
+        if (chunk.first_point + chunk.num_points > header.number_points)
+          throw QString("corrupt spatial chunk (too many points)");
+
+        const bool intersects =
+            glm::all(glm::lessThanEqual(region.min_point,
+                                        chunk.aabb.max_point)) &&
+            glm::all(glm::lessThanEqual(chunk.aabb.min_point,
+                                        region.max_point));
+        if (!intersects) continue;
+
+        const PointCloud::point_range_t chunk_range{
+            chunk.first_point, chunk.first_point + chunk.num_points};
+
+        // Only the points of chunks crossing the boundary are tested
+        if (region.contains(chunk.aabb.min_point, 0.f) &&
+            region.contains(chunk.aabb.max_point, 0.f)) {
+          add_range(chunk_range);
+        } else {
+          for (PointCloud::point_range_t range :
+               pointcloud.point_ranges_in_region(region, chunk_range))
+            add_range(range);
+        }
+      }
+
+      pointcloud = pointcloud.subset(ranges);
+      region_of_interest_applied = true;
+
+      return true;
+    }
+
+    if (vertex_section != nullptr)
+      load_points_section(&pointcloud.coordinate_color, *vertex_section);
+    else
+      fill_vertices_without_coordinates();
+
+    // Only the columns used by the shader are copied into the user data. The
+    // others stay mapped until they are used. The pages of the user data are
+    // only taken, once a column is copied into them, so the memory isn't
+    // taken up front, if all columns stay pending.
+    pointcloud.user_data.resize_without_first_touch(size_t(point_data_size));
+    pointcloud.pending_user_data_columns.resize(size_t(header.number_fields));
+    for (int i = 0; i < header.number_fields; ++i) {
+      const pcvd_format::section_t& section = *column_sections[size_t(i)];
+      load_points_section(&pointcloud.pending_user_data_columns[size_t(i)],
+                          section, true);
+      if (!checksums.empty() && !compressed_sections)
+        pointcloud.pending_user_data_checksums.push_back(
+            checksum_of_section(section));
+
+      if (shader_section == nullptr ||
+          pointcloud.shader.used_properties.contains(field_names[i]))
+        pointcloud.load_user_data_column(i);
+    }
+
+    if (kd_tree_section != nullptr)
+      load_points_section(
+          pointcloud.kdtree_index.buffer_for_loading(header.aabb),
+          *kd_tree_section);
+
+    for (const pcvd_format::section_t* section : remap_cache_sections) {
+      Buffer coordinate_color;
+      load_points_section(&coordinate_color, *section);
+      pointcloud.remap_cache.append(section->key, std::move(coordinate_color));
+    }
+
+    return true;
+  }
+
+  if (load_vertex) {
+    load_section(&pointcloud.coordinate_color, vertex_data_size);
+    handle_loaded_chunk(current_progress += vertex_data_size);
+  }
+
+  load_section(&pointcloud.user_data, point_data_size);
+  handle_loaded_chunk(current_progress += point_data_size);
+
+  if (!load_vertex) fill_vertices_without_coordinates();
+
+  if (load_kd_tree) {
+    load_section(pointcloud.kdtree_index.buffer_for_loading(header.aabb),
+                 kd_tree_size);
+    handle_loaded_chunk(current_progress += kd_tree_size);
+  }
+
+  if (load_shader) {
+    read_shader();
+    handle_loaded_chunk(current_progress += shader_size);
+  }
+
+  if (load_remap_cache) {
+    pcvd_format::remap_cache_description_t remap_cache_description;
+
+    read_bytes = read(&remap_cache_description,
+                      sizeof(pcvd_format::remap_cache_description_t));
+    if (read_bytes != sizeof(pcvd_format::remap_cache_description_t))
+      throw QString("Incomplete file!");
+    if (remap_cache_description.reserved != 0)
+      throw QString("corrupt remap cache (invalid padding)");
+
+    total_progress += std::streamsize(
+        remap_cache_description.number_entries *
+        (sizeof(RemapCache::key_t) + uint64_t(vertex_data_size)));
+
+    for (uint32_t i = 0; i < remap_cache_description.number_entries; ++i) {
+      RemapCache::key_t key;
+      Buffer coordinate_color;
+
+      read_bytes = read(&key, sizeof(RemapCache::key_t));
+      if (read_bytes != sizeof(RemapCache::key_t))
+        throw QString("Incomplete file!");
+      load_section(&coordinate_color, vertex_data_size);
+
+      pointcloud.remap_cache.append(key, std::move(coordinate_color));
+
+      handle_loaded_chunk(current_progress +=
+                          sizeof(RemapCache::key_t) + vertex_data_size);
+    }
   }
 
   return true;
@@ -13,6 +13,9 @@ class PcvdImporter final : public AbstractPointCloudImporter {
  public:
   PcvdImporter(const std::string& input_file);
 
+  // Whether the checksums of files having them are verified while loading
+  bool verify_checksums = true;
+
  protected:
   bool import_implementation() override;
 
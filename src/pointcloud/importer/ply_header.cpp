@@ -0,0 +1,92 @@
+#include <pointcloud/importer/ply_header.hpp>
+
+#include <cstring>
+#include <sstream>
+
+bool parse_ply_vertex_layout(const uchar* file_data, size_t file_size,
+                             ply_vertex_layout_t* layout) {
+  size_t line_begin = 0;
+  auto next_line = [&](std::string* line) -> bool {
+    if (line_begin >= file_size) return false;
+
+    const uchar* line_end = static_cast<const uchar*>(
+        std::memchr(file_data + line_begin, '\n', file_size - line_begin));
+    if (line_end == nullptr) return false;
+
+    line->assign(reinterpret_cast<const char*>(file_data + line_begin),
+                 reinterpret_cast<const char*>(line_end));
+    if (!line->empty() && line->back() == '\r') line->pop_back();
+
+    line_begin = size_t(line_end - file_data) + 1;
+    return true;
+  };
+
+  std::string line;
+  if (!next_line(&line) || line != "ply") return false;
+
+  // elements are only accepted, if the vertices are the first one
+  enum { BEFORE_VERTEX, VERTEX, AFTER_VERTEX } element = BEFORE_VERTEX;
+
+  while (next_line(&line)) {
+    std::istringstream stream(line);
+    std::string keyword;
+    stream >> keyword;
+
+    if (keyword == "format") {
+      std::string format;
+      stream >> format;
+      if (format == "ascii")
+        layout->format = ply_vertex_layout_t::format_t::ASCII;
+      else if (format == "binary_little_endian")
+        layout->format = ply_vertex_layout_t::format_t::BINARY_LITTLE_ENDIAN;
+      else if (format == "binary_big_endian")
+        layout->format = ply_vertex_layout_t::format_t::BINARY_BIG_ENDIAN;
+      else
+        return false;
+    } else if (keyword == "element") {
+      std::string name;
+      size_t count = 0;
+      stream >> name >> count;
+      if (element != BEFORE_VERTEX || name != "vertex" || stream.fail()) {
+        element = AFTER_VERTEX;
+      } else {
+        element = VERTEX;
+        layout->num_points = count;
+      }
+      if (element != VERTEX && layout->property_names.isEmpty()) return false;
+    } else if (keyword == "property" && element == VERTEX) {
+      std::string type, name;
+      stream >> type >> name;
+
+      data_type::base_type_t base_type;
+      if (type == "char" || type == "int8")
+        base_type = data_type::base_type_t::INT8;
+      else if (type == "short" || type == "int16")
+        base_type = data_type::base_type_t::INT16;
+      else if (type == "int" || type == "int32")
+        base_type = data_type::base_type_t::INT32;
+      else if (type == "uchar" || type == "uint8")
+        base_type = data_type::base_type_t::UINT8;
+      else if (type == "ushort" || type == "uint16")
+        base_type = data_type::base_type_t::UINT16;
+      else if (type == "uint" || type == "uint32")
+        base_type = data_type::base_type_t::UINT32;
+      else if (type == "float" || type == "float32")
+        base_type = data_type::base_type_t::FLOAT32;
+      else if (type == "double" || type == "float64")
+        base_type = data_type::base_type_t::FLOAT64;
+      else
+        return false;  // lists or unknown types
+
+      layout->property_names.append(QString::fromStdString(name));
+      layout->property_offsets.append(layout->stride);
+      layout->property_types.append(base_type);
+      layout->stride += data_type::size_of_type(base_type);
+    } else if (keyword == "end_header") {
+      layout->header_size = line_begin;
+      return element != BEFORE_VERTEX && layout->stride > 0;
+    }
+  }
+
+  return false;
+}
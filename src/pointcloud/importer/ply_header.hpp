@@ -0,0 +1,33 @@
+#ifndef POINTCLOUD_IMPORTER_PLY_HEADER_HPP_
+#define POINTCLOUD_IMPORTER_PLY_HEADER_HPP_
+
+#include <pointcloud/buffer.hpp>
+
+#include <QString>
+#include <QVector>
+
+/**
+Fixed record layout of the vertex element of a ply file.
+*/
+struct ply_vertex_layout_t {
+  enum class format_t {
+    ASCII,
+    BINARY_LITTLE_ENDIAN,
+    BINARY_BIG_ENDIAN,
+  };
+
+  format_t format = format_t::ASCII;
+  size_t header_size = 0;
+  size_t num_points = 0;
+  size_t stride = 0;
+  QVector<QString> property_names;
+  QVector<size_t> property_offsets;
+  QVector<data_type::base_type_t> property_types;
+};
+
+// Parses the header of a ply file. Returns false, if the vertex element is not
+// the first element or contains list properties.
+bool parse_ply_vertex_layout(const uchar* file_data, size_t file_size,
+                             ply_vertex_layout_t* layout);
+
+#endif  // POINTCLOUD_IMPORTER_PLY_HEADER_HPP_
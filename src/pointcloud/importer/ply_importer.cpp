@@ -1,18 +1,30 @@
 #include <core_library/print.hpp>
 #include <core_library/types.hpp>
 #include <pointcloud/convert_values.hpp>
+#include <pointcloud/importer/ply_header.hpp>
 #include <pointcloud/importer/ply_importer.hpp>
+#include <pointcloud/importer/vertex_decoder.hpp>
+#include <pointcloud/property_view.hpp>
 
 #include <glm/gtx/io.hpp>
 
 #include <QAbstractEventDispatcher>
+#include <QFile>
 #include <QFileInfo>
 #include <QThread>
 
+#include <algorithm>
 #include <iostream>
 
 typedef pcl::io::ply::ply_parser ply_parser;
 
+namespace {
+
+template <typename value_type>
+void swap_byte_order(uint8_t* data, size_t stride, size_t num_points);
+
+}  // namespace
+
 PlyImporter::PlyImporter(const std::string& input_file)
     : AbstractPointCloudImporter(input_file) {}
 
@@ -23,6 +35,8 @@ bool PlyImporter::import_implementation() {
   property_offsets.clear();
   property_types.clear();
 
+  if (import_mapped_binary()) return true;
+
   ply_parser parser;
 
   // initialze logging
@@ -116,8 +130,13 @@ bool PlyImporter::import_implementation() {
 
     Q_ASSERT(num_points != std::numeric_limits<size_t>::max());
 
-    // preallocate the necessary memory
+    // preallocate the necessary memory. Properties missing in the file keep
+    // the fill value (nan coordinates and white colors).
     this->pointcloud.resize(num_points);
+    this->pointcloud.coordinate_color.memset(0xffffffff);
+    this->pointcloud.user_data.memset(0xffffffff);
+    this->pointcloud.coordinates_need_remapping =
+        !vertex_decoder_t::has_coordinates(property_names);
 
     // The pointers are used later for storing the actual vertex data
     new_vertex_x = reinterpret_cast<PointCloud::vertex_t*>(
@@ -236,3 +255,139 @@ PlyImporter::property_callback_handler(PointCloud::vertex_t** new_vertex_x,
     return data_handler;
   };
 };
+
+/*
+Fast path for binary files starting with the vertex element: the file is mapped
+into memory and the fixed size vertex records are decoded in parallel blocks.
+As the user data has the same layout as the records, it's a plain memcpy (or a
+byte swap for the other endianness).
+
+Returns false, if the file can't be handled this way.
+*/
+bool PlyImporter::import_mapped_binary() {
+  QFile file(QString::fromStdString(input_file));
+  if (!file.open(QIODevice::ReadOnly)) return false;
+
+  const size_t file_size = size_t(file.size());
+  const uchar* file_data = file.map(0, file.size());
+  if (file_data == nullptr) return false;
+
+  ply_vertex_layout_t layout;
+  if (!parse_ply_vertex_layout(file_data, file_size, &layout) ||
+      layout.format == ply_vertex_layout_t::format_t::ASCII)
+    return false;
+
+  if (Q_UNLIKELY(file_size - layout.header_size <
+                 layout.num_points * layout.stride))
+    throw QString("Unexpected end of the vertex data in %0")
+        .arg(QFileInfo(file).fileName());
+
+  Q_ASSERT(layout.num_points < size_t(std::numeric_limits<int64_t>::max()));
+  total_progress = int64_t(layout.num_points);
+
+  const bool swap_bytes =
+      (layout.format == ply_vertex_layout_t::format_t::BINARY_BIG_ENDIAN) !=
+      (Q_BYTE_ORDER == Q_BIG_ENDIAN);
+  const vertex_decoder_t decoder(layout.stride, layout.property_names,
+                                 layout.property_offsets,
+                                 layout.property_types);
+  pointcloud.coordinates_need_remapping =
+      !vertex_decoder_t::has_coordinates(layout.property_names);
+
+  const uint8_t* records = file_data + layout.header_size;
+
+  // Copies the selected records (or all of them without a selection) to the
+  // user data and decodes them. Returns the number of copied records.
+  auto decode_records = [&](size_t first_record, size_t num_records,
+                            const point_selection_t* selection,
+                            uint8_t* user_data,
+                            PointCloud::vertex_t* vertices, aabb_t* aabb) {
+    size_t num_points = num_records;
+    if (selection == nullptr) {
+      std::memcpy(user_data, records + first_record * layout.stride,
+                  num_records * layout.stride);
+    } else {
+      num_points = 0;
+      for (size_t i = first_record; i < first_record + num_records; ++i)
+        if (selection->is_selected(i))
+          std::memcpy(user_data + (num_points++) * layout.stride,
+                      records + i * layout.stride, layout.stride);
+    }
+
+    if (swap_bytes)
+      for (int i = 0; i < layout.property_types.length(); ++i)
+        visit_property_type(layout.property_types[i], [&](auto value) {
+          swap_byte_order<decltype(value)>(
+              user_data + layout.property_offsets[i], layout.stride,
+              num_points);
+        });
+
+    decoder.decode(user_data, vertices, num_points, aabb);
+    return num_points;
+  };
+
+  point_selection_t selection;
+  const bool decimate = select_points(
+      layout.num_points, layout.stride + PointCloud::stride,
+      [&](size_t first_point, size_t num_points, glm::vec3* coordinates) {
+        std::vector<uint8_t> user_data(num_points * layout.stride);
+        std::vector<PointCloud::vertex_t> vertices(num_points);
+
+        aabb_t aabb = aabb_t::invalid();
+        decode_records(first_point, num_points, nullptr, user_data.data(),
+                       vertices.data(), &aabb);
+        for (size_t i = 0; i < num_points; ++i)
+          coordinates[i] = vertices[i].coordinate;
+      },
+      &selection);
+  const size_t num_points =
+      decimate ? selection.num_selected_points() : layout.num_points;
+
+  pointcloud.aabb = aabb_t::invalid();
+  pointcloud.set_user_data_format(layout.stride, layout.property_names,
+                                  layout.property_offsets,
+                                  layout.property_types);
+  pointcloud.resize(num_points);
+
+  uint8_t* user_data = pointcloud.user_data.data();
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(
+      pointcloud.coordinate_color.data());
+
+  const size_t block_size = point_selection_t::points_per_block();
+  const size_t num_blocks = (layout.num_points + block_size - 1) / block_size;
+
+  std::vector<aabb_t> thread_aabbs(num_threads_for_blocks(num_blocks),
+                                   aabb_t::invalid());
+
+  process_blocks_in_parallel(num_blocks, [&](size_t block, size_t thread) {
+    const size_t first_record = block * block_size;
+    const size_t num_records =
+        glm::min(block_size, layout.num_points - first_record);
+    const size_t first_point =
+        decimate ? selection.first_selected_point(block) : first_record;
+
+    const size_t num_block_points = decode_records(
+        first_record, num_records, decimate ? &selection : nullptr,
+        user_data + first_point * layout.stride, vertices + first_point,
+        &thread_aabbs[thread]);
+    publish_loaded_points(first_point, num_block_points);
+
+    return int64_t(num_records);
+  });
+
+  // The aabb of every thread only contains the dimensions present in the file
+  for (const aabb_t& aabb : thread_aabbs)
+    vertex_decoder_t::merge_aabb(&pointcloud.aabb, aabb);
+
+  return true;
+}
+
+namespace {
+
+template <typename value_type>
+void swap_byte_order(uint8_t* data, size_t stride, size_t num_points) {
+  for (size_t i = 0; i < num_points; ++i, data += stride)
+    std::reverse(data, data + sizeof(value_type));
+}
+
+}  // namespace
@@ -21,6 +21,8 @@ class PlyImporter final : public AbstractPointCloudImporter {
  private:
   int64_t current_progress;
 
+  bool import_mapped_binary();
+
   size_t vertex_data_stride;
   QVector<QString> property_names;
   QVector<size_t> property_offsets;
@@ -0,0 +1,171 @@
+#include <pointcloud/importer/point_selection.hpp>
+
+#include <QStringList>
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+uint64_t hash_of_point(uint64_t seed, uint64_t point);
+int64_t voxel_grid_index(float coordinate, float voxel_size);
+
+}  // namespace
+
+double decimation_t::ratio_for(size_t num_points,
+                               size_t bytes_per_point) const {
+  double ratio = glm::clamp(this->ratio, 0., 1.);
+
+  if (memory_budget > 0 && num_points > 0)
+    ratio = glm::min(ratio, double(memory_budget) /
+                                (double(num_points) * double(bytes_per_point)));
+
+  return ratio;
+}
+
+bool decimation_t::parse(QString text, decimation_t* decimation) {
+  const QStringList components = text.split(':');
+  if (components.length() < 2) return false;
+
+  const QString mode = components[0].trimmed();
+  bool ok = false;
+  const double value = components[1].trimmed().toDouble(&ok);
+  if (!ok || !std::isfinite(value) || value <= 0.) return false;
+
+  *decimation = decimation_t();
+
+  if (mode == "random" && components.length() <= 3) {
+    decimation->mode = mode_t::RANDOM;
+    decimation->ratio = value;
+    if (components.length() == 3)
+      decimation->seed = components[2].trimmed().toULongLong(&ok);
+    return ok && value <= 1.;
+  } else if (mode == "nth" && components.length() == 2) {
+    decimation->mode = mode_t::EVERY_NTH;
+    decimation->ratio = 1. / value;
+    return value >= 1.;
+  } else if (mode == "voxel" && components.length() == 2) {
+    decimation->mode = mode_t::VOXEL_GRID;
+    decimation->voxel_size = float(value);
+    return true;
+  } else if (mode == "fit" && components.length() == 2) {
+    decimation->mode = mode_t::RANDOM;
+    decimation->memory_budget = size_t(value * 1024. * 1024. * 1024.);
+    return decimation->memory_budget > 0;
+  }
+
+  return false;
+}
+
+point_selection_t::point_selection_t(size_t num_points)
+    : _num_points(num_points), bits((num_points + 63) / 64, 0) {}
+
+size_t point_selection_t::num_blocks() const {
+  return (_num_points + points_per_block() - 1) / points_per_block();
+}
+
+size_t point_selection_t::num_selected_points() const {
+  Q_ASSERT(first_selected_points.size() == num_blocks() + 1);
+  return first_selected_points.back();
+}
+
+size_t point_selection_t::first_selected_point(size_t block) const {
+  Q_ASSERT(block < first_selected_points.size());
+  return first_selected_points[block];
+}
+
+void point_selection_t::select_block(size_t block, decimation_t::mode_t mode,
+                                     double ratio, uint64_t seed) {
+  const size_t first_point = block * points_per_block();
+  const size_t end_point =
+      glm::min(first_point + points_per_block(), _num_points);
+
+  if (mode == decimation_t::mode_t::EVERY_NTH) {
+    const size_t step =
+        ratio > 0. ? size_t(glm::max(1., glm::round(1. / ratio))) : 0;
+    if (step == 0) return;
+    for (size_t point = (first_point + step - 1) / step * step;
+         point < end_point; point += step)
+      select(point);
+  } else if (mode == decimation_t::mode_t::RANDOM) {
+    // compared in 53 bits, so the threshold is exact
+    const uint64_t threshold = uint64_t(ratio * double(uint64_t(1) << 53));
+    for (size_t point = first_point; point < end_point; ++point)
+      if ((hash_of_point(seed, point) >> 11) < threshold) select(point);
+  }
+}
+
+void point_selection_t::count_selected_points() {
+  // points_per_block() is a multiple of 64
+  const size_t words_per_block = points_per_block() / 64;
+
+  first_selected_points.resize(num_blocks() + 1);
+
+  size_t num_selected = 0;
+  for (size_t block = 0; block < num_blocks(); ++block) {
+    first_selected_points[block] = num_selected;
+
+    const size_t end_word =
+        glm::min((block + 1) * words_per_block, bits.size());
+    for (size_t word = block * words_per_block; word < end_word; ++word)
+      num_selected += size_t(__builtin_popcountll(bits[word]));
+  }
+  first_selected_points.back() = num_selected;
+}
+
+std::vector<PointCloud::point_range_t> point_selection_t::selected_ranges()
+    const {
+  std::vector<PointCloud::point_range_t> ranges;
+
+  for (size_t point = 0; point < _num_points; ++point) {
+    if (!is_selected(point)) continue;
+
+    if (!ranges.empty() && ranges.back().end == point)
+      ranges.back().end++;
+    else
+      ranges.push_back(PointCloud::point_range_t{point, point + 1});
+  }
+
+  return ranges;
+}
+
+voxel_cell_t voxel_grid_cell(glm::vec3 point, float voxel_size) {
+  return voxel_cell_t{voxel_grid_index(point.x, voxel_size),
+                      voxel_grid_index(point.y, voxel_size),
+                      voxel_grid_index(point.z, voxel_size)};
+}
+
+size_t voxel_cell_t::hash_t::operator()(const voxel_cell_t& cell) const {
+  uint64_t hash = hash_of_point(0, uint64_t(cell.x));
+  hash = hash_of_point(hash, uint64_t(cell.y));
+  hash = hash_of_point(hash, uint64_t(cell.z));
+  return size_t(hash);
+}
+
+namespace {
+
+// splitmix64 of the point index offset by the seed
+uint64_t hash_of_point(uint64_t seed, uint64_t point) {
+  uint64_t x = seed + (point + 1) * 0x9e3779b97f4a7c15;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+/*
+Cells up to 2^62 cells away from the origin are indexed directly. Further
+away, adjacent floats are more than one cell apart, so every float gets its
+own cell, indexed beyond 2^62 by its bits.
+*/
+int64_t voxel_grid_index(float coordinate, float voxel_size) {
+  const double max_index = double(int64_t(1) << 62);
+  const double index = std::floor(double(coordinate) / double(voxel_size));
+  if (std::abs(index) < max_index) return int64_t(index);
+
+  uint32_t bits;
+  std::memcpy(&bits, &coordinate, sizeof(float));
+  const int64_t far_index = (int64_t(1) << 62) + int64_t(bits & 0x7fffffff);
+  return index < 0. ? -far_index : far_index;
+}
+
+}  // namespace
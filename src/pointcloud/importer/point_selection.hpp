@@ -0,0 +1,102 @@
+#ifndef POINTCLOUD_IMPORTER_POINT_SELECTION_HPP_
+#define POINTCLOUD_IMPORTER_POINT_SELECTION_HPP_
+
+#include <pointcloud/pointcloud.hpp>
+
+#include <QString>
+
+#include <vector>
+
+/*
+How the points are subsampled while importing.
+
+RANDOM keeps every point with the probability `ratio` (decided by a hash of
+the seed and the index of the point, so the same seed selects the same
+points). EVERY_NTH keeps every round(1/ratio)-th point. VOXEL_GRID keeps the
+first point of every cell of a grid with the edge length `voxel_size`.
+
+With a memory_budget (in bytes), RANDOM and EVERY_NTH lower the ratio so the
+imported points fit into the budget.
+*/
+struct decimation_t {
+  enum class mode_t {
+    NONE,
+    RANDOM,
+    EVERY_NTH,
+    VOXEL_GRID,
+  };
+
+  mode_t mode = mode_t::NONE;
+  double ratio = 1.;
+  uint64_t seed = 0;
+  float voxel_size = 0.f;
+  size_t memory_budget = 0;
+
+  bool is_enabled() const { return mode != mode_t::NONE; }
+
+  // The ratio used for num_points points needing bytes_per_point each
+  double ratio_for(size_t num_points, size_t bytes_per_point) const;
+
+  // Parses "random:<ratio>[:<seed>]", "nth:<n>", "voxel:<size>" or
+  // "fit:<gigabytes>" (random with the ratio fitting into the memory)
+  static bool parse(QString text, decimation_t* decimation);
+};
+
+/*
+The points selected by a decimation, stored as one bit per point.
+
+The points are processed in blocks of points_per_block() points. Once the
+points are selected and counted, the selected points of each block can be
+written in parallel starting at first_selected_point(block).
+*/
+class point_selection_t {
+ public:
+  constexpr static size_t points_per_block() { return 65536; }
+
+  point_selection_t() = default;
+  explicit point_selection_t(size_t num_points);
+
+  size_t num_points() const { return _num_points; }
+  size_t num_blocks() const;
+
+  bool is_selected(size_t point) const {
+    return (bits[point / 64] >> (point % 64)) & 1;
+  }
+
+  // Only valid after count_selected_points
+  size_t num_selected_points() const;
+  size_t first_selected_point(size_t block) const;
+
+  // Different blocks can be selected by different threads at the same time
+  void select(size_t point) { bits[point / 64] |= uint64_t(1) << (point % 64); }
+  // Selects the points of the block for RANDOM and EVERY_NTH
+  void select_block(size_t block, decimation_t::mode_t mode, double ratio,
+                    uint64_t seed);
+  void count_selected_points();
+
+  // The ranges of consecutive selected points
+  std::vector<PointCloud::point_range_t> selected_ranges() const;
+
+ private:
+  size_t _num_points = 0;
+  std::vector<uint64_t> bits;
+  std::vector<size_t> first_selected_points;
+};
+
+// A cell of the voxel grid, the index of the cell along each axis
+struct voxel_cell_t {
+  int64_t x, y, z;
+
+  bool operator==(const voxel_cell_t& other) const {
+    return x == other.x && y == other.y && z == other.z;
+  }
+
+  struct hash_t {
+    size_t operator()(const voxel_cell_t& cell) const;
+  };
+};
+
+// The voxel grid cell containing the point
+voxel_cell_t voxel_grid_cell(glm::vec3 point, float voxel_size);
+
+#endif  // POINTCLOUD_IMPORTER_POINT_SELECTION_HPP_
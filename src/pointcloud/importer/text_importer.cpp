@@ -0,0 +1,384 @@
+#include <core_library/types.hpp>
+#include <pointcloud/importer/ply_header.hpp>
+#include <pointcloud/importer/text_importer.hpp>
+#include <pointcloud/importer/vertex_decoder.hpp>
+#include <pointcloud/property_view.hpp>
+
+#include <QByteArray>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <charconv>
+#include <locale>
+#include <sstream>
+
+namespace {
+
+// The chunks are extended to the end of the line
+const size_t chunk_size = size_t(16) << 20;
+
+bool is_separator(char c);
+bool is_data_line(const char* begin, const char* end);
+
+template <typename functor_t>
+void for_each_data_line(const char* begin, const char* end,
+                        const functor_t& functor);
+
+template <typename value_type>
+bool parse_value(const char* begin, const char* end, value_type* value);
+
+data_type::base_type_t color_type_of_text_file(const char* begin,
+                                               const char* end,
+                                               int num_columns);
+void columns_of_text_file(int num_columns,
+                          data_type::base_type_t color_type,
+                          QVector<QString>* names,
+                          QVector<data_type::base_type_t>* types);
+
+}  // namespace
+
+TextImporter::TextImporter(const std::string& input_file, format_t format)
+    : AbstractPointCloudImporter(input_file), format(format) {}
+
+bool TextImporter::is_supported_ascii_ply(const std::string& input_file) {
+  QFile file(QString::fromStdString(input_file));
+  if (!file.open(QIODevice::ReadOnly)) return false;
+
+  QByteArray header;
+  while (!file.atEnd() && header.size() < (1 << 20)) {
+    const QByteArray line = file.readLine();
+    header += line;
+    if (line.startsWith("end_header")) break;
+  }
+
+  ply_vertex_layout_t layout;
+  return parse_ply_vertex_layout(
+             reinterpret_cast<const uchar*>(header.constData()),
+             size_t(header.size()), &layout) &&
+         layout.format == ply_vertex_layout_t::format_t::ASCII;
+}
+
+/*
+The file is parsed in two parallel passes over newline aligned chunks. The
+first pass counts the points of each chunk, so the second pass knows, where to
+write the points of its chunk in the final buffers.
+*/
+bool TextImporter::import_implementation() {
+  QFile file(QString::fromStdString(input_file));
+  if (!file.open(QIODevice::ReadOnly))
+    throw QString("Could not open %0").arg(QFileInfo(file).fileName());
+
+  const size_t file_size = size_t(file.size());
+  const char* file_data =
+      reinterpret_cast<const char*>(file.map(0, file.size()));
+  if (file_data == nullptr)
+    throw QString("Could not map %0 into memory")
+        .arg(QFileInfo(file).fileName());
+  const char* file_end = file_data + file_size;
+
+  auto end_of_line = [file_end](const char* begin) -> const char* {
+    const char* line_end = static_cast<const char*>(
+        std::memchr(begin, '\n', size_t(file_end - begin)));
+    return line_end == nullptr ? file_end : line_end;
+  };
+
+  size_t data_begin = 0;
+  size_t max_num_points = std::numeric_limits<size_t>::max();
+  size_t stride = 0;
+  QVector<QString> property_names;
+  QVector<size_t> property_offsets;
+  QVector<data_type::base_type_t> property_types;
+
+  if (format == format_t::PLY) {
+    ply_vertex_layout_t layout;
+    if (!parse_ply_vertex_layout(reinterpret_cast<const uchar*>(file_data),
+                                 file_size, &layout) ||
+        layout.format != ply_vertex_layout_t::format_t::ASCII)
+      throw QString("Unsupported ply header in %0")
+          .arg(QFileInfo(file).fileName());
+
+    data_begin = layout.header_size;
+    max_num_points = layout.num_points;
+    stride = layout.stride;
+    property_names = layout.property_names;
+    property_offsets = layout.property_offsets;
+    property_types = layout.property_types;
+  } else {
+    const char* line_begin = file_data;
+
+    // The first line of a pts file contains the number of points
+    if (format == format_t::PTS)
+      line_begin = std::min(end_of_line(line_begin) + 1, file_end);
+    data_begin = size_t(line_begin - file_data);
+
+    // The number of columns is taken from the first point
+    while (line_begin != file_end &&
+           !is_data_line(line_begin, end_of_line(line_begin)))
+      line_begin = std::min(end_of_line(line_begin) + 1, file_end);
+
+    int num_columns = 0;
+    for (const char* c = line_begin, *line_end = end_of_line(line_begin);
+         c != line_end; ++c)
+      if (!is_separator(*c) && (c == line_begin || is_separator(c[-1])))
+        num_columns++;
+
+    columns_of_text_file(
+        num_columns,
+        color_type_of_text_file(line_begin, file_end, num_columns),
+        &property_names, &property_types);
+    for (data_type::base_type_t type : property_types) {
+      property_offsets << stride;
+      stride += data_type::size_of_type(type);
+    }
+  }
+
+  // Splitting the data into newline aligned chunks
+  std::vector<size_t> chunk_bounds = {data_begin};
+  while (chunk_bounds.back() < file_size) {
+    const size_t end = chunk_bounds.back() + chunk_size;
+    if (end >= file_size)
+      chunk_bounds.push_back(file_size);
+    else
+      chunk_bounds.push_back(glm::min(
+          file_size, size_t(end_of_line(file_data + end) - file_data) + 1));
+  }
+  const size_t num_chunks = chunk_bounds.size() - 1;
+
+  Q_ASSERT(file_size < size_t(std::numeric_limits<int64_t>::max() / 2));
+  total_progress = glm::max<int64_t>(1, int64_t(2 * (file_size - data_begin)));
+
+  std::vector<size_t> first_rows(num_chunks + 1, 0);
+  process_blocks_in_parallel(num_chunks, [&](size_t chunk, size_t) {
+    size_t num_rows = 0;
+    for_each_data_line(file_data + chunk_bounds[chunk],
+                       file_data + chunk_bounds[chunk + 1],
+                       [&num_rows](const char*, const char*) { num_rows++; });
+    first_rows[chunk + 1] = num_rows;
+    return int64_t(chunk_bounds[chunk + 1] - chunk_bounds[chunk]);
+  });
+
+  for (size_t chunk = 0; chunk < num_chunks; ++chunk)
+    first_rows[chunk + 1] += first_rows[chunk];
+
+  const size_t num_points = glm::min(first_rows.back(), max_num_points);
+  if (format == format_t::PLY && num_points < max_num_points)
+    throw QString("Unexpected end of the vertex data in %0")
+        .arg(QFileInfo(file).fileName());
+
+  pointcloud.aabb = aabb_t::invalid();
+  pointcloud.set_user_data_format(stride, property_names, property_offsets,
+                                  property_types);
+  pointcloud.resize(num_points);
+  pointcloud.coordinates_need_remapping =
+      !vertex_decoder_t::has_coordinates(property_names);
+
+  const vertex_decoder_t decoder(stride, property_names, property_offsets,
+                                 property_types);
+
+  uint8_t* user_data = pointcloud.user_data.data();
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(
+      pointcloud.coordinate_color.data());
+
+  auto parse_row = [&](const char* begin, const char* end, size_t row) {
+    uint8_t* target = user_data + row * stride;
+
+    for (int i = 0; i < property_types.length(); ++i) {
+      while (begin != end && is_separator(*begin)) ++begin;
+      const char* token_end = begin;
+      while (token_end != end && !is_separator(*token_end)) ++token_end;
+
+      bool parsed = false;
+      visit_property_type(property_types[i], [&](auto value) {
+        parsed = parse_value(begin, token_end, &value);
+        write_value_to_buffer(target + property_offsets[i], value);
+      });
+      if (Q_UNLIKELY(!parsed))
+        throw QString("Could not parse the %0. value of point %1 in %2")
+            .arg(i + 1)
+            .arg(row + 1)
+            .arg(QFileInfo(file).fileName());
+
+      begin = token_end;
+    }
+  };
+
+  std::vector<aabb_t> thread_aabbs(num_threads_for_blocks(num_chunks),
+                                   aabb_t::invalid());
+
+  process_blocks_in_parallel(
+      num_chunks,
+      [&](size_t chunk, size_t thread) {
+        const size_t first_row = first_rows[chunk];
+        size_t row = first_row;
+
+        for_each_data_line(file_data + chunk_bounds[chunk],
+                           file_data + chunk_bounds[chunk + 1],
+                           [&](const char* line_begin, const char* line_end) {
+                             if (row < num_points)
+                               parse_row(line_begin, line_end, row++);
+                           });
+
+        if (row > first_row)
+          decoder.decode(user_data + first_row * stride, vertices + first_row,
+                         row - first_row, &thread_aabbs[thread]);
+        publish_loaded_points(first_row, row - first_row);
+
+        return int64_t(chunk_bounds[chunk + 1] - chunk_bounds[chunk]);
+      },
+      int64_t(file_size - data_begin));
+
+  for (const aabb_t& aabb : thread_aabbs)
+    vertex_decoder_t::merge_aabb(&pointcloud.aabb, aabb);
+
+  return true;
+}
+
+namespace {
+
+bool is_separator(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == ',';
+}
+
+// Lines not starting with a number (empty lines, comments, column headers)
+// are skipped. Numbers include nan and inf.
+bool is_data_line(const char* begin, const char* end) {
+  while (begin != end && is_separator(*begin)) ++begin;
+  if (begin == end) return false;
+
+  const char c = *begin;
+  if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.') return true;
+
+  const char* token_end = begin;
+  while (token_end != end && !is_separator(*token_end)) ++token_end;
+  float64_t value;
+  return parse_value(begin, token_end, &value);
+}
+
+template <typename functor_t>
+void for_each_data_line(const char* begin, const char* end,
+                        const functor_t& functor) {
+  while (begin != end) {
+    const char* line_end = static_cast<const char*>(
+        std::memchr(begin, '\n', size_t(end - begin)));
+    if (line_end == nullptr) line_end = end;
+
+    if (is_data_line(begin, line_end)) functor(begin, line_end);
+
+    begin = line_end == end ? end : line_end + 1;
+  }
+}
+
+template <typename value_type>
+bool parse_value(const char* begin, const char* end, value_type* value) {
+  if (begin != end && *begin == '+') ++begin;
+
+#if !defined(__cpp_lib_to_chars)
+  // Standard libraries without from_chars for floating point values
+  if constexpr (std::is_floating_point<value_type>::value) {
+    std::istringstream stream(std::string(begin, end));
+    stream.imbue(std::locale::classic());
+    stream >> *value;
+    return !stream.fail() &&
+           stream.peek() == std::istringstream::traits_type::eof();
+  } else
+#endif
+  {
+    // The whole token must be the value (e.g. no fraction in integer
+    // columns)
+    const std::from_chars_result result = std::from_chars(begin, end, *value);
+    return result.ec == std::errc() && result.ptr == end;
+  }
+}
+
+/*
+The type of the last three columns (the colors, if there are any) is taken
+from the first data lines: 8 or 16 bit integers, if all their values fit,
+otherwise floats (e.g. in [0, 1]). The colors of the points are normalized
+by the range of the type.
+*/
+data_type::base_type_t color_type_of_text_file(const char* begin,
+                                               const char* end,
+                                               int num_columns) {
+  const int max_num_lines = 1000;
+
+  int num_lines = 0;
+  bool are_integers = true;
+  int64_t max_value = 0;
+
+  while (begin != end && num_lines < max_num_lines && are_integers) {
+    const char* line_end = static_cast<const char*>(
+        std::memchr(begin, '\n', size_t(end - begin)));
+    if (line_end == nullptr) line_end = end;
+
+    if (is_data_line(begin, line_end)) {
+      num_lines++;
+
+      int column = 0;
+      for (const char* token = begin; token != line_end; ++column) {
+        while (token != line_end && is_separator(*token)) ++token;
+        const char* token_end = token;
+        while (token_end != line_end && !is_separator(*token_end))
+          ++token_end;
+        if (token == token_end) break;
+
+        int64_t value = 0;
+        if (column >= num_columns - 3) {
+          are_integers = are_integers &&
+                         parse_value(token, token_end, &value) && value >= 0;
+          max_value = glm::max(max_value, value);
+        }
+
+        token = token_end;
+      }
+    }
+
+    begin = line_end == end ? end : line_end + 1;
+  }
+
+  if (are_integers && max_value <= 255) return data_type::base_type_t::UINT8;
+  if (are_integers && max_value <= 65535)
+    return data_type::base_type_t::UINT16;
+  return data_type::base_type_t::FLOAT32;
+}
+
+/*
+Columns of xyz and pts files:
+- x y z
+- x y z intensity
+- x y z red green blue
+- x y z intensity red green blue
+Any other number of columns is loaded as x y z followed by unnamed properties.
+*/
+void columns_of_text_file(int num_columns,
+                          data_type::base_type_t color_type,
+                          QVector<QString>* names,
+                          QVector<data_type::base_type_t>* types) {
+  if (num_columns < 3)
+    throw QString("Expected at least three values (x y z) per point");
+
+  *names << "x"
+         << "y"
+         << "z";
+  *types << data_type::base_type_t::FLOAT64 << data_type::base_type_t::FLOAT64
+         << data_type::base_type_t::FLOAT64;
+
+  if (num_columns == 4 || num_columns == 7) {
+    *names << "intensity";
+    *types << data_type::base_type_t::FLOAT32;
+  }
+
+  if (num_columns == 6 || num_columns == 7) {
+    *names << "red"
+           << "green"
+           << "blue";
+    *types << color_type << color_type << color_type;
+  }
+
+  for (int i = names->length(); i < num_columns; ++i) {
+    *names << QString("property%0").arg(i - 2);
+    *types << data_type::base_type_t::FLOAT32;
+  }
+}
+
+}  // namespace
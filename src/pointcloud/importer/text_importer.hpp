@@ -0,0 +1,30 @@
+#ifndef POINTCLOUD_WORKERS_IMPORTER_TEXT_HPP_
+#define POINTCLOUD_WORKERS_IMPORTER_TEXT_HPP_
+
+#include <pointcloud/importer/abstract_importer.hpp>
+
+/**
+Implementation for loading text files with one point per line (ascii ply, xyz
+and pts files). The file is mapped into memory and parsed in parallel chunks.
+*/
+class TextImporter final : public AbstractPointCloudImporter {
+ public:
+  enum class format_t {
+    PLY,
+    XYZ,
+    PTS,
+  };
+
+  const format_t format;
+
+  TextImporter(const std::string& input_file, format_t format);
+
+  // Whether the file is an ascii ply file, which can be loaded by the
+  // TextImporter.
+  static bool is_supported_ascii_ply(const std::string& input_file);
+
+ protected:
+  bool import_implementation() override;
+};
+
+#endif  // POINTCLOUD_WORKERS_IMPORTER_TEXT_HPP_
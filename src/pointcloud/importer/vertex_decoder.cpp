@@ -0,0 +1,116 @@
+#include <core_library/simd_kernels.hpp>
+#include <pointcloud/importer/vertex_decoder.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+simd::value_type_t simd_value_type(data_type::base_type_t type);
+
+}  // namespace
+
+vertex_decoder_t::vertex_decoder_t(
+    size_t stride, const QVector<QString>& property_names,
+    const QVector<size_t>& property_offsets,
+    const QVector<data_type::base_type_t>& property_types)
+    : stride(stride),
+      property_offsets(property_offsets),
+      property_types(property_types) {
+  const char* coordinate_names[3] = {"x", "y", "z"};
+  const char* color_names[3] = {"red", "green", "blue"};
+
+  for (int i = 0; i < 3; ++i) {
+    coordinate_properties[i] = property_names.indexOf(coordinate_names[i]);
+    color_properties[i] = property_names.indexOf(color_names[i]);
+  }
+}
+
+// The columns are decoded one after another by the simd kernels.
+void vertex_decoder_t::decode(const uint8_t* user_data,
+                              PointCloud::vertex_t* vertices,
+                              size_t num_points, aabb_t* aabb) const {
+  uint8_t* vertex_data = reinterpret_cast<uint8_t*>(vertices);
+
+  // The vertices aren't initialized, so the missing components are filled
+  PointCloud::vertex_t fill_value{};
+  uint8_t fill_mask[PointCloud::stride];
+  std::memset(fill_mask, 0, sizeof(fill_mask));
+
+  std::memset(fill_mask + offsetof(PointCloud::vertex_t, _padding), 0xff,
+              sizeof(fill_value._padding));
+  for (int dimension = 0; dimension < 3; ++dimension) {
+    if (coordinate_properties[dimension] >= 0) continue;
+    fill_value.coordinate[dimension] = std::numeric_limits<float>::quiet_NaN();
+    std::memset(fill_mask + offsetof(PointCloud::vertex_t, coordinate) +
+                    size_t(dimension) * sizeof(float32_t),
+                0xff, sizeof(float32_t));
+  }
+  for (int channel = 0; channel < 3; ++channel) {
+    if (color_properties[channel] >= 0) continue;
+    fill_value.color[channel] = 255;
+    fill_mask[offsetof(PointCloud::vertex_t, color) + size_t(channel)] = 0xff;
+  }
+
+  uint8_t fill_bytes[PointCloud::stride];
+  std::memcpy(fill_bytes, &fill_value, sizeof(fill_bytes));
+  simd::masked_fill(vertex_data, PointCloud::stride, num_points, fill_bytes,
+                    fill_mask, PointCloud::stride);
+
+  for (int dimension = 0; dimension < 3; ++dimension) {
+    const int property = coordinate_properties[dimension];
+    if (property < 0) continue;
+
+    simd::convert(simd_value_type(property_types[property]),
+                  user_data + property_offsets[property], stride,
+                  simd::value_type_t::FLOAT32,
+                  vertex_data + offsetof(PointCloud::vertex_t, coordinate) +
+                      size_t(dimension) * sizeof(float32_t),
+                  PointCloud::stride, num_points, true);
+  }
+
+  // Only the dimensions present in the user data aren't nan
+  simd::extend_bounds(vertex_data + offsetof(PointCloud::vertex_t, coordinate),
+                      PointCloud::stride, num_points, &aabb->min_point,
+                      &aabb->max_point);
+
+  for (int channel = 0; channel < 3; ++channel) {
+    const int property = color_properties[channel];
+    if (property < 0) continue;
+
+    simd::convert(simd_value_type(property_types[property]),
+                  user_data + property_offsets[property], stride,
+                  simd::value_type_t::UINT8,
+                  vertex_data + offsetof(PointCloud::vertex_t, color) +
+                      size_t(channel),
+                  PointCloud::stride, num_points, true);
+  }
+}
+
+void vertex_decoder_t::merge_aabb(aabb_t* aabb, const aabb_t& other) {
+  aabb->min_point = glm::min(aabb->min_point, other.min_point);
+  aabb->max_point = glm::max(aabb->max_point, other.max_point);
+}
+
+bool vertex_decoder_t::has_coordinates(
+    const QVector<QString>& property_names) {
+  return property_names.contains("x") && property_names.contains("y") &&
+         property_names.contains("z");
+}
+
+namespace {
+
+// Both enums use the same values
+simd::value_type_t simd_value_type(data_type::base_type_t type) {
+  static_assert(int(simd::value_type_t::INT8) ==
+                        int(data_type::base_type_t::INT8) &&
+                    int(simd::value_type_t::UINT32) ==
+                        int(data_type::base_type_t::UINT32) &&
+                    int(simd::value_type_t::FLOAT64) ==
+                        int(data_type::base_type_t::FLOAT64),
+                "value types don't match");
+  return simd::value_type_t(type);
+}
+
+}  // namespace
@@ -0,0 +1,34 @@
+#ifndef POINTCLOUD_IMPORTER_VERTEX_DECODER_HPP_
+#define POINTCLOUD_IMPORTER_VERTEX_DECODER_HPP_
+
+#include <pointcloud/pointcloud.hpp>
+
+/**
+Decodes the coordinates and colors of points from their user data. The
+properties x, y, z, red, green and blue are found by their names.
+*/
+struct vertex_decoder_t {
+  size_t stride = 0;
+  QVector<size_t> property_offsets;
+  QVector<data_type::base_type_t> property_types;
+  int coordinate_properties[3] = {-1, -1, -1};
+  int color_properties[3] = {-1, -1, -1};
+
+  vertex_decoder_t(size_t stride, const QVector<QString>& property_names,
+                   const QVector<size_t>& property_offsets,
+                   const QVector<data_type::base_type_t>& property_types);
+
+  // Only the dimensions of the aabb present in the user data are extended.
+  // Missing coordinates become nan and missing colors white.
+  void decode(const uint8_t* user_data, PointCloud::vertex_t* vertices,
+              size_t num_points, aabb_t* aabb) const;
+
+  // Merges the aabb's returned by decode for different blocks of points
+  static void merge_aabb(aabb_t* aabb, const aabb_t& other);
+
+  // Whether the properties contain x, y and z. Otherwise, the coordinates
+  // are nan until the points are remapped.
+  static bool has_coordinates(const QVector<QString>& property_names);
+};
+
+#endif  // POINTCLOUD_IMPORTER_VERTEX_DECODER_HPP_
@@ -1,18 +1,24 @@
 #include <QtGlobal>
 #include <core_library/print.hpp>
 #include <core_library/stack.hpp>
+#include <core_library/thread_pool.hpp>
 #include <pointcloud/kdtree_index.hpp>
 
-#include <boost/sort/block_indirect_sort/block_indirect_sort.hpp>
+#include <algorithm>
+#include <atomic>
 
 KDTreeIndex::KDTreeIndex() {}
 
+KDTreeIndex::KDTreeIndex(KDTreeIndex&& other) = default;
+
+KDTreeIndex& KDTreeIndex::operator=(KDTreeIndex&& other) = default;
+
 KDTreeIndex::~KDTreeIndex() {}
 
 KDTreeIndex::point_index_t KDTreeIndex::pick_point(
     cone_t cone, const uint8_t* coordinates, uint stride,
     KDTreeIndex::point_index_t fallback) const {
-  if (tree.empty()) return fallback;
+  if (num_entries() == 0) return fallback;
 
   point_index_t best_point = fallback;
   float distance_of_best_point = std::numeric_limits<float>::infinity();
@@ -23,7 +29,7 @@ KDTreeIndex::point_index_t KDTreeIndex::pick_point(
   };
 
   Stack<stack_entry_t> stack;
-  stack.reserve(tree.size());
+  stack.reserve(128);
 
   stack.push(stack_entry_t{whole_tree(), total_aabb});
 
@@ -44,7 +50,7 @@ KDTreeIndex::point_index_t KDTreeIndex::pick_point(
         near_distance > distance_of_best_point)
       continue;
 
-    point_index_t current_point = tree[current.subtree.root()];
+    point_index_t current_point = entries()[current.subtree.root()];
     glm::vec3 current_coordinate =
         coordinate_for_index(current_point, coordinates, stride);
 
@@ -87,7 +93,7 @@ KDTreeIndex::point_index_t KDTreeIndex::pick_point(
 }
 
 size_t KDTreeIndex::root_point() const {
-  return range_t{0, this->tree.size()}.median();
+  return range_t{0, num_entries()}.median();
 }
 
 bool KDTreeIndex::has_children(size_t point) const {
@@ -148,6 +154,57 @@ glm::vec3 KDTreeIndex::point_coordinate(size_t point,
   return coordinate_for_index(point, coordinates, stride);
 }
 
+void KDTreeIndex::visit_points_in_region(
+    const aabb_t& region, const uint8_t* coordinates, uint stride,
+    const std::function<void(const point_index_t*, const point_index_t*)>&
+        visitor) const {
+  if (num_entries() == 0) return;
+
+  struct stack_entry_t {
+    subtree_t subtree;
+    aabb_t aabb;
+  };
+
+  Stack<stack_entry_t> stack;
+  stack.reserve(128);
+
+  stack.push(stack_entry_t{whole_tree(), total_aabb});
+
+  while (!stack.is_empty()) {
+    const stack_entry_t current = stack.pop();
+
+    if (glm::any(glm::lessThan(current.aabb.max_point, region.min_point)) ||
+        glm::any(glm::greaterThan(current.aabb.min_point, region.max_point)))
+      continue;
+
+    const range_t range = current.subtree.range;
+    if (glm::all(glm::lessThanEqual(region.min_point,
+                                    current.aabb.min_point)) &&
+        glm::all(glm::lessThanEqual(current.aabb.max_point,
+                                    region.max_point))) {
+      visitor(entries() + range.begin, entries() + range.end);
+      continue;
+    }
+
+    const size_t root = current.subtree.root();
+    const glm::vec3 root_coordinate =
+        coordinate_for_index(root, coordinates, stride);
+    if (region.contains(root_coordinate, 0.f))
+      visitor(entries() + root, entries() + root + 1);
+
+    std::pair<aabb_t, aabb_t> sub_aabbs =
+        current.aabb.split(current.subtree.split_dimension, root_coordinate);
+
+    const subtree_t left_subtree = current.subtree.left_subtree();
+    const subtree_t right_subtree = current.subtree.right_subtree();
+
+    if (!left_subtree.is_empty())
+      stack.push(stack_entry_t{left_subtree, sub_aabbs.first});
+    if (!right_subtree.is_empty())
+      stack.push(stack_entry_t{right_subtree, sub_aabbs.second});
+  }
+}
+
 void KDTreeIndex::clear() { tree.clear(); }
 
 void KDTreeIndex::build(aabb_t total_aabb, const uint8_t* coordinates,
@@ -158,59 +215,74 @@ void KDTreeIndex::build(aabb_t total_aabb, const uint8_t* coordinates,
     return component_for_index(point_index, dimension, coordinates, stride);
   };
 
-  tree.resize(num_points);
+  tree.resize(num_points * sizeof(point_index_t));
   this->total_aabb = total_aabb;
 
   // Fill the array with the coordinates in original order
-  for (size_t i = 0; i < num_points; ++i) tree[i] = point_index_t(i);
-
-  Stack<subtree_t> stack;
-  stack.reserve(num_points / 2);
-
-  stack.push(whole_tree());
-
-  size_t num_processed_points = 0;
-  size_t feedback_count_down;
+  point_index_t* indices = entries();
+  for (size_t i = 0; i < num_points; ++i) indices[i] = point_index_t(i);
+
+  // Subtrees at least this large are partitioned by jobs of their own
+  const size_t min_job_size = 65536;
+
+  std::atomic<size_t> num_processed_points(0);
+  std::atomic<bool> aborted(false);
+
+  std::function<void(subtree_t)> build_subtree;
+  task_group_t group(priority_t::BACKGROUND);
+
+  build_subtree = [&](subtree_t subtree) {
+    // Depth first, the stack holds at most two subtrees per level of the tree
+    Stack<subtree_t> stack;
+    stack.reserve(128);
+
+    stack.push(subtree);
+
+    size_t num_newly_processed_points = 0;
+    while (!stack.is_empty() && !aborted) {
+      const subtree_t current_tree = stack.pop();
+      const uint8_t dimension = current_tree.split_dimension;
+      num_newly_processed_points++;
+
+      // Only the root needs its final place, both halves stay unordered
+      std::nth_element(
+          indices + current_tree.range.begin, indices + current_tree.root(),
+          indices + current_tree.range.end,
+          [dimension, &coordinate_for_index](point_index_t a,
+                                             point_index_t b) {
+            return coordinate_for_index(a, dimension) <
+                   coordinate_for_index(b, dimension);
+          });
+
+      for (const subtree_t& child :
+           {current_tree.left_subtree(), current_tree.right_subtree()}) {
+        if (child.is_leaf())
+          num_newly_processed_points += child.range.size();
+        else if (child.range.size() >= min_job_size)
+          group.run([&build_subtree, child]() { build_subtree(child); });
+        else
+          stack.push(child);
+      }
 
-  auto reset_feedback_countdown = [&feedback_count_down, num_points]() {
-    feedback_count_down = num_points;
+      if (Q_UNLIKELY(num_newly_processed_points >= 4096)) {
+        num_processed_points += num_newly_processed_points;
+        num_newly_processed_points = 0;
+      }
+    }
+    num_processed_points += num_newly_processed_points;
   };
-  reset_feedback_countdown();
 
-  while (!stack.is_empty()) {
-    const subtree_t current_tree = stack.pop();
-    const uint8_t dimension = current_tree.split_dimension;
-    num_processed_points++;
-
-    boost::sort::block_indirect_sort(
-        tree.data() + current_tree.range.begin,
-        tree.data() + current_tree.range.end,
-        [dimension, coordinate_for_index](point_index_t a, point_index_t b) {
-          return coordinate_for_index(a, dimension) <
-                 coordinate_for_index(b, dimension);
-        });
-
-    const subtree_t left_subtree = current_tree.left_subtree();
-    if (!left_subtree.is_leaf())
-      stack.push(left_subtree);
-    else
-      num_processed_points += left_subtree.range.size();
+  const subtree_t root_tree = whole_tree();
+  group.run([&build_subtree, root_tree]() { build_subtree(root_tree); });
 
-    const subtree_t right_subtree = current_tree.right_subtree();
-    if (!right_subtree.is_leaf())
-      stack.push(right_subtree);
-    else
-      num_processed_points += right_subtree.range.size();
+  while (!group.wait_for(std::chrono::milliseconds(10)))
+    if (!aborted && !feedback(num_processed_points, num_points))
+      aborted = true;
+  group.wait();
 
-    if (Q_UNLIKELY(feedback_count_down < current_tree.range.size())) {
-      reset_feedback_countdown();
-      if (!feedback(num_processed_points, num_points)) {
-        tree.clear();
-        return;
-      }
-    } else {
-      feedback_count_down -= current_tree.range.size();
-    }
+  if (aborted) {
+    tree.clear();
+    return;
   }
 
 #ifndef NDEBUG
@@ -218,17 +290,27 @@ void KDTreeIndex::build(aabb_t total_aabb, const uint8_t* coordinates,
 #endif
 }
 
-bool KDTreeIndex::is_initialized() const { return !tree.empty(); }
+bool KDTreeIndex::is_initialized() const { return num_entries() != 0; }
 
 const KDTreeIndex::point_index_t* KDTreeIndex::data() const {
-  return tree.data();
+  return entries();
 }
 
-KDTreeIndex::point_index_t* KDTreeIndex::alloc_for_loading(size_t num_points,
-                                                           aabb_t total_aabb) {
+Buffer* KDTreeIndex::buffer_for_loading(aabb_t total_aabb) {
   this->total_aabb = total_aabb;
-  tree.resize(num_points);
-  return tree.data();
+  return &tree;
+}
+
+size_t KDTreeIndex::num_entries() const {
+  return tree.size() / sizeof(point_index_t);
+}
+
+KDTreeIndex::point_index_t* KDTreeIndex::entries() {
+  return reinterpret_cast<point_index_t*>(tree.data());
+}
+
+const KDTreeIndex::point_index_t* KDTreeIndex::entries() const {
+  return reinterpret_cast<const point_index_t*>(tree.data());
 }
 
 KDTreeIndex::subtree_t KDTreeIndex::traverse_kd_tree_to_point(
@@ -250,7 +332,7 @@ KDTreeIndex::subtree_t KDTreeIndex::traverse_kd_tree_to_point(
 }
 
 KDTreeIndex::subtree_t KDTreeIndex::whole_tree() const {
-  return subtree_t{range_t{0, this->tree.size()}, 0};
+  return subtree_t{range_t{0, num_entries()}, 0};
 }
 
 void KDTreeIndex::validate_tree(const uint8_t* coordinates, size_t num_points,
@@ -266,7 +348,7 @@ void KDTreeIndex::validate_tree(const uint8_t* coordinates, size_t num_points,
   };
 
   Stack<stack_entry_t> stack;
-  stack.reserve(num_points / 2);
+  stack.reserve(128);
 
   stack.push(stack_entry_t{total_aabb, whole_tree()});
 
@@ -321,7 +403,8 @@ float KDTreeIndex::component_for_index(point_index_t point_index,
 float KDTreeIndex::component_for_index(size_t entry_index, uint8_t dimension,
                                        const uint8_t* coordinates,
                                        uint stride) const {
-  return component_for_index(tree[entry_index], dimension, coordinates, stride);
+  return component_for_index(entries()[entry_index], dimension, coordinates,
+                             stride);
 }
 
 glm::vec3 KDTreeIndex::coordinate_for_index(point_index_t point_index,
@@ -336,7 +419,7 @@ glm::vec3 KDTreeIndex::coordinate_for_index(point_index_t point_index,
 glm::vec3 KDTreeIndex::coordinate_for_index(size_t entry_index,
                                             const uint8_t* coordinates,
                                             uint stride) const {
-  return coordinate_for_index(tree[entry_index], coordinates, stride);
+  return coordinate_for_index(entries()[entry_index], coordinates, stride);
 }
 
 bool KDTreeIndex::range_t::is_empty() const { return size() == 0; }
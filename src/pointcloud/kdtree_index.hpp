@@ -5,6 +5,7 @@
 #include <geometry/aabb.hpp>
 #include <geometry/cone.hpp>
 #include <glm/glm.hpp>
+#include <pointcloud/buffer.hpp>
 
 #include <functional>
 #include <vector>
@@ -22,6 +23,8 @@ class KDTreeIndex {
   typedef point_index_t POINT_INDEX;
 
   KDTreeIndex();
+  KDTreeIndex(KDTreeIndex&& other);
+  KDTreeIndex& operator=(KDTreeIndex&& other);
   ~KDTreeIndex();
 
   point_index_t pick_point(cone_t cone, const uint8_t* coordinates, uint stride,
@@ -37,6 +40,14 @@ class KDTreeIndex {
   glm::vec3 point_coordinate(size_t point, const uint8_t* coordinates,
                              uint stride) const;
 
+  // Calls the visitor with the points of all subtrees inside the region
+  // (including its boundary) and with the single points inside the region of
+  // the subtrees intersecting it. Only the visited subtrees are traversed.
+  void visit_points_in_region(
+      const aabb_t& region, const uint8_t* coordinates, uint stride,
+      const std::function<void(const point_index_t* begin,
+                               const point_index_t* end)>& visitor) const;
+
   void clear();
 
   void build(aabb_t total_aabb, const uint8_t* coordinates, size_t num_points,
@@ -45,7 +56,9 @@ class KDTreeIndex {
   bool is_initialized() const;
 
   const point_index_t* data() const;
-  point_index_t* alloc_for_loading(size_t num_points, aabb_t total_aabb);
+
+  // The buffer to load the tree into (it might be backed by a mapped file)
+  Buffer* buffer_for_loading(aabb_t total_aabb);
 
  private:
   struct range_t {
@@ -81,7 +94,11 @@ class KDTreeIndex {
   };
 
   aabb_t total_aabb;
-  std::vector<point_index_t> tree;
+  Buffer tree;  // array of point_index_t
+
+  size_t num_entries() const;
+  point_index_t* entries();
+  const point_index_t* entries() const;
 
   subtree_t traverse_kd_tree_to_point(
       size_t point, std::function<void(subtree_t inner_subtree)> visitor) const;
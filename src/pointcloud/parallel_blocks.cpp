@@ -0,0 +1,56 @@
+#include <core_library/thread_pool.hpp>
+#include <pointcloud/parallel_blocks.hpp>
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+
+size_t num_threads_for_blocks(size_t num_blocks) {
+  return glm::clamp<size_t>(thread_pool::num_threads(), 1,
+                            glm::max<size_t>(1, num_blocks));
+}
+
+void process_blocks_in_parallel(
+    size_t num_blocks,
+    const std::function<int64_t(size_t, size_t)>& process_block,
+    const std::function<void(int64_t)>& wait, int64_t first_progress) {
+  const size_t num_threads = num_threads_for_blocks(num_blocks);
+
+  std::atomic<size_t> next_block(0);
+  std::atomic<int64_t> progress(first_progress);
+  std::atomic<bool> aborted(false);
+
+  std::function<void(size_t)> process_next_block;
+  task_group_t group(priority_t::BACKGROUND);
+
+  // Every thread slot has at most one job at a time. Each job processes a
+  // single block and queues the next one, so interactive jobs don't have to
+  // wait until all blocks are done.
+  process_next_block = [&](size_t thread) {
+    const size_t block = next_block++;
+    if (block >= num_blocks || aborted) return;
+
+    try {
+      progress += process_block(block, thread);
+    } catch (...) {
+      aborted = true;
+      throw;
+    }
+
+    group.run([&process_next_block, thread]() { process_next_block(thread); });
+  };
+
+  for (size_t i = 0; i < num_threads; ++i)
+    group.run([&process_next_block, i]() { process_next_block(i); });
+
+  try {
+    while (!group.wait_for(std::chrono::milliseconds(10))) wait(progress);
+  } catch (...) {
+    // the destructor of the group waits for the running blocks
+    aborted = true;
+    throw;
+  }
+
+  group.wait();
+}
@@ -0,0 +1,22 @@
+#ifndef POINTCLOUD_PARALLEL_BLOCKS_HPP_
+#define POINTCLOUD_PARALLEL_BLOCKS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Number of threads used by process_blocks_in_parallel
+size_t num_threads_for_blocks(size_t num_blocks);
+
+// Calls process_block(block, thread) for all blocks as jobs of the thread
+// pool, with num_threads_for_blocks distinct values for thread. Meanwhile, the
+// calling thread, which must not be a worker of the pool, regularly calls
+// wait with the sum of the returned values (starting at first_progress).
+// Exceptions thrown by any of them stop the processing and are rethrown.
+void process_blocks_in_parallel(
+    size_t num_blocks,
+    const std::function<int64_t(size_t block, size_t thread)>& process_block,
+    const std::function<void(int64_t progress)>& wait,
+    int64_t first_progress = 0);
+
+#endif  // POINTCLOUD_PARALLEL_BLOCKS_HPP_
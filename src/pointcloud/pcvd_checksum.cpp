@@ -0,0 +1,80 @@
+#include <pointcloud/pcvd_checksum.hpp>
+
+#include <cstring>
+
+namespace pcvd_checksum {
+
+namespace {
+
+uint64_t checksum_of_word(uint64_t word, uint64_t index) {
+  uint64_t x = word ^ (index * 0x9e3779b97f4a7c15);
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+}  // namespace
+
+uint64_t checksum_of_words(const uint8_t* data, size_t size,
+                           uint64_t first_word_index) {
+  uint64_t sum = 0;
+  uint64_t index = first_word_index;
+
+  for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(uint64_t));
+    sum += checksum_of_word(word, index++);
+    data += sizeof(uint64_t);
+  }
+
+  if (size > 0) {
+    uint64_t word = 0;
+    std::memcpy(&word, data, size);
+    sum += checksum_of_word(word, index);
+  }
+
+  return sum;
+}
+
+void accumulator_t::append(const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+  // Completing the partial word first
+  const size_t partial_size = size_t(this->size % sizeof(uint64_t));
+  if (partial_size != 0) {
+    const size_t n = size < sizeof(uint64_t) - partial_size
+                         ? size
+                         : sizeof(uint64_t) - partial_size;
+    std::memcpy(partial_word + partial_size, bytes, n);
+    bytes += n;
+    size -= n;
+    this->size += n;
+
+    if (this->size % sizeof(uint64_t) != 0) return;
+    sum += checksum_of_words(partial_word, sizeof(uint64_t),
+                             this->size / sizeof(uint64_t) - 1);
+  }
+
+  const size_t words_size = size - size % sizeof(uint64_t);
+  sum += checksum_of_words(bytes, words_size, this->size / sizeof(uint64_t));
+  this->size += words_size;
+
+  std::memcpy(partial_word, bytes + words_size, size - words_size);
+  this->size += size - words_size;
+}
+
+void accumulator_t::replace_word(uint64_t offset, uint64_t old_word,
+                                 uint64_t new_word) {
+  const uint64_t index = offset / sizeof(uint64_t);
+  sum += checksum_of_word(new_word, index) - checksum_of_word(old_word, index);
+}
+
+uint64_t accumulator_t::checksum() const {
+  const size_t partial_size = size_t(size % sizeof(uint64_t));
+  if (partial_size == 0) return sum;
+
+  return sum + checksum_of_words(partial_word, partial_size,
+                                 size / sizeof(uint64_t));
+}
+
+}  // namespace pcvd_checksum
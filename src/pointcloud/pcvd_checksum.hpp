@@ -0,0 +1,44 @@
+#ifndef POINTCLOUD_PCVD_CHECKSUM_HPP_
+#define POINTCLOUD_PCVD_CHECKSUM_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+Checksums of the sections of pcvd files.
+
+The checksum of a byte sequence is the sum (modulo 2^64) of
+mix(word ^ index * 0x9e3779b97f4a7c15) over its 64 bit words, where index is
+the index of the word within the sequence, the last word is padded with zeros
+and mix is the (bijective) finalizer of splitmix64. The words are read in the
+byte order of the platform (little endian, like the files).
+
+As the words contribute independently, parts of a sequence can be checked in
+parallel and a word can still be replaced after it has been added.
+*/
+namespace pcvd_checksum {
+
+// Sum of the words of data, the first one having the given index. size must
+// be a multiple of 8, except at the end of the sequence.
+uint64_t checksum_of_words(const uint8_t* data, size_t size,
+                           uint64_t first_word_index);
+
+// Checksum of a sequence appended in pieces of any size
+class accumulator_t {
+ public:
+  void append(const void* data, size_t size);
+
+  // Replaces the word at the byte offset (a multiple of 8) appended before
+  void replace_word(uint64_t offset, uint64_t old_word, uint64_t new_word);
+
+  uint64_t checksum() const;
+
+ private:
+  uint64_t sum = 0;
+  uint64_t size = 0;
+  uint8_t partial_word[8] = {};
+};
+
+}  // namespace pcvd_checksum
+
+#endif  // POINTCLOUD_PCVD_CHECKSUM_HPP_
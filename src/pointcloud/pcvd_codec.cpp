@@ -0,0 +1,410 @@
+#include <pointcloud/pcvd_codec.hpp>
+#include <pointcloud/property_view.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace pcvd_codec {
+
+namespace {
+
+constexpr uint32_t max_cell() { return (1u << 21) - 1; }
+
+uint64_t zigzag(uint64_t delta) {
+  return (delta << 1) ^ uint64_t(int64_t(delta) >> 63);
+}
+
+uint64_t unzigzag(uint64_t value) { return (value >> 1) ^ (0 - (value & 1)); }
+
+uint32_t bits_needed(uint64_t value) {
+  uint32_t bits = 0;
+  while (bits < 64 && (value >> bits) != 0) ++bits;
+  return bits;
+}
+
+template <typename T>
+void write_raw(std::vector<uint8_t>* block, const T& value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  block->insert(block->end(), bytes, bytes + sizeof(T));
+}
+
+void write_varint(std::vector<uint8_t>* block, uint64_t value) {
+  while (value >= 0x80) {
+    block->push_back(uint8_t(value | 0x80));
+    value >>= 7;
+  }
+  block->push_back(uint8_t(value));
+}
+
+// Appends the lower bits of each value
+void write_bits(std::vector<uint8_t>* block,
+                const std::vector<uint64_t>& values, uint32_t bits) {
+  uint64_t accumulator = 0;
+  uint32_t accumulated_bits = 0;
+
+  for (uint64_t value : values) {
+    if (bits == 0) break;
+
+    accumulator |= value << accumulated_bits;
+    if (accumulated_bits + bits < 64) {
+      accumulated_bits += bits;
+      continue;
+    }
+
+    write_raw(block, accumulator);
+    accumulator =
+        accumulated_bits == 0 ? 0 : value >> (64 - accumulated_bits);
+    accumulated_bits = accumulated_bits + bits - 64;
+  }
+
+  for (uint32_t i = 0; i < accumulated_bits; i += 8)
+    block->push_back(uint8_t(accumulator >> i));
+}
+
+// Reads from a block, throwing instead of reading behind its end
+struct reader_t {
+  const uint8_t* current;
+  const uint8_t* end;
+
+  void require(size_t num_bytes) const {
+    if (size_t(end - current) < num_bytes)
+      throw QString("Corrupt compressed block!");
+  }
+
+  template <typename T>
+  T read_raw() {
+    require(sizeof(T));
+    T value;
+    std::memcpy(&value, current, sizeof(T));
+    current += sizeof(T);
+    return value;
+  }
+
+  uint64_t read_varint() {
+    uint64_t value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+      require(1);
+      const uint8_t byte = *(current++);
+      value |= uint64_t(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return value;
+    }
+    throw QString("Corrupt compressed block!");
+  }
+};
+
+// Reads values written by write_bits. The caller makes sure, the bytes exist.
+struct bit_reader_t {
+  const uint8_t* current;
+  uint64_t accumulator = 0;
+  uint32_t accumulated_bits = 0;
+
+  uint64_t read(uint32_t bits) {
+    if (bits == 0) return 0;
+    const uint64_t mask = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+
+    while (accumulated_bits < bits && accumulated_bits <= 56) {
+      accumulator |= uint64_t(*(current++)) << accumulated_bits;
+      accumulated_bits += 8;
+    }
+
+    if (accumulated_bits >= bits) {
+      const uint64_t value = accumulator & mask;
+      accumulator = bits == 64 ? 0 : accumulator >> bits;
+      accumulated_bits -= bits;
+      return value;
+    }
+
+    // The value continues in the next byte, which doesn't fit completely
+    const uint8_t next_byte = *(current++);
+    const uint64_t value =
+        (accumulator | (uint64_t(next_byte) << accumulated_bits)) & mask;
+    const uint32_t used_bits = bits - accumulated_bits;
+    accumulator = uint64_t(next_byte) >> used_bits;
+    accumulated_bits = 8 - used_bits;
+    return value;
+  }
+};
+
+bool is_integer(data_type::base_type_t type) {
+  return type != data_type::BASE_TYPE::FLOAT32 &&
+         type != data_type::BASE_TYPE::FLOAT64;
+}
+
+void encode_raw(const void* data, size_t size, std::vector<uint8_t>* block) {
+  block->clear();
+  block->push_back(uint8_t(encoding_t::RAW));
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+  block->insert(block->end(), bytes, bytes + size);
+}
+
+void decode_raw(reader_t& reader, void* data, size_t size) {
+  reader.require(size);
+  std::memcpy(data, reader.current, size);
+  reader.current += size;
+}
+
+uint64_t split_by_3(uint32_t component) {
+  uint64_t x = component & max_cell();
+  x = (x | x << 32) & 0x1f00000000ffffull;
+  x = (x | x << 16) & 0x1f0000ff0000ffull;
+  x = (x | x << 8) & 0x100f00f00f00f00full;
+  x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+  x = (x | x << 2) & 0x1249249249249249ull;
+  return x;
+}
+
+uint32_t compact_by_3(uint64_t x) {
+  x &= 0x1249249249249249ull;
+  x = (x ^ (x >> 2)) & 0x10c30c30c30c30c3ull;
+  x = (x ^ (x >> 4)) & 0x100f00f00f00f00full;
+  x = (x ^ (x >> 8)) & 0x1f0000ff0000ffull;
+  x = (x ^ (x >> 16)) & 0x1f00000000ffffull;
+  x = (x ^ (x >> 32)) & 0x1fffffull;
+  return uint32_t(x);
+}
+
+glm::uvec3 quantize(glm::vec3 coordinate, glm::vec3 origin, float step) {
+  return glm::uvec3(glm::min(glm::round((coordinate - origin) / step),
+                             glm::vec3(float(max_cell()))));
+}
+
+bool is_finite(glm::vec3 coordinate) {
+  return !glm::any(glm::isnan(coordinate)) && !glm::any(glm::isinf(coordinate));
+}
+
+}  // namespace
+
+uint64_t morton_code(glm::uvec3 cell) {
+  return split_by_3(cell.x) | (split_by_3(cell.y) << 1) |
+         (split_by_3(cell.z) << 2);
+}
+
+glm::uvec3 cell_of_morton_code(uint64_t code) {
+  return glm::uvec3(compact_by_3(code), compact_by_3(code >> 1),
+                    compact_by_3(code >> 2));
+}
+
+void encode_vertices(const PointCloud::vertex_t* vertices, size_t num_points,
+                     float coordinate_step, std::vector<uint8_t>* block) {
+  const size_t raw_size = num_points * sizeof(PointCloud::vertex_t);
+
+  aabb_t aabb = aabb_t::invalid();
+  for (size_t i = 0; i < num_points; ++i) {
+    if (!is_finite(vertices[i].coordinate))
+      return encode_raw(vertices, raw_size, block);
+    aabb |= vertices[i].coordinate;
+  }
+  if (num_points == 0) return encode_raw(vertices, raw_size, block);
+
+  const glm::vec3 extent = aabb.size();
+  float step = glm::max(coordinate_step,
+                        glm::max(extent.x, glm::max(extent.y, extent.z)) /
+                            float(max_cell()));
+  if (!(step > 0.f) || std::isinf(step)) step = 1.f;
+
+  std::vector<uint64_t> deltas;
+  deltas.reserve(num_points - 1);
+  uint64_t previous_code =
+      morton_code(quantize(vertices[0].coordinate, aabb.min_point, step));
+  const uint64_t first_code = previous_code;
+  uint64_t max_delta = 0;
+  for (size_t i = 1; i < num_points; ++i) {
+    const uint64_t code =
+        morton_code(quantize(vertices[i].coordinate, aabb.min_point, step));
+    deltas.push_back(zigzag(code - previous_code));
+    max_delta = glm::max(max_delta, deltas.back());
+    previous_code = code;
+  }
+  const uint32_t bits = bits_needed(max_delta);
+
+  block->clear();
+  block->push_back(uint8_t(encoding_t::QUANTIZED_MORTON));
+  write_raw(block, aabb.min_point);
+  write_raw(block, step);
+  write_raw(block, first_code);
+  block->push_back(uint8_t(bits));
+  write_bits(block, deltas, bits);
+
+  glm::u8vec3 previous_color(0);
+  for (size_t i = 0; i < num_points; ++i) {
+    const glm::u8vec3 color = vertices[i].color;
+    for (int channel = 0; channel < 3; ++channel) {
+      const int8_t delta =
+          int8_t(uint8_t(color[channel] - previous_color[channel]));
+      write_varint(block, zigzag(uint64_t(int64_t(delta))));
+    }
+    previous_color = color;
+  }
+
+  if (block->size() > raw_size + 1) encode_raw(vertices, raw_size, block);
+}
+
+void decode_vertices(const uint8_t* block, size_t block_size,
+                     PointCloud::vertex_t* vertices, size_t num_points) {
+  reader_t reader{block, block + block_size};
+
+  switch (encoding_t(reader.read_raw<uint8_t>())) {
+    case encoding_t::RAW:
+      decode_raw(reader, vertices, num_points * sizeof(PointCloud::vertex_t));
+      return;
+    case encoding_t::QUANTIZED_MORTON:
+      break;
+    default:
+      throw QString("Corrupt compressed block! (unknown encoding)");
+  }
+
+  if (num_points == 0) throw QString("Corrupt compressed block!");
+
+  const glm::vec3 origin = reader.read_raw<glm::vec3>();
+  const float step = reader.read_raw<float>();
+  uint64_t code = reader.read_raw<uint64_t>();
+  const uint32_t bits = reader.read_raw<uint8_t>();
+  if (bits > 64) throw QString("Corrupt compressed block! (invalid bits)");
+
+  const size_t packed_size = ((num_points - 1) * bits + 7) / 8;
+  reader.require(packed_size);
+
+  bit_reader_t bit_reader{reader.current};
+  for (size_t i = 0; i < num_points; ++i) {
+    if (i > 0) code += unzigzag(bit_reader.read(bits));
+    vertices[i].coordinate =
+        origin + glm::vec3(cell_of_morton_code(code)) * step;
+  }
+  reader.current += packed_size;
+
+  glm::u8vec3 color(0);
+  for (size_t i = 0; i < num_points; ++i) {
+    for (int channel = 0; channel < 3; ++channel)
+      color[channel] = uint8_t(color[channel] +
+                               uint8_t(unzigzag(reader.read_varint())));
+    vertices[i].color = color;
+    vertices[i]._padding = padding<uint8_t>();
+  }
+}
+
+void encode_values(data_type::base_type_t type, const uint8_t* values,
+                   size_t num_points, std::vector<uint8_t>* block) {
+  const size_t value_size = data_type::size_of_type(type);
+  const size_t raw_size = num_points * value_size;
+
+  if (!is_integer(type)) return encode_raw(values, raw_size, block);
+
+  block->clear();
+  block->push_back(uint8_t(encoding_t::DELTA_VARINT));
+
+  visit_property_type(type, [&](auto type_value) {
+    const PropertyView<decltype(type_value)> view(values, value_size,
+                                                  num_points);
+
+    uint64_t previous = 0;
+    for (size_t i = 0; i < num_points; ++i) {
+      const uint64_t value = uint64_t(int64_t(view[i]));
+      write_varint(block, zigzag(value - previous));
+      previous = value;
+    }
+  });
+
+  if (block->size() > raw_size + 1) encode_raw(values, raw_size, block);
+}
+
+void decode_values(data_type::base_type_t type, const uint8_t* block,
+                   size_t block_size, uint8_t* values, size_t num_points) {
+  const size_t value_size = data_type::size_of_type(type);
+  reader_t reader{block, block + block_size};
+
+  switch (encoding_t(reader.read_raw<uint8_t>())) {
+    case encoding_t::RAW:
+      decode_raw(reader, values, num_points * value_size);
+      return;
+    case encoding_t::DELTA_VARINT: {
+      if (!is_integer(type)) break;
+
+      visit_property_type(type, [&](auto type_value) {
+        typedef decltype(type_value) value_t;
+
+        uint64_t value = 0;
+        for (size_t i = 0; i < num_points; ++i) {
+          value += unzigzag(reader.read_varint());
+          write_value_to_buffer(values + i * value_size,
+                                value_t(int64_t(value)));
+        }
+      });
+      return;
+    }
+    default:
+      break;
+  }
+
+  throw QString("Corrupt compressed block! (unknown encoding)");
+}
+
+void encode_indices(const uint64_t* indices, size_t num_points,
+                    std::vector<uint8_t>* block) {
+  const size_t raw_size = num_points * sizeof(uint64_t);
+
+  block->clear();
+  block->push_back(uint8_t(encoding_t::DELTA_VARINT));
+
+  uint64_t previous = 0;
+  for (size_t i = 0; i < num_points; ++i) {
+    write_varint(block, zigzag(indices[i] - previous));
+    previous = indices[i];
+  }
+
+  if (block->size() > raw_size + 1) encode_raw(indices, raw_size, block);
+}
+
+void decode_indices(const uint8_t* block, size_t block_size,
+                    uint64_t* indices, size_t num_points) {
+  reader_t reader{block, block + block_size};
+
+  switch (encoding_t(reader.read_raw<uint8_t>())) {
+    case encoding_t::RAW:
+      decode_raw(reader, indices, num_points * sizeof(uint64_t));
+      return;
+    case encoding_t::DELTA_VARINT: {
+      uint64_t index = 0;
+      for (size_t i = 0; i < num_points; ++i) {
+        index += unzigzag(reader.read_varint());
+        indices[i] = index;
+      }
+      return;
+    }
+    default:
+      throw QString("Corrupt compressed block! (unknown encoding)");
+  }
+}
+
+void sort_by_morton_code(const PointCloud& pointcloud, size_t* begin,
+                         size_t* end) {
+  aabb_t aabb = aabb_t::invalid();
+  for (const size_t* point = begin; point != end; ++point) {
+    const glm::vec3 coordinate = pointcloud.vertex(*point).coordinate;
+    if (is_finite(coordinate)) aabb |= coordinate;
+  }
+  if (aabb.is_inf()) return;
+
+  const glm::vec3 extent = aabb.size();
+  const float step =
+      glm::max(extent.x, glm::max(extent.y, extent.z)) / float(max_cell());
+  if (!(step > 0.f) || std::isinf(step)) return;
+
+  std::vector<std::pair<uint64_t, size_t>> codes;
+  codes.reserve(size_t(end - begin));
+  for (const size_t* point = begin; point != end; ++point) {
+    const glm::vec3 coordinate = pointcloud.vertex(*point).coordinate;
+    codes.emplace_back(
+        is_finite(coordinate)
+            ? morton_code(quantize(coordinate, aabb.min_point, step))
+            : 0,
+        *point);
+  }
+
+  std::sort(codes.begin(), codes.end());
+
+  for (const std::pair<uint64_t, size_t>& code : codes)
+    *(begin++) = code.second;
+}
+
+}  // namespace pcvd_codec
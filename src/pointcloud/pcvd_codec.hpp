@@ -0,0 +1,69 @@
+#ifndef POINTCLOUD_PCVD_CODEC_HPP_
+#define POINTCLOUD_PCVD_CODEC_HPP_
+
+#include <pointcloud/pointcloud.hpp>
+
+#include <vector>
+
+/*
+Codec for the compressed sections of pcvd files.
+
+The points of a section are split into blocks of
+section_header_t::points_per_block points. Each block is encoded on its own,
+so the blocks can be encoded and decoded in parallel. A compressed section
+consists out of
+
+  section_header_t
+  uint64_t[number_blocks]   // the size of each block in bytes
+  the blocks                // each starting with its encoding_t
+
+The decoders throw a QString for corrupt blocks.
+*/
+namespace pcvd_codec {
+
+constexpr size_t points_per_block() { return 65536; }
+
+struct section_header_t {
+  uint32_t number_blocks;
+  uint32_t points_per_block;
+};
+
+enum class encoding_t : uint8_t {
+  RAW = 0,
+  QUANTIZED_MORTON = 1,  // vertices (coordinates and colors)
+  DELTA_VARINT = 2,      // integers
+};
+
+// The coordinates are quantized to a grid relative to the block's minimum
+// (with a step of at least coordinate_step, coarser only for blocks larger
+// than 2^21 steps), ordered by their Morton code and stored as bit packed
+// deltas of the Morton codes. Blocks with non finite coordinates are stored
+// raw. The colors are delta and varint encoded per channel.
+void encode_vertices(const PointCloud::vertex_t* vertices, size_t num_points,
+                     float coordinate_step, std::vector<uint8_t>* block);
+void decode_vertices(const uint8_t* block, size_t block_size,
+                     PointCloud::vertex_t* vertices, size_t num_points);
+
+// Integers are delta and varint encoded, floats are stored raw
+void encode_values(data_type::base_type_t type, const uint8_t* values,
+                   size_t num_points, std::vector<uint8_t>* block);
+void decode_values(data_type::base_type_t type, const uint8_t* block,
+                   size_t block_size, uint8_t* values, size_t num_points);
+
+void encode_indices(const uint64_t* indices, size_t num_points,
+                    std::vector<uint8_t>* block);
+void decode_indices(const uint8_t* block, size_t block_size,
+                    uint64_t* indices, size_t num_points);
+
+// Interleaves the lower 21 bits of the components
+uint64_t morton_code(glm::uvec3 cell);
+glm::uvec3 cell_of_morton_code(uint64_t code);
+
+// Sorts the point indices along the Morton order of their coordinates, so
+// the deltas of the encoded Morton codes are small
+void sort_by_morton_code(const PointCloud& pointcloud, size_t* begin,
+                         size_t* end);
+
+}  // namespace pcvd_codec
+
+#endif  // POINTCLOUD_PCVD_CODEC_HPP_
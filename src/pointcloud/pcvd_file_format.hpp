@@ -21,10 +21,69 @@ number_points. Format is described by  the field headers
   SHADER                    // optional - existant if and only if `(flags &
 0b100)!=0`. Consists out of the shader_description_t and the following string
 data (utf8)
+  REMAP_CACHE               // optional - existant if and only if `(flags &
+0b1000)!=0`. Consists out of the remap_cache_description_t followed by
+remap_cache_description_t::number_entries times the key (uint64_t) and
+vertex_t[header.number_points]. The most recently used entry comes first.
   UNKNOWN_DATA              // optional, only allowed if and only if
-`(flags&0xf8)!=0`)
+`(flags&0xff80)!=0`)
+
+File version 2 added the REMAP_CACHE section. As it's placed behind all other
+sections, files of version 2 can still be read by version 1 readers.
+
+File version 3 added the flag 0b10000 for aligned sections. If set, zero
+padding is inserted in front of the arrays of the POINT_CLOUD_VERTEX_DATA,
+POINT_CLOUD_DATA and KD_TREE sections and in front of the vertex_t array of
+every REMAP_CACHE entry, so each of them starts at a file offset being a
+multiple of section_alignment(). This allows mapping the sections directly
+into memory. Files with aligned sections can't be read by older readers.
+
+File version 4 added the flag 0b100000 for a table of contents. If set, the
+FIELD_NAMES are followed by
+
+  TABLE_OF_CONTENTS         // table_of_contents_t followed by
+section_t[number_sections]
+
+and all other data is stored in the sections listed there. Each section starts
+at a file offset being a multiple of section_alignment(). The user data is
+stored column wise with one PROPERTY_COLUMN section per field, containing the
+tightly packed values of this field for all points. This allows loading
+single properties. The flags 0b1, 0b10, 0b100 and 0b1000 still tell, which of
+the optional sections exist. Sections with unknown types are ignored.
+
+The optional SPATIAL_CHUNKS section splits the points into chunks of
+neighbouring points. The points are sorted by chunk, so each chunk is a
+contiguous range of points and covers the byte range
+[first_point*element_size, (first_point+num_points)*element_size) of every
+per-point section. Readers only interested in a region can skip the chunks
+not intersecting it.
+
+File version 5 added the flag 0b1000000 for compressed sections, which is only
+allowed together with the table of contents. The VERTEX_DATA,
+PROPERTY_COLUMN, KD_TREE and REMAP_CACHE_ENTRY sections are then encoded as
+described in pcvd_codec.hpp and section_t::size is their encoded size. Within
+each encoded block (and chunk), the points are sorted along the Morton order.
+
+File version 6 added the CHECKSUMS section (see pcvd_checksum.hpp), the last
+section of the file. It contains one checksum per section in the order of the
+table of contents. Its own entry is the checksum of the file up to the end of
+the table of contents. As unknown sections are ignored, these files can still
+be read by version 4 and 5 readers.
+
+File version 7 added the ORIGIN section. The vertex coordinates and the
+floating point properties x, y and z are relative to this origin. Files with
+an ORIGIN section have the downwards compatibility version 7, as older readers
+would ignore it and misplace the points.
 */
 
+constexpr uint64_t section_alignment() { return 4096; }
+
+// Number of padding bytes to insert at the given file offset
+inline uint64_t padding_for_section_alignment(uint64_t offset) {
+  return (section_alignment() - offset % section_alignment()) %
+         section_alignment();
+}
+
 struct header_t {
   static constexpr uint32_t expected_macic_number() {
     return (uint32_t('p') << 0) | (uint32_t('c') << 8) | (uint32_t('v') << 16) |
@@ -33,7 +92,7 @@ struct header_t {
 
   uint32_t magic_number;  // must be `expected_macic_number()`
 
-  uint16_t file_version_number;  // the file version (must be 1)
+  uint16_t file_version_number;  // the file version (must be 1 to 7)
   uint16_t downwards_compatibility_version_number;  // up to which file version
                                                     // is this file downwards
                                                     // compatible
@@ -48,7 +107,11 @@ struct header_t {
 
   uint16_t flags;  // 0b1: contains kdtree, 0b10: contains vertex_data other
                    // bits must be zero if file_version_number==0. 0b100:
-                   // contains the shader
+                   // contains the shader. 0b1000: contains the remap cache
+                   // (file_version_number>=2). 0b10000: aligned sections
+                   // (file_version_number>=3). 0b100000: table of contents
+                   // (file_version_number>=4). 0b1000000: compressed
+                   // sections (file_version_number>=5)
 
   aabb_t aabb;
 
@@ -57,6 +120,37 @@ struct header_t {
   uint32_t reserved;  // ignored. Must be zero, if file_version_number<=1
 };
 
+enum class section_type_t : uint32_t {
+  VERTEX_DATA = 0,        // vertex_t[header.number_points]
+  PROPERTY_COLUMN = 1,    // values of the field section_t::index
+  KD_TREE = 2,            // uint64_t[header.number_points]
+  SHADER = 3,             // shader_description_t and the string data
+  REMAP_CACHE_ENTRY = 4,  // vertex_t[header.number_points], ordered by
+                          // section_t::index (most recently used first)
+  SPATIAL_CHUNKS = 5,     // spatial_chunk_t[], ordered by first_point
+  CHECKSUMS = 6,          // uint64_t[number_sections]
+  ORIGIN = 7,             // float64_t[3]
+};
+
+struct table_of_contents_t {
+  uint32_t number_sections;
+  uint32_t reserved;  // must be zero
+};
+
+struct section_t {
+  section_type_t type;
+  uint32_t index;   // field index or remap cache entry index (otherwise zero)
+  uint64_t key;     // key of a REMAP_CACHE_ENTRY (otherwise zero)
+  uint64_t offset;  // from the beginning of the file
+  uint64_t size;    // in bytes
+};
+
+struct spatial_chunk_t {
+  aabb_t aabb;  // of the vertex coordinates of the chunk
+  uint64_t first_point;
+  uint64_t num_points;
+};
+
 struct field_description_t {
   uint8_t name_length;
   data_type::base_type_t type;
@@ -69,4 +163,9 @@ struct shader_description_t {
   uint16_t node_data_length;              // number of bytes (utf8)
 };
 
+struct remap_cache_description_t {
+  uint32_t number_entries;
+  uint32_t reserved;  // must be zero
+};
+
 }  // namespace pcvd_format
@@ -1,6 +1,9 @@
 #include <core_library/print.hpp>
+#include <cmath>
 #include <cstring>
+#include <pointcloud/pcvd_checksum.hpp>
 #include <pointcloud/pointcloud.hpp>
+#include <pointcloud/property_view.hpp>
 
 #include <core_library/types.hpp>
 
@@ -8,9 +11,12 @@
 #include <QSettings>
 #include <QtGlobal>
 
-typedef data_type::BASE_TYPE BASE_TYPE;
+#include <type_traits>
 
-PointCloud::PointCloud() { is_valid = false; }
+PointCloud::PointCloud() {
+  is_valid = false;
+  num_points = 0;
+}
 
 PointCloud::PointCloud(PointCloud&& other) = default;
 
@@ -22,29 +28,19 @@ PointCloud::UserData PointCloud::all_values_of_point(size_t point_index) const {
   QVector<QVariant> values;
   values.reserve(n);
 
-  const uint8_t* data = user_data.data() + user_data_stride * point_index;
-
   for (int i = 0; i < n; ++i) {
+    // pending columns are read directly, without loading the whole column
     QVariant value;
-    switch (user_data_types[i]) {
-      case BASE_TYPE::UINT8:
-      case BASE_TYPE::UINT16:
-      case BASE_TYPE::UINT32:
-        value = qulonglong(data_type::read_value_from_buffer<uint64_t>(
-            user_data_types[i], data + user_data_offset[i]));
-        break;
-      case BASE_TYPE::INT8:
-      case BASE_TYPE::INT16:
-      case BASE_TYPE::INT32:
-        value = qlonglong(data_type::read_value_from_buffer<int64_t>(
-            user_data_types[i], data + user_data_offset[i]));
-        break;
-      case BASE_TYPE::FLOAT32:
-      case BASE_TYPE::FLOAT64:
-        value = double(data_type::read_value_from_buffer<float64_t>(
-            user_data_types[i], data + user_data_offset[i]));
-        break;
-    }
+    visit_property(*this, i, [&](auto view) {
+      typedef typename decltype(view)::value_type value_t;
+
+      if constexpr (std::is_floating_point<value_t>::value)
+        value = double(view[point_index]);
+      else if constexpr (std::is_signed<value_t>::value)
+        value = qlonglong(view[point_index]);
+      else
+        value = qulonglong(view[point_index]);
+    });
 
     values << value;
   }
@@ -54,22 +50,291 @@ PointCloud::UserData PointCloud::all_values_of_point(size_t point_index) const {
 
 void PointCloud::set_label(size_t point_index, int label) {
   if (point_index != (size_t)KDTreeIndex::point_index_t::INVALID) {
-    std::cout << "PointCloud::set_label" << std::endl;
-
     const int user_data_idx = 6;
+    load_user_data_column(user_data_idx);
+
     uint8_t* data = user_data.data() + user_data_stride * point_index;
     data_type::write_value_to_buffer<uint64_t>(
         user_data_types[user_data_idx], data + user_data_offset[user_data_idx],
         label * 255);
+
+    mark_dirty(point_index);
+
+    // the cached results computed from the old labels
+    remap_cache.invalidate_property(user_data_names[user_data_idx]);
   }
 }
 
+bool PointCloud::is_user_data_column_pending(int column) const {
+  return size_t(column) < pending_user_data_columns.size() &&
+         pending_user_data_columns[size_t(column)].size() != 0;
+}
+
+bool PointCloud::load_user_data_columns(const QSet<QString>& names) {
+  bool loaded_any_column = false;
+  QString error;
+
+  for (const QString& name : names) {
+    const int column = user_data_names.indexOf(name);
+    if (column < 0) continue;
+
+    try {
+      loaded_any_column |= load_user_data_column(column);
+    } catch (QString message) {
+      loaded_any_column = true;
+      error = message;
+    }
+  }
+
+  if (!error.isEmpty()) throw error;
+  return loaded_any_column;
+}
+
+bool PointCloud::load_user_data_column(int column) {
+  if (!is_user_data_column_pending(column)) return false;
+
+  Buffer pending_column =
+      std::move(pending_user_data_columns[size_t(column)]);
+
+  const size_t value_size = data_type::size_of_type(user_data_types[column]);
+  const uint8_t* source = pending_column.data();
+  uint8_t* target = user_data.data() + user_data_offset[column];
+
+  // Mapped columns are read for the first time here
+  const bool is_corrupt =
+      size_t(column) < pending_user_data_checksums.size() &&
+      pcvd_checksum::checksum_of_words(source, pending_column.size(), 0) !=
+          pending_user_data_checksums[size_t(column)];
+
+  for (size_t i = 0; i < num_points; ++i) {
+    if (is_corrupt)
+      std::memset(target, 0, value_size);
+    else
+      std::memcpy(target, source, value_size);
+    source += value_size;
+    target += user_data_stride;
+  }
+
+  if (is_corrupt)
+    throw QString("Corrupt file! (checksum mismatch of the property %0)")
+        .arg(user_data_names[column]);
+
+  return true;
+}
+
+bool PointCloud::load_all_user_data_columns() {
+  QSet<QString> names;
+  for (const QString& name : user_data_names) names << name;
+  return load_user_data_columns(names);
+}
+
+void PointCloud::mark_dirty(size_t point_index) {
+  Q_ASSERT(point_index < num_points);
+
+  const size_t chunk = point_index / dirty_chunk_size();
+
+  if (dirty_chunks.size() <= chunk)
+    dirty_chunks.resize((num_points + dirty_chunk_size() - 1) /
+                            dirty_chunk_size(),
+                        false);
+
+  if (!dirty_chunks[chunk]) {
+    dirty_chunks[chunk] = true;
+    num_dirty_chunks++;
+  }
+}
+
+bool PointCloud::has_dirty_points() const { return num_dirty_chunks > 0; }
+
+std::vector<PointCloud::point_range_t> PointCloud::dirty_point_ranges() const {
+  std::vector<point_range_t> ranges;
+
+  for (size_t chunk = 0; chunk < dirty_chunks.size(); ++chunk) {
+    if (!dirty_chunks[chunk]) continue;
+
+    const size_t begin = chunk * dirty_chunk_size();
+    const size_t end = glm::min(begin + dirty_chunk_size(), num_points);
+
+    // merge neighboring chunks
+    if (!ranges.empty() && ranges.back().end == begin)
+      ranges.back().end = end;
+    else
+      ranges.push_back(point_range_t{begin, end});
+  }
+
+  return ranges;
+}
+
+void PointCloud::clear_dirty_points() {
+  dirty_chunks.clear();
+  num_dirty_chunks = 0;
+}
+
+PointCloud PointCloud::stratified_sample(
+    size_t target_num_points,
+    std::function<bool(size_t, size_t)> feedback) const {
+  PointCloud sample;
+  sample.set_user_data_format(user_data_stride, user_data_names,
+                              user_data_offset, user_data_types);
+  sample.aabb = aabb;
+  sample.origin = origin;
+  sample.coordinates_need_remapping = coordinates_need_remapping;
+
+  if (num_points == 0) {
+    sample.resize(0);
+    return sample;
+  }
+
+  target_num_points = glm::clamp<size_t>(target_num_points, 1, num_points);
+  const size_t sample_stride =
+      glm::max<size_t>(1, num_points / target_num_points);
+
+  std::vector<size_t> sampled_points;
+  sampled_points.reserve(target_num_points * 2);
+
+  const bool has_coordinates = !coordinates_need_remapping && aabb.is_valid();
+
+  if (has_coordinates) {
+    // Taking every n-th point of each cell (at least one per cell) keeps
+    // sparse regions visible.
+    const size_t resolution = glm::clamp<size_t>(
+        size_t(std::cbrt(double(target_num_points)) / 2), 1, 128);
+    const glm::vec3 cell_size =
+        glm::max(aabb.size() / float(resolution), glm::vec3(1.e-20f));
+
+    std::vector<size_t> points_per_cell(resolution * resolution * resolution,
+                                        0);
+
+    size_t point_index = 0;
+    for (const vertex_t& v : *this) {
+      if (point_index % (size_t(1) << 20) == 0 &&
+          !feedback(point_index, num_points)) {
+        sample.resize(0);
+        return sample;
+      }
+
+      const glm::vec3 relative_coordinate =
+          glm::max((v.coordinate - aabb.min_point) / cell_size, glm::vec3(0));
+      const glm::uvec3 cell = glm::min(glm::uvec3(relative_coordinate),
+                                       glm::uvec3(resolution - 1));
+      size_t& counter =
+          points_per_cell[(cell.z * resolution + cell.y) * resolution + cell.x];
+
+      if (counter % sample_stride == 0) sampled_points.push_back(point_index);
+      counter++;
+      point_index++;
+    }
+  } else {
+    for (size_t i = 0; i < num_points; i += sample_stride)
+      sampled_points.push_back(i);
+  }
+
+  sample.resize(sampled_points.size());
+
+  for (size_t i = 0; i < sampled_points.size(); ++i) {
+    const size_t point_index = sampled_points[i];
+    std::memcpy(sample.coordinate_color.data() + i * stride,
+                coordinate_color.data() + point_index * stride, stride);
+    std::memcpy(sample.user_data.data() + i * user_data_stride,
+                user_data.data() + point_index * user_data_stride,
+                user_data_stride);
+  }
+
+  return sample;
+}
+
+std::vector<PointCloud::point_range_t> PointCloud::point_ranges_in_region(
+    const aabb_t& region, point_range_t range) const {
+  std::vector<point_range_t> ranges;
+
+  for (size_t i = range.begin; i < range.end; ++i) {
+    if (!region.contains(vertex(i).coordinate, 0.f)) continue;
+
+    if (!ranges.empty() && ranges.back().end == i)
+      ranges.back().end = i + 1;
+    else
+      ranges.push_back(point_range_t{i, i + 1});
+  }
+
+  return ranges;
+}
+
+PointCloud PointCloud::subset(const std::vector<point_range_t>& ranges) const {
+  PointCloud result;
+  result.set_user_data_format(user_data_stride, user_data_names,
+                              user_data_offset, user_data_types);
+  result.shader = shader;
+  result.origin = origin;
+  result.coordinates_need_remapping = coordinates_need_remapping;
+  result.remap_cache.set_memory_budget(remap_cache.memory_budget());
+
+  size_t result_num_points = 0;
+  for (const point_range_t& range : ranges)
+    result_num_points += range.end - range.begin;
+  result.resize(result_num_points);
+
+  // Copies the elements of the ranges from a tightly packed array
+  auto gather = [&ranges](uint8_t* target, size_t target_stride,
+                          const uint8_t* source, size_t element_size) {
+    for (const point_range_t& range : ranges) {
+      for (size_t i = range.begin; i < range.end; ++i) {
+        std::memcpy(target, source + i * element_size, element_size);
+        target += target_stride;
+      }
+    }
+  };
+
+  gather(result.coordinate_color.data(), stride, coordinate_color.data(),
+         stride);
+
+  if (user_data.size() == num_points * user_data_stride)
+    gather(result.user_data.data(), user_data_stride, user_data.data(),
+           user_data_stride);
+
+  for (int column = 0; column < user_data_names.length(); ++column)
+    if (is_user_data_column_pending(column))
+      gather(result.user_data.data() + user_data_offset[column],
+             user_data_stride,
+             pending_user_data_columns[size_t(column)].data(),
+             data_type::size_of_type(user_data_types[column]));
+
+  for (const RemapCache::entry_t& entry : remap_cache.entries()) {
+    RemapCache::entry_t result_entry;
+    result_entry.key = entry.key;
+    result_entry.used_properties = entry.used_properties;
+    result_entry.depends_on_all_properties = entry.depends_on_all_properties;
+    result_entry.coordinate_color.resize(result_num_points * stride);
+    gather(result_entry.coordinate_color.data(), stride,
+           entry.coordinate_color.data(), stride);
+    result.remap_cache.append(std::move(result_entry));
+  }
+
+  result.aabb = aabb_t::invalid();
+  for (const vertex_t& v : result)
+    if (!glm::any(glm::isnan(v.coordinate))) result.aabb |= v.coordinate;
+  if (result.aabb.is_nan() || result.aabb.is_inf()) result.aabb = aabb;
+
+  return result;
+}
+
 PointCloud::vertex_t PointCloud::vertex(size_t point_index) const {
   vertex_t vertex = read_value_from_buffer<vertex_t>(coordinate_color.data() +
                                                      point_index * stride);
   return vertex;
 }
 
+double PointCloud::offset_of_property(int property) const {
+  const data_type::base_type_t type = user_data_types[property];
+  if (type != data_type::base_type_t::FLOAT32 &&
+      type != data_type::base_type_t::FLOAT64)
+    return 0.;
+
+  const QString& name = user_data_names[property];
+  const int dimension =
+      name == "x" ? 0 : name == "y" ? 1 : name == "z" ? 2 : -1;
+  return dimension < 0 ? 0. : origin[dimension];
+}
+
 const PointCloud::vertex_t* PointCloud::begin() const {
   return reinterpret_cast<const vertex_t*>(coordinate_color.data());
 }
@@ -81,10 +346,16 @@ const PointCloud::vertex_t* PointCloud::end() const {
 void PointCloud::clear() {
   coordinate_color.clear();
   user_data.clear();
+  pending_user_data_columns.clear();
+  pending_user_data_checksums.clear();
   kdtree_index.clear();
+  remap_cache.clear();
+  clear_dirty_points();
 
   aabb.min_point = glm::vec3(std::numeric_limits<float>::max());
   aabb.max_point = glm::vec3(-std::numeric_limits<float>::max());
+  origin = glm::dvec3(0);
+  coordinates_need_remapping = false;
 
   user_data_stride = 0;
   user_data_names.clear();
@@ -96,11 +367,13 @@ void PointCloud::resize(size_t num_points) {
   this->num_points = num_points;
   this->is_valid = true;
 
+  // The importers write all points, so the new bytes aren't initialized
   coordinate_color.resize(num_points * stride);
   user_data.resize(num_points * user_data_stride);
+  pending_user_data_columns.clear();
+  pending_user_data_checksums.clear();
 
-  coordinate_color.memset(0xffffffff);
-  user_data.memset(0xffffffff);
+  clear_dirty_points();
 }
 
 void PointCloud::set_user_data_format(
@@ -4,6 +4,7 @@
 #include <geometry/aabb.hpp>
 #include <pointcloud/buffer.hpp>
 #include <pointcloud/kdtree_index.hpp>
+#include <pointcloud/remap_cache.hpp>
 
 #include <QSet>
 #include <QString>
@@ -14,6 +15,7 @@
 Stores the whole point cloud consisting out of the
 - coordinate_color -- coordinates and colors
 - user_data -- all property data
+- remap_cache -- coordinate_color of previously applied shaders
 */
 class PointCloud final {
  public:
@@ -30,6 +32,10 @@ class PointCloud final {
     padding<uint8_t> _padding = padding<uint8_t>();
   };
 
+  struct point_range_t {
+    size_t begin, end;
+  };
+
   struct UserData {
     QVector<QString> names;
     QVector<QVariant> values;
@@ -49,16 +55,34 @@ class PointCloud final {
 
   Buffer coordinate_color, user_data;
   KDTreeIndex kdtree_index;
+  RemapCache remap_cache;
   Shader shader;
   aabb_t aabb;
+  // The coordinates (and the coordinate properties x, y and z) are relative
+  // to the origin, so they keep their precision as floats. The exporters add
+  // it back.
+  glm::dvec3 origin = glm::dvec3(0);
   size_t num_points;
   bool is_valid;
+  // Set by the importers, if the file doesn't contain the coordinates (they
+  // are nan then), until the shader is applied to all points
+  bool coordinates_need_remapping = false;
 
   size_t user_data_stride;
   QVector<QString> user_data_names;
   QVector<size_t> user_data_offset;
   QVector<data_type::base_type_t> user_data_types;
 
+  // Property columns not copied into user_data yet (e.g. still mapped from
+  // the file they've been loaded from). Empty for columns already loaded.
+  std::vector<Buffer> pending_user_data_columns;
+  // The checksums (see pcvd_checksum.hpp) of the pending columns, which are
+  // verified when the columns are loaded. Empty, if they aren't known.
+  std::vector<uint64_t> pending_user_data_checksums;
+
+  std::vector<bool> dirty_chunks;
+  size_t num_dirty_chunks = 0;
+
   PointCloud();
   PointCloud(PointCloud&& other);
   PointCloud& operator=(PointCloud&& other);
@@ -69,14 +93,54 @@ class PointCloud final {
   UserData all_values_of_point(size_t point_index) const;
   vertex_t vertex(size_t point_index) const;
 
+  // Added to the stored values of the property to get the absolute values:
+  // the origin for the floating point properties x, y and z, otherwise zero
+  double offset_of_property(int property) const;
+
   const vertex_t* begin() const;
   const vertex_t* end() const;
 
   void clear();
+  // The data of the points is left uninitialized
   void resize(size_t num_points);
 
   void set_label(size_t point_index, int label);
 
+  bool is_user_data_column_pending(int column) const;
+  // Copies pending property columns into user_data. Returns whether any
+  // column was pending. Throws a QString, if the checksum of a column
+  // doesn't match (after loading all other columns and setting the values
+  // of the corrupt one to zero).
+  bool load_user_data_columns(const QSet<QString>& names);
+  bool load_user_data_column(int column);
+  bool load_all_user_data_columns();
+
+  // Points whose user data was changed since the last call of
+  // clear_dirty_points (tracked in chunks of dirty_chunk_size() points)
+  constexpr static size_t dirty_chunk_size() { return 4096; }
+  void mark_dirty(size_t point_index);
+  bool has_dirty_points() const;
+  std::vector<point_range_t> dirty_point_ranges() const;
+  void clear_dirty_points();
+
+  // Roughly target_num_points points, proportionally taken from each cell of
+  // a regular grid over the aabb (falls back to taking every n-th point, if
+  // the points weren't remapped yet). The sample has no shader, so it can be
+  // taken while the shader is being edited. The feedback gets the number of
+  // scanned points and num_points, returning false aborts (the sample is
+  // empty then).
+  PointCloud stratified_sample(
+      size_t target_num_points,
+      std::function<bool(size_t, size_t)> feedback) const;
+
+  // Ranges of the points within the given range having their coordinate
+  // inside the region (including its boundary)
+  std::vector<point_range_t> point_ranges_in_region(const aabb_t& region,
+                                                    point_range_t range) const;
+  // Copy of the points in the given ranges, including their remap cache
+  // entries but without the kd tree. Pending columns are read directly.
+  PointCloud subset(const std::vector<point_range_t>& ranges) const;
+
   void set_user_data_format(size_t user_data_stride,
                             QVector<QString> user_data_names,
                             QVector<size_t> user_data_offset,
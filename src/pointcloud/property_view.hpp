@@ -0,0 +1,49 @@
+#ifndef POINTCLOUD_PROPERTY_VIEW_HPP_
+#define POINTCLOUD_PROPERTY_VIEW_HPP_
+
+#include <pointcloud/pointcloud.hpp>
+
+/*
+Typed view of a property column of the user data.
+
+The type of a column is only known at runtime. Instead of switching on it for
+every single value, visit_property_type resolves it once per column (or block
+of points) and the loop over the view is compiled for the actual type, so it
+can be inlined and vectorized.
+*/
+template <typename T>
+class PropertyView final {
+ public:
+  typedef T value_type;
+
+  PropertyView(const uint8_t* first_value, size_t stride, size_t num_points);
+
+  // The column of the property, also if it's still pending
+  PropertyView(const PointCloud& pointcloud, int property);
+
+  size_t size() const;
+
+  T operator[](size_t point_index) const;
+
+  // The view of the points [first_point, first_point + num_points)
+  PropertyView<T> block(size_t first_point, size_t num_points) const;
+
+ private:
+  const uint8_t* first_value;
+  size_t stride;
+  size_t num_points;
+};
+
+// Calls the function with a default constructed value of the given type
+template <typename function_t>
+void visit_property_type(data_type::base_type_t type,
+                         const function_t& function);
+
+// Calls the function with the PropertyView of the property of the pointcloud
+template <typename function_t>
+void visit_property(const PointCloud& pointcloud, int property,
+                    const function_t& function);
+
+#include <pointcloud/property_view.inl>
+
+#endif  // POINTCLOUD_PROPERTY_VIEW_HPP_
@@ -0,0 +1,79 @@
+#include <pointcloud/property_view.hpp>
+
+template <typename T>
+PropertyView<T>::PropertyView(const uint8_t* first_value, size_t stride,
+                              size_t num_points)
+    : first_value(first_value), stride(stride), num_points(num_points) {}
+
+template <typename T>
+PropertyView<T>::PropertyView(const PointCloud& pointcloud, int property)
+    : num_points(pointcloud.num_points) {
+  Q_ASSERT(pointcloud.user_data_types[property] ==
+           data_type::base_type_of<T>::value());
+
+  if (pointcloud.is_user_data_column_pending(property)) {
+    first_value = pointcloud.pending_user_data_columns[size_t(property)].data();
+    stride = sizeof(T);
+  } else {
+    first_value =
+        pointcloud.user_data.data() + pointcloud.user_data_offset[property];
+    stride = pointcloud.user_data_stride;
+  }
+}
+
+template <typename T>
+size_t PropertyView<T>::size() const {
+  return num_points;
+}
+
+template <typename T>
+T PropertyView<T>::operator[](size_t point_index) const {
+  return read_value_from_buffer<T>(first_value + point_index * stride);
+}
+
+template <typename T>
+PropertyView<T> PropertyView<T>::block(size_t first_point,
+                                       size_t num_points) const {
+  Q_ASSERT(first_point + num_points <= this->num_points);
+  return PropertyView<T>(first_value + first_point * stride, stride,
+                         num_points);
+}
+
+template <typename function_t>
+void visit_property_type(data_type::base_type_t type,
+                         const function_t& function) {
+  switch (type) {
+    case data_type::base_type_t::INT8:
+      function(int8_t());
+      break;
+    case data_type::base_type_t::INT16:
+      function(int16_t());
+      break;
+    case data_type::base_type_t::INT32:
+      function(int32_t());
+      break;
+    case data_type::base_type_t::UINT8:
+      function(uint8_t());
+      break;
+    case data_type::base_type_t::UINT16:
+      function(uint16_t());
+      break;
+    case data_type::base_type_t::UINT32:
+      function(uint32_t());
+      break;
+    case data_type::base_type_t::FLOAT32:
+      function(float32_t());
+      break;
+    case data_type::base_type_t::FLOAT64:
+      function(float64_t());
+      break;
+  }
+}
+
+template <typename function_t>
+void visit_property(const PointCloud& pointcloud, int property,
+                    const function_t& function) {
+  visit_property_type(pointcloud.user_data_types[property], [&](auto value) {
+    function(PropertyView<decltype(value)>(pointcloud, property));
+  });
+}
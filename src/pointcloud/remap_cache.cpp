@@ -0,0 +1,138 @@
+#include <pointcloud/remap_cache.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cstring>
+
+RemapCache::RemapCache() {}
+
+RemapCache::RemapCache(RemapCache&& other) = default;
+
+RemapCache& RemapCache::operator=(RemapCache&& other) = default;
+
+RemapCache::key_t RemapCache::key_for(const QString& shader_code,
+                                      const QStringList& ordered_properties) {
+  // FNV-1a, as the key is stored in files and must be stable across platforms
+  key_t hash = 0xcbf29ce484222325;
+  auto add_byte = [&hash](uint8_t byte) {
+    hash ^= key_t(byte);
+    hash *= 0x100000001b3;
+  };
+  auto add_bytes = [&add_byte](const QByteArray& bytes) {
+    for (char c : bytes) add_byte(uint8_t(c));
+    add_byte(0);  // terminator, so "ab"+"c" differs from "a"+"bc"
+  };
+
+  add_bytes(shader_code.toUtf8());
+  for (const QString& property : ordered_properties)
+    add_bytes(property.toUtf8());
+
+  return hash;
+}
+
+size_t RemapCache::default_memory_budget() {
+  static const size_t memory_budget =
+      glm::max(Buffer::available_memory() / 4, size_t(512) * 1024 * 1024);
+  return memory_budget;
+}
+
+size_t RemapCache::memory_budget() const { return _memory_budget; }
+
+void RemapCache::set_memory_budget(size_t memory_budget) {
+  _memory_budget = memory_budget;
+  shrink_to_budget();
+}
+
+size_t RemapCache::memory_usage() const { return _memory_usage; }
+
+bool RemapCache::restore(key_t key, Buffer* coordinate_color) {
+  for (auto i = _entries.begin(); i != _entries.end(); ++i) {
+    if (i->key != key) continue;
+
+    if (i->coordinate_color.size() != coordinate_color->size()) {
+      _memory_usage -= i->coordinate_color.size();
+      _entries.erase(i);
+      return false;
+    }
+
+    std::memcpy(coordinate_color->data(), i->coordinate_color.data(),
+                coordinate_color->size());
+    _entries.splice(_entries.begin(), _entries, i);
+    return true;
+  }
+
+  return false;
+}
+
+void RemapCache::store(key_t key, const Buffer& coordinate_color,
+                       const QStringList& used_properties) {
+  if (coordinate_color.size() > _memory_budget) return;
+
+  for (auto i = _entries.begin(); i != _entries.end(); ++i) {
+    if (i->key == key) {
+      _memory_usage -= i->coordinate_color.size();
+      _entries.erase(i);
+      break;
+    }
+  }
+
+  entry_t entry;
+  entry.key = key;
+  entry.used_properties = used_properties;
+  entry.depends_on_all_properties = false;
+  entry.coordinate_color.resize(coordinate_color.size());
+  std::memcpy(entry.coordinate_color.data(), coordinate_color.data(),
+              coordinate_color.size());
+
+  _memory_usage += entry.coordinate_color.size();
+  _entries.push_front(std::move(entry));
+
+  shrink_to_budget();
+}
+
+void RemapCache::append(key_t key, Buffer&& coordinate_color) {
+  entry_t entry;
+  entry.key = key;
+  entry.coordinate_color = std::move(coordinate_color);
+  append(std::move(entry));
+}
+
+void RemapCache::append(entry_t&& entry) {
+  if (_memory_usage + entry.coordinate_color.size() > _memory_budget) return;
+
+  for (const entry_t& other : _entries)
+    if (other.key == entry.key) return;
+
+  _memory_usage += entry.coordinate_color.size();
+  _entries.push_back(std::move(entry));
+}
+
+void RemapCache::invalidate_property(const QString& property) {
+  for (auto i = _entries.begin(); i != _entries.end();) {
+    if (i->depends_on_all_properties ||
+        i->used_properties.contains(property)) {
+      _memory_usage -= i->coordinate_color.size();
+      i = _entries.erase(i);
+    } else {
+      ++i;
+    }
+  }
+}
+
+void RemapCache::clear() {
+  _entries.clear();
+  _memory_usage = 0;
+}
+
+bool RemapCache::is_empty() const { return _entries.empty(); }
+
+const std::list<RemapCache::entry_t>& RemapCache::entries() const {
+  return _entries;
+}
+
+void RemapCache::shrink_to_budget() {
+  while (!_entries.empty() && _memory_usage > _memory_budget) {
+    _memory_usage -= _entries.back().coordinate_color.size();
+    _entries.pop_back();
+  }
+}
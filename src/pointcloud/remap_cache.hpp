@@ -0,0 +1,72 @@
+#ifndef POINTCLOUD_REMAP_CACHE_HPP_
+#define POINTCLOUD_REMAP_CACHE_HPP_
+
+#include <pointcloud/buffer.hpp>
+
+#include <QString>
+#include <QStringList>
+
+#include <list>
+
+/**
+Least recently used cache of remapped point data (the content of
+PointCloud::coordinate_color).
+
+The entries are identified by a hash of the generated shader code and of the
+used properties, so switching back to a previously applied shader doesn't need
+to remap all points again.
+*/
+class RemapCache final {
+ public:
+  typedef uint64_t key_t;
+
+  struct entry_t {
+    key_t key;
+    Buffer coordinate_color;
+    // The properties the points were remapped from. Entries loaded from
+    // files don't know them, so they depend on all properties.
+    QStringList used_properties;
+    bool depends_on_all_properties = true;
+  };
+
+  // A quarter of the physical memory available at the first call (at least
+  // 512 MiB), so even an entry of a large pointcloud fits
+  static size_t default_memory_budget();
+
+  RemapCache();
+  RemapCache(RemapCache&& other);
+  RemapCache& operator=(RemapCache&& other);
+
+  static key_t key_for(const QString& shader_code,
+                       const QStringList& ordered_properties);
+
+  size_t memory_budget() const;
+  void set_memory_budget(size_t memory_budget);
+  size_t memory_usage() const;
+
+  // Copies the cached data into coordinate_color. Returns false, if not cached
+  bool restore(key_t key, Buffer* coordinate_color);
+  void store(key_t key, const Buffer& coordinate_color,
+             const QStringList& used_properties);
+
+  // Adds an entry as least recently used one (used while loading)
+  void append(key_t key, Buffer&& coordinate_color);
+  void append(entry_t&& entry);
+
+  // Drops the entries depending on the property (e.g. after editing it)
+  void invalidate_property(const QString& property);
+  void clear();
+  bool is_empty() const;
+
+  // most recently used first
+  const std::list<entry_t>& entries() const;
+
+ private:
+  std::list<entry_t> _entries;
+  size_t _memory_budget = default_memory_budget();
+  size_t _memory_usage = 0;
+
+  void shrink_to_budget();
+};
+
+#endif  // POINTCLOUD_REMAP_CACHE_HPP_
@@ -1,6 +1,7 @@
 #ifndef POINTCLOUDVIEWER_DECLARATIONS_HPP_
 #define POINTCLOUDVIEWER_DECLARATIONS_HPP_
 
+class Viewport;
 class Visualization;
 
 #endif  // POINTCLOUDVIEWER_DECLARATIONS_HPP_
@@ -41,7 +41,7 @@ MainWindow::MainWindow()
             kdTreeInspector.handle_new_point_cloud(p);
             pointCloudInspector.handle_new_point_cloud(p);
             viewport.navigation.handle_new_point_cloud();
-            if (glm::any(glm::isnan(p->vertex(0).coordinate)))
+            if (p->coordinates_need_remapping)
               this->apply_point_shader(p->shader, true, true);
             loadedShader = p->shader;
           });
@@ -63,7 +63,7 @@ bool MainWindow::apply_point_shader(PointCloud::Shader new_shader,
   this->pointcloud->shader = new_shader;
 
   const bool needs_being_rebuilt_for_the_first_time =
-      glm::any(glm::isnan(this->pointcloud->vertex(0).coordinate));
+      this->pointcloud->coordinates_need_remapping;
   const bool had_some_changes = coordinates_changed || colors_changed;
 
   if (!needs_being_rebuilt_for_the_first_time && !had_some_changes)
@@ -102,7 +102,16 @@ bool MainWindow::apply_point_shader(PointCloud::Shader new_shader,
     this->pointcloud->shader.color_expression =
         autogenerated_shader.color_expression;
 
-  if (!viewport.reapply_point_shader(coordinates_changed)) return false;
+  // the shader might have been replaced by the autogenerated one
+  coordinates_changed = coordinates_changed ||
+                        old_shader.coordinate_expression !=
+                            this->pointcloud->shader.coordinate_expression;
+  colors_changed = colors_changed ||
+                   old_shader.color_expression !=
+                       this->pointcloud->shader.color_expression;
+
+  if (!viewport.reapply_point_shader(coordinates_changed, colors_changed))
+    return false;
 
   // update the selected point
   pointCloudInspector.update();
@@ -6,6 +6,8 @@
 #include <QMainWindow>
 #include <QUrl>
 
+#include <pointcloud/exporter/export_filter.hpp>
+#include <pointcloud/importer/point_selection.hpp>
 #include <pointcloud_viewer/flythrough/flythrough.hpp>
 #include <pointcloud_viewer/kdtree_inspector.hpp>
 #include <pointcloud_viewer/point_shader_editor.hpp>
@@ -51,7 +53,10 @@ class MainWindow : public QMainWindow {
   QDockWidget* initDataInspectionDock();
 
   void importPointcloudLayer();
+  void importPointcloudRegion();
+  void importPointcloudDecimated();
   void exportPointcloud();
+  void exportPointcloudSubset();
   void openAboutDialog();
 
   void exportCameraPath();
@@ -72,8 +77,11 @@ class MainWindow : public QMainWindow {
   QSharedPointer<PointCloud> pointcloud;
   PointCloud::Shader loadedShader;
 
-  void import_pointcloud(QString filepath);
-  void export_pointcloud(QString filepath, QString selectedFilter);
+  void import_pointcloud(QStringList filepaths,
+                         const aabb_t* region_of_interest = nullptr,
+                         const decimation_t& decimation = decimation_t());
+  void export_pointcloud(QString filepath, QString selectedFilter,
+                         const export_filter_t& filter = export_filter_t());
 };
 
 #endif  // POINTCLOUDVIEWER_MAINWINDOW_HPP_
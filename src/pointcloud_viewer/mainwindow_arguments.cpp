@@ -1,3 +1,4 @@
+#include <core_library/thread_pool.hpp>
 #include <pointcloud_viewer/mainwindow.hpp>
 #include <pointcloud_viewer/workers/import_pointcloud.hpp>
 
@@ -13,6 +14,10 @@ void MainWindow::handleApplicationArguments() {
     this->noninteractive = true;
   };
 
+  aabb_t region_of_interest;
+  bool use_region_of_interest = false;
+  decimation_t decimation;
+
   for (int argument_index = 1; argument_index < arguments.length();
        ++argument_index) {
     const QString argument = arguments[argument_index];
@@ -28,7 +33,9 @@ void MainWindow::handleApplicationArguments() {
 
       const QString path = arguments[argument_index];
 
-      QSharedPointer<PointCloud> point_cloud = import_point_cloud(this, path);
+      QSharedPointer<PointCloud> point_cloud = import_point_clouds(
+          this, files_to_import(path),
+          use_region_of_interest ? &region_of_interest : nullptr, decimation);
 
       if (Q_UNLIKELY(!point_cloud->is_valid)) {
         abort();
@@ -36,6 +43,66 @@ void MainWindow::handleApplicationArguments() {
       }
 
       pointcloud_imported(point_cloud);
+    } else if (argument == "--roi") {
+      if (argument_index + 1 == arguments.length()) {
+        qDebug() << "Missing argument after \"--roi\"";
+        std::exit(-1);
+      }
+      argument_index++;
+
+      const QString parameter = arguments[argument_index];
+
+      if (!parse_region_of_interest(parameter, &region_of_interest)) {
+        qDebug() << "Invalid value" << parameter << "after \"--roi\"";
+        std::exit(-1);
+      }
+      use_region_of_interest = true;
+    } else if (argument == "--decimate") {
+      if (argument_index + 1 == arguments.length()) {
+        qDebug() << "Missing argument after \"--decimate\"";
+        std::exit(-1);
+      }
+      argument_index++;
+
+      const QString parameter = arguments[argument_index];
+
+      if (!decimation_t::parse(parameter, &decimation)) {
+        qDebug() << "Invalid value" << parameter << "after \"--decimate\"";
+        std::exit(-1);
+      }
+    } else if (argument == "--huge-pages") {
+      if (argument_index + 1 == arguments.length()) {
+        qDebug() << "Missing argument after \"--huge-pages\"";
+        std::exit(-1);
+      }
+      argument_index++;
+
+      const QString parameter = arguments[argument_index];
+
+      buffer_allocation_t allocation = Buffer::allocation();
+      if (!buffer_allocation_t::parse_huge_pages(parameter,
+                                                 &allocation.huge_pages)) {
+        qDebug() << "Invalid value" << parameter << "after \"--huge-pages\"";
+        std::exit(-1);
+      }
+      Buffer::set_allocation(allocation);
+    } else if (argument == "--threads") {
+      if (argument_index + 1 == arguments.length()) {
+        qDebug() << "Missing argument after \"--threads\"";
+        std::exit(-1);
+      }
+      argument_index++;
+
+      const QString parameter = arguments[argument_index];
+
+      bool ok;
+      const uint num_threads = parameter.toUInt(&ok);
+
+      if (!ok) {
+        qDebug() << "Invalid value" << parameter << "after \"--threads\"";
+        std::exit(-1);
+      }
+      thread_pool::set_num_threads(num_threads);
     } else if (argument == "--camera-path") {
       if (argument_index + 1 == arguments.length()) {
         qDebug() << "Missing argument after \"--path\"";
@@ -89,6 +156,22 @@ void MainWindow::handleApplicationArguments() {
                   "\n"
                   "--data <FILE>        Pointcloud file to load                "
                   "                    \n"
+                  "                     (a directory or a pattern like "
+                  "\"tiles/*.las\" loads and merges\n"
+                  "                     all the files)\n"
+                  "--roi <minx,miny,minz,maxx,maxy,maxz>\n"
+                  "                     Only load the points inside the box "
+                  "(must precede --data)\n"
+                  "--decimate <random:RATIO[:SEED]|nth:N|voxel:SIZE|fit:GB>\n"
+                  "                     Only load a subset of the points "
+                  "(must precede --data)\n"
+                  "--huge-pages <none|transparent|explicit>\n"
+                  "                     Huge pages for large buffers "
+                  "(default: transparent, must\n"
+                  "                     precede --data)\n"
+                  "--threads <N>        Number of worker threads (default: "
+                  "0, one per core, must\n"
+                  "                     precede --data)\n"
                   "--camera-path <FILE> The path of the camera                 "
                   "                    \n"
                   "\n"
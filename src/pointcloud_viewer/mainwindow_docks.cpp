@@ -246,6 +246,24 @@ QDockWidget* MainWindow::initDataInspectionDock() {
     z->setTextFormat(Qt::PlainText);
     z->setTextInteractionFlags(Qt::TextSelectableByMouse);
 
+    // The coordinates are shown relative to the origin of the file
+    QLabel* origin = new QLabel;
+    origin->setTextFormat(Qt::PlainText);
+    origin->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    origin->setVisible(false);
+    vbox->addWidget(origin);
+    connect(this, &MainWindow::pointcloud_imported,
+            [origin](QSharedPointer<PointCloud> pointcloud) {
+              const glm::dvec3 o = pointcloud->origin;
+              origin->setText(QString("origin: %0 %1 %2")
+                                  .arg(o.x, 0, 'g', 12)
+                                  .arg(o.y, 0, 'g', 12)
+                                  .arg(o.z, 0, 'g', 12));
+              origin->setVisible(o != glm::dvec3(0));
+            });
+    connect(this, &MainWindow::pointcloud_unloaded,
+            [origin]() { origin->setVisible(false); });
+
     row = new QHBoxLayout;
     vbox->addLayout(row);
     QLabel* labelUserData = new QLabel;
@@ -288,18 +306,23 @@ QDockWidget* MainWindow::initDataInspectionDock() {
 
     QObject::connect(
         &pointCloudInspector, &PointCloudInspector::selected_point,
-        [x, y, z, color, btnCopyNames, btnCopyValues, labelUserData](
+        [this, x, y, z, color, btnCopyNames, btnCopyValues, labelUserData](
             glm::vec3 coordinate, glm::u8vec3 _color,
             PointCloud::UserData userData) {
-          auto format_float = [](float f) -> QString {
+          const glm::dvec3 origin =
+              pointcloud ? pointcloud->origin : glm::dvec3(0);
+          auto format_coordinate = [&origin, &coordinate](int i) -> QString {
             QString s;
-            s.setNum(f);
+            if (origin[i] == 0.)
+              s.setNum(coordinate[i]);
+            else
+              s.setNum(double(coordinate[i]) + origin[i], 'g', 12);
             return s.toHtmlEscaped();
           };
 
-          x->setText(format_float(coordinate.x));
-          y->setText(format_float(coordinate.y));
-          z->setText(format_float(coordinate.z));
+          x->setText(format_coordinate(0));
+          y->setText(format_coordinate(1));
+          z->setText(format_coordinate(2));
 
           const Color pointColor(_color);
           QString colorCode = pointColor.hexcode();
@@ -578,6 +601,22 @@ QDockWidget* MainWindow::initRenderDock() {
                   shaderComboBox->currentIndex(),
                   QVariant::fromValue<PointCloud::Shader>(pointcloud->shader));
           });
+  auto update_spy_statistics = [this]() {
+    pointShaderEditor.update_spy_statistics(
+        [this](const QVector<PointCloud::Shader>& spy_shaders,
+               QVector<QVector<glm::vec3>>* values) {
+          return viewport.evaluate_on_preview_sample(spy_shaders, values);
+        });
+  };
+  connect(&pointShaderEditor, &PointShaderEditor::preview_requested,
+          [this, update_spy_statistics](PointCloud::Shader shader) {
+            viewport.preview_point_shader(shader);
+            update_spy_statistics();
+          });
+  // The first preview is waiting for the sample
+  connect(&viewport, &Viewport::preview_sample_ready, update_spy_statistics);
+  connect(&pointShaderEditor, &PointShaderEditor::preview_canceled, &viewport,
+          &Viewport::stop_preview);
 
   shaderComboBox->addItem("<loaded>");
   shaderComboBox->addItem("<autogenerated>");
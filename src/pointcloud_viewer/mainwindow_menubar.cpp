@@ -9,8 +9,11 @@
 
 #include <QApplication>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QMenuBar>
+#include <QMessageBox>
 #include <QMimeData>
+#include <QSettings>
 
 void MainWindow::initMenuBar() {
   QMenuBar* menuBar = new QMenuBar;
@@ -22,20 +25,39 @@ void MainWindow::initMenuBar() {
   QMenu* menu_project = menuBar->addMenu("&Project");
   QAction* import_pointcloud_layers =
       menu_project->addAction("&Import Pointcloud");
+  QAction* import_pointcloud_region =
+      menu_project->addAction("Import Pointcloud &Region");
+  QAction* import_pointcloud_decimated =
+      menu_project->addAction("Import Pointcloud &Decimated");
   QAction* export_pointcloud = menu_project->addAction("&Save Pointcloud");
+  QAction* export_pointcloud_subset =
+      menu_project->addAction("Save Pointcloud S&ubset");
 
   import_pointcloud_layers->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_I));
   connect(import_pointcloud_layers, &QAction::triggered, this,
           &MainWindow::importPointcloudLayer);
+  connect(import_pointcloud_region, &QAction::triggered, this,
+          &MainWindow::importPointcloudRegion);
+  connect(import_pointcloud_decimated, &QAction::triggered, this,
+          &MainWindow::importPointcloudDecimated);
 
   export_pointcloud->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_S));
   export_pointcloud->setEnabled(false);
   connect(export_pointcloud, &QAction::triggered, this,
           &MainWindow::exportPointcloud);
+  export_pointcloud_subset->setEnabled(false);
+  connect(export_pointcloud_subset, &QAction::triggered, this,
+          &MainWindow::exportPointcloudSubset);
   connect(this, &MainWindow::pointcloud_unloaded,
-          [export_pointcloud]() { export_pointcloud->setEnabled(false); });
+          [export_pointcloud, export_pointcloud_subset]() {
+            export_pointcloud->setEnabled(false);
+            export_pointcloud_subset->setEnabled(false);
+          });
   connect(this, &MainWindow::pointcloud_imported,
-          [export_pointcloud]() { export_pointcloud->setEnabled(true); });
+          [export_pointcloud, export_pointcloud_subset]() {
+            export_pointcloud->setEnabled(true);
+            export_pointcloud_subset->setEnabled(true);
+          });
 
   // ======== Flythrough
   // ===============================================================================================
@@ -194,30 +216,45 @@ void MainWindow::initMenuBar() {
 
 void MainWindow::dropEvent(QDropEvent* ev) {
   QList<QUrl> urls = ev->mimeData()->urls();
+  QStringList files_to_import;
   foreach (QUrl url, urls) {
     const QString file_to_import = url.path();
-    if (file_to_import.isEmpty()) return;
-    import_pointcloud(file_to_import);
-    return;
+    if (!file_to_import.isEmpty()) files_to_import << file_to_import;
   }
+  if (files_to_import.isEmpty()) return;
+  import_pointcloud(files_to_import);
 }
 
 void MainWindow::dragEnterEvent(QDragEnterEvent* ev) { ev->accept(); }
 
 void MainWindow::closeEvent(QCloseEvent*) { QApplication::quit(); }
 
-void MainWindow::import_pointcloud(QString filepath) {
+void MainWindow::import_pointcloud(QStringList filepaths,
+                                   const aabb_t* region_of_interest,
+                                   const decimation_t& decimation) {
   pointcloud_unloaded();
 
-  QSharedPointer<PointCloud> pointcloud = import_point_cloud(this, filepath);
+  QSharedPointer<PointCloud> pointcloud =
+      import_point_clouds(this, filepaths, region_of_interest, decimation,
+                          &viewport);
 
   if (pointcloud && pointcloud->is_valid && pointcloud->num_points > 0)
     pointcloud_imported(pointcloud);
+  else
+    viewport.unload_all_point_clouds();  // removes the partially loaded points
 }
 
-void MainWindow::export_pointcloud(QString filepath, QString selectedFilter) {
-  if (pointcloud && pointcloud->is_valid && pointcloud->num_points > 0)
-    export_point_cloud(this, filepath, *pointcloud, selectedFilter);
+void MainWindow::export_pointcloud(QString filepath, QString selectedFilter,
+                                   const export_filter_t& filter) {
+  if (pointcloud && pointcloud->is_valid && pointcloud->num_points > 0) {
+    // colors evaluated only while rendering are not part of the point data yet
+    if (!viewport.bake_point_colors()) return;
+    // the exporters are reading the whole user data
+    if (!viewport.load_user_data_columns(
+            pointcloud->user_data_names.toList().toSet()))
+      return;
+    export_point_cloud(this, filepath, *pointcloud, selectedFilter, filter);
+  }
 }
 
 void MainWindow::exportCameraPath() {
@@ -247,13 +284,65 @@ void MainWindow::importCameraPath() {
 #include <QVBoxLayout>
 
 void MainWindow::importPointcloudLayer() {
-  QString file_to_import = QFileDialog::getOpenFileName(
-      this, "Select pointcloud to import", ".",
+  QStringList files_to_import = QFileDialog::getOpenFileNames(
+      this, "Select pointclouds to import", ".",
       AbstractPointCloudImporter::allSupportedFiletypes());
 
-  if (file_to_import.isEmpty()) return;
+  if (files_to_import.isEmpty()) return;
+
+  import_pointcloud(files_to_import);
+}
+
+void MainWindow::importPointcloudRegion() {
+  QStringList files_to_import = QFileDialog::getOpenFileNames(
+      this, "Select pointclouds to import", ".",
+      AbstractPointCloudImporter::allSupportedFiletypes());
+
+  if (files_to_import.isEmpty()) return;
 
-  import_pointcloud(file_to_import);
+  QSettings settings;
+  QString text = settings.value("Import/regionOfInterest").toString();
+  aabb_t region_of_interest;
+
+  do {
+    bool ok;
+    text = QInputDialog::getText(
+        this, "Region of Interest",
+        "Only import the points inside the box\n"
+        "minx,miny,minz,maxx,maxy,maxz",
+        QLineEdit::Normal, text, &ok);
+    if (!ok) return;
+  } while (!parse_region_of_interest(text, &region_of_interest));
+
+  settings.setValue("Import/regionOfInterest", text);
+
+  import_pointcloud(files_to_import, &region_of_interest);
+}
+
+void MainWindow::importPointcloudDecimated() {
+  QStringList files_to_import = QFileDialog::getOpenFileNames(
+      this, "Select pointclouds to import", ".",
+      AbstractPointCloudImporter::allSupportedFiletypes());
+
+  if (files_to_import.isEmpty()) return;
+
+  QSettings settings;
+  QString text = settings.value("Import/decimation", "fit:4").toString();
+  decimation_t decimation;
+
+  do {
+    bool ok;
+    text = QInputDialog::getText(
+        this, "Decimation",
+        "Only import a subset of the points\n"
+        "random:<ratio>[:<seed>], nth:<n>, voxel:<size> or fit:<gigabytes>",
+        QLineEdit::Normal, text, &ok);
+    if (!ok) return;
+  } while (!decimation_t::parse(text, &decimation));
+
+  settings.setValue("Import/decimation", text);
+
+  import_pointcloud(files_to_import, nullptr, decimation);
 }
 
 void MainWindow::exportPointcloud() {
@@ -267,6 +356,45 @@ void MainWindow::exportPointcloud() {
   export_pointcloud(file_to_export_to, selectedFilter);
 }
 
+void MainWindow::exportPointcloudSubset() {
+  if (!pointcloud) return;
+
+  QSettings settings;
+  QString text = settings.value("Export/filter").toString();
+  export_filter_t filter;
+
+  // the conditions must refer to existing properties
+  auto is_valid = [this, &filter]() {
+    for (const export_filter_t::condition_t& condition : filter.conditions)
+      if (!pointcloud->user_data_names.contains(condition.property))
+        return false;
+    return true;
+  };
+
+  do {
+    bool ok;
+    text = QInputDialog::getText(
+        this, "Subset",
+        "Only save the points passing all ';' separated parts\n"
+        "box:minx,miny,minz,maxx,maxy,maxz\n"
+        "obox:x,y,z,qw,qx,qy,qz,extentx,extenty,extentz\n"
+        "<property> (==|!=|<|<=|>|>=) <value>",
+        QLineEdit::Normal, text, &ok);
+    if (!ok) return;
+  } while (!export_filter_t::parse(text, &filter) || !is_valid());
+
+  settings.setValue("Export/filter", text);
+
+  QString selectedFilter;
+  QString file_to_export_to = QFileDialog::getSaveFileName(
+      this, "Export as", ".",
+      AbstractPointCloudExporter::allSupportedFiletypes(), &selectedFilter);
+
+  if (file_to_export_to.isEmpty()) return;
+
+  export_pointcloud(file_to_export_to, selectedFilter, filter);
+}
+
 extern const QString pcl_notes;
 extern const QString pcl_license;
 
@@ -52,6 +52,8 @@ PointShaderEditor::PointShaderEditor(MainWindow* mainWindow)
   exportShader_action = shader_menu->addAction("&Export Shader");
   shader_menu->addSeparator();
   QAction* applyShaderEditor_action = shader_menu->addAction("Apply Shader");
+  livePreview_action = shader_menu->addAction("&Live Preview");
+  livePreview_action->setCheckable(true);
   shader_menu->addSeparator();
   QAction* closeShaderEditor_action =
       shader_menu->addAction("Close Shader Editor");
@@ -65,6 +67,20 @@ PointShaderEditor::PointShaderEditor(MainWindow* mainWindow)
 
   QObject::connect(applyShaderEditor_action, &QAction::triggered, this,
                    &PointShaderEditor::applyShader);
+  QObject::connect(livePreview_action, &QAction::toggled, this,
+                   &PointShaderEditor::setLivePreviewEnabled);
+
+  {
+    QSettings settings;
+    livePreview_action->setChecked(
+        settings.value("PointShaderEditor/livePreview", false).toBool());
+  }
+
+  // Remapping the preview sample for every single change would be wasted work
+  previewTimer.setSingleShot(true);
+  previewTimer.setInterval(250);
+  QObject::connect(&previewTimer, &QTimer::timeout, this,
+                   &PointShaderEditor::requestLivePreview);
   QObject::connect(closeShaderEditor_action, &QAction::triggered, this,
                    &PointShaderEditor::closeEditor);
 
@@ -143,6 +159,9 @@ PointShaderEditor::PointShaderEditor(MainWindow* mainWindow)
 }
 
 PointShaderEditor::~PointShaderEditor() {
+  QSettings settings;
+  settings.setValue("PointShaderEditor/livePreview", isLivePreviewEnabled());
+
   delete fallbackFlowScene;
   delete flowScene;
 }
@@ -172,6 +191,9 @@ void PointShaderEditor::load_point_cloud(
 void PointShaderEditor::unload_shader() {
   if (flowScene == nullptr) return;
 
+  previewTimer.stop();
+  preview_canceled();
+
   delete flowScene;
   flowScene = nullptr;
   flowView->setScene(fallbackFlowScene);
@@ -190,6 +212,17 @@ void PointShaderEditor::load_shader(PointCloud::Shader shader) {
   flowScene = new QtNodes::FlowScene(registry);
   flowScene->loadFromMemory(shader.node_data.toUtf8());
   flowView->setScene(flowScene);
+
+  flowScene->iterateOverNodes(
+      [this](QtNodes::Node* node) { watchNode(*node); });
+  connect(flowScene, &QtNodes::FlowScene::nodeCreated, this,
+          &PointShaderEditor::watchNode);
+  connect(flowScene, &QtNodes::FlowScene::nodeDeleted, this,
+          &PointShaderEditor::scheduleLivePreview);
+  connect(flowScene, &QtNodes::FlowScene::connectionCreated, this,
+          &PointShaderEditor::scheduleLivePreview);
+  connect(flowScene, &QtNodes::FlowScene::connectionDeleted, this,
+          &PointShaderEditor::scheduleLivePreview);
 }
 
 void PointShaderEditor::append_shader(PointCloud::Shader shader) {
@@ -286,6 +319,85 @@ bool PointShaderEditor::isPointCloudLoaded() const {
 
 bool PointShaderEditor::isReadOnly() const { return m_isReadOnly; }
 
+bool PointShaderEditor::isLivePreviewEnabled() const {
+  return livePreview_action->isChecked();
+}
+
+void PointShaderEditor::setLivePreviewEnabled(bool livePreviewEnabled) {
+  livePreview_action->setChecked(livePreviewEnabled);
+
+  if (livePreviewEnabled) {
+    scheduleLivePreview();
+  } else {
+    previewTimer.stop();
+    preview_canceled();
+  }
+}
+
+void PointShaderEditor::update_spy_statistics(
+    std::function<bool(const QVector<PointCloud::Shader>&,
+                       QVector<QVector<glm::vec3>>*)>
+        evaluate_on_sample) {
+  if (flowScene == nullptr) return;
+
+  QVector<SpyNode*> spyNodes;
+  QVector<PointCloud::Shader> shaders;
+
+  flowScene->iterateOverNodes([this, &spyNodes, &shaders](QtNodes::Node* node) {
+    SpyNode* spyNode = dynamic_cast<SpyNode*>(node->nodeDataModel());
+    if (spyNode == nullptr) return;
+
+    std::shared_ptr<Value> value = spyNode->value();
+    if (value == nullptr) {
+      spyNode->clear_preview_values();
+      return;
+    }
+
+    // The value is passed through the coordinates, as they keep floats
+    PointCloud::Shader shader;
+    shader.used_properties = find_used_properties(flowScene, node);
+    shader.coordinate_expression = "vec3(" + value->expression + ")";
+    shader.color_expression = "uvec3(0)";
+
+    spyNodes << spyNode;
+    shaders << shader;
+  });
+
+  if (spyNodes.isEmpty()) return;
+
+  QVector<QVector<glm::vec3>> values;
+  const bool evaluated = evaluate_on_sample(shaders, &values);
+
+  for (int i = 0; i < spyNodes.size(); ++i) {
+    if (evaluated)
+      spyNodes[i]->set_preview_values(values[i]);
+    else
+      spyNodes[i]->clear_preview_values();
+  }
+}
+
+void PointShaderEditor::scheduleLivePreview() {
+  if (isLivePreviewEnabled()) previewTimer.start();
+}
+
+void PointShaderEditor::requestLivePreview() {
+  if (!isLivePreviewEnabled() || !isPointCloudLoaded() || isReadOnly() ||
+      flowScene == nullptr)
+    return;
+
+  PointCloud::Shader shader = _pointCloud->shader;
+  shader.node_data = flowScene->saveToMemory();
+  shader = generate_code_from_shader(flowScene, shader);
+
+  preview_requested(shader);
+}
+
+void PointShaderEditor::watchNode(QtNodes::Node& node) {
+  connect(node.nodeDataModel(), &QtNodes::NodeDataModel::dataUpdated, this,
+          &PointShaderEditor::scheduleLivePreview);
+  scheduleLivePreview();
+}
+
 QString PointShaderEditor::shaderName() const { return m_shaderName; }
 
 void PointShaderEditor::setIsReadOnly(bool isReadOnly) {
@@ -398,7 +510,11 @@ void PointShaderEditor::applyShader() {
   shader_applied(coordinates_changed, colors_changed);
 }
 
-void PointShaderEditor::closeEditor() { hide(); }
+void PointShaderEditor::closeEditor() {
+  previewTimer.stop();
+  preview_canceled();
+  hide();
+}
 
 void PointShaderEditor::appendShader() {
   if (!isPointCloudLoaded() || isReadOnly()) {
@@ -565,50 +681,55 @@ PointCloud::Shader generate_code_from_shader(QtNodes::FlowScene* flowScene,
 QSet<QString> find_used_properties(QtNodes::FlowScene* flowScene) {
   QSet<QString> used_properties;
 
-  // Lambda filling used_properties with all property names, which are actually
-  // used
-  auto collectProperties = [&used_properties, flowScene](QtNodes::Node* node) {
-    QHash<QtNodes::Node*, QSet<QtNodes::Node*>> incoming_nodes;
-    for (auto _connection : flowScene->connections()) {
-      std::shared_ptr<QtNodes::Connection> connection = _connection.second;
-      incoming_nodes[connection->getNode(QtNodes::PortType::In)].insert(
-          connection->getNode(QtNodes::PortType::Out));
-    }
+  // Only the properties reachable from the output nodes are actually used
+  flowScene->iterateOverNodes([&used_properties,
+                               flowScene](QtNodes::Node* node) {
+    OutputNode* outputNode = dynamic_cast<OutputNode*>(node->nodeDataModel());
 
-    QSet<QtNodes::Node*> done_nodes;
-    QQueue<QtNodes::Node*> queued_nodes;
+    if (outputNode != nullptr)
+      used_properties += find_used_properties(flowScene, node);
+  });
 
-    queued_nodes.enqueue(node);
+  return used_properties;
+}
 
-    while (queued_nodes.isEmpty() == false) {
-      node = queued_nodes.dequeue();
+// Collects all property names, which are used by the given node
+QSet<QString> find_used_properties(QtNodes::FlowScene* flowScene,
+                                   QtNodes::Node* node) {
+  QSet<QString> used_properties;
 
-      if (done_nodes.contains(node)) continue;
+  QHash<QtNodes::Node*, QSet<QtNodes::Node*>> incoming_nodes;
+  for (auto _connection : flowScene->connections()) {
+    std::shared_ptr<QtNodes::Connection> connection = _connection.second;
+    incoming_nodes[connection->getNode(QtNodes::PortType::In)].insert(
+        connection->getNode(QtNodes::PortType::Out));
+  }
 
-      PropertyNode* property =
-          dynamic_cast<PropertyNode*>(node->nodeDataModel());
-      VectorPropertyNode* vectorProperty =
-          dynamic_cast<VectorPropertyNode*>(node->nodeDataModel());
+  QSet<QtNodes::Node*> done_nodes;
+  QQueue<QtNodes::Node*> queued_nodes;
 
-      if (property != nullptr) used_properties << property->property_name();
-      if (vectorProperty != nullptr)
-        for (QString n : vectorProperty->vector_properties_names())
-          used_properties << n;
+  queued_nodes.enqueue(node);
 
-      for (QtNodes::Node* n : incoming_nodes[node])
-        if (!done_nodes.contains(n) && !queued_nodes.contains(n))
-          queued_nodes.enqueue(n);
-    }
-  };
+  while (queued_nodes.isEmpty() == false) {
+    node = queued_nodes.dequeue();
 
-  // Find the output nodes to
-  // a) collect all actually used attributes with collectProperties
-  // b) generate the actual expression
-  flowScene->iterateOverNodes([collectProperties](QtNodes::Node* node) {
-    OutputNode* outputNode = dynamic_cast<OutputNode*>(node->nodeDataModel());
+    if (done_nodes.contains(node)) continue;
+    done_nodes << node;
 
-    if (outputNode != nullptr) collectProperties(node);
-  });
+    PropertyNode* property =
+        dynamic_cast<PropertyNode*>(node->nodeDataModel());
+    VectorPropertyNode* vectorProperty =
+        dynamic_cast<VectorPropertyNode*>(node->nodeDataModel());
+
+    if (property != nullptr) used_properties << property->property_name();
+    if (vectorProperty != nullptr)
+      for (QString n : vectorProperty->vector_properties_names())
+        used_properties << n;
+
+    for (QtNodes::Node* n : incoming_nodes[node])
+      if (!done_nodes.contains(n) && !queued_nodes.contains(n))
+        queued_nodes.enqueue(n);
+  }
 
   return used_properties;
 }
@@ -7,9 +7,11 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QSharedPointer>
+#include <QTimer>
 #include <QToolButton>
 #include <QWidget>
 
+#include <functional>
 #include <memory>
 
 namespace QtNodes {
@@ -17,6 +19,7 @@ namespace QtNodes {
 struct DataModelRegistry;
 struct FlowScene;
 struct FlowView;
+class Node;
 
 }  // namespace QtNodes
 
@@ -45,12 +48,20 @@ class PointShaderEditor : public QWidget {
 
   bool isPointCloudLoaded() const;
   bool isReadOnly() const;
+  bool isLivePreviewEnabled() const;
+
+  // Evaluates the expressions of all spy nodes on the preview sample at once
+  void update_spy_statistics(
+      std::function<bool(const QVector<PointCloud::Shader>&,
+                         QVector<QVector<glm::vec3>>*)>
+          evaluate_on_sample);
 
   QString shaderName() const;
 
  public slots:
   void setIsReadOnly(bool isReadOnly);
   void setShaderName(QString shaderName);
+  void setLivePreviewEnabled(bool livePreviewEnabled);
 
   void applyShader();
 
@@ -61,6 +72,9 @@ class PointShaderEditor : public QWidget {
 
   void shader_applied(bool coordinates_changed, bool colors_changed);
 
+  void preview_requested(PointCloud::Shader shader);
+  void preview_canceled();
+
   void shaderNameChanged(QString shaderName);
 
  private:
@@ -79,9 +93,13 @@ class PointShaderEditor : public QWidget {
   QAction* importShader_action = nullptr;
   QAction* exportShader_action = nullptr;
 
+  QAction* livePreview_action = nullptr;
+
   QLabel* readonlyNotificationBar;
   QLineEdit* shaderName_Editor;
 
+  QTimer previewTimer;
+
   static std::shared_ptr<QtNodes::DataModelRegistry> qt_nodes_model_registry(
       const PointCloud* pointcloud);
 
@@ -90,6 +108,10 @@ class PointShaderEditor : public QWidget {
   QString m_shaderName;
 
  private slots:
+  void scheduleLivePreview();
+  void requestLivePreview();
+  void watchNode(QtNodes::Node& node);
+
   void closeEditor();
   void appendShader();
   void importShader();
@@ -98,6 +120,8 @@ class PointShaderEditor : public QWidget {
 
 QSet<QString> find_used_properties(const PointCloud* pointcloud);
 QSet<QString> find_used_properties(QtNodes::FlowScene* flowScene);
+QSet<QString> find_used_properties(QtNodes::FlowScene* flowScene,
+                                   QtNodes::Node* node);
 PointCloud::Shader generate_code_from_shader(const PointCloud* pointcloud);
 PointCloud::Shader generate_code_from_shader(QtNodes::FlowScene* flowScene,
                                              PointCloud::Shader shader);
@@ -105,9 +105,7 @@ void PointCloudInspector::annotate_point(glm::ivec2 pixel, int label) {
   KDTreeIndex::point_index_t nearest_point = find_nearest_point(pixel);
 
   if (nearest_point != KDTreeIndex::point_index_t::INVALID) {
-    std::cout << "annotate " << (size_t)nearest_point << std::endl;
-    point_cloud->set_label((size_t)nearest_point, label);
-    viewport.update();
+    viewport.set_point_label((size_t)nearest_point, label);
     setSelectedPoint(nearest_point);
   }
 }
@@ -5,6 +5,7 @@
 SpyNode::SpyNode() {
   _label_expression = new QLabel;
   _label_type = new QLabel;
+  _label_statistics = new QLabel;
 
   QVBoxLayout* vbox = new QVBoxLayout;
   _root = new QWidget();
@@ -12,6 +13,7 @@ SpyNode::SpyNode() {
 
   vbox->addWidget(_label_expression);
   vbox->addWidget(_label_type);
+  vbox->addWidget(_label_statistics);
   vbox->setMargin(0);
 
   QFont font = _label_expression->font();
@@ -20,6 +22,7 @@ SpyNode::SpyNode() {
   _label_expression->setFont(font);
   _label_expression->setAlignment(Qt::AlignHCenter);
   _label_type->setAlignment(Qt::AlignRight);
+  _label_statistics->setVisible(false);
 }
 
 uint SpyNode::nPorts(QtNodes::PortType portType) const {
@@ -43,6 +46,9 @@ void SpyNode::setInData(std::shared_ptr<QtNodes::NodeData> nodeData,
                         QtNodes::PortIndex portIndex) {
   Q_ASSERT(portIndex == 0);
 
+  _value = std::dynamic_pointer_cast<Value>(nodeData);
+  clear_preview_values();
+
   if (nodeData == nullptr) {
     _label_expression->setText(QString());
     _label_type->setText(QString());
@@ -65,3 +71,45 @@ std::shared_ptr<QtNodes::NodeData> SpyNode::outData(
 }
 
 QWidget* SpyNode::embeddedWidget() { return _root; }
+
+std::shared_ptr<Value> SpyNode::value() const { return _value; }
+
+void SpyNode::set_preview_values(const QVector<glm::vec3>& values) {
+  if (values.isEmpty() || _value == nullptr) {
+    clear_preview_values();
+    return;
+  }
+
+  glm::dvec3 min_value(std::numeric_limits<double>::infinity());
+  glm::dvec3 max_value(-std::numeric_limits<double>::infinity());
+  glm::dvec3 sum(0);
+
+  for (const glm::vec3& v : values) {
+    min_value = glm::min(min_value, glm::dvec3(v));
+    max_value = glm::max(max_value, glm::dvec3(v));
+    sum += glm::dvec3(v);
+  }
+
+  const glm::dvec3 mean = sum / double(values.length());
+
+  auto to_string = [this](glm::dvec3 v) -> QString {
+    if (!is_vector(_value->value_type)) return QString::number(v.x);
+    return QString("(%0, %1, %2)")
+        .arg(QString::number(v.x))
+        .arg(QString::number(v.y))
+        .arg(QString::number(v.z));
+  };
+
+  _label_statistics->setText(QString("min: %0\nmax: %1\nmean: %2")
+                                 .arg(to_string(min_value))
+                                 .arg(to_string(max_value))
+                                 .arg(to_string(mean)));
+  _label_statistics->setToolTip(
+      QString("Computed on a sample of %0 points").arg(values.length()));
+  _label_statistics->setVisible(true);
+}
+
+void SpyNode::clear_preview_values() {
+  _label_statistics->clear();
+  _label_statistics->setVisible(false);
+}
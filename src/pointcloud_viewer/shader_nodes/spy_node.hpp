@@ -6,6 +6,7 @@
 #include <nodes/NodeDataModel>
 
 #include <QLabel>
+#include <QVector>
 
 class SpyNode final : public QtNodes::NodeDataModel {
  public:
@@ -24,10 +25,19 @@ class SpyNode final : public QtNodes::NodeDataModel {
 
   QWidget* embeddedWidget() override;
 
+  std::shared_ptr<Value> value() const;
+
+  // Shows min/max/mean of the values computed on the preview sample
+  void set_preview_values(const QVector<glm::vec3>& values);
+  void clear_preview_values();
+
  private:
   QLabel* _label_expression;
   QLabel* _label_type;
+  QLabel* _label_statistics;
   QWidget* _root;
+
+  std::shared_ptr<Value> _value;
 };
 
 #endif  // POINTCLOUDVIEWER_SHADER_NODES_SPY_NODE_HPP_
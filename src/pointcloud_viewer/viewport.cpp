@@ -1,8 +1,12 @@
 #include <core_library/color_palette.hpp>
+#include <core_library/simd_kernels.hpp>
+#include <core_library/thread_pool.hpp>
 #include <pointcloud_viewer/viewport.hpp>
 #include <pointcloud_viewer/visualizations.hpp>
+#include <pointcloud_viewer/workers/remap_points_dialog.hpp>
 
 #include <renderer/gl450/point_remapper.hpp>
+#include <renderer/gl450/point_renderer.hpp>
 #include <renderer/gl450/uniforms.hpp>
 
 #include <QElapsedTimer>
@@ -10,6 +14,62 @@
 #include <QPainter>
 #include <QSettings>
 
+#include <cstring>
+
+namespace {
+
+// Selects the expression evaluated for a copy of the preview sample
+const char* const copy_index_property = "impl_copy_index";
+
+// The sample num_copies times, with the number of the copy as an additional
+// property
+PointCloud copies_of_sample(const PointCloud& sample, int num_copies) {
+  const size_t index_offset = (sample.user_data_stride + 3) / 4 * 4;
+  const size_t stride = index_offset + sizeof(uint32_t);
+
+  PointCloud copies;
+  copies.set_user_data_format(
+      stride, sample.user_data_names + QVector<QString>{copy_index_property},
+      sample.user_data_offset + QVector<size_t>{index_offset},
+      sample.user_data_types +
+          QVector<data_type::base_type_t>{data_type::base_type_t::UINT32});
+  copies.resize(sample.num_points * size_t(num_copies));
+  std::memset(copies.user_data.data(), 0, copies.user_data.size());
+
+  uint8_t* record = copies.user_data.data();
+  for (uint32_t copy = 0; copy < uint32_t(num_copies); ++copy) {
+    for (size_t i = 0; i < sample.num_points; ++i) {
+      std::memcpy(record, sample.user_data.data() + i * sample.user_data_stride,
+                  sample.user_data_stride);
+      std::memcpy(record + index_offset, &copy, sizeof(copy));
+      record += stride;
+    }
+  }
+
+  return copies;
+}
+
+aabb_t bounds_of_points(const PointCloud& point_cloud) {
+  const uint8_t* vertices = point_cloud.coordinate_color.data();
+
+  return parallel_reduce(
+      0, point_cloud.num_points, size_t(1) << 20, aabb_t::invalid(),
+      [vertices](size_t begin, size_t end) {
+        aabb_t aabb = aabb_t::invalid();
+        simd::extend_bounds(vertices + begin * PointCloud::stride,
+                            PointCloud::stride, end - begin, &aabb.min_point,
+                            &aabb.max_point);
+        return aabb;
+      },
+      [](aabb_t a, const aabb_t& b) {
+        a |= b;
+        return a;
+      },
+      priority_t::INTERACTIVE);
+}
+
+}  // namespace
+
 Viewport::Viewport() : navigation(this) {
   QSurfaceFormat format;
 
@@ -30,11 +90,26 @@ Viewport::Viewport() : navigation(this) {
   m_backgroundColor =
       settings.value("Rendering/backgroundColor", m_backgroundColor)
           .value<int>();
+  // The budget scales with the memory, unless it's set explicitly
+  const size_t remap_cache_budget_mib = size_t(
+      settings.value("Rendering/remapCacheMemoryBudgetMiB", qulonglong(0))
+          .value<qulonglong>());
+  if (remap_cache_budget_mib > 0)
+    m_remapCacheBudget = remap_cache_budget_mib * 1024 * 1024;
+
+  preview_sample_timer.setInterval(25);
+  connect(&preview_sample_timer, &QTimer::timeout, this,
+          &Viewport::handle_taken_preview_sample);
 }
 
 Viewport::~Viewport() {
+  background_remapping.reset();
+  drop_preview_sample();
+  applied_remap_program.reset();
+
   delete global_uniform;
   delete point_renderer;
+  delete preview_renderer;
   delete _visualization;
 
   QSettings settings;
@@ -50,57 +125,504 @@ void Viewport::set_camera_frame(const frame_t& frame) {
 }
 
 void Viewport::unload_all_point_clouds() {
+  stop_preview();
+  drop_preview_sample();
+  reset_applied_remap_shader();
+
   point_renderer->clear_buffer();
   _aabb = aabb_t::invalid();
   this->point_cloud.clear();
+  num_partial_points = 0;
+  partial_points_kept = false;
 
   this->update();
 }
 
 void Viewport::load_point_cloud(QSharedPointer<PointCloud> point_cloud) {
+  stop_preview();
+  drop_preview_sample();
+  reset_applied_remap_shader();
+
+  // the points uploaded while importing are reused
+  const bool shows_all_points =
+      partial_points_kept && num_partial_points == point_cloud->num_points;
+
   this->point_cloud = point_cloud;
+  this->point_cloud->remap_cache.set_memory_budget(m_remapCacheBudget);
+  num_partial_points = 0;
+  partial_points_kept = false;
 
   _aabb = point_cloud->aabb;
 
+  if (!shows_all_points) {
+    this->makeCurrent();
+    point_renderer->clear_buffer();
+    point_renderer->load_points(point_cloud->coordinate_color.data(),
+                                point_cloud->num_points);
+    this->doneCurrent();
+  }
+
+  this->update();
+}
+
+void Viewport::load_partial_points(const PointCloud::vertex_t* vertices,
+                                   size_t first_point, size_t num_points,
+                                   size_t total_num_points) {
+  Q_ASSERT(point_cloud == nullptr);
+
+  if (point_renderer == nullptr ||
+      num_partial_points + num_points > total_num_points ||
+      first_point + num_points > total_num_points)
+    return;
+
+  // The blocks are written at their final position, as they are loaded in
+  // any order
   this->makeCurrent();
-  point_renderer->load_points(point_cloud->coordinate_color.data(),
-                              GLsizei(point_cloud->num_points));
+  if (num_partial_points == 0) {
+    stop_preview();
+    _aabb = aabb_t::invalid();
+    partial_points_framed = false;
+    partial_points_kept = false;
+    point_renderer->allocate_points(total_num_points);
+  }
+  point_renderer->update_points(reinterpret_cast<const uint8_t*>(vertices),
+                                first_point, num_points);
   this->doneCurrent();
+  num_partial_points += num_points;
+
+  // points without coordinates are not shown anyway
+  const aabb_t aabb = aabb_t::fromVertices(
+      &vertices[first_point].coordinate, num_points, sizeof(*vertices));
+  if (!aabb.is_nan() && !aabb.is_inf()) {
+    _aabb |= aabb.min_point;
+    _aabb |= aabb.max_point;
+    // the view is framed once, so it's not reset while navigating
+    if (!partial_points_framed) navigation.handle_new_point_cloud();
+    partial_points_framed = true;
+  }
 
   this->update();
 }
 
-bool Viewport::reapply_point_shader(bool coordinates_were_changed) {
-  this->makeCurrent();
+void Viewport::keep_partial_points() { partial_points_kept = true; }
 
-  if (!renderer::gl450::remap_points(point_cloud.data())) {
+bool Viewport::reapply_point_shader(bool coordinates_were_changed,
+                                    bool colors_were_changed) {
+  stop_preview();
+  load_user_data_columns(point_cloud->shader.used_properties);
+
+  const bool points_were_remapped_before =
+      point_cloud->num_points > 0 && !point_cloud->coordinates_need_remapping;
+
+  // Changing only the colors doesn't need to touch the coordinates, so the
+  // color expression is evaluated while rendering instead of remapping all
+  // points.
+  if (!coordinates_were_changed && colors_were_changed &&
+      points_were_remapped_before) {
+    this->makeCurrent();
+    const bool applied_color_shader = apply_color_shader();
     this->doneCurrent();
-    QMessageBox::warning(this, "Shader error",
-                         "Could not apply the point shader.\nPlease take a "
-                         "look at the Standard Output");
-    return false;
+
+    if (applied_color_shader) {
+      this->update();
+      return true;
+    }
   }
 
-  point_renderer->load_points(point_cloud->coordinate_color.data(),
-                              GLsizei(point_cloud->num_points));
+  if (!remap_points()) return false;
 
   if (coordinates_were_changed) {
-    aabb_t aabb = aabb_t::invalid();
+    point_cloud->aabb = bounds_of_points(*point_cloud);
+    point_cloud->kdtree_index.clear();
+  }
+
+  this->update();
 
-    for (const PointCloud::vertex_t& vertex : *point_cloud)
-      aabb |= vertex.coordinate;
+  return true;
+}
 
-    point_cloud->aabb = aabb;
-    point_cloud->kdtree_index.clear();
+bool Viewport::bake_point_colors() {
+  if (point_cloud == nullptr || !point_renderer->has_color_shader())
+    return true;
+
+  const bool success = remap_points();
+
+  this->update();
+
+  return success;
+}
+
+bool Viewport::apply_color_shader() {
+  if (!point_renderer->has_user_data())
+    point_renderer->load_user_data(point_cloud->user_data.data(),
+                                   point_cloud->num_points,
+                                   GLsizei(point_cloud->user_data_stride));
+
+  return point_renderer->set_color_shader(
+      renderer::gl450::color_shader_glsl450(point_cloud.data()));
+}
+
+void Viewport::reset_applied_remap_shader() {
+  applied_remap_shader.reset();
+
+  if (applied_remap_program == nullptr) return;
+  this->makeCurrent();
+  applied_remap_program.reset();
+  this->doneCurrent();
+}
+
+bool Viewport::remap_points() {
+  // The coordinates are replaced
+  drop_preview_sample();
+
+  const renderer::gl450::remap_shader_t remap_shader =
+      renderer::gl450::remap_shader_glsl450(point_cloud.data());
+
+  // The previous points keep being rendered until the remapping has finished
+  Buffer coordinate_color;
+  coordinate_color.resize(point_cloud->coordinate_color.size());
+
+  if (!point_cloud->remap_cache.restore(remap_shader.cache_key,
+                                        &coordinate_color)) {
+    switch (remap_points_in_background(this, this->context(), *point_cloud,
+                                       remap_shader, &coordinate_color)) {
+      case remap_result_t::SUCCEEDED:
+        break;
+      case remap_result_t::ABORTED:
+        return false;
+      case remap_result_t::FAILED:
+        QMessageBox::warning(this, "Shader error",
+                             "Could not apply the point shader.\nPlease take "
+                             "a look at the Standard Output");
+        return false;
+    }
+
+    point_cloud->remap_cache.store(remap_shader.cache_key, coordinate_color,
+                                   remap_shader.used_properties);
+  }
+
+  point_cloud->coordinate_color = std::move(coordinate_color);
+  point_cloud->coordinates_need_remapping = false;
+  point_cloud->clear_dirty_points();
+  applied_remap_shader.reset(
+      new renderer::gl450::remap_shader_t(remap_shader));
+
+  this->makeCurrent();
+  // compiled once for remapping the edited points
+  applied_remap_program =
+      renderer::gl450::compile_remap_shader(*applied_remap_shader);
+  point_renderer->reset_color_shader();
+  point_renderer->load_points(point_cloud->coordinate_color.data(),
+                              point_cloud->num_points);
+  this->doneCurrent();
+
+  return true;
+}
+
+void Viewport::preview_point_shader(PointCloud::Shader shader) {
+  if (point_cloud == nullptr || point_cloud->num_points == 0) return;
+
+  background_remapping.reset();
+  pending_preview_shader.reset();
+  load_user_data_columns(shader.used_properties);
+
+  const renderer::gl450::remap_shader_t remap_shader =
+      renderer::gl450::remap_shader_glsl450(point_cloud.data(), shader);
+
+  Buffer coordinate_color;
+
+  // Remapping all points might be already cached
+  coordinate_color.resize(point_cloud->coordinate_color.size());
+  if (point_cloud->remap_cache.restore(remap_shader.cache_key,
+                                       &coordinate_color)) {
+    this->makeCurrent();
+    preview_renderer->load_points(coordinate_color.data(),
+                                  point_cloud->num_points);
+    this->doneCurrent();
+
+    is_previewing = true;
+    this->update();
+    return;
   }
 
+  if (preview_sample == nullptr) {
+    pending_preview_shader.reset(new PointCloud::Shader(shader));
+    take_preview_sample();
+    return;
+  }
+
+  coordinate_color.resize(preview_sample->coordinate_color.size());
+
+  this->makeCurrent();
+  const bool remapped_sample = renderer::gl450::remap_points(
+      remap_shader, *preview_sample, &coordinate_color,
+      [](size_t, size_t) { return true; });
+  if (remapped_sample)
+    preview_renderer->load_points(coordinate_color.data(),
+                                  preview_sample->num_points);
   this->doneCurrent();
 
+  // Shader errors are printed to the standard output, the previous preview
+  // stays visible
+  if (!remapped_sample) return;
+
+  is_previewing = true;
   this->update();
 
+  background_remapping.reset(
+      new BackgroundRemapping(this->context(), point_cloud, remap_shader));
+  connect(background_remapping.get(), &BackgroundRemapping::finished, this,
+          &Viewport::handle_finished_background_remapping);
+}
+
+bool Viewport::evaluate_on_preview_sample(
+    const QVector<PointCloud::Shader>& shaders,
+    QVector<QVector<glm::vec3>>* values) {
+  values->clear();
+  if (point_cloud == nullptr) return false;
+  if (shaders.isEmpty()) return true;
+
+  QSet<QString> used_properties;
+  for (const PointCloud::Shader& shader : shaders)
+    used_properties += shader.used_properties;
+  load_user_data_columns(used_properties);
+
+  if (preview_sample == nullptr) {
+    take_preview_sample();
+    return false;
+  }
+
+  // A single remapping evaluates all expressions on a copy of the sample per
+  // shader, the number of the copy selects the expression
+  const size_t num_sample_points = preview_sample->num_points;
+  const int num_copies = shaders.size();
+  if (spy_sample == nullptr ||
+      spy_sample->num_points != num_sample_points * size_t(num_copies))
+    spy_sample.reset(
+        new PointCloud(copies_of_sample(*preview_sample, num_copies)));
+
+  PointCloud::Shader shader;
+  shader.used_properties = used_properties;
+  shader.used_properties << copy_index_property;
+  for (int i = 0; i < num_copies; ++i)
+    shader.coordinate_expression +=
+        QString("%1 == %2u ? %3 : ")
+            .arg(QString(copy_index_property), QString::number(i),
+                 shaders[i].coordinate_expression);
+  shader.coordinate_expression += "vec3(0)";
+  shader.color_expression = "uvec3(0)";
+
+  const renderer::gl450::remap_shader_t remap_shader =
+      renderer::gl450::remap_shader_glsl450(spy_sample.get(), shader);
+
+  Buffer coordinate_color;
+  coordinate_color.resize(spy_sample->coordinate_color.size());
+
+  this->makeCurrent();
+  const bool succeeded = renderer::gl450::remap_points(
+      remap_shader, *spy_sample, &coordinate_color,
+      [](size_t, size_t) { return true; });
+  this->doneCurrent();
+
+  if (!succeeded) return false;
+
+  values->resize(num_copies);
+  const uint8_t* vertex = coordinate_color.data();
+  for (QVector<glm::vec3>& copy_values : *values) {
+    copy_values.resize(int(num_sample_points));
+    for (glm::vec3& value : copy_values) {
+      value = read_value_from_buffer<PointCloud::vertex_t>(vertex).coordinate;
+      vertex += PointCloud::stride;
+    }
+  }
+
   return true;
 }
 
+void Viewport::stop_preview() {
+  background_remapping.reset();
+  pending_preview_shader.reset();
+
+  if (!is_previewing) return;
+
+  is_previewing = false;
+
+  this->makeCurrent();
+  preview_renderer->clear_buffer();
+  this->doneCurrent();
+
+  this->update();
+}
+
+void Viewport::handle_finished_background_remapping(
+    BackgroundRemapping* remapping) {
+  if (remapping != background_remapping.get()) return;
+
+  if (remapping->result() == remap_result_t::SUCCEEDED) {
+    point_cloud->remap_cache.store(remapping->remap_shader.cache_key,
+                                   remapping->coordinate_color,
+                                   remapping->remap_shader.used_properties);
+
+    if (is_previewing) {
+      this->makeCurrent();
+      preview_renderer->load_points(remapping->coordinate_color.data(),
+                                    point_cloud->num_points);
+      this->doneCurrent();
+
+      this->update();
+    }
+  }
+
+  // Deleting the sender while it's emitting isn't allowed
+  background_remapping.release()->deleteLater();
+}
+
+// Properties of pcvd files are loaded, when a shader is using them for the
+// first time
+bool Viewport::load_user_data_columns(const QSet<QString>& names) {
+  bool any_column_pending = false;
+  for (const QString& name : names)
+    any_column_pending |= point_cloud->is_user_data_column_pending(
+        point_cloud->user_data_names.indexOf(name));
+  if (!any_column_pending) return true;
+
+  // The background remapping and the sampling are reading the user data
+  // being written and the sample is a copy of the old one
+  background_remapping.reset();
+  drop_preview_sample();
+
+  // The values of corrupt columns are zero
+  bool is_corrupt = false;
+  try {
+    point_cloud->load_user_data_columns(names);
+  } catch (QString message) {
+    QMessageBox::warning(this, "Corrupt property", message);
+    is_corrupt = true;
+  }
+
+  if (point_renderer->has_user_data()) {
+    this->makeCurrent();
+    point_renderer->load_user_data(point_cloud->user_data.data(),
+                                   point_cloud->num_points,
+                                   GLsizei(point_cloud->user_data_stride));
+    this->doneCurrent();
+  }
+
+  return !is_corrupt;
+}
+
+// Remaps only the points changed since the last remapping (e.g. annotated
+// points) and patches them in the already uploaded buffers. Without an
+// applied shader, the shader of the point cloud is compiled for it.
+void Viewport::update_dirty_points() {
+  if (point_cloud == nullptr || !point_cloud->has_dirty_points()) return;
+
+  const std::vector<PointCloud::point_range_t> ranges =
+      point_cloud->dirty_point_ranges();
+  point_cloud->clear_dirty_points();
+
+  this->makeCurrent();
+
+  for (const PointCloud::point_range_t& range : ranges)
+    point_renderer->update_user_data(point_cloud->user_data.data(),
+                                     range.begin, range.end - range.begin);
+
+  if (applied_remap_program == nullptr) {
+    applied_remap_shader.reset(new renderer::gl450::remap_shader_t(
+        renderer::gl450::remap_shader_glsl450(point_cloud.data())));
+    applied_remap_program =
+        renderer::gl450::compile_remap_shader(*applied_remap_shader);
+  }
+
+  // The old coordinates tell whether the points were moved
+  std::vector<glm::vec3> old_coordinates;
+  for (const PointCloud::point_range_t& range : ranges)
+    for (size_t i = range.begin; i < range.end; ++i)
+      old_coordinates.push_back(point_cloud->vertex(i).coordinate);
+
+  const bool remapped =
+      applied_remap_program != nullptr &&
+      renderer::gl450::remap_points(
+          *applied_remap_shader, applied_remap_program.get(), *point_cloud,
+          &point_cloud->coordinate_color, ranges,
+          [](size_t, size_t) { return true; });
+
+  bool coordinates_were_changed = false;
+  if (remapped) {
+    size_t k = 0;
+    for (const PointCloud::point_range_t& range : ranges) {
+      point_renderer->update_points(point_cloud->coordinate_color.data(),
+                                    range.begin, range.end - range.begin);
+
+      for (size_t i = range.begin; i < range.end; ++i)
+        coordinates_were_changed |=
+            point_cloud->vertex(i).coordinate != old_coordinates[k++];
+    }
+  }
+
+  this->doneCurrent();
+
+  // Moved points would be picked at their old place and the bounds may have
+  // shrunk as well
+  if (coordinates_were_changed) {
+    point_cloud->aabb = bounds_of_points(*point_cloud);
+    point_cloud->kdtree_index.clear();
+    _aabb = point_cloud->aabb;
+  }
+}
+
+// The sample is taken by a task, as it scans all points
+void Viewport::take_preview_sample() {
+  if (preview_sample != nullptr || preview_sample_task.future.valid()) return;
+
+  const PointCloud* point_cloud = this->point_cloud.data();
+  preview_sample_task = run_task([point_cloud](
+      progress_counter_t, cancellation_token_t cancellation_token) {
+    return point_cloud->stratified_sample(
+        glm::max<size_t>(point_cloud->num_points / 100, 10000),
+        [&cancellation_token](size_t, size_t) {
+          return !cancellation_token.is_canceled();
+        });
+  });
+  preview_sample_timer.start();
+}
+
+void Viewport::handle_taken_preview_sample() {
+  if (!preview_sample_task.is_finished()) return;
+
+  preview_sample_timer.stop();
+  preview_sample.reset(new PointCloud(preview_sample_task.get()));
+
+  if (pending_preview_shader != nullptr)
+    preview_point_shader(*pending_preview_shader);
+
+  preview_sample_ready();
+}
+
+// A pending preview waits for the next sample
+void Viewport::drop_preview_sample() {
+  preview_sample_timer.stop();
+  preview_sample_task.cancel();
+  if (preview_sample_task.future.valid()) preview_sample_task.future.wait();
+  preview_sample_task = task_t<PointCloud>();
+
+  preview_sample.reset();
+  spy_sample.reset();
+}
+
+void Viewport::set_point_label(size_t point_index, int label) {
+  if (point_cloud == nullptr) return;
+
+  // The background remapping and the sampling are reading the user data
+  // being written and the sample is a copy of the old one
+  background_remapping.reset();
+  drop_preview_sample();
+
+  point_cloud->set_label(point_index, label);
+  update_dirty_points();
+  this->update();
+}
+
 void Viewport::render_points(frame_t camera_frame, float aspect,
                              std::function<void()> additional_rendering) const {
   GL_CALL(glClearColor, m_backgroundColor / 255.f, m_backgroundColor / 255.f,
@@ -120,7 +642,10 @@ void Viewport::render_points(frame_t camera_frame, float aspect,
   global_uniform->write(global_vertex_data);
   global_uniform->bind();
 
-  point_renderer->render_points();
+  if (is_previewing)
+    preview_renderer->render_points();
+  else
+    point_renderer->render_points();
   additional_rendering();
 
   global_uniform->unbind();
@@ -154,6 +679,7 @@ void Viewport::initializeGL() {
   gladLoadGL();
 
   point_renderer = new PointRenderer();
+  preview_renderer = new PointRenderer();
   global_uniform = new GlobalUniform();
   _visualization = new Visualization();
 
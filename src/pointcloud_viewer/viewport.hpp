@@ -1,6 +1,7 @@
 #ifndef POINTCLOUDVIEWER_VIEWPORT_HPP_
 #define POINTCLOUDVIEWER_VIEWPORT_HPP_
 
+#include <core_library/task.hpp>
 #include <pointcloud/pointcloud.hpp>
 #include <pointcloud/pointcloud.hpp>
 #include <pointcloud_viewer/camera.hpp>
@@ -9,9 +10,17 @@
 #include <renderer/gl450/declarations.hpp>
 
 #include <QOpenGLWidget>
+#include <QTimer>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 
+class BackgroundRemapping;
+
+namespace gl {
+class ShaderObject;
+}  // namespace gl
+
 /*
 The viewport is owning the opengl context and delegating the point rendering to
 the renderer.
@@ -36,9 +45,40 @@ class Viewport final : public QOpenGLWidget {
 
   void unload_all_point_clouds();
   void load_point_cloud(QSharedPointer<PointCloud> point_cloud);
+  // Shows the points of a point cloud while it's being imported, until the
+  // next call of load_point_cloud or unload_all_point_clouds. vertices are
+  // all vertices of the point cloud, of which the given range was loaded.
+  void load_partial_points(const PointCloud::vertex_t* vertices,
+                           size_t first_point, size_t num_points,
+                           size_t total_num_points);
+  // Called once all points of the imported point cloud were passed to
+  // load_partial_points, so the next load_point_cloud doesn't upload them
+  // again
+  void keep_partial_points();
 
   // Only MainWindow::apply_point_shader is allowed to call this function
-  bool reapply_point_shader(bool reapply_point_shader);
+  bool reapply_point_shader(bool coordinates_were_changed,
+                            bool colors_were_changed);
+
+  // Writes the colors evaluated while rendering back into the point cloud
+  bool bake_point_colors();
+
+  // Annotates the point (all writes to the user data of the loaded point
+  // cloud must go through the viewport, which stops reading it first)
+  void set_point_label(size_t point_index, int label);
+  // Loads the pending property columns (see PointCloud). Returns false, if a
+  // column is corrupt.
+  bool load_user_data_columns(const QSet<QString>& names);
+
+  // Live preview of a shader being edited. A sample of the points is remapped
+  // and shown immediately, while all points are remapped in the background.
+  // The sample is taken by a task, so the first preview waits for it.
+  void preview_point_shader(PointCloud::Shader shader);
+  // Evaluates the coordinate expressions of the shaders on the preview sample
+  // by remapping it once. Returns false, if there is no sample yet or a
+  // shader doesn't compile.
+  bool evaluate_on_preview_sample(const QVector<PointCloud::Shader>& shaders,
+                                  QVector<QVector<glm::vec3>>* values);
 
   void render_points(frame_t camera_frame, float aspect,
                      std::function<void()> additional_rendering) const;
@@ -49,6 +89,8 @@ class Viewport final : public QOpenGLWidget {
   Visualization& visualization() { return *_visualization; }
 
  public slots:
+  void stop_preview();
+
   void setBackgroundColor(int backgroundColor);
   void setPointSize(int pointSize);
 
@@ -60,6 +102,9 @@ class Viewport final : public QOpenGLWidget {
 
   void openGlContextCreated();
 
+  // The preview sample was taken, so it can be evaluated
+  void preview_sample_ready();
+
  protected:
   void initializeGL() override;
   void resizeGL(int w, int h) override;
@@ -79,15 +124,45 @@ class Viewport final : public QOpenGLWidget {
   typedef renderer::gl450::GlobalUniform GlobalUniform;
 
   PointRenderer* point_renderer = nullptr;
+  PointRenderer* preview_renderer = nullptr;
   GlobalUniform* global_uniform = nullptr;
 
   Visualization* _visualization;
 
   aabb_t _aabb = aabb_t::invalid();
   QSharedPointer<PointCloud> point_cloud;
+  size_t num_partial_points = 0;
+  bool partial_points_framed = false;
+  bool partial_points_kept = false;
   size_t next_handle = 0;
   int m_backgroundColor = 0;
   int m_pointSize = 1;
+  size_t m_remapCacheBudget = RemapCache::default_memory_budget();
+
+  std::unique_ptr<renderer::gl450::remap_shader_t> applied_remap_shader;
+  std::unique_ptr<gl::ShaderObject> applied_remap_program;
+
+  bool is_previewing = false;
+  std::unique_ptr<PointCloud> preview_sample;
+  // The preview sample once per evaluated shader (see
+  // evaluate_on_preview_sample)
+  std::unique_ptr<PointCloud> spy_sample;
+  task_t<PointCloud> preview_sample_task;
+  QTimer preview_sample_timer;
+  // Previewed, once the sample was taken
+  std::unique_ptr<PointCloud::Shader> pending_preview_shader;
+  std::unique_ptr<BackgroundRemapping> background_remapping;
+
+  bool apply_color_shader();
+  bool remap_points();
+  void reset_applied_remap_shader();
+  void update_dirty_points();
+  void take_preview_sample();
+  void handle_taken_preview_sample();
+  // Must be called before changing the point cloud read by the task
+  void drop_preview_sample();
+
+  void handle_finished_background_remapping(BackgroundRemapping* remapping);
 };
 
 #endif  // POINTCLOUDVIEWER_VIEWPORT_HPP_
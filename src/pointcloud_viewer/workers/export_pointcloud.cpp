@@ -3,19 +3,17 @@
 #include <pointcloud/exporter/abstract_exporter.hpp>
 #include <pointcloud_viewer/mainwindow.hpp>
 #include <pointcloud_viewer/workers/export_pointcloud.hpp>
+#include <pointcloud_viewer/workers/task_progress_dialog.hpp>
 
-#include <QAbstractEventDispatcher>
-#include <QCoreApplication>
 #include <QDebug>
 #include <QFileInfo>
 #include <QMessageBox>
-#include <QProgressDialog>
-#include <QThread>
 
 #include <fstream>
 
 bool export_point_cloud(QWidget* parent, QString filepath,
-                        const PointCloud& pointcloud, QString selectedFilter) {
+                        const PointCloud& pointcloud, QString selectedFilter,
+                        const export_filter_t& filter) {
   filepath =
       AbstractPointCloudExporter::addMissingSuffix(filepath, selectedFilter);
 
@@ -31,36 +29,13 @@ bool export_point_cloud(QWidget* parent, QString filepath,
 
   Q_ASSERT(exporter != nullptr);
 
-  QProgressDialog progressDialog(
-      QString("Exporting Pointcloud \n<%1>").arg(file.fileName()), "&Abort", 0,
-      AbstractPointCloudExporter::progress_max(), parent);
-  progressDialog.setWindowModality(Qt::ApplicationModal);
+  exporter->filter = filter;
 
-  progressDialog.show();
-
-  QThread thread;
-  exporter->moveToThread(&thread);
-
-  bool waiting = true;
-
-  QObject::connect(exporter.data(),
-                   &AbstractPointCloudExporter::update_progress,
-                   &progressDialog, &QProgressDialog::setValue);
-  QObject::connect(exporter.data(), &AbstractPointCloudExporter::finished,
-                   &thread, &QThread::quit);
-  QObject::connect(&progressDialog, &QProgressDialog::canceled, exporter.data(),
-                   &AbstractPointCloudExporter::cancel);
-  QObject::connect(&thread, &QThread::started, exporter.data(),
-                   &AbstractPointCloudExporter::export_now);
-  QObject::connect(&thread, &QThread::finished,
-                   [&waiting]() { waiting = false; });
-
-  thread.start();
-
-  while (waiting)
-    QCoreApplication::processEvents(QEventLoop::EventLoopExec |
-                                    QEventLoop::DialogExec |
-                                    QEventLoop::WaitForMoreEvents);
+  task_t<void> task = start_export(exporter);
+  wait_for_task(parent,
+                QString("Exporting Pointcloud \n<%1>").arg(file.fileName()),
+                task);
+  task.get();
 
   switch (exporter->state) {
     case AbstractPointCloudExporter::CANCELED:
@@ -78,11 +53,15 @@ bool export_point_cloud(QWidget* parent, QString filepath,
           QString("Couldn't export to the file <%0>. Probably an io error.")
               .arg(file.fileName()));
       return false;
+    case AbstractPointCloudExporter::NO_POINTS:
+      QMessageBox::warning(parent, "Export Error",
+                           filter.is_enabled()
+                               ? QString("No points match the filter.")
+                               : QString("There are no points to export."));
+      return false;
     case AbstractPointCloudExporter::SUCCEEDED:
       return true;
   }
 
-  progressDialog.hide();
-
   return false;
 }
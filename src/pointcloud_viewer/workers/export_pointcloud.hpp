@@ -2,12 +2,15 @@
 #define POINTCLOUDVIEWER_WORKERS_EXPORTPOINTCLOUD_HPP_
 
 #include <QObject>
+#include <pointcloud/exporter/export_filter.hpp>
 #include <pointcloud/pointcloud.hpp>
 
 /**
-The function responsible for export point clouds.
+The function responsible for export point clouds. Only the points passing the
+filter are exported.
 */
 bool export_point_cloud(QWidget* parent, QString file,
-                        const PointCloud& pointcloud, QString selectedFilter);
+                        const PointCloud& pointcloud, QString selectedFilter,
+                        const export_filter_t& filter = export_filter_t());
 
 #endif  // POINTCLOUDVIEWER_WORKERS_EXPORTPOINTCLOUD_HPP_
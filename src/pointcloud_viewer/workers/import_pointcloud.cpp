@@ -1,32 +1,56 @@
 #include <core_library/print.hpp>
+#include <core_library/thread_pool.hpp>
 #include <core_library/types.hpp>
 #include <pointcloud/importer/abstract_importer.hpp>
+#include <pointcloud/importer/merge_pointclouds.hpp>
 #include <pointcloud_viewer/mainwindow.hpp>
+#include <pointcloud_viewer/viewport.hpp>
 #include <pointcloud_viewer/workers/import_pointcloud.hpp>
+#include <pointcloud_viewer/workers/task_progress_dialog.hpp>
 
-#include <QAbstractEventDispatcher>
-#include <QCoreApplication>
 #include <QDebug>
+#include <QDir>
 #include <QFileInfo>
 #include <QMessageBox>
-#include <QProgressDialog>
-#include <QThread>
 
+#include <cmath>
 #include <fstream>
+#include <vector>
 
 QSharedPointer<PointCloud> failed() {
   return QSharedPointer<PointCloud>(new PointCloud);
 }
 
-QSharedPointer<PointCloud> import_point_cloud(QWidget* parent,
-                                              QString filepath) {
+bool parse_region_of_interest(QString text, aabb_t* region_of_interest) {
+  const QStringList components = text.split(',');
+  if (components.length() != 6) return false;
+
+  float values[6];
+  for (int i = 0; i < 6; ++i) {
+    bool ok;
+    values[i] = components[i].trimmed().toFloat(&ok);
+    if (!ok || std::isnan(values[i])) return false;
+  }
+
+  *region_of_interest = aabb_t::invalid();
+  region_of_interest->min_point = glm::vec3(values[0], values[1], values[2]);
+  region_of_interest->max_point = glm::vec3(values[3], values[4], values[5]);
+
+  return glm::all(glm::lessThanEqual(region_of_interest->min_point,
+                                     region_of_interest->max_point));
+}
+
+// Shows a warning and returns null, if the file can't be imported
+QSharedPointer<AbstractPointCloudImporter> create_importer(
+    QWidget* parent, QString filepath, const aabb_t* region_of_interest,
+    const decimation_t& decimation) {
   QFileInfo file(filepath);
 
   if (!file.exists()) {
     QMessageBox::warning(
         parent, "Not existing file",
         QString("The given file <%0> does not exist!").arg(filepath));
-    return failed();
+    return QSharedPointer<AbstractPointCloudImporter>();
   }
 
   const std::string filepath_std = file.absoluteFilePath().toStdString();
@@ -35,7 +59,7 @@ QSharedPointer<PointCloud> import_point_cloud(QWidget* parent,
     QMessageBox::warning(
         parent, "Can't existing file",
         QString("Could not open the file <%0> for reading.").arg(filepath));
-    return failed();
+    return QSharedPointer<AbstractPointCloudImporter>();
   }
 
   const QString suffix = file.suffix();
@@ -46,42 +70,62 @@ QSharedPointer<PointCloud> import_point_cloud(QWidget* parent,
   if (!importer) {
     QMessageBox::warning(parent, "Unexpected file format",
                          QString("Unexpected file format '%0'.").arg(suffix));
-    return failed();
+    return importer;
   }
 
-  QProgressDialog progressDialog(
-      QString("Importing Pointcloud \n<%1>").arg(file.fileName()), "&Abort", 0,
-      AbstractPointCloudImporter::progress_max(), parent);
-  progressDialog.setWindowModality(Qt::ApplicationModal);
+  if (region_of_interest != nullptr) {
+    importer->use_region_of_interest = true;
+    importer->region_of_interest = *region_of_interest;
+  }
+  importer->decimation = decimation;
 
-  progressDialog.show();
+  return importer;
+}
 
-  QThread thread;
-  importer->moveToThread(&thread);
+QSharedPointer<PointCloud> import_point_cloud(
+    QWidget* parent, QString filepath, const aabb_t* region_of_interest,
+    const decimation_t& decimation, Viewport* viewport) {
+  QFileInfo file(filepath);
 
-  bool waiting = true;
+  QSharedPointer<AbstractPointCloudImporter> importer =
+      create_importer(parent, filepath, region_of_interest, decimation);
+  if (!importer) return failed();
 
-  QObject::connect(importer.data(),
-                   &AbstractPointCloudImporter::update_progress,
-                   &progressDialog, &QProgressDialog::setValue);
-  QObject::connect(importer.data(), &AbstractPointCloudImporter::finished,
-                   &thread, &QThread::quit);
-  QObject::connect(&progressDialog, &QProgressDialog::canceled, importer.data(),
-                   &AbstractPointCloudImporter::cancel);
-  QObject::connect(&thread, &QThread::started, importer.data(),
-                   &AbstractPointCloudImporter::import);
-  QObject::connect(&thread, &QThread::finished,
-                   [&waiting]() { waiting = false; });
+  task_t<void> task = start_import(importer);
 
-  thread.start();
+  // The points loaded so far are shown on every tick
+  auto show_loaded_points = [viewport, &importer]() {
+    if (viewport == nullptr) return;
+    importer->read_new_loaded_points(
+        [viewport](const PointCloud::vertex_t* vertices, size_t first_point,
+                   size_t num_points, size_t total_num_points) {
+          viewport->load_partial_points(vertices, first_point, num_points,
+                                        total_num_points);
+        });
+  };
+  wait_for_task(parent,
+                QString("Importing Pointcloud \n<%1>").arg(file.fileName()),
+                task, show_loaded_points);
+  task.get();
 
-  while (waiting)
-    QCoreApplication::processEvents(QEventLoop::EventLoopExec |
-                                    QEventLoop::DialogExec |
-                                    QEventLoop::WaitForMoreEvents);
+  // If the viewport shows all points already, they aren't uploaded again
+  if (importer->state == AbstractPointCloudImporter::SUCCEEDED) {
+    show_loaded_points();
+    if (viewport != nullptr && importer->published_all_points())
+      viewport->keep_partial_points();
+  }
 
   switch (importer->state) {
     case AbstractPointCloudImporter::CANCELED:
+      if (importer->pointcloud.num_points > 0) {
+        QMessageBox::information(
+            parent, "Importing Cancelled",
+            QString("Importing the pointcloud file was canceled by the user. "
+                    "Keeping the %0 points loaded so far.")
+                .arg(importer->pointcloud.num_points));
+        return QSharedPointer<PointCloud>(
+            new PointCloud(std::move(importer->pointcloud)));
+      }
       QMessageBox::warning(
           parent, "Importing Cancelled",
           QString("Importing the pointcloud file was canceled by the user."));
@@ -106,7 +150,149 @@ QSharedPointer<PointCloud> import_point_cloud(QWidget* parent,
           new PointCloud(std::move(importer->pointcloud)));
   }
 
-  progressDialog.hide();
-
   return failed();
 }
+
+QStringList files_to_import(QString path) {
+  const QFileInfo file(path);
+
+  QStringList name_filters;
+  if (file.isDir()) {
+    for (const QString& suffix :
+         AbstractPointCloudImporter::supportedSuffixes())
+      name_filters << "*." + suffix;
+  } else if (file.fileName().contains(QRegExp("[*?[]"))) {
+    name_filters << file.fileName();
+  } else {
+    return QStringList(path);
+  }
+
+  const QDir directory = file.isDir() ? QDir(path) : file.dir();
+  QStringList files;
+  for (const QString& name :
+       directory.entryList(name_filters, QDir::Files, QDir::Name))
+    files << directory.absoluteFilePath(name);
+  return files;
+}
+
+QSharedPointer<PointCloud> import_point_clouds(
+    QWidget* parent, QStringList filepaths, const aabb_t* region_of_interest,
+    const decimation_t& decimation, Viewport* viewport) {
+  if (filepaths.isEmpty()) {
+    QMessageBox::warning(parent, "No files", "No pointcloud files to import.");
+    return failed();
+  }
+
+  if (filepaths.length() == 1)
+    return import_point_cloud(parent, filepaths.first(), region_of_interest,
+                              decimation, viewport);
+
+  const int num_files = filepaths.length();
+
+  QVector<QSharedPointer<AbstractPointCloudImporter>> importers;
+  QVector<size_t> file_sizes;
+  for (const QString& filepath : filepaths) {
+    importers << create_importer(parent, filepath, region_of_interest,
+                                 decimation);
+    if (!importers.last()) return failed();
+    file_sizes << size_t(QFileInfo(filepath).size());
+  }
+
+  // The files are imported concurrently, as long as the files being imported
+  // fit into half of the available memory (but at least one file is
+  // imported). The finished files keep their memory until they're merged, so
+  // the available memory is measured again before starting more imports.
+  const int max_concurrent_imports = int(thread_pool::num_threads());
+  const size_t fallback_memory_budget = size_t(4) * 1024 * 1024 * 1024;
+
+  std::vector<task_t<void>> tasks(size_t(num_files));
+  int next_file = 0;
+  bool canceled = false;
+
+  // Starts the next imports fitting into the budget and sums up the progress
+  auto poll = [&](int* progress) -> bool {
+    int num_running = 0;
+    size_t running_file_size = 0;
+    for (int i = 0; i < next_file; ++i) {
+      if (tasks[size_t(i)].is_finished()) continue;
+      num_running++;
+      running_file_size += file_sizes[i];
+    }
+
+    size_t memory_budget = fallback_memory_budget;
+    if (next_file < num_files && num_running < max_concurrent_imports) {
+      const size_t available_memory = Buffer::available_memory();
+      if (available_memory > 0) memory_budget = available_memory / 2;
+    }
+
+    while (!canceled && next_file < num_files &&
+           (num_running == 0 ||
+            (num_running < max_concurrent_imports &&
+             running_file_size + file_sizes[next_file] <= memory_budget))) {
+      const int i = next_file++;
+      tasks[size_t(i)] = start_import(importers[i]);
+      num_running++;
+      running_file_size += file_sizes[i];
+    }
+
+    int64_t total_progress = 0;
+    for (int i = 0; i < next_file; ++i)
+      total_progress += tasks[size_t(i)].is_finished()
+                            ? AbstractPointCloudImporter::progress_max()
+                            : tasks[size_t(i)].progress.value();
+    *progress = int(total_progress / num_files);
+
+    return num_running > 0;
+  };
+
+  show_progress_dialog(parent,
+                       QString("Importing %0 Pointclouds").arg(num_files),
+                       poll, [&]() {
+                         canceled = true;
+                         for (int i = 0; i < next_file; ++i)
+                           tasks[size_t(i)].cancel();
+                       });
+
+  for (int i = 0; i < next_file; ++i) tasks[size_t(i)].get();
+
+  // Failed files are reported, the other ones are merged
+  std::vector<PointCloud> pointclouds(size_t(num_files));
+  QStringList failed_files;
+  for (int i = 0; i < next_file; ++i) {
+    AbstractPointCloudImporter& importer = *importers[i];
+    if (importer.state == AbstractPointCloudImporter::SUCCEEDED ||
+        importer.state == AbstractPointCloudImporter::CANCELED)
+      pointclouds[size_t(i)] = std::move(importer.pointcloud);
+    else
+      failed_files << QFileInfo(filepaths[i]).fileName();
+  }
+
+  if (!failed_files.isEmpty())
+    QMessageBox::warning(
+        parent, "Import Error",
+        QString("Couldn't import %0 of the files%1:\n* %2")
+            .arg(failed_files.length())
+            .arg(region_of_interest != nullptr
+                     ? " (or they have no points inside the region)"
+                     : "")
+            .arg(failed_files.join("\n* ")));
+
+  size_t num_points = 0;
+  for (const PointCloud& pointcloud : pointclouds)
+    num_points += pointcloud.num_points;
+  if (num_points == 0) {
+    if (canceled)
+      QMessageBox::warning(
+          parent, "Importing Cancelled",
+          QString("Importing the pointcloud files was canceled by the user."));
+    return failed();
+  }
+
+  try {
+    return QSharedPointer<PointCloud>(
+        new PointCloud(merge_pointclouds(&pointclouds)));
+  } catch (QString message) {
+    QMessageBox::warning(parent, "Import Error", message);
+    return failed();
+  }
+}
@@ -2,11 +2,41 @@
 #define POINTCLOUDVIEWER_WORKERS_IMPORTPOINTCLOUD_HPP_
 
 #include <QObject>
+#include <QStringList>
+#include <pointcloud/importer/point_selection.hpp>
 #include <pointcloud/pointcloud.hpp>
+#include <pointcloud_viewer/declarations.hpp>
 
 /**
 The function responsible for import point clouds.
+
+If region_of_interest is given, only the points inside are imported. The
+points are subsampled according to the decimation. If a viewport is given, it
+shows the points already loaded while importing. The points loaded before
+canceling are kept.
+*/
+QSharedPointer<PointCloud> import_point_cloud(
+    QWidget* parent, QString file,
+    const aabb_t* region_of_interest = nullptr,
+    const decimation_t& decimation = decimation_t(),
+    Viewport* viewport = nullptr);
+
+/**
+Imports several files concurrently (as many at once as fit into the memory)
+and merges them into one pointcloud, see merge_pointclouds. A single file is
+imported by import_point_cloud.
 */
-QSharedPointer<PointCloud> import_point_cloud(QWidget* parent, QString file);
+QSharedPointer<PointCloud> import_point_clouds(
+    QWidget* parent, QStringList files,
+    const aabb_t* region_of_interest = nullptr,
+    const decimation_t& decimation = decimation_t(),
+    Viewport* viewport = nullptr);
+
+// The supported files of a directory or the files matching a wildcard
+// pattern (e.g. "tiles/*.las"), any other path is returned as it is
+QStringList files_to_import(QString path);
+
+// Parses "minx,miny,minz,maxx,maxy,maxz"
+bool parse_region_of_interest(QString text, aabb_t* region_of_interest);
 
 #endif  // POINTCLOUDVIEWER_WORKERS_IMPORTPOINTCLOUD_HPP_
@@ -0,0 +1,120 @@
+#include <core_library/print.hpp>
+#include <pointcloud_viewer/workers/remap_points_dialog.hpp>
+#include <pointcloud_viewer/workers/task_progress_dialog.hpp>
+
+#include <QThread>
+
+namespace {
+
+const int polling_interval_ms = 25;
+
+}  // namespace
+
+RemapContext::RemapContext(QOpenGLContext* share_context) {
+  surface.setFormat(share_context->format());
+  surface.create();
+
+  context.setFormat(share_context->format());
+  context.setShareContext(share_context);
+  _is_valid = surface.isValid() && context.create();
+  if (!_is_valid)
+    println_error("Could not create the OpenGL context for remapping");
+
+  // An object without thread affinity can be pulled into the current thread
+  context.moveToThread(nullptr);
+}
+
+RemapContext::~RemapContext() {
+  context.moveToThread(QThread::currentThread());
+}
+
+bool RemapContext::is_valid() const { return _is_valid; }
+
+bool RemapContext::make_current() {
+  context.moveToThread(QThread::currentThread());
+  if (context.makeCurrent(&surface)) return true;
+
+  context.moveToThread(nullptr);
+  return false;
+}
+
+void RemapContext::done_current() {
+  context.doneCurrent();
+  context.moveToThread(nullptr);
+}
+
+task_t<remap_result_t> start_remapping(
+    RemapContext* context, const PointCloud& pointCloud,
+    const renderer::gl450::remap_shader_t& remap_shader,
+    Buffer* coordinate_color) {
+  Q_ASSERT(coordinate_color->size() == pointCloud.coordinate_color.size());
+
+  return run_task([context, &pointCloud, remap_shader, coordinate_color](
+      progress_counter_t progress, cancellation_token_t cancellation_token) {
+    if (!context->is_valid() || !context->make_current()) {
+      println_error("Could not activate the OpenGL context for remapping");
+      return remap_result_t::FAILED;
+    }
+
+    const bool succeeded = renderer::gl450::remap_points(
+        remap_shader, pointCloud, coordinate_color,
+        [&progress, &cancellation_token](size_t done, size_t total) -> bool {
+          progress.set(int64_t(done), int64_t(total));
+          return !cancellation_token.is_canceled();
+        });
+    context->done_current();
+
+    if (succeeded) return remap_result_t::SUCCEEDED;
+    return cancellation_token.is_canceled() ? remap_result_t::ABORTED
+                                            : remap_result_t::FAILED;
+  });
+}
+
+remap_result_t remap_points_in_background(
+    QWidget* parent, QOpenGLContext* share_context,
+    const PointCloud& pointCloud,
+    const renderer::gl450::remap_shader_t& remap_shader,
+    Buffer* coordinate_color) {
+  RemapContext context(share_context);
+  if (!context.is_valid()) return remap_result_t::FAILED;
+
+  task_t<remap_result_t> task =
+      start_remapping(&context, pointCloud, remap_shader, coordinate_color);
+
+  wait_for_task(parent, QString("Applying the Point Shader"), task);
+  return task.get();
+}
+
+BackgroundRemapping::BackgroundRemapping(
+    QOpenGLContext* share_context, QSharedPointer<PointCloud> pointCloud,
+    const renderer::gl450::remap_shader_t& remap_shader)
+    : pointCloud(pointCloud), remap_shader(remap_shader),
+      context(share_context) {
+  coordinate_color.resize(pointCloud->coordinate_color.size());
+
+  if (context.is_valid())
+    task = start_remapping(&context, *pointCloud, this->remap_shader,
+                           &coordinate_color);
+
+  QObject::connect(&polling_timer, &QTimer::timeout, this,
+                   &BackgroundRemapping::poll_task);
+  polling_timer.start(polling_interval_ms);
+}
+
+BackgroundRemapping::~BackgroundRemapping() {
+  // The remapping stops after the current block
+  task.cancel();
+  if (task.future.valid()) task.future.wait();
+}
+
+remap_result_t BackgroundRemapping::result() const { return _result; }
+
+void BackgroundRemapping::poll_task() {
+  if (task.future.valid()) {
+    if (!task.is_finished()) return;
+    _result = task.get();
+  }
+
+  polling_timer.stop();
+  finished(this);
+}
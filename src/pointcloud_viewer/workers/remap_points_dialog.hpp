@@ -0,0 +1,99 @@
+#ifndef POINTCLOUDVIEWER_WORKERS_REMAP_POINTS_DIALOG_HPP_
+#define POINTCLOUDVIEWER_WORKERS_REMAP_POINTS_DIALOG_HPP_
+
+#include <core_library/task.hpp>
+#include <pointcloud/pointcloud.hpp>
+#include <renderer/gl450/point_remapper.hpp>
+
+#include <QObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QSharedPointer>
+#include <QTimer>
+
+enum class remap_result_t {
+  SUCCEEDED,
+  FAILED,
+  ABORTED,
+};
+
+/**
+Offscreen OpenGL context sharing its objects with share_context.
+
+It must be created and destroyed by the main thread. In between, it belongs to
+no thread, so a task can make it current in its own thread.
+*/
+class RemapContext final {
+ public:
+  explicit RemapContext(QOpenGLContext* share_context);
+  ~RemapContext();
+
+  bool is_valid() const;
+
+  // Called by the thread using the context
+  bool make_current();
+  void done_current();
+
+ private:
+  QOffscreenSurface surface;
+  QOpenGLContext context;
+  bool _is_valid = false;
+};
+
+/**
+Remaps the points into coordinate_color in a task, which reports its progress
+and stops after the current block, once it's canceled.
+
+The context, the point cloud and coordinate_color must outlive the task.
+*/
+task_t<remap_result_t> start_remapping(
+    RemapContext* context, const PointCloud& pointCloud,
+    const renderer::gl450::remap_shader_t& remap_shader,
+    Buffer* coordinate_color);
+
+/**
+Remaps the points into coordinate_color in a task using an offscreen OpenGL
+context sharing its objects with share_context.
+
+The main thread stays responsive (showing the previous points) while a
+progress dialog allows aborting the remapping.
+*/
+remap_result_t remap_points_in_background(
+    QWidget* parent, QOpenGLContext* share_context,
+    const PointCloud& pointCloud,
+    const renderer::gl450::remap_shader_t& remap_shader,
+    Buffer* coordinate_color);
+
+/**
+Remaps the points in a task without blocking the main thread or showing a
+dialog (used by the live preview). Emits finished, once the task is done.
+
+Destroying it cancels the task and waits for it.
+*/
+class BackgroundRemapping final : public QObject {
+  Q_OBJECT
+ public:
+  const QSharedPointer<PointCloud> pointCloud;
+  const renderer::gl450::remap_shader_t remap_shader;
+  Buffer coordinate_color;
+
+  BackgroundRemapping(QOpenGLContext* share_context,
+                      QSharedPointer<PointCloud> pointCloud,
+                      const renderer::gl450::remap_shader_t& remap_shader);
+  ~BackgroundRemapping();
+
+  remap_result_t result() const;
+
+ signals:
+  void finished(BackgroundRemapping* remapping);
+
+ private:
+  RemapContext context;
+  task_t<remap_result_t> task;
+  remap_result_t _result = remap_result_t::FAILED;
+  QTimer polling_timer;
+
+  void poll_task();
+};
+
+#endif  // POINTCLOUDVIEWER_WORKERS_REMAP_POINTS_DIALOG_HPP_
@@ -0,0 +1,55 @@
+#include <pointcloud_viewer/workers/task_progress_dialog.hpp>
+
+#include <QEventLoop>
+#include <QProgressDialog>
+#include <QTimer>
+
+namespace {
+
+const int polling_interval_ms = 25;
+
+}  // namespace
+
+void show_progress_dialog(QWidget* parent, QString label,
+                          const std::function<bool(int*)>& poll,
+                          const std::function<void()>& cancel) {
+  int progress = 0;
+  if (!poll(&progress)) return;
+
+  QProgressDialog progressDialog(label, "&Abort", 0, progress_counter_t::max(),
+                                 parent);
+  progressDialog.setWindowModality(Qt::ApplicationModal);
+  // reaching the maximum must not close the dialog before poll is done
+  progressDialog.setAutoReset(false);
+  progressDialog.setAutoClose(false);
+  progressDialog.setValue(progress);
+  progressDialog.show();
+
+  QEventLoop event_loop;
+  QTimer timer;
+
+  QObject::connect(&timer, &QTimer::timeout, [&]() {
+    if (poll(&progress))
+      progressDialog.setValue(progress);
+    else
+      event_loop.quit();
+  });
+  QObject::connect(&progressDialog, &QProgressDialog::canceled, cancel);
+
+  timer.start(polling_interval_ms);
+  event_loop.exec();
+  timer.stop();
+
+  progressDialog.hide();
+}
+
+void wait_for_task(QWidget* parent, QString label, const task_handle_t& task,
+                   const std::function<void()>& poll) {
+  show_progress_dialog(parent, label,
+                       [&task, &poll](int* progress) {
+                         if (poll) poll();
+                         *progress = task.progress.value();
+                         return !task.is_finished();
+                       },
+                       [&task]() { task.cancel(); });
+}
@@ -0,0 +1,27 @@
+#ifndef POINTCLOUDVIEWER_WORKERS_TASK_PROGRESS_DIALOG_HPP_
+#define POINTCLOUDVIEWER_WORKERS_TASK_PROGRESS_DIALOG_HPP_
+
+#include <core_library/task.hpp>
+
+#include <QString>
+#include <QWidget>
+
+#include <functional>
+
+/*
+Shows a modal progress dialog and calls poll on a timer, until it returns
+false. poll sets the progress (in [0, progress_counter_t::max()]). Aborting
+the dialog calls cancel. The gui keeps running meanwhile, but no worker ever
+touches the event loop.
+*/
+void show_progress_dialog(QWidget* parent, QString label,
+                          const std::function<bool(int* progress)>& poll,
+                          const std::function<void()>& cancel);
+
+// Shows a modal progress dialog until the task has finished, aborting it
+// cancels the task. poll is called on every tick, e.g. to show partial
+// results.
+void wait_for_task(QWidget* parent, QString label, const task_handle_t& task,
+                   const std::function<void()>& poll = std::function<void()>());
+
+#endif  // POINTCLOUDVIEWER_WORKERS_TASK_PROGRESS_DIALOG_HPP_
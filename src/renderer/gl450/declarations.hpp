@@ -15,6 +15,8 @@ class DebugMeshRenderer;
 class GlobalUniform;
 class PointRenderer;
 
+struct remap_shader_t;
+
 }  // namespace gl450
 }  // namespace renderer
 
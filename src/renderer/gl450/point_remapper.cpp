@@ -20,30 +20,88 @@ enum class value_type_t;
 constexpr const uint invalid_binding = std::numeric_limits<uint>::max();
 
 std::tuple<QString, QVector<uint>> shader_code_glsl450(
-    const PointCloud* pointcloud, QSet<QString> used_properties);
-bool remap_points(const std::string& vertex_shader,
-                  const QVector<uint>& bindings, PointCloud* pointCloud);
+    const PointCloud* pointcloud, PointCloud::Shader shader);
+gl::VertexArrayObject::Attribute::Type attribute_type_for_property(
+    data_type::base_type_t property_type);
+QString glsl450_helper_functions();
 
-bool remap_points(PointCloud* pointCloud) {
+remap_shader_t remap_shader_glsl450(const PointCloud* pointCloud) {
+  Q_ASSERT(pointCloud != nullptr);
+
+  PointCloud::Shader shader = generate_code_from_shader(pointCloud);
+  shader.used_properties = find_used_properties(pointCloud);
+
+  return remap_shader_glsl450(pointCloud, shader);
+}
+
+remap_shader_t remap_shader_glsl450(const PointCloud* pointCloud,
+                                    const PointCloud::Shader& shader) {
   Q_ASSERT(pointCloud != nullptr);
 
-  const QSet<QString> used_properties = find_used_properties(pointCloud);
   QString code;
-  QVector<uint> property_vao_bindings;
+  remap_shader_t remap_shader;
+
+  std::tie(code, remap_shader.bindings) =
+      shader_code_glsl450(pointCloud, shader);
+
+  remap_shader.vertex_shader = code.toStdString();
+  remap_shader.used_properties = shader.ordered_properties();
+  remap_shader.cache_key =
+      RemapCache::key_for(code, remap_shader.used_properties);
+
+  return remap_shader;
+}
+
+bool remap_points(PointCloud* pointCloud) {
+  Q_ASSERT(pointCloud != nullptr);
+
+  const remap_shader_t remap_shader = remap_shader_glsl450(pointCloud);
+
+  if (pointCloud->remap_cache.restore(remap_shader.cache_key,
+                                      &pointCloud->coordinate_color))
+    return true;
+
+  if (!remap_points(remap_shader, *pointCloud, &pointCloud->coordinate_color,
+                    [](size_t, size_t) { return true; }))
+    return false;
+
+  pointCloud->remap_cache.store(remap_shader.cache_key,
+                                pointCloud->coordinate_color,
+                                remap_shader.used_properties);
+
+  return true;
+}
+
+bool remap_points(const remap_shader_t& remap_shader,
+                  const PointCloud& pointCloud, Buffer* coordinate_color,
+                  std::function<bool(size_t, size_t)> feedback) {
+  return remap_points(remap_shader, pointCloud, coordinate_color,
+                      {PointCloud::point_range_t{0, pointCloud.num_points}},
+                      feedback);
+}
 
-  std::tie(code, property_vao_bindings) =
-      shader_code_glsl450(pointCloud, used_properties);
+bool remap_points(const remap_shader_t& remap_shader,
+                  const PointCloud& pointCloud, Buffer* coordinate_color,
+                  const std::vector<PointCloud::point_range_t>& ranges,
+                  std::function<bool(size_t, size_t)> feedback) {
+  const std::unique_ptr<gl::ShaderObject> shader_object =
+      compile_remap_shader(remap_shader);
+  if (shader_object == nullptr) return false;
 
-  return remap_points(code.toStdString(), property_vao_bindings, pointCloud);
+  return remap_points(remap_shader, shader_object.get(), pointCloud,
+                      coordinate_color, ranges, feedback);
 }
 
-bool remap_points(const std::string& vertex_shader,
-                  const QVector<uint>& bindings, PointCloud* pointCloud) {
-  gl::ShaderObject shader_object("point_remapper");
-  shader_object.AddShaderFromSource(gl::ShaderObject::ShaderType::VERTEX,
-                                    vertex_shader, "generated vertex shader");
+std::unique_ptr<gl::ShaderObject> compile_remap_shader(
+    const remap_shader_t& remap_shader) {
+  const std::string& vertex_shader = remap_shader.vertex_shader;
 
-  const bool failed = gl::Result::FAILURE == shader_object.CreateProgram();
+  std::unique_ptr<gl::ShaderObject> shader_object(
+      new gl::ShaderObject("point_remapper"));
+  shader_object->AddShaderFromSource(gl::ShaderObject::ShaderType::VERTEX,
+                                     vertex_shader, "generated vertex shader");
+
+  const bool failed = gl::Result::FAILURE == shader_object->CreateProgram();
 
   constexpr const bool always_print_shader = false;
   constexpr const bool with_linenumbers = true;
@@ -63,50 +121,40 @@ bool remap_points(const std::string& vertex_shader,
 
     println_error("=================================================");
 
-    if (failed) return false;
+    if (failed) return nullptr;
   }
 
-  GLsizei num_points = GLsizei(pointCloud->num_points);
+  return shader_object;
+}
+
+bool remap_points(const remap_shader_t& remap_shader,
+                  gl::ShaderObject* shader_object,
+                  const PointCloud& pointCloud, Buffer* coordinate_color,
+                  const std::vector<PointCloud::point_range_t>& ranges,
+                  std::function<bool(size_t, size_t)> feedback) {
+  Q_ASSERT(coordinate_color->size() == pointCloud.coordinate_color.size());
+
+  const QVector<uint>& bindings = remap_shader.bindings;
+
+  size_t num_points = 0;
+  for (const PointCloud::point_range_t& range : ranges) {
+    Q_ASSERT(range.begin <= range.end && range.end <= pointCloud.num_points);
+    num_points += range.end - range.begin;
+  }
+
+  if (num_points == 0) return true;
 
   std::vector<gl::VertexArrayObject::Attribute> attributes;
   attributes.reserve(size_t(bindings.length()));
-  const GLsizei attribute_stride = GLsizei(pointCloud->user_data_stride);
+  const GLsizei attribute_stride = GLsizei(pointCloud.user_data_stride);
   for (int i = 0; i < bindings.length(); ++i) {
-    QString property_name = pointCloud->user_data_names[i];
-    data_type::base_type_t property_type = pointCloud->user_data_types[i];
+    data_type::base_type_t property_type = pointCloud.user_data_types[i];
 
     uint attribute_binding = bindings[i];
 
     if (attribute_binding != invalid_binding) {
       gl::VertexArrayObject::Attribute::Type attribute_type =
-          gl::VertexArrayObject::Attribute::Type::INT8;
-
-      switch (property_type) {
-        case data_type::BASE_TYPE::FLOAT32:
-          attribute_type = gl::VertexArrayObject::Attribute::Type::FLOAT;
-          break;
-        case data_type::BASE_TYPE::FLOAT64:
-          attribute_type = gl::VertexArrayObject::Attribute::Type::DOUBLE;
-          break;
-        case data_type::BASE_TYPE::INT8:
-          attribute_type = gl::VertexArrayObject::Attribute::Type::INT8;
-          break;
-        case data_type::BASE_TYPE::INT16:
-          attribute_type = gl::VertexArrayObject::Attribute::Type::INT16;
-          break;
-        case data_type::BASE_TYPE::INT32:
-          attribute_type = gl::VertexArrayObject::Attribute::Type::INT32;
-          break;
-        case data_type::BASE_TYPE::UINT8:
-          attribute_type = gl::VertexArrayObject::Attribute::Type::UINT8;
-          break;
-        case data_type::BASE_TYPE::UINT16:
-          attribute_type = gl::VertexArrayObject::Attribute::Type::UINT16;
-          break;
-        case data_type::BASE_TYPE::UINT32:
-          attribute_type = gl::VertexArrayObject::Attribute::Type::UINT32;
-          break;
-      }
+          attribute_type_for_property(property_type);
 
       attributes.push_back(gl::VertexArrayObject::Attribute(attribute_type, 1,
                                                             attribute_binding));
@@ -118,7 +166,8 @@ bool remap_points(const std::string& vertex_shader,
 
   gl::VertexArrayObject vertex_array_object(std::move(attributes));
 
-  const GLsizei points_per_block = glm::min(65536, num_points);
+  const GLsizei points_per_block =
+      GLsizei(glm::min<size_t>(65536, num_points));
 
   gl::Buffer input_buffer(points_per_block * attribute_stride,
                           gl::Buffer::UsageFlag(gl::Buffer::MAP_WRITE |
@@ -130,54 +179,63 @@ bool remap_points(const std::string& vertex_shader,
   vertex_array_object.Bind();
   for (int i = 0, binding_index = 0; i < bindings.length(); ++i) {
     if (bindings[i] != invalid_binding) {
-      size_t property_offset = pointCloud->user_data_offset[i];
+      size_t property_offset = pointCloud.user_data_offset[i];
       input_buffer.BindVertexBuffer(
           uint(binding_index++), GLsizeiptr(property_offset), attribute_stride);
     }
   }
 
-  auto remap_block = [&output_buffer, &shader_object, &input_buffer,
-                      &pointCloud, attribute_stride](GLintptr first_index,
-                                                     GLintptr num_vertices) {
+  auto remap_block = [&output_buffer, shader_object, &input_buffer,
+                      &pointCloud, coordinate_color,
+                      attribute_stride](GLintptr first_index,
+                                        GLintptr num_vertices) {
     input_buffer.Set(
-        pointCloud->user_data.data() + first_index * attribute_stride, 0,
+        pointCloud.user_data.data() + first_index * attribute_stride, 0,
         num_vertices * attribute_stride);
 
     glMemoryBarrier(GL_ALL_BARRIER_BITS);
 
     output_buffer.BindShaderStorageBuffer(0, 0, num_vertices * vertex_stride);
 
-    shader_object.Activate();
+    shader_object->Activate();
 
     GL_CALL(glDrawArrays, GL_POINTS, 0, num_vertices);
 
-    shader_object.Deactivate();
+    shader_object->Deactivate();
 
     glMemoryBarrier(GL_ALL_BARRIER_BITS);
 
-    output_buffer.Get(
-        pointCloud->coordinate_color.data() + first_index * vertex_stride, 0,
-        num_vertices * vertex_stride);
+    output_buffer.Get(coordinate_color->data() + first_index * vertex_stride,
+                      0, num_vertices * vertex_stride);
 
     glMemoryBarrier(GL_ALL_BARRIER_BITS);
   };
 
-  for (GLintptr i = 0; i < num_points; i += points_per_block) {
-    remap_block(i, glm::min<GLintptr>(i + points_per_block, num_points) - i);
+  bool aborted = false;
+  size_t num_remapped_points = 0;
+  for (const PointCloud::point_range_t& range : ranges) {
+    for (size_t i = range.begin; i < range.end && !aborted;
+         i += size_t(points_per_block)) {
+      const size_t end =
+          glm::min<size_t>(i + size_t(points_per_block), range.end);
+      remap_block(GLintptr(i), GLintptr(end - i));
+      num_remapped_points += end - i;
+      aborted = !feedback(num_remapped_points, num_points);
+    }
   }
 
   for (int i = 0; i < bindings.length(); ++i) {
     if (bindings[i] != invalid_binding) {
-      glBindVertexBuffer(bindings[i], 0, 0, 0);
+      GL_CALL(glBindVertexBuffer, bindings[i], 0, 0, 0);
     }
   }
   vertex_array_object.ResetBinding();
 
-  return true;
+  return !aborted;
 }
 
 std::tuple<QString, QVector<uint>> shader_code_glsl450(
-    const PointCloud* pointcloud, QSet<QString> used_properties) {
+    const PointCloud* pointcloud, PointCloud::Shader shader) {
   QString code;
   code += "#version 450 core\n";
   code += "\n";
@@ -192,7 +250,7 @@ std::tuple<QString, QVector<uint>> shader_code_glsl450(
   // https://www.khronos.org/opengl/wiki/Shader_Storage_Buffer_Object
   // https://www.khronos.org/files/opengl45-quick-reference-card.pdf
 
-  PointCloud::Shader shader = generate_code_from_shader(pointcloud);
+  const QSet<QString>& used_properties = shader.used_properties;
 
   if (shader.coordinate_expression.isEmpty())
     shader.coordinate_expression = "vec3(0) /* not set */";
@@ -235,12 +293,7 @@ std::tuple<QString, QVector<uint>> shader_code_glsl450(
   code += "};\n";
   code += "\n";
 
-  code += "// ==== Helper Functions ====\n";
-  code += "int    to_scalar(in ivec3 v){return (v.x + v.y + v.z) / 3;}\n";
-  code += "uint   to_scalar(in uvec3 v){return (v.x + v.y + v.z) / 3;}\n";
-  code += "float  to_scalar(in  vec3 v){return (v.x + v.y + v.z) / 3;}\n";
-  code += "double to_scalar(in dvec3 v){return (v.x + v.y + v.z) / 3;}\n";
-  code += "\n";
+  code += glsl450_helper_functions();
   code += "// ==== Actual execution ====\n";
   code += "void main()\n";
   code += "{\n";
@@ -264,5 +317,95 @@ std::tuple<QString, QVector<uint>> shader_code_glsl450(
   return std::make_tuple(code, property_bindings);
 }
 
+PointRenderer::color_shader_t color_shader_glsl450(
+    const PointCloud* pointcloud) {
+  Q_ASSERT(pointcloud != nullptr);
+
+  PointRenderer::color_shader_t color_shader;
+
+  PointCloud::Shader shader = generate_code_from_shader(pointcloud);
+  if (shader.color_expression.isEmpty())
+    shader.color_expression = "uvec3(255) /* not set */";
+
+  const QSet<QString> used_properties = find_used_properties(pointcloud);
+
+  QString code;
+  code += "#define class class_property\n";
+  code += "\n";
+  code += "// ==== Input Buffer ====\n";
+  uint binding_index = PointRenderer::first_property_binding_index();
+  for (int i = 0; i < pointcloud->user_data_names.length(); ++i) {
+    QString name = pointcloud->user_data_names[i];
+
+    if (used_properties.contains(name) == false) continue;
+
+    data_type::base_type_t property_type = pointcloud->user_data_types[i];
+    QString type = property_to_glsl_type(property_type);
+
+    code += "layout(location = " + QString::number(binding_index) + ")\n";
+    code += "in " + type + " " + name + ";\n";
+
+    color_shader.property_attributes.push_back(
+        gl::VertexArrayObject::Attribute(
+            attribute_type_for_property(property_type), 1, binding_index));
+    color_shader.property_offsets.push_back(
+        GLintptr(pointcloud->user_data_offset[i]));
+
+    binding_index++;
+  }
+  code += "\n";
+
+  code += glsl450_helper_functions();
+  code += "// ==== Color Expression ====\n";
+  code += "vec3 render_time_color()\n";
+  code += "{\n";
+  code += "  return vec3(\n";
+  code += "\n";
+  code += "      // ==== COLOR =========\n";
+  code += "      " + shader.color_expression + "\n";
+  code += "      // ====================\n";
+  code += "\n  );\n";
+  code += "}\n";
+
+  color_shader.code = code.toStdString();
+
+  return color_shader;
+}
+
+gl::VertexArrayObject::Attribute::Type attribute_type_for_property(
+    data_type::base_type_t property_type) {
+  switch (property_type) {
+    case data_type::BASE_TYPE::FLOAT32:
+      return gl::VertexArrayObject::Attribute::Type::FLOAT;
+    case data_type::BASE_TYPE::FLOAT64:
+      return gl::VertexArrayObject::Attribute::Type::DOUBLE;
+    case data_type::BASE_TYPE::INT8:
+      return gl::VertexArrayObject::Attribute::Type::INT8;
+    case data_type::BASE_TYPE::INT16:
+      return gl::VertexArrayObject::Attribute::Type::INT16;
+    case data_type::BASE_TYPE::INT32:
+      return gl::VertexArrayObject::Attribute::Type::INT32;
+    case data_type::BASE_TYPE::UINT8:
+      return gl::VertexArrayObject::Attribute::Type::UINT8;
+    case data_type::BASE_TYPE::UINT16:
+      return gl::VertexArrayObject::Attribute::Type::UINT16;
+    case data_type::BASE_TYPE::UINT32:
+      return gl::VertexArrayObject::Attribute::Type::UINT32;
+  }
+
+  return gl::VertexArrayObject::Attribute::Type::INT8;
+}
+
+QString glsl450_helper_functions() {
+  QString code;
+  code += "// ==== Helper Functions ====\n";
+  code += "int    to_scalar(in ivec3 v){return (v.x + v.y + v.z) / 3;}\n";
+  code += "uint   to_scalar(in uvec3 v){return (v.x + v.y + v.z) / 3;}\n";
+  code += "float  to_scalar(in  vec3 v){return (v.x + v.y + v.z) / 3;}\n";
+  code += "double to_scalar(in dvec3 v){return (v.x + v.y + v.z) / 3;}\n";
+  code += "\n";
+  return code;
+}
+
 }  // namespace gl450
 }  // namespace renderer
@@ -3,19 +3,87 @@
 
 #include <pointcloud/pointcloud.hpp>
 #include <renderer/gl450/declarations.hpp>
+#include <renderer/gl450/point_renderer.hpp>
 
 #include <glhelper/buffer.hpp>
 #include <glhelper/shaderobject.hpp>
 #include <glhelper/vertexarrayobject.hpp>
 
+#include <functional>
+#include <memory>
+
 namespace renderer {
 namespace gl450 {
 
+/**
+Everything needed for remapping the points.
+
+Generating it accesses the node editor, so it must be done in the main thread.
+The remapping itself can be executed by any thread with a current OpenGL
+context.
+*/
+struct remap_shader_t {
+  std::string vertex_shader;
+  QVector<uint> bindings;
+  RemapCache::key_t cache_key;
+  QStringList used_properties;
+};
+
+remap_shader_t remap_shader_glsl450(const PointCloud* pointCloud);
+remap_shader_t remap_shader_glsl450(const PointCloud* pointCloud,
+                                    const PointCloud::Shader& shader);
+
 /**
 Remaps the point coordinates and colors osed for rendering
+
+Previously computed results are taken from PointCloud::remap_cache.
 */
 bool remap_points(PointCloud* pointCloud);
 
+/**
+Remaps the points block by block into coordinate_color, which must have the
+same size as pointCloud.coordinate_color.
+
+The feedback gets the number of remapped points and the total number of points
+after each block. Returning false aborts the remapping.
+*/
+bool remap_points(const remap_shader_t& remap_shader,
+                  const PointCloud& pointCloud, Buffer* coordinate_color,
+                  std::function<bool(size_t, size_t)> feedback);
+
+/**
+Like above, but remaps only the points within the given ranges.
+*/
+bool remap_points(const remap_shader_t& remap_shader,
+                  const PointCloud& pointCloud, Buffer* coordinate_color,
+                  const std::vector<PointCloud::point_range_t>& ranges,
+                  std::function<bool(size_t, size_t)> feedback);
+
+/**
+Compiles the remap shader for the current OpenGL context, so it can be used
+for remapping again and again (e.g. the points being edited). Returns null, if
+it doesn't compile (after printing the code).
+*/
+std::unique_ptr<gl::ShaderObject> compile_remap_shader(
+    const remap_shader_t& remap_shader);
+
+/**
+Like above, but with the shader compiled by compile_remap_shader for the
+current OpenGL context
+*/
+bool remap_points(const remap_shader_t& remap_shader,
+                  gl::ShaderObject* shader_object,
+                  const PointCloud& pointCloud, Buffer* coordinate_color,
+                  const std::vector<PointCloud::point_range_t>& ranges,
+                  std::function<bool(size_t, size_t)> feedback);
+
+/**
+Generates the code for evaluating only the color expression of the point
+shader while rendering. See PointRenderer::color_shader_t
+*/
+PointRenderer::color_shader_t color_shader_glsl450(
+    const PointCloud* pointcloud);
+
 }  // namespace gl450
 }  // namespace renderer
 
@@ -7,6 +7,8 @@
 #include <glm/gtc/constants.hpp>
 #include <glm/gtx/io.hpp>
 
+#include <limits>
+
 namespace renderer {
 namespace gl450 {
 
@@ -17,6 +19,59 @@ const GLsizeiptr STRIDE = 4 * 4;
 
 const int POSITION_BINDING_INDEX = 0;
 const int COLOR_BINDING_INDEX = 1;
+const int FIRST_PROPERTY_BINDING_INDEX = 2;
+
+// 512 MiB of vertices per segment
+const size_t POINTS_PER_SEGMENT = size_t(1) << 25;
+
+// Calls visit(segment, first_point_in_segment, first_point, num_points) for
+// the part of [first_point, first_point + num_points) within each segment
+template <typename visitor_t>
+void visit_segments(size_t first_point, size_t num_points, visitor_t visit) {
+  while (num_points > 0) {
+    const size_t segment = first_point / POINTS_PER_SEGMENT;
+    const size_t first_point_in_segment = first_point % POINTS_PER_SEGMENT;
+    const size_t n =
+        glm::min(num_points, POINTS_PER_SEGMENT - first_point_in_segment);
+
+    visit(segment, first_point_in_segment, first_point, n);
+
+    first_point += n;
+    num_points -= n;
+  }
+}
+
+// Without data, the buffers are left uninitialized. SUB_DATA_UPDATE allows
+// patching edited points with update_points.
+std::vector<gl::Buffer> create_segment_buffers(const uint8_t* data,
+                                               size_t num_points,
+                                               GLsizeiptr stride) {
+  std::vector<gl::Buffer> buffers;
+  buffers.reserve((num_points + POINTS_PER_SEGMENT - 1) / POINTS_PER_SEGMENT);
+
+  visit_segments(0, num_points, [&](size_t, size_t, size_t first_point,
+                                    size_t n) {
+    buffers.emplace_back(
+        GLsizeiptr(n) * stride, gl::Buffer::UsageFlag::SUB_DATA_UPDATE,
+        data == nullptr ? nullptr : data + GLsizeiptr(first_point) * stride);
+  });
+
+  return buffers;
+}
+
+// data points to the data of first_point
+void set_segment_data(std::vector<gl::Buffer>* buffers, const uint8_t* data,
+                      size_t first_point, size_t num_points,
+                      GLsizeiptr stride) {
+  visit_segments(first_point, num_points,
+                 [&](size_t segment, size_t first_point_in_segment, size_t,
+                     size_t n) {
+                   (*buffers)[segment].Set(
+                       data, GLsizeiptr(first_point_in_segment) * stride,
+                       GLsizeiptr(n) * stride);
+                   data += GLsizeiptr(n) * stride;
+                 });
+}
 
 PointRenderer::PointRenderer()
     : shader_object("point_renderer"),
@@ -42,39 +97,90 @@ PointRenderer::~PointRenderer() {}
 
 PointRenderer::PointRenderer(PointRenderer&& point_renderer)
     : shader_object(std::move(point_renderer.shader_object)),
-      vertex_position_buffer(std::move(point_renderer.vertex_position_buffer)),
-      vertex_array_object(std::move(point_renderer.vertex_array_object)) {}
+      vertex_position_buffers(
+          std::move(point_renderer.vertex_position_buffers)),
+      vertex_array_object(std::move(point_renderer.vertex_array_object)),
+      num_vertices(point_renderer.num_vertices),
+      user_data_buffers(std::move(point_renderer.user_data_buffers)),
+      user_data_stride(point_renderer.user_data_stride),
+      color_shader_object(std::move(point_renderer.color_shader_object)),
+      color_vertex_array_object(
+          std::move(point_renderer.color_vertex_array_object)),
+      color_property_offsets(
+          std::move(point_renderer.color_property_offsets)) {}
 
 PointRenderer& PointRenderer::operator=(PointRenderer&& point_renderer) {
   shader_object = std::move(point_renderer.shader_object);
-  vertex_position_buffer = std::move(point_renderer.vertex_position_buffer);
+  vertex_position_buffers = std::move(point_renderer.vertex_position_buffers);
   vertex_array_object = std::move(point_renderer.vertex_array_object);
+  num_vertices = point_renderer.num_vertices;
+  user_data_buffers = std::move(point_renderer.user_data_buffers);
+  user_data_stride = point_renderer.user_data_stride;
+  color_shader_object = std::move(point_renderer.color_shader_object);
+  color_vertex_array_object =
+      std::move(point_renderer.color_vertex_array_object);
+  color_property_offsets = std::move(point_renderer.color_property_offsets);
   return *this;
 }
 
+uint PointRenderer::first_property_binding_index() {
+  return FIRST_PROPERTY_BINDING_INDEX;
+}
+
+size_t PointRenderer::points_per_segment() { return POINTS_PER_SEGMENT; }
+
 void PointRenderer::clear_buffer() {
-  gl::Buffer buffer;
-  this->vertex_position_buffer = std::move(buffer);
+  this->vertex_position_buffers.clear();
   this->num_vertices = 0;
-}
 
-void PointRenderer::load_points(const uint8_t* point_data, GLsizei num_points) {
-  clear_buffer();
+  this->user_data_buffers.clear();
+  this->user_data_stride = 0;
+
+  reset_color_shader();
+}
 
-  gl::Buffer buffer(GLsizeiptr(num_points) * STRIDE,
-                    gl::Buffer::UsageFlag::IMMUTABLE, point_data);
+void PointRenderer::load_points(const uint8_t* point_data, size_t num_points) {
+  // free the old memory before allocating the new one
+  this->vertex_position_buffers.clear();
+  this->num_vertices = 0;
 
-  this->vertex_position_buffer = std::move(buffer);
+  this->vertex_position_buffers =
+      create_segment_buffers(point_data, num_points, STRIDE);
   this->num_vertices = num_points;
 
 #if 0
   const vertex_t* vertices = reinterpret_cast<const vertex_t*>(point_data);
-  for(GLsizei i=0; i<glm::min(num_points, 10); ++i)
+  for(size_t i=0; i<glm::min<size_t>(num_points, 10); ++i)
     print(vertices[i].coordinate, " ", vertices[i].color);
 #endif
 }
 
+void PointRenderer::allocate_points(size_t num_points) {
+  clear_buffer();
+
+  this->vertex_position_buffers =
+      create_segment_buffers(nullptr, num_points, STRIDE);
+  this->num_vertices = num_points;
+
+  // points with nan coordinates aren't rasterized
+  const float32_t nan = std::numeric_limits<float32_t>::quiet_NaN();
+  for (gl::Buffer& buffer : vertex_position_buffers)
+    GL_CALL(glClearNamedBufferData, buffer.GetInternHandle(), GL_R32F, GL_RED,
+            GL_FLOAT, &nan);
+}
+
+void PointRenderer::update_points(const uint8_t* point_data,
+                                  size_t first_point, size_t num_points) {
+  Q_ASSERT(first_point + num_points <= num_vertices);
+
+  set_segment_data(&vertex_position_buffers,
+                   point_data + GLsizeiptr(first_point) * STRIDE, first_point,
+                   num_points, STRIDE);
+}
+
 void PointRenderer::load_test(GLsizei num_vertices) {
+  Q_ASSERT(size_t(num_vertices) <= POINTS_PER_SEGMENT);
+
   gl::Buffer buffer(GLsizeiptr(num_vertices) * STRIDE,
                     gl::Buffer::UsageFlag::MAP_WRITE, nullptr);
 
@@ -89,21 +195,129 @@ void PointRenderer::load_test(GLsizei num_vertices) {
   vertices = nullptr;
   buffer.Unmap();
 
-  this->vertex_position_buffer = std::move(buffer);
-  this->num_vertices = num_vertices;
+  this->vertex_position_buffers.clear();
+  this->vertex_position_buffers.push_back(std::move(buffer));
+  this->num_vertices = size_t(num_vertices);
+}
+
+void PointRenderer::load_user_data(const uint8_t* user_data,
+                                   size_t num_points,
+                                   GLsizei user_data_stride) {
+  // free the old memory before allocating the new one
+  this->user_data_buffers.clear();
+  this->user_data_stride = 0;
+
+  if (num_points == 0 || user_data_stride == 0) return;
+
+  // The segments match the ones of the points
+  this->user_data_buffers = create_segment_buffers(
+      user_data, num_points, GLsizeiptr(user_data_stride));
+  this->user_data_stride = user_data_stride;
+}
+
+void PointRenderer::update_user_data(const uint8_t* user_data,
+                                     size_t first_point, size_t num_points) {
+  if (!has_user_data()) return;
+
+  const GLsizeiptr stride = GLsizeiptr(user_data_stride);
+  set_segment_data(&user_data_buffers,
+                   user_data + GLsizeiptr(first_point) * stride, first_point,
+                   num_points, stride);
+}
+
+bool PointRenderer::has_user_data() const { return user_data_stride != 0; }
+
+bool PointRenderer::set_color_shader(const color_shader_t& color_shader) {
+  Q_ASSERT(color_shader.property_attributes.size() ==
+           color_shader.property_offsets.size());
+
+  if (!has_user_data()) return false;
+
+  GLint max_vertex_attributes = 0;
+  GL_CALL(glGetIntegerv, GL_MAX_VERTEX_ATTRIBS, &max_vertex_attributes);
+  if (FIRST_PROPERTY_BINDING_INDEX +
+          GLint(color_shader.property_attributes.size()) >
+      max_vertex_attributes)
+    return false;
+
+  std::unique_ptr<gl::ShaderObject> new_shader_object(
+      new gl::ShaderObject("point_renderer_with_color_shader"));
+  new_shader_object->AddShaderFromFile(
+      gl::ShaderObject::ShaderType::VERTEX, "point_cloud.vs.glsl",
+      format("#define POSITION_BINDING_INDEX ", POSITION_BINDING_INDEX, "\n",
+             "#define COLOR_BINDING_INDEX ", COLOR_BINDING_INDEX, "\n",
+             "#define RENDER_TIME_COLOR\n", color_shader.code, "\n"));
+  new_shader_object->AddShaderFromFile(gl::ShaderObject::ShaderType::FRAGMENT,
+                                       "point_cloud.fs.glsl");
+  if (new_shader_object->CreateProgram() == gl::Result::FAILURE) return false;
+
+  std::vector<gl::VertexArrayObject::Attribute> attributes = {
+      gl::VertexArrayObject::Attribute(
+          gl::VertexArrayObject::Attribute::Type::FLOAT, 3,
+          POSITION_BINDING_INDEX),
+      gl::VertexArrayObject::Attribute(
+          gl::VertexArrayObject::Attribute::Type::UINT8, 3,
+          COLOR_BINDING_INDEX,
+          gl::VertexArrayObject::Attribute::IntegerHandling::NORMALIZED),
+  };
+  attributes.insert(attributes.end(), color_shader.property_attributes.begin(),
+                    color_shader.property_attributes.end());
+
+  color_shader_object = std::move(new_shader_object);
+  color_vertex_array_object.reset(
+      new gl::VertexArrayObject(std::move(attributes)));
+  color_property_offsets = color_shader.property_offsets;
+
+  return true;
+}
+
+void PointRenderer::reset_color_shader() {
+  color_shader_object.reset();
+  color_vertex_array_object.reset();
+  color_property_offsets.clear();
+}
+
+bool PointRenderer::has_color_shader() const {
+  return color_shader_object != nullptr;
 }
 
 void PointRenderer::render_points() {
   if (Q_UNLIKELY(num_vertices == 0)) return;
 
-  vertex_array_object.Bind();
-  vertex_position_buffer.BindVertexBuffer(POSITION_BINDING_INDEX, 0, STRIDE);
-  vertex_position_buffer.BindVertexBuffer(COLOR_BINDING_INDEX, COLOR_OFFSET,
-                                          STRIDE);
+  const bool use_color_shader = has_color_shader() && has_user_data();
 
+  gl::ShaderObject& shader_object =
+      use_color_shader ? *color_shader_object : this->shader_object;
+  gl::VertexArrayObject& vertex_array_object =
+      use_color_shader ? *color_vertex_array_object : this->vertex_array_object;
+
+  vertex_array_object.Bind();
   shader_object.Activate();
-  GL_CALL(glDrawArrays, GL_POINTS, 0, num_vertices);
+
+  // Only the appended points of the allocated segments are drawn
+  visit_segments(0, num_vertices, [&](size_t segment, size_t, size_t,
+                                      size_t n) {
+    gl::Buffer& vertex_position_buffer = vertex_position_buffers[segment];
+    vertex_position_buffer.BindVertexBuffer(POSITION_BINDING_INDEX, 0, STRIDE);
+    vertex_position_buffer.BindVertexBuffer(COLOR_BINDING_INDEX, COLOR_OFFSET,
+                                            STRIDE);
+    if (use_color_shader) {
+      for (size_t i = 0; i < color_property_offsets.size(); ++i)
+        user_data_buffers[segment].BindVertexBuffer(
+            uint(FIRST_PROPERTY_BINDING_INDEX + i), color_property_offsets[i],
+            user_data_stride);
+    }
+
+    GL_CALL(glDrawArrays, GL_POINTS, 0, GLsizei(n));
+  });
+
   shader_object.Deactivate();
+
+  if (use_color_shader) {
+    for (size_t i = 0; i < color_property_offsets.size(); ++i)
+      GL_CALL(glBindVertexBuffer, GLuint(FIRST_PROPERTY_BINDING_INDEX + i), 0,
+              0, 0);
+  }
   vertex_array_object.ResetBinding();
 }
 
@@ -7,32 +7,83 @@
 #include <glhelper/shaderobject.hpp>
 #include <glhelper/vertexarrayobject.hpp>
 
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace renderer {
 namespace gl450 {
 
 /**
 Renderer responsible for rendering a single point-cloud.
 Multiple of those can be used for having multiple layers of point clouds.
+
+The points are split into segments of points_per_segment() points, each with
+its own buffers and draw call, as draw calls count the points with a GLsizei
+and drivers limit the size of a single buffer. So clouds with billions of
+points can be rendered, as long as they fit into the video memory.
 */
 class PointRenderer final {
  public:
+  /*
+  Allows evaluating the color expression of the point shader while rendering,
+  reading the used properties directly from the user data uploaded with
+  load_user_data. Changing only the colors doesn't need any remapping then.
+
+  The code is prepended to point_cloud.vs.glsl and must define the function
+  `render_time_color()`. The property attributes must use the locations
+  starting at first_property_binding_index().
+  */
+  struct color_shader_t {
+    std::string code;
+    std::vector<gl::VertexArrayObject::Attribute> property_attributes;
+    std::vector<GLintptr> property_offsets;
+  };
+
   PointRenderer();
   ~PointRenderer();
 
   PointRenderer(PointRenderer&& point_renderer);
   PointRenderer& operator=(PointRenderer&& point_renderer);
 
+  static uint first_property_binding_index();
+  static size_t points_per_segment();
+
   void clear_buffer();
-  void load_points(const uint8_t* point_data, GLsizei num_points);
+  void load_points(const uint8_t* point_data, size_t num_points);
+  // Allocates the memory for num_points points, which are set block by block
+  // with update_points. Points not set yet have nan coordinates.
+  void allocate_points(size_t num_points);
+  // point_data points to the first point of the whole point cloud
+  void update_points(const uint8_t* point_data, size_t first_point,
+                     size_t num_points);
   void load_test(GLsizei num_vertices = 512);
 
+  void load_user_data(const uint8_t* user_data, size_t num_points,
+                      GLsizei user_data_stride);
+  void update_user_data(const uint8_t* user_data, size_t first_point,
+                        size_t num_points);
+  bool has_user_data() const;
+
+  bool set_color_shader(const color_shader_t& color_shader);
+  void reset_color_shader();
+  bool has_color_shader() const;
+
   void render_points();
 
  private:
   gl::ShaderObject shader_object;
-  gl::Buffer vertex_position_buffer;
+  // one buffer per segment
+  std::vector<gl::Buffer> vertex_position_buffers;
   gl::VertexArrayObject vertex_array_object;
-  GLsizei num_vertices = 0;
+  size_t num_vertices = 0;
+
+  std::vector<gl::Buffer> user_data_buffers;
+  GLsizei user_data_stride = 0;
+
+  std::unique_ptr<gl::ShaderObject> color_shader_object;
+  std::unique_ptr<gl::VertexArrayObject> color_vertex_array_object;
+  std::vector<GLintptr> color_property_offsets;
 };
 
 }  // namespace gl450
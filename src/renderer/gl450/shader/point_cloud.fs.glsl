@@ -1,11 +1,11 @@
 #version 450 core
 
-in vec4 color;
+in vec4 impl_color;
 
 layout(location=0)
 out vec4 fragment_color;
 
 void main()
 {
-  fragment_color = color;
+  fragment_color = impl_color;
 }
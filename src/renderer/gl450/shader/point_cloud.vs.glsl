@@ -3,15 +3,20 @@
 #include <uniforms/global.vs.glsl>
 
 layout(location = POSITION_BINDING_INDEX)
-in vec3 point_coord;
+in vec3 impl_point_coord;
 layout(location = COLOR_BINDING_INDEX)
-in vec3 point_color;
+in vec3 impl_point_color;
 
-out vec4 color;
+out vec4 impl_color;
 
 void main()
 {
-  gl_Position = global.camera_matrix * vec4(point_coord.xyz, 1);
+  gl_Position = global.camera_matrix * vec4(impl_point_coord.xyz, 1);
   
-  color = vec4(point_color.rgb, 1);
+#ifdef RENDER_TIME_COLOR
+  // the color expression of the point shader is evaluated while rendering
+  impl_color = vec4(clamp(vec3(render_time_color()), 0, 255) / 255., 1);
+#else
+  impl_color = vec4(impl_point_color.rgb, 1);
+#endif
 }
@@ -0,0 +1,217 @@
+#include <pointcloud/buffer.hpp>
+#include <tests/check.hpp>
+
+#include <QFile>
+#include <QSharedPointer>
+#include <QtGlobal>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+Resizes, clears, moves and maps buffers with every allocation strategy: the
+bytes are kept by resizing, memset sets all of them and mapped file sections
+are private copies. On linux, the resident pages show, that a buffer resized
+without first touch takes no memory until it's written, while the pages of a
+buffer resized with first touch are all resident.
+
+Returns 1, if a check fails.
+*/
+
+namespace {
+
+typedef buffer_allocation_t::huge_pages_t huge_pages_t;
+
+const char* const filename = "buffer_test.bin";
+
+// Larger than the mapping threshold and split into parts copied in parallel
+const size_t buffer_size = size_t(48) << 20;
+
+uint8_t pattern(size_t i) { return uint8_t(i * 31 + i / 4096); }
+
+void write_pattern(Buffer* buffer, size_t begin, size_t end) {
+  uint8_t* data = buffer->data();
+  for (size_t i = begin; i < end; ++i) data[i] = pattern(i);
+}
+
+bool has_pattern(const Buffer& buffer, size_t begin, size_t end) {
+  const uint8_t* data = buffer.data();
+  for (size_t i = begin; i < end; ++i)
+    if (data[i] != pattern(i)) return false;
+  return true;
+}
+
+bool has_value(const Buffer& buffer, uint8_t value) {
+  const uint8_t* data = buffer.data();
+  for (size_t i = 0; i < buffer.size(); ++i)
+    if (data[i] != value) return false;
+  return true;
+}
+
+void test_allocation(const char* name, buffer_allocation_t allocation) {
+  Buffer::set_allocation(allocation);
+
+  Buffer buffer;
+  check(buffer.size() == 0 && buffer.data() == nullptr, name, ": empty");
+
+  buffer.resize(buffer_size / 2);
+  write_pattern(&buffer, 0, buffer_size / 2);
+  buffer.resize(buffer_size);
+  write_pattern(&buffer, buffer_size / 2, buffer_size);
+  check(buffer.size() == buffer_size && has_pattern(buffer, 0, buffer_size),
+        name, ": bytes kept by growing");
+
+  // the capacity is kept
+  buffer.resize(1000);
+  buffer.resize(buffer_size);
+  check(has_pattern(buffer, 0, buffer_size), name,
+        ": bytes kept by shrinking");
+
+  Buffer other;
+  other.resize_without_first_touch(buffer_size);
+  write_pattern(&other, 0, buffer_size);
+  check(has_pattern(other, 0, buffer_size), name,
+        ": resized without first touch");
+
+  buffer.memset(0x12345678);
+  check(has_value(buffer, 0x78), name, ": memset");
+
+  Buffer moved(std::move(buffer));
+  check(buffer.size() == 0 && buffer.data() == nullptr &&
+            moved.size() == buffer_size && has_value(moved, 0x78),
+        name, ": moved");
+  moved = std::move(other);
+  check(other.size() == 0 && has_pattern(moved, 0, buffer_size), name,
+        ": move assigned");
+
+  moved.clear();
+  check(moved.size() == 0 && moved.data() == nullptr, name, ": cleared");
+}
+
+void test_mapped_file_section() {
+  Buffer::set_allocation(buffer_allocation_t());
+
+  {
+    std::string data(3 * 4096, '\0');
+    for (size_t i = 0; i < data.size(); ++i) data[i] = char(pattern(i));
+    std::ofstream file(filename, std::ios::binary);
+    file.write(data.data(), std::streamsize(data.size()));
+  }
+
+  QSharedPointer<QFile> file(new QFile(filename));
+  check(file->open(QIODevice::ReadOnly), "file opened");
+
+  // the section starts at the second page, so its values are pattern(4096 + i)
+  Buffer buffer;
+  check(buffer.map_file_section(file, 4096, 2 * 4096) && buffer.is_mapped() &&
+            buffer.size() == 2 * 4096,
+        "section mapped");
+  bool section_equal = true;
+  for (size_t i = 0; i < buffer.size(); ++i)
+    section_equal &= buffer.data()[i] == pattern(4096 + i);
+  check(section_equal, "values of the section");
+
+  // the mapping is private
+  buffer.data()[0] = uint8_t(~pattern(4096));
+  Buffer other;
+  other.map_file_section(file, 4096, 4096);
+  check(other.data()[0] == pattern(4096), "written values not in the file");
+
+  // growing copies the mapped bytes
+  other.resize(3 * 4096);
+  bool copied = !other.is_mapped() && other.size() == 3 * 4096;
+  for (size_t i = 0; copied && i < 4096; ++i)
+    copied = other.data()[i] == pattern(4096 + i);
+  check(copied, "mapped bytes copied");
+
+  buffer.memset(7);
+  check(!buffer.is_mapped() && buffer.size() == 2 * 4096 &&
+            has_value(buffer, 7),
+        "memset of a mapped section");
+
+  file->close();
+  std::remove(filename);
+}
+
+#ifdef Q_OS_LINUX
+// The number of pages of the bytes in physical memory
+size_t resident_pages(const Buffer& buffer) {
+  const size_t page_size = size_t(::sysconf(_SC_PAGESIZE));
+  std::vector<unsigned char> pages((buffer.size() + page_size - 1) /
+                                   page_size);
+  if (::mincore(const_cast<uint8_t*>(buffer.data()), buffer.size(),
+                pages.data()) != 0)
+    return 0;
+
+  size_t num_resident = 0;
+  for (unsigned char page : pages) num_resident += page & 1;
+  return num_resident;
+}
+
+// Without huge pages, touching a byte only takes its page
+void test_first_touch() {
+  buffer_allocation_t allocation;
+  allocation.huge_pages = huge_pages_t::NONE;
+  allocation.mapping_threshold = 0;
+  Buffer::set_allocation(allocation);
+
+  const size_t num_pages = buffer_size / size_t(::sysconf(_SC_PAGESIZE));
+
+  Buffer touched;
+  touched.resize(buffer_size);
+  check(resident_pages(touched) == num_pages, "all pages first touched");
+
+  Buffer untouched;
+  untouched.resize_without_first_touch(buffer_size);
+  check(resident_pages(untouched) == 0, "no pages touched");
+
+  write_pattern(&untouched, 0, buffer_size / 4);
+  const size_t resident = resident_pages(untouched);
+  check(resident >= num_pages / 4 && resident < num_pages / 2,
+        "only the written pages resident");
+}
+#endif
+
+}  // namespace
+
+int main() {
+  buffer_allocation_t heap;
+  heap.mapping_threshold = buffer_size * 2;
+  test_allocation("heap", heap);
+
+  for (const char* huge_pages : {"none", "transparent", "explicit"}) {
+    for (bool parallel_first_touch : {true, false}) {
+      buffer_allocation_t mapped;
+      buffer_allocation_t::parse_huge_pages(huge_pages, &mapped.huge_pages);
+      mapped.parallel_first_touch = parallel_first_touch;
+      mapped.mapping_threshold = size_t(1) << 20;
+
+      const std::string name = std::string("mapped with huge pages ") +
+                               huge_pages +
+                               (parallel_first_touch ? " and first touch" : "");
+      test_allocation(name.c_str(), mapped);
+    }
+  }
+
+  test_mapped_file_section();
+
+#ifdef Q_OS_LINUX
+  test_first_touch();
+#endif
+
+  huge_pages_t huge_pages = huge_pages_t::NONE;
+  check(buffer_allocation_t::parse_huge_pages(" explicit", &huge_pages) &&
+            huge_pages == huge_pages_t::EXPLICIT &&
+            !buffer_allocation_t::parse_huge_pages("always", &huge_pages),
+        "parsed huge pages");
+
+  return exit_code();
+}
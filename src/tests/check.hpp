@@ -0,0 +1,26 @@
+#ifndef TESTS_CHECK_HPP_
+#define TESTS_CHECK_HPP_
+
+#include <core_library/print.hpp>
+
+/*
+The checks of the tests. A failed check prints its description and the test
+goes on, so all failures are reported. main returns exit_code().
+*/
+
+inline bool& all_checks_passed() {
+  static bool passed = true;
+  return passed;
+}
+
+template <typename... arg_t>
+void check(bool passed, const arg_t&... what) {
+  if (passed) return;
+  println_error("failed: ", what...);
+  all_checks_passed() = false;
+}
+
+// 1, if a check failed
+inline int exit_code() { return all_checks_passed() ? 0 : 1; }
+
+#endif  // TESTS_CHECK_HPP_
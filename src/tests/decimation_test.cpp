@@ -0,0 +1,81 @@
+#include <pointcloud/importer/point_selection.hpp>
+#include <tests/check.hpp>
+
+#include <cmath>
+
+/*
+Parses the decimations given on the command line and rejects malformed ones.
+
+Returns 1, if a check fails.
+*/
+
+namespace {
+
+typedef decimation_t::mode_t mode_t;
+
+void test_valid() {
+  decimation_t decimation;
+
+  check(decimation_t::parse("random:0.25", &decimation) &&
+            decimation.mode == mode_t::RANDOM && decimation.ratio == 0.25 &&
+            decimation.seed == 0 && decimation.memory_budget == 0,
+        "random");
+  check(decimation_t::parse("random:1:42", &decimation) &&
+            decimation.mode == mode_t::RANDOM && decimation.ratio == 1. &&
+            decimation.seed == 42,
+        "random with a seed");
+  check(decimation_t::parse(" nth : 4 ", &decimation) &&
+            decimation.mode == mode_t::EVERY_NTH && decimation.ratio == 0.25,
+        "every nth point (with spaces)");
+  check(decimation_t::parse("voxel:0.05", &decimation) &&
+            decimation.mode == mode_t::VOXEL_GRID &&
+            decimation.voxel_size == 0.05f,
+        "voxel grid");
+  check(decimation_t::parse("fit:0.5", &decimation) &&
+            decimation.mode == mode_t::RANDOM && decimation.ratio == 1. &&
+            decimation.memory_budget == size_t(512) << 20,
+        "fit into memory");
+
+  // a previous decimation is reset
+  decimation_t::parse("random:0.5:7", &decimation);
+  check(decimation_t::parse("voxel:2", &decimation) &&
+            decimation.ratio == 1. && decimation.seed == 0,
+        "previous decimation reset");
+}
+
+void test_invalid() {
+  const char* const invalid[] = {
+      "",           "random",      "random:",      "random:0",
+      "random:1.5", "random:-0.5", "random:nan",   "random:inf",
+      "random:abc", "random:0.5:", "random:0.5:x", "random:0.5:1:2",
+      "nth:0.5",    "nth:2:3",     "voxel:0",      "voxel:-1",
+      "fit:0",      "grid:1",      ":0.5",         "0.5"};
+
+  for (const char* text : invalid) {
+    decimation_t decimation;
+    check(!decimation_t::parse(text, &decimation), "\"", text, "\" rejected");
+  }
+}
+
+void test_ratio_for() {
+  decimation_t decimation;
+  decimation_t::parse("fit:1", &decimation);
+  check(std::abs(decimation.ratio_for(size_t(1) << 30, 4) - 0.25) < 1.e-12,
+        "ratio fitting into the memory");
+  check(decimation.ratio_for(1000, 4) == 1.,
+        "ratio of points fitting into the memory anyway");
+
+  decimation_t::parse("random:0.1", &decimation);
+  check(decimation.ratio_for(size_t(1) << 40, 32) == 0.1,
+        "ratio without a memory budget");
+}
+
+}  // namespace
+
+int main() {
+  test_valid();
+  test_invalid();
+  test_ratio_for();
+
+  return exit_code();
+}
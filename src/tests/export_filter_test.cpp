@@ -0,0 +1,274 @@
+#include <pointcloud/exporter/export_filter.hpp>
+#include <pointcloud/exporter/ply_exporter.hpp>
+#include <pointcloud/importer/ply_importer.hpp>
+#include <tests/check.hpp>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/*
+Filters a pointcloud by boxes, oriented boxes and conditions on its properties
+without and with its kd tree and compares the ranges with the ones of testing
+every point. Points on the boundary of the regions pass. Also parses filters
+and exports a filtered pointcloud.
+
+Returns 1, if a check fails.
+*/
+
+namespace {
+
+typedef PointCloud::point_range_t point_range_t;
+typedef export_filter_t::region_t region_t;
+typedef export_filter_t::comparison_t comparison_t;
+
+const char* const filename = "export_filter_test.ply";
+
+const size_t num_points = 200000;
+// uchar classification, float intensity
+const size_t stride = 5;
+
+// Every other point lies on an integer grid (so some are on the boundary of
+// the boxes), the others are random. Many points are duplicates.
+PointCloud test_pointcloud() {
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> distribution(0.f, 100.f);
+
+  PointCloud pointcloud;
+  pointcloud.set_user_data_format(
+      stride, {"classification", "intensity"}, {0, 1},
+      {data_type::base_type_t::UINT8, data_type::base_type_t::FLOAT32});
+  pointcloud.resize(num_points);
+  pointcloud.aabb = aabb_t::invalid();
+
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(
+      pointcloud.coordinate_color.data());
+  for (size_t i = 0; i < num_points; ++i) {
+    glm::vec3 coordinate;
+    if (i % 2 == 0)
+      coordinate = glm::vec3(float(i / 2 % 101), float(i / 202 % 101),
+                             float(i % 7 * 10));
+    else
+      coordinate = glm::vec3(distribution(generator), distribution(generator),
+                             distribution(generator));
+
+    vertices[i] = PointCloud::vertex_t();
+    vertices[i].coordinate = coordinate;
+    pointcloud.aabb |= coordinate;
+
+    const uint8_t classification = uint8_t(i % 7);
+    const float intensity = distribution(generator) * 0.01f;
+    uint8_t* record = pointcloud.user_data.data() + i * stride;
+    std::memcpy(record, &classification, sizeof(classification));
+    std::memcpy(record + 1, &intensity, sizeof(intensity));
+  }
+
+  return pointcloud;
+}
+
+uint8_t classification_of(const PointCloud& pointcloud, size_t point) {
+  return pointcloud.user_data.data()[point * stride];
+}
+
+float intensity_of(const PointCloud& pointcloud, size_t point) {
+  float intensity;
+  std::memcpy(&intensity, pointcloud.user_data.data() + point * stride + 1,
+              sizeof(intensity));
+  return intensity;
+}
+
+// The ranges of the points passing the test
+template <typename test_t>
+std::vector<point_range_t> ranges_of_points(const PointCloud& pointcloud,
+                                            const test_t& passes) {
+  std::vector<point_range_t> ranges;
+  for (size_t i = 0; i < pointcloud.num_points; ++i) {
+    if (!passes(i)) continue;
+    if (!ranges.empty() && ranges.back().end == i)
+      ranges.back().end = i + 1;
+    else
+      ranges.push_back(point_range_t{i, i + 1});
+  }
+  return ranges;
+}
+
+// Whether the filter gives the ranges of the points passing the test
+template <typename test_t>
+bool filter_passes(const PointCloud& pointcloud,
+                   const export_filter_t& filter, const test_t& passes) {
+  const std::vector<point_range_t> expected =
+      ranges_of_points(pointcloud, passes);
+  const std::vector<point_range_t> ranges =
+      filtered_point_ranges(pointcloud, filter, [](int64_t) {});
+
+  bool equal = ranges.size() == expected.size();
+  for (size_t i = 0; equal && i < ranges.size(); ++i)
+    equal = ranges[i].begin == expected[i].begin &&
+            ranges[i].end == expected[i].end;
+  return equal;
+}
+
+std::vector<point_range_t> filtered_ranges(const PointCloud& pointcloud,
+                                           const export_filter_t& filter) {
+  return filtered_point_ranges(pointcloud, filter, [](int64_t) {});
+}
+
+export_filter_t parsed_filter(const char* text) {
+  export_filter_t filter;
+  check(export_filter_t::parse(text, &filter), "\"", text, "\" parsed");
+  return filter;
+}
+
+void test_regions(const PointCloud& pointcloud, const char* kd_tree) {
+  const export_filter_t box = parsed_filter("box: 10, 20, 30, 40, 50, 60");
+  auto inside_box = [&](size_t i) {
+    return box.box.contains(pointcloud.vertex(i).coordinate, 0.f);
+  };
+  check(filter_passes(pointcloud, box, inside_box), "box ", kd_tree);
+
+  // rotated by 30 degrees around the z axis
+  export_filter_t oriented_box;
+  oriented_box.region = region_t::ORIENTED_BOX;
+  oriented_box.frame =
+      frame_t(glm::vec3(50.f, 50.f, 40.f),
+              glm::angleAxis(glm::radians(30.f), glm::vec3(0, 0, 1)));
+  oriented_box.extent = glm::vec3(20.f, 10.f, 20.f);
+  const frame_t inverse_frame = oriented_box.frame.inverse();
+  auto inside_oriented_box = [&](size_t i) {
+    const glm::vec3 p =
+        inverse_frame.transform_point(pointcloud.vertex(i).coordinate);
+    return glm::all(glm::lessThanEqual(glm::abs(p), oriented_box.extent));
+  };
+  check(filter_passes(pointcloud, oriented_box, inside_oriented_box),
+        "oriented box ", kd_tree);
+
+  // all points are inside the box except for x
+  const export_filter_t combined = parsed_filter(
+      "classification >= 3; box:0,0,0,50,100,100; intensity < 0.5");
+  auto passes_combined = [&](size_t i) {
+    return classification_of(pointcloud, i) >= 3 &&
+           intensity_of(pointcloud, i) < 0.5f &&
+           pointcloud.vertex(i).coordinate.x <= 50.f;
+  };
+  check(filter_passes(pointcloud, combined, passes_combined),
+        "box and conditions ", kd_tree);
+
+  const export_filter_t outside = parsed_filter("box:200,0,0,300,100,100");
+  check(filtered_ranges(pointcloud, outside).empty(), "box outside ",
+        kd_tree);
+}
+
+void test_conditions(const PointCloud& pointcloud) {
+  const export_filter_t equal = parsed_filter("classification == 2");
+  check(filter_passes(pointcloud, equal,
+                      [&](size_t i) {
+                        return classification_of(pointcloud, i) == 2;
+                      }),
+        "condition");
+
+  // joined ranges of consecutive points
+  const export_filter_t not_equal = parsed_filter("classification != 6");
+  check(filtered_ranges(pointcloud, not_equal).size() ==
+            (num_points + 6) / 7,
+        "consecutive points joined");
+
+  bool unknown_property_rejected = false;
+  try {
+    filtered_ranges(pointcloud, parsed_filter("label > 1"));
+  } catch (QString) {
+    unknown_property_rejected = true;
+  }
+  check(unknown_property_rejected, "unknown property rejected");
+}
+
+void test_parse() {
+  const export_filter_t filter =
+      parsed_filter(" obox:1,2,3, 2,0,0,0, 4,5,6 ; intensity<=0.25;");
+  check(filter.region == region_t::ORIENTED_BOX &&
+            filter.frame.position == glm::vec3(1, 2, 3) &&
+            filter.frame.orientation == glm::quat(1, 0, 0, 0) &&
+            filter.extent == glm::vec3(4, 5, 6),
+        "oriented box with a normalized orientation");
+  check(filter.conditions.length() == 1 &&
+            filter.conditions[0].property == "intensity" &&
+            filter.conditions[0].comparison == comparison_t::LESS_EQUAL &&
+            filter.conditions[0].value == 0.25,
+        "condition");
+
+  export_filter_t none;
+  check(export_filter_t::parse("", &none) && !none.is_enabled(),
+        "empty filter");
+
+  const char* const invalid[] = {"box:1,2,3",
+                                 "box:1,2,3,0,0,0",
+                                 "box:1,2,3,4,5,x",
+                                 "obox:0,0,0,0,0,0,0,1,1,1",
+                                 "obox:0,0,0,1,0,0,0,-1,1,1",
+                                 "box:0,0,0,1,1,1;box:0,0,0,1,1,1",
+                                 "classification",
+                                 "classification == ",
+                                 "classification == nan",
+                                 "== 2"};
+  for (const char* text : invalid) {
+    export_filter_t filter;
+    check(!export_filter_t::parse(text, &filter), "\"", text, "\" rejected");
+  }
+}
+
+// The exported records are the ones of the passing points in their order (all
+// coordinates are positive)
+void test_export(const PointCloud& pointcloud) {
+  PlyExporter exporter(filename, pointcloud);
+  exporter.filter = parsed_filter("box:0,0,0,30,30,30; classification < 2");
+  exporter.export_now();
+  check(exporter.state == AbstractPointCloudExporter::SUCCEEDED,
+        "filtered export");
+
+  std::vector<size_t> points;
+  for (size_t i = 0; i < pointcloud.num_points; ++i)
+    if (glm::all(glm::lessThanEqual(pointcloud.vertex(i).coordinate,
+                                    glm::vec3(30.f))) &&
+        classification_of(pointcloud, i) < 2)
+      points.push_back(i);
+
+  PlyImporter importer(filename);
+  importer.import();
+  const PointCloud& imported = importer.pointcloud;
+  bool records_equal =
+      importer.state == AbstractPointCloudImporter::SUCCEEDED &&
+      imported.num_points == points.size();
+  for (size_t i = 0; records_equal && i < points.size(); ++i)
+    records_equal =
+        std::memcmp(imported.user_data.data() + i * stride,
+                    pointcloud.user_data.data() + points[i] * stride,
+                    stride) == 0;
+  check(records_equal, "exported records");
+
+  PlyExporter empty_exporter(filename, pointcloud);
+  empty_exporter.filter = parsed_filter("classification > 6");
+  empty_exporter.export_now();
+  check(empty_exporter.state == AbstractPointCloudExporter::NO_POINTS,
+        "no points exported");
+}
+
+}  // namespace
+
+int main() {
+  PointCloud pointcloud = test_pointcloud();
+
+  test_parse();
+  test_regions(pointcloud, "without kd tree");
+  test_conditions(pointcloud);
+  test_export(pointcloud);
+
+  pointcloud.build_kd_tree([](size_t, size_t) { return true; });
+  test_regions(pointcloud, "with kd tree");
+  test_export(pointcloud);
+
+  std::remove(filename);
+
+  return exit_code();
+}
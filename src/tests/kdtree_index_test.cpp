@@ -0,0 +1,166 @@
+#include <geometry/cone.hpp>
+#include <pointcloud/kdtree_index.hpp>
+#include <pointcloud/pointcloud.hpp>
+#include <tests/check.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+/*
+Builds the kd tree of degenerate points (a cluster of identical points, points
+on a line and on a grid plus random points) and compares the points visited in
+regions with the ones of testing every point. The traversals grow their stacks
+on demand, so the deep subtrees of the identical points are fully visited.
+Picking a point with a narrow cone finds the duplicated point it's aimed at.
+
+Returns 1, if a check fails.
+*/
+
+namespace {
+
+typedef KDTreeIndex::point_index_t point_index_t;
+
+const size_t num_points = 300000;
+const glm::vec3 duplicated_point(5.f, 5.f, 5.f);
+const glm::vec3 picked_point(20.f, 20.f, 20.f);
+
+PointCloud test_pointcloud() {
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<float> distribution(0.f, 10.f);
+
+  PointCloud pointcloud;
+  pointcloud.set_user_data_format(0, {}, {}, {});
+  pointcloud.resize(num_points);
+
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(
+      pointcloud.coordinate_color.data());
+  for (size_t i = 0; i < num_points; ++i) {
+    glm::vec3 coordinate;
+    switch (i % 4) {
+      case 0:
+        coordinate = duplicated_point;
+        break;
+      case 1:
+        coordinate = glm::vec3(distribution(generator), 2.f, 3.f);
+        break;
+      case 2:
+        coordinate =
+            glm::vec3(float(i / 4 % 11), float(i / 44 % 11), float(i % 3));
+        break;
+      default:
+        coordinate = glm::vec3(distribution(generator), distribution(generator),
+                               distribution(generator));
+    }
+    if (i % 3001 == 0) coordinate = picked_point;
+
+    vertices[i] = PointCloud::vertex_t();
+    vertices[i].coordinate = coordinate;
+  }
+
+  pointcloud.aabb = aabb_t::fromVertices(
+      &vertices[0].coordinate, num_points, sizeof(PointCloud::vertex_t));
+  return pointcloud;
+}
+
+std::vector<size_t> visited_points(const PointCloud& pointcloud,
+                                   const aabb_t& region) {
+  std::vector<size_t> points;
+  pointcloud.kdtree_index.visit_points_in_region(
+      region, pointcloud.coordinate_color.data(), PointCloud::stride,
+      [&points](const point_index_t* begin, const point_index_t* end) {
+        for (; begin != end; ++begin) points.push_back(size_t(*begin));
+      });
+  std::sort(points.begin(), points.end());
+  return points;
+}
+
+std::vector<size_t> points_inside(const PointCloud& pointcloud,
+                                  const aabb_t& region) {
+  std::vector<size_t> points;
+  for (size_t i = 0; i < pointcloud.num_points; ++i)
+    if (region.contains(pointcloud.vertex(i).coordinate, 0.f))
+      points.push_back(i);
+  return points;
+}
+
+aabb_t box(glm::vec3 min_point, glm::vec3 max_point) {
+  aabb_t aabb = aabb_t::invalid();
+  aabb.min_point = min_point;
+  aabb.max_point = max_point;
+  return aabb;
+}
+
+void test_aabb(const PointCloud& pointcloud) {
+  check(pointcloud.aabb.min_point == glm::vec3(0.f) &&
+            pointcloud.aabb.max_point == picked_point,
+        "aabb of the strided vertices");
+}
+
+void test_regions(const PointCloud& pointcloud) {
+  const aabb_t regions[] = {
+      // only the identical points
+      box(duplicated_point, duplicated_point),
+      // the line on the boundary and some of the grid points
+      box(glm::vec3(0.f, 2.f, 2.f), glm::vec3(5.f, 5.f, 3.f)),
+      box(glm::vec3(2.5f, 0.f, 1.f), glm::vec3(7.5f, 10.f, 6.f)),
+      // everything and nothing
+      box(glm::vec3(-1.f), glm::vec3(21.f)),
+      box(glm::vec3(11.f), glm::vec3(19.f))};
+
+  for (const aabb_t& region : regions)
+    check(visited_points(pointcloud, region) ==
+              points_inside(pointcloud, region),
+          "points in the region from ", region.min_point.x, " ",
+          region.min_point.y, " ", region.min_point.z, " to ",
+          region.max_point.x, " ", region.max_point.y, " ",
+          region.max_point.z);
+
+  std::mt19937 generator(5);
+  std::uniform_real_distribution<float> distribution(-1.f, 11.f);
+  bool random_regions_equal = true;
+  for (int i = 0; i < 20; ++i) {
+    const glm::vec3 a(distribution(generator), distribution(generator),
+                      distribution(generator));
+    const glm::vec3 b(distribution(generator), distribution(generator),
+                      distribution(generator));
+    const aabb_t region = box(glm::min(a, b), glm::max(a, b));
+    random_regions_equal &= visited_points(pointcloud, region) ==
+                            points_inside(pointcloud, region);
+  }
+  check(random_regions_equal, "points in random regions");
+}
+
+void test_pick(const PointCloud& pointcloud) {
+  ray_t ray;
+  ray.origin = picked_point + glm::vec3(20.f, 0.f, 0.f);
+  ray.direction = glm::vec3(-1.f, 0.f, 0.f);
+
+  const point_index_t picked = pointcloud.kdtree_index.pick_point(
+      cone_t::cone_from_ray_angle(ray, 0.01f),
+      pointcloud.coordinate_color.data(), PointCloud::stride);
+  check(picked != point_index_t::INVALID &&
+            pointcloud.vertex(size_t(picked)).coordinate == picked_point,
+        "duplicated point picked");
+
+  ray.direction = glm::vec3(1.f, 0.f, 0.f);
+  check(pointcloud.kdtree_index.pick_point(
+            cone_t::cone_from_ray_angle(ray, 0.01f),
+            pointcloud.coordinate_color.data(),
+            PointCloud::stride) == point_index_t::INVALID,
+        "no point picked behind the ray");
+}
+
+}  // namespace
+
+int main() {
+  PointCloud pointcloud = test_pointcloud();
+  pointcloud.build_kd_tree([](size_t, size_t) { return true; });
+  check(pointcloud.has_build_kdtree(), "kd tree built");
+
+  test_aabb(pointcloud);
+  test_regions(pointcloud);
+  test_pick(pointcloud);
+
+  return exit_code();
+}
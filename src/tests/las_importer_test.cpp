@@ -0,0 +1,300 @@
+#include <pointcloud/importer/las_importer.hpp>
+#include <tests/check.hpp>
+
+#include <glm/gtc/epsilon.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+/*
+Writes small las files of all point data record formats (0 to 10) and imports
+them: the coordinates are shifted to the center of the bounding box, the
+fields of the legacy and the extended records are decoded, 16 and 8 bit colors
+are detected and version 1.4 files take the 64 bit point count. Truncated and
+compressed files and records shorter than their format are rejected.
+
+Returns 1, if a check fails.
+*/
+
+namespace {
+
+const char* const filename = "las_importer_test.las";
+
+const size_t num_points = 1000;
+const glm::dvec3 scale(0.01, 0.01, 0.001);
+const glm::dvec3 offset(400000., 5000000., 100.);
+
+struct fixture_t {
+  int point_format = 0;
+  int extra_bytes = 0;  // appended to every record
+  bool eight_bit_colors = false;
+  bool legacy_point_count = true;
+  size_t bytes_missing = 0;
+  bool compressed = false;
+};
+
+bool is_extended(int point_format) { return point_format >= 6; }
+
+bool has_gps_time(int point_format) {
+  return point_format != 0 && point_format != 2;
+}
+
+bool has_colors(int point_format) {
+  return point_format == 2 || point_format == 3 || point_format == 5 ||
+         point_format == 7 || point_format == 8 || point_format == 10;
+}
+
+// The size of the records and the offsets of the gps time and the colors
+// given by the specification
+size_t record_length_of(int point_format) {
+  const size_t lengths[] = {20, 28, 26, 34, 57, 63, 30, 36, 38, 59, 67};
+  return lengths[point_format];
+}
+
+size_t gps_time_offset(int point_format) {
+  return is_extended(point_format) ? 22 : 20;
+}
+
+size_t color_offset(int point_format) {
+  if (is_extended(point_format)) return 30;
+  return point_format == 2 ? 20 : 28;
+}
+
+glm::ivec3 scaled_coordinate_of(size_t i) {
+  return glm::ivec3(int(i) * 10 - 5000, int(i) * 3, -int(i));
+}
+
+uint16_t intensity_of(size_t i) { return uint16_t(i * 7); }
+int return_number_of(size_t i) { return int(i % 3) + 1; }
+int number_of_returns_of(size_t) { return 3; }
+double gps_time_of(size_t i) { return 1.e5 + double(i) * 0.5; }
+glm::u8vec3 color_of(size_t i) {
+  return glm::u8vec3(uint8_t(i), uint8_t(i * 3), uint8_t(255 - i % 256));
+}
+
+int classification_of(size_t i, int point_format) {
+  return is_extended(point_format) ? int(i % 200) : int(i % 5);
+}
+
+template <typename value_type>
+void put(std::string* data, size_t position, value_type value) {
+  std::memcpy(&(*data)[position], &value, sizeof(value_type));
+}
+
+void write_file(const fixture_t& fixture) {
+  const int format = fixture.point_format;
+  const int version_minor = format <= 3 ? 2 : format <= 5 ? 3 : 4;
+  const size_t header_size = version_minor == 4 ? 375 : 227;
+  const size_t record_length =
+      size_t(int(record_length_of(format)) + fixture.extra_bytes);
+
+  std::string data(header_size + num_points * record_length, '\0');
+
+  std::memcpy(&data[0], "LASF", 4);
+  put<uint8_t>(&data, 24, 1);
+  put<uint8_t>(&data, 25, uint8_t(version_minor));
+  put<uint16_t>(&data, 94, uint16_t(header_size));
+  put<uint32_t>(&data, 96, uint32_t(header_size));
+  put<uint8_t>(&data, 104,
+               uint8_t(format | (fixture.compressed ? 0x80 : 0)));
+  put<uint16_t>(&data, 105, uint16_t(record_length));
+  put<uint32_t>(&data, 107,
+                fixture.legacy_point_count ? uint32_t(num_points) : 0);
+  if (version_minor == 4) put<uint64_t>(&data, 247, uint64_t(num_points));
+
+  const glm::dvec3 min_point =
+      glm::dvec3(scaled_coordinate_of(0).x, scaled_coordinate_of(0).y,
+                 scaled_coordinate_of(num_points - 1).z) *
+          scale +
+      offset;
+  const glm::dvec3 max_point =
+      glm::dvec3(scaled_coordinate_of(num_points - 1).x,
+                 scaled_coordinate_of(num_points - 1).y,
+                 scaled_coordinate_of(0).z) *
+          scale +
+      offset;
+  for (int dimension = 0; dimension < 3; ++dimension) {
+    put<double>(&data, size_t(131 + dimension * 8), scale[dimension]);
+    put<double>(&data, size_t(155 + dimension * 8), offset[dimension]);
+    put<double>(&data, size_t(179 + dimension * 16), max_point[dimension]);
+    put<double>(&data, size_t(187 + dimension * 16), min_point[dimension]);
+  }
+
+  for (size_t i = 0; i < num_points; ++i) {
+    const size_t record = header_size + i * record_length;
+    const glm::ivec3 coordinate = scaled_coordinate_of(i);
+    for (int dimension = 0; dimension < 3; ++dimension)
+      put<int32_t>(&data, record + size_t(dimension) * 4,
+                   coordinate[dimension]);
+    put<uint16_t>(&data, record + 12, intensity_of(i));
+
+    // the flags next to the returns and the classification are ignored
+    if (is_extended(format)) {
+      put<uint8_t>(&data, record + 14,
+                   uint8_t(return_number_of(i) |
+                           number_of_returns_of(i) << 4));
+      put<uint8_t>(&data, record + 15, 0xff);
+      put<uint8_t>(&data, record + 16,
+                   uint8_t(classification_of(i, format)));
+    } else {
+      put<uint8_t>(&data, record + 14,
+                   uint8_t(return_number_of(i) |
+                           number_of_returns_of(i) << 3 | 0xc0));
+      put<uint8_t>(&data, record + 15,
+                   uint8_t(classification_of(i, format) | 0xe0));
+    }
+
+    if (has_gps_time(format))
+      put<double>(&data, record + gps_time_offset(format), gps_time_of(i));
+
+    if (has_colors(format)) {
+      const glm::u8vec3 color = color_of(i);
+      const size_t rgb = record + color_offset(format);
+      for (int channel = 0; channel < 3; ++channel)
+        put<uint16_t>(&data, rgb + size_t(channel) * 2,
+                      uint16_t(fixture.eight_bit_colors
+                                   ? color[channel]
+                                   : color[channel] * 257));
+    }
+  }
+
+  data.resize(data.size() - fixture.bytes_missing);
+  std::ofstream file(filename, std::ios::binary);
+  file.write(data.data(), std::streamsize(data.size()));
+}
+
+double value_of(const PointCloud& pointcloud, size_t point,
+                const QString& name) {
+  const PointCloud::UserData data = pointcloud.all_values_of_point(point);
+  return data.values[data.names.indexOf(name)].toDouble();
+}
+
+AbstractPointCloudImporter::state_t import_file(const fixture_t& fixture,
+                                                PointCloud* pointcloud) {
+  write_file(fixture);
+
+  LasImporter importer(filename);
+  importer.import();
+  *pointcloud = std::move(importer.pointcloud);
+  return importer.state;
+}
+
+void test_point_format(const fixture_t& fixture) {
+  const int format = fixture.point_format;
+  const std::string name = "format " + std::to_string(format) +
+                           (fixture.eight_bit_colors ? " (8 bit colors)" : "");
+
+  PointCloud pointcloud;
+  check(import_file(fixture, &pointcloud) ==
+            AbstractPointCloudImporter::SUCCEEDED,
+        name, ": import");
+  if (pointcloud.num_points != num_points) {
+    check(false, name, ": number of points");
+    return;
+  }
+
+  QVector<QString> names = {"x", "y", "z"};
+  if (has_gps_time(format)) names << "gps_time";
+  names << "intensity"
+        << "return_number"
+        << "number_of_returns"
+        << "classification";
+  if (has_colors(format))
+    names << "red"
+          << "green"
+          << "blue";
+  check(pointcloud.user_data_names == names, name, ": properties");
+
+  // the center of the bounding box
+  const glm::dvec3 origin = glm::dvec3(-0.05, 14.985, -0.4995) + offset;
+  check(glm::all(glm::epsilonEqual(pointcloud.origin, glm::round(origin),
+                                   1.e-9)),
+        name, ": origin");
+
+  bool coordinates_equal = true, fields_equal = true, colors_equal = true;
+  for (size_t i = 0; i < num_points; ++i) {
+    const glm::dvec3 coordinate =
+        glm::dvec3(scaled_coordinate_of(i)) * scale + offset -
+        pointcloud.origin;
+    const glm::dvec3 property(value_of(pointcloud, i, "x"),
+                              value_of(pointcloud, i, "y"),
+                              value_of(pointcloud, i, "z"));
+    coordinates_equal &=
+        glm::all(glm::epsilonEqual(property, coordinate, 1.e-6)) &&
+        glm::all(glm::epsilonEqual(pointcloud.vertex(i).coordinate,
+                                   glm::vec3(coordinate), 1.e-3f));
+
+    fields_equal &=
+        value_of(pointcloud, i, "intensity") == intensity_of(i) &&
+        value_of(pointcloud, i, "return_number") == return_number_of(i) &&
+        value_of(pointcloud, i, "number_of_returns") ==
+            number_of_returns_of(i) &&
+        value_of(pointcloud, i, "classification") ==
+            classification_of(i, format) &&
+        (!has_gps_time(format) ||
+         value_of(pointcloud, i, "gps_time") == gps_time_of(i));
+
+    const glm::u8vec3 color =
+        has_colors(format) ? color_of(i) : glm::u8vec3(255);
+    colors_equal &= pointcloud.vertex(i).color == color;
+    if (has_colors(format))
+      colors_equal &= value_of(pointcloud, i, "red") == color.r &&
+                      value_of(pointcloud, i, "green") == color.g &&
+                      value_of(pointcloud, i, "blue") == color.b;
+  }
+  check(coordinates_equal, name, ": coordinates");
+  check(fields_equal, name, ": fields of the records");
+  check(colors_equal, name, ": colors");
+}
+
+void test_invalid_files() {
+  PointCloud pointcloud;
+
+  fixture_t truncated;
+  truncated.point_format = 3;
+  truncated.bytes_missing = 10;
+  check(import_file(truncated, &pointcloud) ==
+            AbstractPointCloudImporter::INVALID_FILE,
+        "truncated file rejected");
+
+  fixture_t compressed;
+  compressed.compressed = true;
+  check(import_file(compressed, &pointcloud) ==
+            AbstractPointCloudImporter::INVALID_FILE,
+        "compressed file rejected");
+
+  fixture_t short_records;
+  short_records.extra_bytes = -1;
+  check(import_file(short_records, &pointcloud) ==
+            AbstractPointCloudImporter::INVALID_FILE,
+        "records shorter than the format rejected");
+}
+
+}  // namespace
+
+int main() {
+  for (int format = 0; format <= 10; ++format) {
+    fixture_t fixture;
+    fixture.point_format = format;
+    // the extended formats of version 1.4 only have the 64 bit point count
+    fixture.legacy_point_count = !is_extended(format);
+    // records longer than the format needs (extra bytes)
+    fixture.extra_bytes = format % 2 == 0 ? 3 : 0;
+    test_point_format(fixture);
+  }
+
+  for (int format : {2, 7}) {
+    fixture_t fixture;
+    fixture.point_format = format;
+    fixture.eight_bit_colors = true;
+    test_point_format(fixture);
+  }
+
+  test_invalid_files();
+
+  std::remove(filename);
+
+  return exit_code();
+}
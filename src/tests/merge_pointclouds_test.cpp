@@ -0,0 +1,135 @@
+#include <pointcloud/importer/merge_pointclouds.hpp>
+#include <tests/check.hpp>
+
+#include <vector>
+
+/*
+Merges three tiles (one of them empty) with different origins and properties
+and checks the coordinates, the union of the properties and the tile ids of
+the merged pointcloud.
+
+Returns 1, if a check fails.
+*/
+
+namespace {
+
+// A tile with the given points and the values of their properties, which are
+// converted to the types of the properties
+PointCloud tile(glm::dvec3 origin, const std::vector<glm::vec3>& coordinates,
+                QVector<QString> names,
+                QVector<data_type::base_type_t> types,
+                const std::vector<std::vector<float>>& values) {
+  PointCloud pointcloud;
+
+  QVector<size_t> offsets;
+  size_t stride = 0;
+  for (data_type::base_type_t type : types) {
+    offsets << stride;
+    stride += data_type::size_of_type(type);
+  }
+  pointcloud.set_user_data_format(stride, names, offsets, types);
+  pointcloud.resize(coordinates.size());
+  pointcloud.origin = origin;
+  pointcloud.aabb = aabb_t::invalid();
+
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(
+      pointcloud.coordinate_color.data());
+  for (size_t i = 0; i < coordinates.size(); ++i) {
+    vertices[i] = PointCloud::vertex_t();
+    vertices[i].coordinate = coordinates[i];
+    vertices[i].color = glm::u8vec3(uint8_t(i));
+    pointcloud.aabb |= coordinates[i];
+
+    for (int j = 0; j < types.length(); ++j)
+      data_type::write_value_to_buffer<float>(
+          types[j],
+          pointcloud.user_data.data() + i * stride + offsets[j],
+          values[i][size_t(j)]);
+  }
+
+  return pointcloud;
+}
+
+// The stored value of the property of the point
+double value_of(const PointCloud& pointcloud, size_t point,
+                const QString& name) {
+  const PointCloud::UserData data = pointcloud.all_values_of_point(point);
+  return data.values[data.names.indexOf(name)].toDouble();
+}
+
+void test_merge() {
+  typedef data_type::base_type_t type_t;
+
+  std::vector<PointCloud> tiles;
+  tiles.push_back(tile(glm::dvec3(1000., 0., 0.),
+                       {glm::vec3(1.f, 2.f, 3.f), glm::vec3(4.f, 5.f, 6.f)},
+                       {"x", "intensity"}, {type_t::FLOAT32, type_t::UINT16},
+                       {{1.f, 100.f}, {4.f, 200.f}}));
+  tiles.push_back(PointCloud());
+  tiles.push_back(tile(glm::dvec3(1010., 5., 0.),
+                       {glm::vec3(0.5f, 0.f, -1.f)},
+                       {"label", "intensity", "x"},
+                       {type_t::INT32, type_t::FLOAT32, type_t::FLOAT32},
+                       {{7.f, 0.5f, 0.5f}}));
+  tiles[2].coordinates_need_remapping = true;
+
+  const PointCloud merged = merge_pointclouds(&tiles);
+
+  check(merged.num_points == 3, "number of points");
+  check(merged.origin == glm::dvec3(1000., 0., 0.), "origin of the first tile");
+  check(merged.coordinates_need_remapping, "remapping needed by a tile");
+  check(tiles[0].num_points == 0 && tiles[2].num_points == 0,
+        "tiles cleared");
+
+  // properties with different types become float64
+  check(merged.user_data_names ==
+            QVector<QString>({"x", "intensity", "label", "tile_id"}),
+        "union of the properties");
+  check(merged.user_data_types ==
+            QVector<type_t>({type_t::FLOAT32, type_t::FLOAT64, type_t::INT32,
+                             type_t::UINT32}),
+        "types of the properties");
+
+  // the last tile is moved to the origin of the first one
+  check(merged.vertex(0).coordinate == glm::vec3(1.f, 2.f, 3.f) &&
+            merged.vertex(1).coordinate == glm::vec3(4.f, 5.f, 6.f) &&
+            merged.vertex(2).coordinate == glm::vec3(10.5f, 5.f, -1.f),
+        "coordinates moved to the common origin");
+  check(merged.vertex(1).color == glm::u8vec3(1) &&
+            merged.vertex(2).color == glm::u8vec3(0),
+        "colors");
+  check(merged.aabb.min_point == glm::vec3(1.f, 2.f, -1.f) &&
+            merged.aabb.max_point == glm::vec3(10.5f, 5.f, 6.f),
+        "aabb of the tiles");
+
+  check(value_of(merged, 0, "x") == 1. && value_of(merged, 2, "x") == 10.5,
+        "coordinate property moved to the common origin");
+  check(value_of(merged, 1, "intensity") == 200. &&
+            value_of(merged, 2, "intensity") == 0.5,
+        "values of a property with different types");
+  check(value_of(merged, 0, "label") == 0. &&
+            value_of(merged, 2, "label") == 7.,
+        "missing property is zero");
+  check(value_of(merged, 0, "tile_id") == 0. &&
+            value_of(merged, 1, "tile_id") == 0. &&
+            value_of(merged, 2, "tile_id") == 2.,
+        "tile ids");
+}
+
+void test_only_empty_tiles() {
+  std::vector<PointCloud> tiles(2);
+  const PointCloud merged = merge_pointclouds(&tiles, "source");
+
+  check(merged.num_points == 0, "no points of empty tiles");
+  check(merged.user_data_names == QVector<QString>({"source"}),
+        "tile id property of empty tiles");
+}
+
+}  // namespace
+
+int main() {
+  test_merge();
+  test_only_empty_tiles();
+
+  return exit_code();
+}
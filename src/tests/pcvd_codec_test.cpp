@@ -0,0 +1,166 @@
+#include <pointcloud/pcvd_codec.hpp>
+#include <tests/check.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+/*
+Round trips blocks through the pcvd codec: the decoded coordinates are within
+half a quantization step of the original ones, everything else is lossless
+and typical blocks compress to well below their raw size.
+
+Returns 1, if a check fails.
+*/
+
+namespace {
+
+// A scanned surface of 20 m x 20 m with some height, colored by height. The
+// points are sorted along the Morton order like the exporter does.
+std::vector<PointCloud::vertex_t> scanned_surface(size_t num_points) {
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> distribution(0.f, 20.f);
+
+  PointCloud pointcloud;
+  pointcloud.resize(num_points);
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(
+      pointcloud.coordinate_color.data());
+  for (size_t i = 0; i < num_points; ++i) {
+    const float x = distribution(generator);
+    const float y = distribution(generator);
+    const float z = 2.f * std::sin(x * 0.3f) * std::cos(y * 0.2f);
+
+    vertices[i] = PointCloud::vertex_t();
+    vertices[i].coordinate = glm::vec3(1000.f + x, 2000.f + y, 100.f + z);
+    vertices[i].color = glm::u8vec3(uint8_t(64.f * (z + 2.f)));
+  }
+
+  std::vector<size_t> order(num_points);
+  for (size_t i = 0; i < num_points; ++i) order[i] = i;
+  pcvd_codec::sort_by_morton_code(pointcloud, order.data(),
+                                  order.data() + num_points);
+
+  std::vector<PointCloud::vertex_t> sorted(num_points);
+  for (size_t i = 0; i < num_points; ++i) sorted[i] = vertices[order[i]];
+  return sorted;
+}
+
+void test_vertices() {
+  const size_t num_points = pcvd_codec::points_per_block();
+  const float step = 0.001f;  // a millimeter
+  const std::vector<PointCloud::vertex_t> vertices =
+      scanned_surface(num_points);
+
+  std::vector<uint8_t> block;
+  pcvd_codec::encode_vertices(vertices.data(), num_points, step, &block);
+  std::vector<PointCloud::vertex_t> decoded(num_points);
+  pcvd_codec::decode_vertices(block.data(), block.size(), decoded.data(),
+                              num_points);
+
+  // half a step plus rounding the decoded coordinates to floats
+  float max_error = 0.f;
+  bool colors_equal = true;
+  for (size_t i = 0; i < num_points; ++i) {
+    const glm::vec3 error =
+        glm::abs(decoded[i].coordinate - vertices[i].coordinate);
+    max_error =
+        glm::max(max_error, glm::max(error.x, glm::max(error.y, error.z)));
+    colors_equal = colors_equal && decoded[i].color == vertices[i].color;
+  }
+  const float rounding = 2020.f * std::numeric_limits<float>::epsilon();
+  check(max_error <= 0.5f * step + rounding,
+        "decoded coordinates within half a step");
+  check(colors_equal, "decoded colors");
+
+  const double ratio =
+      double(block.size()) / double(num_points * PointCloud::stride);
+  println("vertices: max error ", max_error, ", compressed to ", ratio);
+  check(ratio < 0.6, "vertices compressed to less than 60%");
+
+  // blocks with nan coordinates are stored raw
+  std::vector<PointCloud::vertex_t> with_nan(vertices.begin(),
+                                             vertices.begin() + 100);
+  with_nan[50].coordinate.y = std::numeric_limits<float>::quiet_NaN();
+  pcvd_codec::encode_vertices(with_nan.data(), with_nan.size(), step, &block);
+  pcvd_codec::decode_vertices(block.data(), block.size(), decoded.data(),
+                              with_nan.size());
+  check(std::memcmp(with_nan.data(), decoded.data(),
+                    with_nan.size() * PointCloud::stride) == 0,
+        "raw block with nan coordinates");
+
+  // truncated blocks are corrupt
+  pcvd_codec::encode_vertices(vertices.data(), num_points, step, &block);
+  bool threw = false;
+  try {
+    pcvd_codec::decode_vertices(block.data(), block.size() / 2,
+                                decoded.data(), num_points);
+  } catch (QString) {
+    threw = true;
+  }
+  check(threw, "truncated block throws");
+}
+
+void test_values() {
+  const size_t num_points = pcvd_codec::points_per_block();
+
+  // a slowly changing intensity and a label
+  std::vector<uint16_t> intensities(num_points);
+  std::vector<int32_t> labels(num_points);
+  for (size_t i = 0; i < num_points; ++i) {
+    intensities[i] = uint16_t(30000 + 20000 * std::sin(double(i) * 1.e-3));
+    labels[i] = int32_t(i / 1000) - 10;
+  }
+
+  std::vector<uint8_t> block;
+  std::vector<uint16_t> decoded_intensities(num_points);
+  pcvd_codec::encode_values(
+      data_type::BASE_TYPE::UINT16,
+      reinterpret_cast<const uint8_t*>(intensities.data()), num_points,
+      &block);
+  pcvd_codec::decode_values(
+      data_type::BASE_TYPE::UINT16, block.data(), block.size(),
+      reinterpret_cast<uint8_t*>(decoded_intensities.data()), num_points);
+  check(decoded_intensities == intensities, "decoded uint16 values");
+  check(block.size() < num_points * sizeof(uint16_t) * 6 / 10,
+        "uint16 values compressed to less than 60%");
+
+  std::vector<int32_t> decoded_labels(num_points);
+  pcvd_codec::encode_values(data_type::BASE_TYPE::INT32,
+                            reinterpret_cast<const uint8_t*>(labels.data()),
+                            num_points, &block);
+  pcvd_codec::decode_values(
+      data_type::BASE_TYPE::INT32, block.data(), block.size(),
+      reinterpret_cast<uint8_t*>(decoded_labels.data()), num_points);
+  check(decoded_labels == labels, "decoded int32 values");
+  check(block.size() < num_points * sizeof(int32_t) / 3,
+        "int32 labels compressed to less than a third");
+
+  // kd tree indices are a permutation of the points
+  std::vector<uint64_t> indices(num_points);
+  for (size_t i = 0; i < num_points; ++i)
+    indices[i] = uint64_t((i * 40503) % num_points);
+  std::vector<uint64_t> decoded_indices(num_points);
+  pcvd_codec::encode_indices(indices.data(), num_points, &block);
+  pcvd_codec::decode_indices(block.data(), block.size(),
+                             decoded_indices.data(), num_points);
+  check(decoded_indices == indices, "decoded indices");
+}
+
+void test_morton_code() {
+  const glm::uvec3 cell(0x1fffff, 12345, 0);
+  check(pcvd_codec::cell_of_morton_code(pcvd_codec::morton_code(cell)) ==
+            cell,
+        "morton code round trip");
+}
+
+}  // namespace
+
+int main() {
+  test_morton_code();
+  test_vertices();
+  test_values();
+
+  return exit_code();
+}
@@ -0,0 +1,300 @@
+#include <pointcloud/exporter/pcvd_exporter.hpp>
+#include <pointcloud/importer/pcvd_importer.hpp>
+#include <pointcloud/pcvd_file_format.hpp>
+#include <tests/check.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+Exports a pointcloud to pcvd files without and with a table of contents
+(optionally compressed) and imports them again: the points, their properties
+and the origin survive the round trip, the kd tree of the file finds the same
+points as a brute force search over the imported coordinates, the region of
+interest is applied and corrupt files are rejected by their checksums.
+
+Returns 1, if a check fails.
+*/
+
+namespace {
+
+const char* const filename = "pcvd_round_trip_test.pcvd";
+
+const size_t num_points = 200000;
+// Not a multiple of 4, so the values are unaligned within the records
+const size_t user_data_stride = 15;
+const float coordinate_step = 0.001f;
+
+// Points on a 100 m x 100 m terrain with a unique id, a timestamp, an
+// intensity and the number of the return as properties
+PointCloud terrain(glm::dvec3 origin) {
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<float> distribution(0.f, 100.f);
+  std::uniform_int_distribution<int> byte(0, 255);
+
+  PointCloud pointcloud;
+  pointcloud.set_user_data_format(
+      user_data_stride, {"id", "gps_time", "intensity", "return"},
+      {0, 4, 12, 14},
+      {data_type::base_type_t::UINT32, data_type::base_type_t::FLOAT64,
+       data_type::base_type_t::UINT16, data_type::base_type_t::INT8});
+  pointcloud.resize(num_points);
+  pointcloud.origin = origin;
+
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(
+      pointcloud.coordinate_color.data());
+  for (size_t i = 0; i < num_points; ++i) {
+    const float x = distribution(generator);
+    const float y = distribution(generator);
+    const float z = 5.f * std::sin(x * 0.1f) + 0.01f * distribution(generator);
+
+    vertices[i] = PointCloud::vertex_t();
+    vertices[i].coordinate = glm::vec3(x, y, z);
+    vertices[i].color =
+        glm::u8vec3(byte(generator), byte(generator), byte(generator));
+
+    uint8_t* record = pointcloud.user_data.data() + i * user_data_stride;
+    const uint32_t id = uint32_t(i);
+    const float64_t gps_time = 1.e5 + double(i) * 1.e-5;
+    const uint16_t intensity = uint16_t(byte(generator) * 200);
+    const int8_t return_number = int8_t(1 + i % 3);
+    std::memcpy(record, &id, sizeof(id));
+    std::memcpy(record + 4, &gps_time, sizeof(gps_time));
+    std::memcpy(record + 12, &intensity, sizeof(intensity));
+    std::memcpy(record + 14, &return_number, sizeof(return_number));
+  }
+
+  pointcloud.aabb.min_point = glm::vec3(std::numeric_limits<float>::max());
+  pointcloud.aabb.max_point = glm::vec3(-std::numeric_limits<float>::max());
+  for (size_t i = 0; i < num_points; ++i)
+    pointcloud.aabb |= vertices[i].coordinate;
+
+  pointcloud.build_kd_tree([](size_t, size_t) { return true; });
+  return pointcloud;
+}
+
+uint32_t id_of_point(const PointCloud& pointcloud, size_t point) {
+  uint32_t id;
+  std::memcpy(&id, pointcloud.user_data.data() + point * user_data_stride,
+              sizeof(id));
+  return id;
+}
+
+bool export_file(const PointCloud& pointcloud, bool column_sections,
+                 bool compress) {
+  PcvdExporter exporter(filename, pointcloud);
+  exporter.column_sections = column_sections;
+  exporter.spatial_chunks = column_sections;
+  exporter.compress = compress;
+  exporter.coordinate_step = coordinate_step;
+  exporter.export_now();
+  return exporter.state == AbstractPointCloudExporter::SUCCEEDED;
+}
+
+// Returns an empty pointcloud, if the import failed
+PointCloud import_file(const aabb_t* region_of_interest = nullptr) {
+  PcvdImporter importer(filename);
+  if (region_of_interest != nullptr) {
+    importer.use_region_of_interest = true;
+    importer.region_of_interest = *region_of_interest;
+  }
+  importer.import();
+
+  if (importer.state != AbstractPointCloudImporter::SUCCEEDED)
+    return PointCloud();
+  importer.pointcloud.load_all_user_data_columns();
+  return std::move(importer.pointcloud);
+}
+
+// The points may be reordered (by the spatial chunks and the Morton order of
+// compressed blocks), so they're matched by their id
+void check_points(const PointCloud& original, const PointCloud& imported,
+                  float max_coordinate_error) {
+  check(imported.num_points == original.num_points, "number of points");
+  check(imported.origin == original.origin, "origin");
+  check(imported.user_data_stride == original.user_data_stride &&
+            imported.user_data_names == original.user_data_names &&
+            imported.user_data_offset == original.user_data_offset &&
+            imported.user_data_types == original.user_data_types,
+        "property format");
+  if (imported.num_points != original.num_points ||
+      imported.user_data_stride != original.user_data_stride)
+    return;
+
+  std::vector<bool> found(num_points, false);
+  bool ids_unique = true;
+  bool coordinates_equal = true;
+  bool colors_equal = true;
+  bool properties_equal = true;
+  for (size_t i = 0; i < imported.num_points; ++i) {
+    const uint32_t id = id_of_point(imported, i);
+    if (id >= num_points || found[id]) {
+      ids_unique = false;
+      continue;
+    }
+    found[id] = true;
+
+    const PointCloud::vertex_t a = original.vertex(id);
+    const PointCloud::vertex_t b = imported.vertex(i);
+    const glm::vec3 error = glm::abs(a.coordinate - b.coordinate);
+    coordinates_equal = coordinates_equal &&
+                        error.x <= max_coordinate_error &&
+                        error.y <= max_coordinate_error &&
+                        error.z <= max_coordinate_error;
+    colors_equal = colors_equal && a.color == b.color;
+    properties_equal =
+        properties_equal &&
+        std::memcmp(original.user_data.data() + id * user_data_stride,
+                    imported.user_data.data() + i * user_data_stride,
+                    user_data_stride) == 0;
+  }
+  check(ids_unique, "every point imported once");
+  check(coordinates_equal, "coordinates");
+  check(colors_equal, "colors");
+  check(properties_equal, "properties");
+}
+
+// Compares the points found by the kd tree in random boxes with a brute force
+// search over the imported coordinates
+void check_kd_tree(const PointCloud& imported) {
+  check(imported.has_build_kdtree(), "kd tree imported");
+  if (!imported.has_build_kdtree()) return;
+
+  std::mt19937 generator(5);
+  std::uniform_real_distribution<float> distribution(-1.f, 101.f);
+
+  bool same_points = true;
+  for (int i = 0; i < 20; ++i) {
+    const glm::vec3 a(distribution(generator), distribution(generator), -10.f);
+    const glm::vec3 b(distribution(generator), distribution(generator),
+                      distribution(generator) * 0.1f - 5.f);
+    aabb_t region;
+    region.min_point = glm::min(a, b);
+    region.max_point = glm::max(a, b);
+
+    std::vector<size_t> found;
+    imported.kdtree_index.visit_points_in_region(
+        region, imported.coordinate_color.data(), PointCloud::stride,
+        [&found](const KDTreeIndex::point_index_t* begin,
+                 const KDTreeIndex::point_index_t* end) {
+          for (; begin != end; ++begin) found.push_back(size_t(*begin));
+        });
+    std::sort(found.begin(), found.end());
+
+    std::vector<size_t> expected;
+    for (size_t j = 0; j < imported.num_points; ++j) {
+      const glm::vec3 coordinate = imported.vertex(j).coordinate;
+      if (glm::all(glm::greaterThanEqual(coordinate, region.min_point)) &&
+          glm::all(glm::lessThanEqual(coordinate, region.max_point)))
+        expected.push_back(j);
+    }
+
+    same_points = same_points && found == expected;
+  }
+  check(same_points, "kd tree finds the points of the brute force search");
+}
+
+// Flips a byte in the middle of the vertex data, which the checksum of its
+// section must detect
+void corrupt_vertex_data() {
+  std::fstream file(filename,
+                    std::ios_base::in | std::ios_base::out |
+                        std::ios_base::binary);
+
+  pcvd_format::header_t header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  file.seekg(std::streamoff(sizeof(header) +
+                            header.number_fields *
+                                sizeof(pcvd_format::field_description_t) +
+                            header.field_names_total_size));
+
+  pcvd_format::table_of_contents_t table_of_contents;
+  file.read(reinterpret_cast<char*>(&table_of_contents),
+            sizeof(table_of_contents));
+  std::vector<pcvd_format::section_t> sections(
+      table_of_contents.number_sections);
+  file.read(reinterpret_cast<char*>(sections.data()),
+            std::streamsize(sections.size() * sizeof(pcvd_format::section_t)));
+
+  for (const pcvd_format::section_t& section : sections) {
+    if (section.type != pcvd_format::section_type_t::VERTEX_DATA) continue;
+
+    const std::streamoff offset =
+        std::streamoff(section.offset + section.size / 2);
+    char byte = 0;
+    file.seekg(offset);
+    file.read(&byte, 1);
+    byte = char(~byte);
+    file.seekp(offset);
+    file.write(&byte, 1);
+  }
+}
+
+void test_without_table_of_contents() {
+  const PointCloud original = terrain(glm::dvec3(0));
+  check(export_file(original, false, false), "export without contents");
+  const PointCloud imported = import_file();
+
+  check_points(original, imported, 0.f);
+  check_kd_tree(imported);
+}
+
+void test_with_table_of_contents() {
+  const PointCloud original = terrain(glm::dvec3(4.e5, 5.e6, 300.));
+  check(export_file(original, true, false), "export with contents");
+  const PointCloud imported = import_file();
+
+  check_points(original, imported, 0.f);
+  check_kd_tree(imported);
+
+  // the spatial chunks outside the region are skipped
+  aabb_t region;
+  region.min_point = glm::vec3(10.f, 20.f, -10.f);
+  region.max_point = glm::vec3(40.f, 30.f, 10.f);
+  const PointCloud inside = import_file(&region);
+  size_t num_points_inside = 0;
+  for (size_t i = 0; i < original.num_points; ++i) {
+    const glm::vec3 coordinate = original.vertex(i).coordinate;
+    if (glm::all(glm::greaterThanEqual(coordinate, region.min_point)) &&
+        glm::all(glm::lessThanEqual(coordinate, region.max_point)))
+      ++num_points_inside;
+  }
+  check(inside.num_points == num_points_inside,
+        "points inside the region of interest");
+
+  corrupt_vertex_data();
+  check(import_file().num_points == 0, "corrupt file rejected");
+}
+
+void test_compressed() {
+  const PointCloud original = terrain(glm::dvec3(4.e5, 5.e6, 300.));
+  check(export_file(original, true, true), "export compressed");
+  const PointCloud imported = import_file();
+
+  // half a step plus rounding the decoded coordinates to floats
+  const float rounding = 200.f * std::numeric_limits<float>::epsilon();
+  check_points(original, imported, 0.5f * coordinate_step + rounding);
+  check_kd_tree(imported);
+
+  corrupt_vertex_data();
+  check(import_file().num_points == 0, "corrupt compressed file rejected");
+}
+
+}  // namespace
+
+int main() {
+  test_without_table_of_contents();
+  test_with_table_of_contents();
+  test_compressed();
+
+  std::remove(filename);
+
+  return exit_code();
+}
@@ -0,0 +1,158 @@
+#include <pointcloud/exporter/ply_exporter.hpp>
+#include <pointcloud/importer/ply_importer.hpp>
+#include <tests/check.hpp>
+
+#include <QtGlobal>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+/*
+Exports pointclouds to binary ply files and imports them again. The user data
+of the first one has the layout of the records, so it's written as it is. The
+second one has padded user data in a different order and an origin, so the
+records are packed and the origin is added to the coordinate properties.
+
+Returns 1, if a check fails.
+*/
+
+namespace {
+
+const char* const filename = "ply_exporter_test.ply";
+
+// More than one chunk of a megabyte
+const size_t num_points = 70000;
+// float x, y, z, uchar red, green, blue, ushort intensity, int label
+const size_t record_size = 21;
+const QVector<size_t> record_offsets = {0, 4, 8, 12, 13, 14, 15, 17};
+
+glm::vec3 coordinate_of(size_t i) {
+  return glm::vec3(float(i % 1000) * 0.5f, float(i / 1000),
+                   -float(i % 7) * 0.125f);
+}
+
+glm::u8vec3 color_of(size_t i) {
+  return glm::u8vec3(uint8_t(i), uint8_t(i * 7), uint8_t(255 - i % 256));
+}
+
+// The record of the point in the byte order of the machine with the offset
+// added to the coordinates
+std::string record_of(size_t i, glm::vec3 offset) {
+  const glm::vec3 coordinate = coordinate_of(i) + offset;
+  const glm::u8vec3 color = color_of(i);
+  const uint16_t intensity = uint16_t(i * 3);
+  const int32_t label = int32_t(i) - 35000;
+
+  std::string record(record_size, '\0');
+  std::memcpy(&record[0], &coordinate, sizeof(coordinate));
+  std::memcpy(&record[12], &color, sizeof(color));
+  std::memcpy(&record[15], &intensity, sizeof(intensity));
+  std::memcpy(&record[17], &label, sizeof(label));
+  return record;
+}
+
+// A pointcloud with the properties of the records stored at the given offsets
+PointCloud pointcloud_of(glm::dvec3 origin, size_t stride,
+                         QVector<size_t> offsets) {
+  typedef data_type::base_type_t type_t;
+  const QVector<type_t> types = {type_t::FLOAT32, type_t::FLOAT32,
+                                 type_t::FLOAT32, type_t::UINT8,
+                                 type_t::UINT8,   type_t::UINT8,
+                                 type_t::UINT16,  type_t::INT32};
+
+  PointCloud pointcloud;
+  pointcloud.set_user_data_format(
+      stride,
+      {"x", "y", "z", "red", "green", "blue", "intensity", "label"}, offsets,
+      types);
+  pointcloud.resize(num_points);
+  pointcloud.user_data.memset(0);
+  pointcloud.origin = origin;
+  pointcloud.aabb = aabb_t::invalid();
+
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(
+      pointcloud.coordinate_color.data());
+  for (size_t i = 0; i < num_points; ++i) {
+    vertices[i] = PointCloud::vertex_t();
+    vertices[i].coordinate = coordinate_of(i);
+    vertices[i].color = color_of(i);
+    pointcloud.aabb |= vertices[i].coordinate;
+
+    // the coordinate properties are relative to the origin like the
+    // coordinates
+    const std::string record = record_of(i, glm::vec3(0));
+    for (int j = 0; j < types.length(); ++j)
+      std::memcpy(pointcloud.user_data.data() + i * stride + offsets[j],
+                  record.data() + record_offsets[j],
+                  data_type::size_of_type(types[j]));
+  }
+
+  return pointcloud;
+}
+
+size_t size_of_file() {
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  return size_t(file.tellg());
+}
+
+void test_round_trip(const char* name, const PointCloud& original) {
+  PlyExporter exporter(filename, original);
+  exporter.export_now();
+  check(exporter.state == AbstractPointCloudExporter::SUCCEEDED, name,
+        ": export");
+
+  std::ostringstream header;
+  write_ply_header(header, original, num_points,
+                   Q_BYTE_ORDER == Q_BIG_ENDIAN ? "binary_big_endian"
+                                                : "binary_little_endian");
+  check(size_of_file() == header.str().size() + num_points * record_size,
+        name, ": records packed");
+
+  PlyImporter importer(filename);
+  importer.import();
+  check(importer.state == AbstractPointCloudImporter::SUCCEEDED, name,
+        ": import");
+  if (importer.state != AbstractPointCloudImporter::SUCCEEDED) return;
+
+  const PointCloud& imported = importer.pointcloud;
+  check(imported.num_points == num_points, name, ": number of points");
+  check(imported.user_data_names == original.user_data_names &&
+            imported.user_data_types == original.user_data_types &&
+            imported.user_data_stride == record_size &&
+            imported.user_data_offset == record_offsets,
+        name, ": properties");
+
+  // the imported coordinates contain the origin
+  const glm::vec3 origin = glm::vec3(original.origin);
+  bool records_equal = true, coordinates_equal = true, colors_equal = true;
+  for (size_t i = 0; i < imported.num_points; ++i) {
+    const std::string record = record_of(i, origin);
+    records_equal &=
+        std::memcmp(imported.user_data.data() + i * record_size,
+                    record.data(), record_size) == 0;
+
+    const PointCloud::vertex_t vertex = imported.vertex(i);
+    coordinates_equal &= vertex.coordinate == coordinate_of(i) + origin;
+    colors_equal &= vertex.color == color_of(i);
+  }
+  check(records_equal, name, ": records");
+  check(coordinates_equal, name, ": coordinates");
+  check(colors_equal, name, ": colors");
+}
+
+}  // namespace
+
+int main() {
+  test_round_trip("packed", pointcloud_of(glm::dvec3(0), record_size,
+                                          record_offsets));
+  test_round_trip("repacked",
+                  pointcloud_of(glm::dvec3(1000., -2000., 0.25), 24,
+                                {0, 4, 8, 20, 21, 22, 16, 12}));
+
+  std::remove(filename);
+
+  return exit_code();
+}
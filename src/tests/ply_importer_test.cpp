@@ -0,0 +1,156 @@
+#include <pointcloud/importer/ply_importer.hpp>
+#include <tests/check.hpp>
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+/*
+Writes binary little and big endian ply files with unaligned records spanning
+several blocks and imports them with the memory mapped decoder: the user data
+keeps the records (in the byte order of the machine), the coordinates, colors
+and the aabb are decoded and a truncated file is rejected.
+
+Returns 1, if a check fails.
+*/
+
+namespace {
+
+const char* const filename = "ply_importer_test.ply";
+
+// More than one block of 65536 points
+const size_t num_points = 70123;
+// float x, y, z, uchar red, green, blue, ushort intensity, int label
+const size_t stride = 21;
+
+glm::vec3 coordinate_of(size_t i) {
+  return glm::vec3(float(i % 1000) * 0.5f, float(i / 1000),
+                   -float(i % 7) * 0.125f);
+}
+
+glm::u8vec3 color_of(size_t i) {
+  return glm::u8vec3(uint8_t(i), uint8_t(i * 7), uint8_t(255 - i % 256));
+}
+
+uint16_t intensity_of(size_t i) { return uint16_t(i * 3); }
+
+int32_t label_of(size_t i) { return int32_t(i) - 35000; }
+
+template <typename value_type>
+void append(std::string* data, value_type value, bool big_endian) {
+  char bytes[sizeof(value_type)];
+  std::memcpy(bytes, &value, sizeof(value_type));
+  if (big_endian != (Q_BYTE_ORDER == Q_BIG_ENDIAN))
+    std::reverse(bytes, bytes + sizeof(value_type));
+  data->append(bytes, sizeof(value_type));
+}
+
+std::string record_of(size_t i, bool big_endian) {
+  std::string record;
+  const glm::vec3 coordinate = coordinate_of(i);
+  const glm::u8vec3 color = color_of(i);
+  for (int j = 0; j < 3; ++j) append(&record, coordinate[j], big_endian);
+  for (int j = 0; j < 3; ++j) append(&record, color[j], big_endian);
+  append(&record, intensity_of(i), big_endian);
+  append(&record, label_of(i), big_endian);
+  return record;
+}
+
+// Writes the file without the last bytes_missing bytes
+void write_file(bool big_endian, size_t bytes_missing = 0) {
+  const char* const format =
+      big_endian ? "binary_big_endian" : "binary_little_endian";
+  std::string data = std::string("ply\nformat ") + format +
+                     " 1.0\n"
+                     "comment written by ply_importer_test\n"
+                     "element vertex " +
+                     std::to_string(num_points) +
+                     "\n"
+                     "property float x\n"
+                     "property float y\n"
+                     "property float z\n"
+                     "property uchar red\n"
+                     "property uchar green\n"
+                     "property uchar blue\n"
+                     "property ushort intensity\n"
+                     "property int label\n"
+                     "end_header\n";
+  for (size_t i = 0; i < num_points; ++i)
+    data += record_of(i, big_endian);
+  data.resize(data.size() - bytes_missing);
+
+  std::ofstream file(filename, std::ios::binary);
+  file.write(data.data(), std::streamsize(data.size()));
+}
+
+void test_import(bool big_endian) {
+  const char* const format = big_endian ? "big endian" : "little endian";
+  write_file(big_endian);
+
+  PlyImporter importer(filename);
+  importer.import();
+  check(importer.state == AbstractPointCloudImporter::SUCCEEDED, format,
+        ": import");
+  if (importer.state != AbstractPointCloudImporter::SUCCEEDED) return;
+
+  typedef data_type::base_type_t type_t;
+  const PointCloud& pointcloud = importer.pointcloud;
+  check(pointcloud.num_points == num_points, format, ": number of points");
+  check(!pointcloud.coordinates_need_remapping, format,
+        ": coordinates in the file");
+  check(pointcloud.user_data_stride == stride &&
+            pointcloud.user_data_names ==
+                QVector<QString>({"x", "y", "z", "red", "green", "blue",
+                                  "intensity", "label"}) &&
+            pointcloud.user_data_offset ==
+                QVector<size_t>({0, 4, 8, 12, 13, 14, 15, 17}) &&
+            pointcloud.user_data_types ==
+                QVector<type_t>({type_t::FLOAT32, type_t::FLOAT32,
+                                 type_t::FLOAT32, type_t::UINT8, type_t::UINT8,
+                                 type_t::UINT8, type_t::UINT16,
+                                 type_t::INT32}),
+        format, ": properties");
+
+  bool records_equal = true, coordinates_equal = true, colors_equal = true;
+  for (size_t i = 0; i < pointcloud.num_points; ++i) {
+    const std::string record = record_of(i, Q_BYTE_ORDER == Q_BIG_ENDIAN);
+    records_equal &= std::memcmp(pointcloud.user_data.data() + i * stride,
+                                 record.data(), stride) == 0;
+
+    const PointCloud::vertex_t vertex = pointcloud.vertex(i);
+    coordinates_equal &= vertex.coordinate == coordinate_of(i);
+    colors_equal &= vertex.color == color_of(i);
+  }
+  check(records_equal, format, ": user data in the byte order of the machine");
+  check(coordinates_equal, format, ": coordinates");
+  check(colors_equal, format, ": colors");
+
+  check(pointcloud.aabb.min_point == glm::vec3(0.f, 0.f, -0.75f) &&
+            pointcloud.aabb.max_point == glm::vec3(499.5f, 70.f, 0.f),
+        format, ": aabb");
+}
+
+void test_truncated_file() {
+  write_file(false, 5);
+
+  PlyImporter importer(filename);
+  importer.import();
+  check(importer.state == AbstractPointCloudImporter::INVALID_FILE,
+        "truncated file rejected");
+}
+
+}  // namespace
+
+int main() {
+  test_import(false);
+  test_import(true);
+  test_truncated_file();
+
+  std::remove(filename);
+
+  return exit_code();
+}
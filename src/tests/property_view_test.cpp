@@ -0,0 +1,169 @@
+#include <pointcloud/property_view.hpp>
+#include <tests/check.hpp>
+
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+/*
+Reads unaligned columns of all property types through typed views, also while
+some of them are still pending, and compares them with the written values,
+the values converted by the runtime type dispatch, the values of a point, the
+views of blocks and of a subset.
+
+Returns 1, if a check fails.
+*/
+
+namespace {
+
+typedef data_type::base_type_t type_t;
+typedef PointCloud::point_range_t point_range_t;
+
+const size_t num_points = 5000;
+
+// Packed, so most values are unaligned
+const QVector<type_t> types = {type_t::INT8,  type_t::UINT16, type_t::FLOAT64,
+                               type_t::INT16, type_t::UINT8,  type_t::FLOAT32,
+                               type_t::INT32, type_t::UINT32};
+const QVector<size_t> offsets = {0, 1, 3, 11, 13, 14, 18, 22};
+const size_t stride = 26;
+
+// Not loaded into the user data yet
+const std::vector<int> pending_properties = {2, 6};
+
+// The extremes of the type followed by values covering its range
+template <typename T>
+T value_of(size_t point) {
+  if (point == 0) return std::numeric_limits<T>::lowest();
+  if (point == 1) return std::numeric_limits<T>::max();
+
+  if constexpr (std::is_floating_point<T>::value)
+    return T(double(point) * 0.375 - 1000.);
+  else
+    return T(uint64_t(point) * 2654435761u);
+}
+
+bool is_pending(int property) {
+  for (int pending_property : pending_properties)
+    if (property == pending_property) return true;
+  return false;
+}
+
+PointCloud test_pointcloud() {
+  PointCloud pointcloud;
+  pointcloud.set_user_data_format(
+      stride, {"a", "b", "c", "d", "e", "f", "g", "h"}, offsets, types);
+  pointcloud.resize(num_points);
+  pointcloud.user_data.memset(0);
+  pointcloud.pending_user_data_columns.resize(size_t(types.length()));
+
+  for (int property = 0; property < types.length(); ++property) {
+    visit_property_type(types[property], [&](auto type_value) {
+      typedef decltype(type_value) value_t;
+
+      uint8_t* first_value = pointcloud.user_data.data() + offsets[property];
+      size_t value_stride = stride;
+      if (is_pending(property)) {
+        Buffer& column =
+            pointcloud.pending_user_data_columns[size_t(property)];
+        column.resize(num_points * sizeof(value_t));
+        first_value = column.data();
+        value_stride = sizeof(value_t);
+      }
+
+      for (size_t i = 0; i < num_points; ++i)
+        write_value_to_buffer(first_value + i * value_stride,
+                              value_of<value_t>(i));
+    });
+  }
+
+  return pointcloud;
+}
+
+void test_types() {
+  bool types_equal = true;
+  for (type_t type : types)
+    visit_property_type(type, [&](auto type_value) {
+      types_equal &=
+          data_type::base_type_of<decltype(type_value)>::value() == type;
+    });
+  check(types_equal, "types visited");
+}
+
+// The point i of the pointcloud has the written values of points[i]
+void check_values(const PointCloud& pointcloud, const char* name,
+                  const std::vector<size_t>& points) {
+  for (int property = 0; property < types.length(); ++property) {
+    bool values_equal = true, blocks_equal = true, point_values_equal = true;
+
+    visit_property(pointcloud, property, [&](auto view) {
+      typedef typename decltype(view)::value_type value_t;
+      values_equal &= view.size() == points.size();
+
+      for (size_t i = 0; values_equal && i < points.size(); ++i)
+        values_equal = view[i] == value_of<value_t>(points[i]);
+
+      const size_t first_point = points.size() / 3;
+      const auto block = view.block(first_point, points.size() / 2);
+      for (size_t i = 0; i < block.size(); ++i)
+        blocks_equal &= block[i] == view[first_point + i];
+
+      for (size_t i = 0; i < points.size(); i += 97)
+        point_values_equal &=
+            pointcloud.all_values_of_point(i).values[property].toDouble() ==
+            double(value_of<value_t>(points[i]));
+    });
+
+    check(values_equal, name, ": values of property ", property);
+    check(blocks_equal, name, ": block of property ", property);
+    check(point_values_equal, name, ": values of the points of property ",
+          property);
+  }
+}
+
+// The typed views read the same values as the runtime type dispatch
+void test_runtime_dispatch(const PointCloud& pointcloud) {
+  for (int property = 0; property < types.length(); ++property) {
+    if (is_pending(property)) continue;
+
+    bool values_equal = true;
+    visit_property(pointcloud, property, [&](auto view) {
+      const uint8_t* first_value =
+          pointcloud.user_data.data() + offsets[property];
+      for (size_t i = 0; i < num_points; ++i)
+        values_equal &= double(view[i]) ==
+                        data_type::read_value_from_buffer<double>(
+                            types[property], first_value + i * stride);
+    });
+    check(values_equal, "runtime dispatch of property ", property);
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::vector<size_t> all_points(num_points);
+  for (size_t i = 0; i < num_points; ++i) all_points[i] = i;
+
+  test_types();
+
+  PointCloud pointcloud = test_pointcloud();
+  check_values(pointcloud, "pending", all_points);
+  test_runtime_dispatch(pointcloud);
+
+  // the subset gathers the pending columns
+  const std::vector<point_range_t> ranges = {
+      {0, 10}, {100, 1100}, {4990, 5000}};
+  std::vector<size_t> subset_points;
+  for (const point_range_t& range : ranges)
+    for (size_t i = range.begin; i < range.end; ++i) subset_points.push_back(i);
+  check_values(pointcloud.subset(ranges), "subset", subset_points);
+
+  pointcloud.load_all_user_data_columns();
+  check(!pointcloud.is_user_data_column_pending(pending_properties[0]) &&
+            !pointcloud.is_user_data_column_pending(pending_properties[1]),
+        "columns loaded");
+  check_values(pointcloud, "loaded", all_points);
+
+  return exit_code();
+}
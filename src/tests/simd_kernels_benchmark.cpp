@@ -0,0 +1,318 @@
+#include <core_library/print.hpp>
+#include <core_library/simd_kernels.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+Benchmarks every simd kernel with each instruction set supported by the cpu
+and checks, that convert and masked_fill write the same bytes as the scalar
+kernels.
+
+Usage: simd_kernels_benchmark [number of points]
+
+Returns 1, if a kernel differs from the scalar one.
+*/
+
+namespace {
+
+using simd::instruction_set_t;
+using simd::kernels_t;
+using simd::value_type_t;
+
+const instruction_set_t all_instruction_sets[] = {
+    instruction_set_t::SCALAR, instruction_set_t::SSE4,
+    instruction_set_t::AVX2, instruction_set_t::AVX512};
+
+const value_type_t all_value_types[] = {
+    value_type_t::INT8,   value_type_t::INT16,   value_type_t::INT32,
+    value_type_t::UINT8,  value_type_t::UINT16,  value_type_t::UINT32,
+    value_type_t::FLOAT32, value_type_t::FLOAT64};
+
+// Number of values compared with the scalar kernels. Not a multiple of any
+// vector size, so the remainder loops are checked, too.
+const size_t num_checked_values = 4099;
+
+const int repetitions = 5;
+
+size_t size_of(value_type_t type) {
+  switch (type) {
+    case value_type_t::INT8:
+    case value_type_t::UINT8:
+      return 1;
+    case value_type_t::INT16:
+    case value_type_t::UINT16:
+      return 2;
+    case value_type_t::INT32:
+    case value_type_t::UINT32:
+    case value_type_t::FLOAT32:
+      return 4;
+    case value_type_t::FLOAT64:
+      return 8;
+  }
+  return 0;
+}
+
+const char* name_of(value_type_t type) {
+  switch (type) {
+    case value_type_t::INT8:
+      return "int8";
+    case value_type_t::INT16:
+      return "int16";
+    case value_type_t::INT32:
+      return "int32";
+    case value_type_t::UINT8:
+      return "uint8";
+    case value_type_t::UINT16:
+      return "uint16";
+    case value_type_t::UINT32:
+      return "uint32";
+    case value_type_t::FLOAT32:
+      return "float32";
+    case value_type_t::FLOAT64:
+      return "float64";
+  }
+  return "";
+}
+
+// Random bytes, so the floating point values include nan, inf and denormals
+std::vector<uint8_t> random_bytes(size_t size, uint32_t seed) {
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<int> distribution(0, 255);
+
+  std::vector<uint8_t> bytes(size);
+  for (uint8_t& byte : bytes) byte = uint8_t(distribution(generator));
+  return bytes;
+}
+
+// Vertices with coordinates in [-1000, 1000] (some of them nan) and random
+// colors
+std::vector<uint8_t> random_vertices(size_t num_points) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> distribution(-1000.f, 1000.f);
+
+  std::vector<uint8_t> vertices = random_bytes(num_points * 16, 42);
+  for (size_t i = 0; i < num_points; ++i)
+    for (size_t j = 0; j < 3; ++j) {
+      const float coordinate =
+          i % 1000 == 0 ? std::numeric_limits<float>::quiet_NaN()
+                        : distribution(generator);
+      std::memcpy(vertices.data() + i * 16 + j * 4, &coordinate, 4);
+    }
+  return vertices;
+}
+
+// Values of the given type, which are the same, if both are nan
+bool equal_values(value_type_t type, const uint8_t* a, const uint8_t* b) {
+  if (type == value_type_t::FLOAT32) {
+    float x, y;
+    std::memcpy(&x, a, sizeof(x));
+    std::memcpy(&y, b, sizeof(y));
+    if (std::isnan(x) && std::isnan(y)) return true;
+  } else if (type == value_type_t::FLOAT64) {
+    double x, y;
+    std::memcpy(&x, a, sizeof(x));
+    std::memcpy(&y, b, sizeof(y));
+    if (std::isnan(x) && std::isnan(y)) return true;
+  }
+  return std::memcmp(a, b, size_of(type)) == 0;
+}
+
+// Compares the values at target + i * stride and checks, that the bytes in
+// between weren't touched
+bool equal_strided_values(value_type_t type, const std::vector<uint8_t>& a,
+                          const std::vector<uint8_t>& b, size_t stride) {
+  for (size_t i = 0; i < a.size(); ++i) {
+    const size_t offset = i % stride;
+    if (offset == 0) {
+      if (!equal_values(type, &a[i], &b[i])) return false;
+    } else if (offset >= size_of(type) && a[i] != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool check_convert(const kernels_t& kernels, const char* name) {
+  const kernels_t& scalar = simd::kernels_for(instruction_set_t::SCALAR);
+  bool all_equal = true;
+
+  for (value_type_t source_type : all_value_types)
+    for (value_type_t target_type : all_value_types)
+      for (bool normalized : {false, true})
+        // tightly packed and strided values
+        for (size_t padding : {size_t(0), size_t(3)}) {
+          const size_t source_stride = size_of(source_type) + padding;
+          const size_t target_stride = size_of(target_type) + padding;
+          const std::vector<uint8_t> source =
+              random_bytes(num_checked_values * source_stride, 1);
+          std::vector<uint8_t> expected =
+              random_bytes(num_checked_values * target_stride, 2);
+          std::vector<uint8_t> target = expected;
+
+          scalar.convert(source_type, source.data(), source_stride,
+                         target_type, expected.data(), target_stride,
+                         num_checked_values, normalized);
+          kernels.convert(source_type, source.data(), source_stride,
+                          target_type, target.data(), target_stride,
+                          num_checked_values, normalized);
+
+          if (!equal_strided_values(target_type, expected, target,
+                                    target_stride)) {
+            println_error(name, ": convert from ", name_of(source_type),
+                          " to ", name_of(target_type),
+                          normalized ? " (normalized)" : "", " with stride ",
+                          source_stride, "/", target_stride,
+                          " differs from the scalar kernel");
+            all_equal = false;
+          }
+        }
+
+  return all_equal;
+}
+
+bool check_masked_fill(const kernels_t& kernels, const char* name) {
+  const kernels_t& scalar = simd::kernels_for(instruction_set_t::SCALAR);
+  bool all_equal = true;
+
+  const std::vector<uint8_t> value = random_bytes(16, 3);
+  std::vector<uint8_t> mask = random_bytes(16, 4);
+  for (size_t j = 0; j < mask.size(); j += 3) mask[j] = 0;
+
+  struct layout_t {
+    size_t stride;
+    size_t size;
+  };
+  // vertices and values within a larger record
+  for (layout_t layout : {layout_t{16, 16}, layout_t{24, 12}}) {
+    std::vector<uint8_t> expected =
+        random_bytes(num_checked_values * layout.stride, 5);
+    std::vector<uint8_t> target = expected;
+
+    scalar.masked_fill(expected.data(), layout.stride, num_checked_values,
+                       value.data(), mask.data(), layout.size);
+    kernels.masked_fill(target.data(), layout.stride, num_checked_values,
+                        value.data(), mask.data(), layout.size);
+
+    if (expected != target) {
+      println_error(name, ": masked_fill with stride ", layout.stride,
+                    " differs from the scalar kernel");
+      all_equal = false;
+    }
+  }
+
+  return all_equal;
+}
+
+// Runs the kernel a few times and prints the throughput of the fastest run
+template <typename function_t>
+void benchmark(const char* kernel, size_t num_bytes, const function_t& run) {
+  typedef std::chrono::steady_clock clock_t;
+
+  double best_seconds = std::numeric_limits<double>::infinity();
+  for (int i = 0; i < repetitions; ++i) {
+    const clock_t::time_point start = clock_t::now();
+    run();
+    const std::chrono::duration<double> duration = clock_t::now() - start;
+    best_seconds = std::min(best_seconds, duration.count());
+  }
+
+  println("  ", kernel, ": ", double(num_bytes) / best_seconds * 1.e-9,
+          " GB/s");
+}
+
+void benchmark_kernels(const kernels_t& kernels, size_t num_points) {
+  const std::vector<uint8_t> vertices = random_vertices(num_points);
+  std::vector<uint8_t> target(num_points * 16);
+
+  // extend_bounds of vertices and of coordinates within larger records
+  benchmark("extend_bounds (vertices)", num_points * 16, [&]() {
+    float min_point[3] = {0.f, 0.f, 0.f};
+    float max_point[3] = {0.f, 0.f, 0.f};
+    kernels.extend_bounds(vertices.data(), 16, num_points, min_point,
+                          max_point);
+  });
+  benchmark("extend_bounds (stride 32)", num_points * 16, [&]() {
+    float min_point[3] = {0.f, 0.f, 0.f};
+    float max_point[3] = {0.f, 0.f, 0.f};
+    kernels.extend_bounds(vertices.data(), 32, num_points / 2, min_point,
+                          max_point);
+  });
+
+  benchmark("convert uint16 to float32 (normalized)", num_points * 6, [&]() {
+    kernels.convert(value_type_t::UINT16, vertices.data(), 2,
+                    value_type_t::FLOAT32, target.data(), 4, num_points,
+                    true);
+  });
+  benchmark("convert float64 to int32", num_points / 2 * 12, [&]() {
+    kernels.convert(value_type_t::FLOAT64, vertices.data(), 8,
+                    value_type_t::INT32, target.data(), 4, num_points / 2,
+                    false);
+  });
+  benchmark("convert float32 to uint8 (vertex colors)", num_points * 5,
+            [&]() {
+              kernels.convert(value_type_t::FLOAT32, vertices.data(), 16,
+                              value_type_t::UINT8, target.data() + 12, 16,
+                              num_points, true);
+            });
+
+  const float matrix[12] = {0.f, 1.f, 0.f, -1.f, 0.f, 0.f,
+                            0.f, 0.f, 2.f, 1.f,  2.f, 3.f};
+  benchmark("transform", num_points * 32, [&]() {
+    kernels.transform(matrix, vertices.data(), 16, target.data(), 16,
+                      num_points);
+  });
+
+  // the coordinates of the vertices
+  const uint8_t value[16] = {};
+  const uint8_t mask[16] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+  benchmark("masked_fill (vertices)", num_points * 32, [&]() {
+    kernels.masked_fill(target.data(), 16, num_points, value, mask, 16);
+  });
+  benchmark("masked_fill (stride 32)", num_points / 2 * 24, [&]() {
+    kernels.masked_fill(target.data(), 32, num_points / 2, value, mask, 12);
+  });
+
+  // an image with rows of 1024 rgba pixels
+  const size_t bytes_per_row = 4096;
+  benchmark("flip_rows", num_points * 16 / bytes_per_row * bytes_per_row * 2,
+            [&]() {
+              kernels.flip_rows(target.data(), bytes_per_row,
+                                num_points * 16 / bytes_per_row);
+            });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t num_points =
+      argc > 1 ? size_t(std::stoull(argv[1])) : size_t(1) << 24;
+
+  println("Benchmarking ", num_points, " points (best of ", repetitions,
+          " runs), the viewer uses ",
+          simd::instruction_set_name(simd::instruction_set()));
+
+  bool all_equal = true;
+  for (instruction_set_t instruction_set : all_instruction_sets) {
+    if (!simd::is_supported(instruction_set)) continue;
+
+    const char* name = simd::instruction_set_name(instruction_set);
+    const kernels_t& kernels = simd::kernels_for(instruction_set);
+
+    println(name, ":");
+    benchmark_kernels(kernels, num_points);
+
+    if (instruction_set != instruction_set_t::SCALAR) {
+      all_equal = check_convert(kernels, name) && all_equal;
+      all_equal = check_masked_fill(kernels, name) && all_equal;
+    }
+  }
+
+  return all_equal ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+#include <core_library/thread_pool.hpp>
+#include <pointcloud/exporter/text_exporter.hpp>
+#include <pointcloud/importer/text_importer.hpp>
+#include <tests/check.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+Exports a few points with exactly representable values to ascii ply and xyz
+files and compares them with the expected text. Then a pointcloud of many
+blocks is exported twice (the files must be identical) and imported again, as
+the shortest formatting must parse back to the same values.
+
+The optional argument is the number of threads, so ctest checks the output of
+a single thread as well as the one of all cores.
+
+Returns 1, if a check fails.
+*/
+
+namespace {
+
+// Named after the number of threads, so ctest can run both tests at once
+std::string filename = "text_exporter_test.txt";
+std::string second_filename = "text_exporter_test_2.txt";
+
+typedef data_type::base_type_t type_t;
+typedef TextExporter::format_t format_t;
+
+// Sets the user data of the point from the values converted to the types of
+// the properties
+void set_values(PointCloud* pointcloud, size_t point,
+                const std::vector<double>& values) {
+  for (int i = 0; i < pointcloud->user_data_types.length(); ++i)
+    data_type::write_value_to_buffer<double>(
+        pointcloud->user_data_types[i],
+        pointcloud->user_data.data() + point * pointcloud->user_data_stride +
+            pointcloud->user_data_offset[i],
+        values[size_t(i)]);
+}
+
+// float x, y, z, ushort intensity, char label, double gps_time
+PointCloud empty_pointcloud(size_t num_points) {
+  PointCloud pointcloud;
+  pointcloud.set_user_data_format(
+      23, {"x", "y", "z", "intensity", "label", "gps_time"},
+      {0, 4, 8, 12, 14, 15},
+      {type_t::FLOAT32, type_t::FLOAT32, type_t::FLOAT32, type_t::UINT16,
+       type_t::INT8, type_t::FLOAT64});
+  pointcloud.resize(num_points);
+  pointcloud.aabb = aabb_t::invalid();
+  return pointcloud;
+}
+
+void set_point(PointCloud* pointcloud, size_t point, glm::vec3 coordinate,
+               glm::u8vec3 color, double intensity, double label,
+               double gps_time) {
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(
+      pointcloud->coordinate_color.data());
+  vertices[point] = PointCloud::vertex_t();
+  vertices[point].coordinate = coordinate;
+  vertices[point].color = color;
+  pointcloud->aabb |= coordinate;
+
+  set_values(pointcloud, point,
+             {coordinate.x, coordinate.y, coordinate.z, intensity, label,
+              gps_time});
+}
+
+std::string contents_of_file(const std::string& name) {
+  std::ifstream file(name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+bool export_file(const std::string& name, const PointCloud& pointcloud,
+                 format_t format) {
+  TextExporter exporter(name, pointcloud, format);
+  exporter.export_now();
+  return exporter.state == AbstractPointCloudExporter::SUCCEEDED;
+}
+
+void test_golden_output() {
+  PointCloud pointcloud = empty_pointcloud(3);
+  set_point(&pointcloud, 0, glm::vec3(0.5f, 1.25f, -2.75f),
+            glm::u8vec3(255, 0, 128), 7., -3., 0.125);
+  set_point(&pointcloud, 1, glm::vec3(-0.25f, 0.f, 3.f),
+            glm::u8vec3(1, 2, 3), 65535., 127., 1000.5);
+  set_point(&pointcloud, 2, glm::vec3(1.5f, -1.f, 0.75f),
+            glm::u8vec3(0, 0, 0), 0., -128., -2.75);
+  // added to the coordinates and the properties x and z
+  pointcloud.origin = glm::dvec3(1000., 0., -2.);
+
+  check(export_file(filename, pointcloud, format_t::PLY), "export ply");
+  check(contents_of_file(filename) ==
+            "ply\n"
+            "format ascii 1.0\n"
+            "element vertex 3\n"
+            "property float x\n"
+            "property float y\n"
+            "property float z\n"
+            "property ushort intensity\n"
+            "property char label\n"
+            "property double gps_time\n"
+            "end_header\n"
+            "1000.5 1.25 -4.75 7 -3 0.125\n"
+            "999.75 0 1 65535 127 1000.5\n"
+            "1001.5 -1 -1.25 0 -128 -2.75\n",
+        "ascii ply text");
+
+  check(export_file(filename, pointcloud, format_t::XYZ), "export xyz");
+  check(contents_of_file(filename) ==
+            "1000.5 1.25 -4.75 255 0 128\n"
+            "999.75 0 1 1 2 3\n"
+            "1001.5 -1 -1.25 0 0 0\n",
+        "xyz text");
+}
+
+// Random values, most of them needing all digits
+PointCloud random_pointcloud() {
+  const size_t num_points = 100000;
+
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> coordinate(-100.f, 100.f);
+  std::uniform_real_distribution<double> gps_time(0., 1.e6);
+  std::uniform_int_distribution<int> byte(0, 255);
+
+  PointCloud pointcloud = empty_pointcloud(num_points);
+  for (size_t i = 0; i < num_points; ++i)
+    set_point(&pointcloud, i,
+              glm::vec3(coordinate(generator), coordinate(generator),
+                        coordinate(generator)),
+              glm::u8vec3(byte(generator), byte(generator), byte(generator)),
+              byte(generator) * 257., byte(generator) - 128.,
+              gps_time(generator));
+  return pointcloud;
+}
+
+// Returns an empty pointcloud, if the import failed
+PointCloud import_file(TextImporter::format_t format) {
+  TextImporter importer(filename, format);
+  importer.import();
+
+  if (importer.state != AbstractPointCloudImporter::SUCCEEDED)
+    return PointCloud();
+  return std::move(importer.pointcloud);
+}
+
+void test_round_trip() {
+  const PointCloud original = random_pointcloud();
+
+  check(export_file(filename, original, format_t::PLY) &&
+            export_file(second_filename, original, format_t::PLY),
+        "export many blocks");
+  check(contents_of_file(filename) == contents_of_file(second_filename),
+        "same text of every export");
+
+  const PointCloud ply = import_file(TextImporter::format_t::PLY);
+  check(ply.num_points == original.num_points &&
+            ply.user_data_stride == original.user_data_stride &&
+            std::memcmp(ply.user_data.data(), original.user_data.data(),
+                        original.user_data.size()) == 0,
+        "values of the ascii ply file");
+
+  check(export_file(filename, original, format_t::XYZ), "export xyz");
+  const PointCloud xyz = import_file(TextImporter::format_t::XYZ);
+  bool vertices_equal = xyz.num_points == original.num_points;
+  for (size_t i = 0; vertices_equal && i < xyz.num_points; ++i)
+    vertices_equal =
+        xyz.vertex(i).coordinate == original.vertex(i).coordinate &&
+        xyz.vertex(i).color == original.vertex(i).color;
+  check(vertices_equal, "vertices of the xyz file");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1) {
+    thread_pool::set_num_threads(size_t(std::stoull(argv[1])));
+    filename = std::string("text_exporter_test_") + argv[1] + ".txt";
+    second_filename = std::string("text_exporter_test_") + argv[1] + "_2.txt";
+  }
+
+  test_golden_output();
+  test_round_trip();
+
+  std::remove(filename.c_str());
+  std::remove(second_filename.c_str());
+
+  return exit_code();
+}